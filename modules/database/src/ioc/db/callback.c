@@ -26,9 +26,10 @@
 #include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsInterrupt.h"
-#include "epicsRingPointer.h"
+#include "epicsSpin.h"
 #include "epicsString.h"
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "epicsTimer.h"
 #include "errlog.h"
 #include "errMdef.h"
@@ -40,6 +41,7 @@
 #include "dbBase.h"
 #include "dbCommon.h"
 #include "dbFldTypes.h"
+#include "dbLatencyPvt.h"
 #include "dbLock.h"
 #include "dbStaticLib.h"
 #include "epicsExport.h"
@@ -50,19 +52,57 @@
 
 static int callbackQueueSize = 2000;
 
+/* Most requests queued for one priority before callbackRequest() fails */
+int callbackQueueMaxSize = 100000;
+epicsExportAddress(int,callbackQueueMaxSize);
+
+int callbackLatencyTiming = 0;
+epicsExportAddress(int,callbackLatencyTiming);
+
+/* Each callback thread has its own queue, which it runs in FIFO order.
+ * A thread with nothing to do takes requests from the other queues of
+ * its priority.  Queues grow while the total for the priority stays
+ * under callbackQueueMaxSize, except in interrupt context.
+ */
+typedef struct cbEntry {
+    epicsCallback *pcallback;
+    epicsUInt64 queued;     /* epicsMonotonicGet(), 0 if not timed */
+} cbEntry;
+
+typedef struct cbWorker {
+    struct cbQueueSet *set;
+    epicsSpinId lock;       /* guards ring, size, head, count and latency */
+    cbEntry *ring;
+    unsigned size;
+    unsigned head;
+    unsigned count;
+    epicsEventId wake;
+    int idle;               /* waiting for wake, use atomic */
+    size_t nRun;            /* requests run by this thread */
+    size_t nStolen;         /* of those, taken from another queue */
+    dbLatency latency;      /* of the requests run by this thread */
+} cbWorker;
+
 typedef struct cbQueueSet {
-    epicsEventId semWakeUp;
-    epicsRingPointerId queue;
     int queueOverflow;
     int queueOverflows;
     int shutdown; // use atomic
     int threadsConfigured;
     int threadsRunning;
     epicsThreadId *threads;
+    cbWorker *workers;
+    size_t nextWorker;      /* round robin for other threads, use atomic */
+    int nIdle;              /* workers waiting, use atomic */
+    int numUsed;            /* requests queued, use atomic */
+    int maxUsed;
+    int capacity;           /* sum of worker queue sizes, use atomic */
 } cbQueueSet;
 
 static cbQueueSet callbackQueue[NUM_CALLBACK_PRIORITIES];
 
+/* The cbWorker of each callback thread */
+static epicsThreadPrivateId workerId;
+
 int callbackThreadsDefault = 1;
 /* Don't know what a reasonable default is (yet).
  * For the time being: parallel means 2 if not explicitly specified */
@@ -86,7 +126,7 @@ static epicsEventId startStopEvent;
 static char *threadNamePrefix[NUM_CALLBACK_PRIORITIES] = {
     "cbLow", "cbMedium", "cbHigh"
 };
-#define FULL_MSG(name) "callbackRequest: " ERL_ERROR " " name " ring buffer full\n"
+#define FULL_MSG(name) "callbackRequest: " ERL_ERROR " " name " queue full\n"
 static char *fullMessage[NUM_CALLBACK_PRIORITIES] = {
     FULL_MSG("cbLow"), FULL_MSG("cbMedium"), FULL_MSG("cbHigh")
 };
@@ -95,7 +135,6 @@ static unsigned int threadPriority[NUM_CALLBACK_PRIORITIES] = {
     epicsThreadPriorityScanLow + 4,
     epicsThreadPriorityScanHigh + 1
 };
-static int priorityValue[NUM_CALLBACK_PRIORITIES] = {0, 1, 2};
 
 
 int callbackSetQueueSize(int size)
@@ -116,10 +155,10 @@ int callbackQueueStatus(const int reset, callbackQueueStats *result)
         int prio;
         result->size = callbackQueueSize;
         for(prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-            epicsRingPointerId qId = callbackQueue[prio].queue;
-            result->numUsed[prio] = epicsRingPointerGetUsed(qId);
-            result->maxUsed[prio] = epicsRingPointerGetHighWaterMark(qId);
-            result->numOverflow[prio] = epicsAtomicGetIntT(&callbackQueue[prio].queueOverflows);
+            cbQueueSet *mySet = &callbackQueue[prio];
+            result->numUsed[prio] = epicsAtomicGetIntT(&mySet->numUsed);
+            result->maxUsed[prio] = epicsAtomicGetIntT(&mySet->maxUsed);
+            result->numOverflow[prio] = epicsAtomicGetIntT(&mySet->queueOverflows);
         }
         ret = 0;
     } else {
@@ -128,12 +167,55 @@ int callbackQueueStatus(const int reset, callbackQueueStats *result)
     if (reset) {
         int prio;
         for(prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-            epicsRingPointerResetHighWaterMark(callbackQueue[prio].queue);
+            cbQueueSet *mySet = &callbackQueue[prio];
+            epicsAtomicSetIntT(&mySet->maxUsed,
+                epicsAtomicGetIntT(&mySet->numUsed));
         }
     }
     return ret;
 }
 
+int callbackLatencyStatus(int priority, const int reset,
+    callbackLatencyStats *result)
+{
+    cbQueueSet *mySet;
+    dbLatency sum;
+    int i;
+
+    if (epicsAtomicGetIntT(&cbState)==cbInit) return -1;
+    if (priority < 0 || priority >= NUM_CALLBACK_PRIORITIES) return -2;
+    mySet = &callbackQueue[priority];
+
+    memset(&sum, 0, sizeof(sum));
+    for (i = 0; i < mySet->threadsConfigured; i++) {
+        cbWorker *pw = &mySet->workers[i];
+
+        epicsSpinLock(pw->lock);
+        dbLatencyMerge(&sum, &pw->latency);
+        if (reset)
+            memset(&pw->latency, 0, sizeof(pw->latency));
+        epicsSpinUnlock(pw->lock);
+    }
+    if (result) {
+        result->count = sum.count;
+        result->mean = sum.count ? sum.sum / sum.count : 0.0;
+        result->p50 = dbLatencyPercentile(sum.histogram, sum.count, sum.max,
+            0.50);
+        result->p99 = dbLatencyPercentile(sum.histogram, sum.count, sum.max,
+            0.99);
+        result->max = sum.max;
+        result->nWorst = sum.nWorst;
+        for (i = 0; i < sum.nWorst; i++) {
+            result->worst[i].callback = (CALLBACKFUNC)sum.worst[i].key;
+            result->worst[i].user = (void *)sum.worst[i].user;
+            result->worst[i].time = sum.worst[i].time;
+        }
+    }
+    return 0;
+}
+
+static void ProcessCallback(epicsCallback *pcallback);
+
 void callbackQueueShow(const int reset)
 {
     callbackQueueStats stats;
@@ -142,14 +224,59 @@ void callbackQueueShow(const int reset)
             "iocInit before using this command.\n");
     } else {
         int prio;
-        printf("PRIORITY  HIGH-WATER MARK  ITEMS IN Q  Q SIZE  %% USED  Q OVERFLOWS\n");
+        int limit = callbackQueueMaxSize;
+
+        printf("PRIORITY  HIGH-WATER MARK  ITEMS IN Q  Q SIZE  Q LIMIT  %% USED  Q OVERFLOWS\n");
         for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-            double qusage = 100.0 * stats.numUsed[prio] / stats.size;
-            printf("%8s  %15d  %10d  %6d  %6.1f  %11d\n",
+            /* requests only fail at the limit */
+            double qusage = limit > 0 ? 100.0 * stats.numUsed[prio] / limit : 0.0;
+            printf("%8s  %15d  %10d  %6d  %7d  %6.1f  %11d\n",
                    threadNamePrefix[prio], stats.maxUsed[prio],
-                   stats.numUsed[prio], stats.size, qusage,
+                   stats.numUsed[prio], stats.size, limit, qusage,
                    stats.numOverflow[prio]);
         }
+        printf("    THREAD  ITEMS IN Q  Q ALLOCATED  CALLBACKS RUN  STOLEN\n");
+        for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
+            cbQueueSet *mySet = &callbackQueue[prio];
+            int j;
+
+            for (j = 0; j < mySet->threadsConfigured; j++) {
+                cbWorker *pw = &mySet->workers[j];
+                unsigned count, size;
+                char name[32];
+
+                epicsSpinLock(pw->lock);
+                count = pw->count;
+                size = pw->size;
+                epicsSpinUnlock(pw->lock);
+                sprintf(name, "%s-%d", threadNamePrefix[prio], j);
+                printf("%10s  %10u  %11u  %13lu  %6lu\n", name, count, size,
+                       (unsigned long)epicsAtomicGetSizeT(&pw->nRun),
+                       (unsigned long)epicsAtomicGetSizeT(&pw->nStolen));
+            }
+        }
+        printf("PRIORITY  REQUESTS TIMED  MEAN WAIT  P50 WAIT  P99 WAIT  MAX WAIT\n");
+        for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
+            callbackLatencyStats lat;
+            int j;
+
+            callbackLatencyStatus(prio, reset, &lat);
+            printf("%8s  %14lu  %9.6f  %8.6f  %8.6f  %8.6f\n",
+                   threadNamePrefix[prio], lat.count, lat.mean, lat.p50,
+                   lat.p99, lat.max);
+            for (j = 0; j < lat.nWorst; j++) {
+                printf("          %.6f  ", lat.worst[j].time);
+                if (lat.worst[j].callback == ProcessCallback &&
+                    lat.worst[j].user)
+                    printf("process %s\n",
+                           ((dbCommon *)lat.worst[j].user)->name);
+                else
+                    printf("callback %p  user %p\n",
+                           (void *)lat.worst[j].callback, lat.worst[j].user);
+            }
+        }
+        if (!callbackLatencyTiming)
+            printf("Set callbackLatencyTiming=1 to time queued requests\n");
     }
 }
 
@@ -203,26 +330,118 @@ found:
     return 0;
 }
 
+/* Take the oldest request from a worker's queue */
+static int workerPop(cbWorker *pw, cbEntry *pent)
+{
+    int found = 0;
+
+    epicsSpinLock(pw->lock);
+    if (pw->count) {
+        *pent = pw->ring[pw->head];
+        pw->head = (pw->head + 1) % pw->size;
+        pw->count--;
+        found = 1;
+    }
+    epicsSpinUnlock(pw->lock);
+    return found;
+}
+
+/* Add a request to a worker's queue, growing it if allowed */
+static int workerPush(cbWorker *pw, const cbEntry *pent)
+{
+    cbQueueSet *mySet = pw->set;
+    int used;
+
+    if (epicsAtomicGetIntT(&mySet->numUsed) >= callbackQueueMaxSize)
+        return 0;
+
+    epicsSpinLock(pw->lock);
+    while (pw->count == pw->size) {
+        unsigned size = pw->size;
+        cbEntry *ring, *old = NULL;
+        unsigned i;
+
+        epicsSpinUnlock(pw->lock);
+        if (epicsInterruptIsInterruptContext() ||
+            epicsAtomicGetIntT(&mySet->capacity) + (int)size >
+                callbackQueueMaxSize)
+            return 0;
+        ring = malloc(2 * size * sizeof(*ring));
+        if (!ring)
+            return 0;
+
+        epicsSpinLock(pw->lock);
+        if (pw->size == size) {
+            for (i = 0; i < pw->count; i++)
+                ring[i] = pw->ring[(pw->head + i) % size];
+            old = pw->ring;
+            pw->ring = ring;
+            pw->size = 2 * size;
+            pw->head = 0;
+            epicsAtomicAddIntT(&mySet->capacity, size);
+        }
+        else {
+            old = ring; /* another thread grew it */
+        }
+        epicsSpinUnlock(pw->lock);
+        free(old);
+        epicsSpinLock(pw->lock);
+    }
+    pw->ring[(pw->head + pw->count) % pw->size] = *pent;
+    pw->count++;
+    epicsSpinUnlock(pw->lock);
+
+    used = epicsAtomicIncrIntT(&mySet->numUsed);
+    if (used > epicsAtomicGetIntT(&mySet->maxUsed))
+        epicsAtomicSetIntT(&mySet->maxUsed, used);
+    return 1;
+}
+
 static void callbackTask(void *arg)
 {
-    int prio = *(int*)arg;
-    cbQueueSet *mySet = &callbackQueue[prio];
+    cbWorker *pw = (cbWorker *)arg;
+    cbQueueSet *mySet = pw->set;
+    const int nWorkers = mySet->threadsConfigured;
+    const int me = (int)(pw - mySet->workers);
 
     taskwdInsert(0, NULL, NULL);
+    epicsThreadPrivateSet(workerId, pw);
     epicsEventSignal(startStopEvent);
 
     while(!epicsAtomicGetIntT(&mySet->shutdown)) {
-        void *ptr;
-        if (epicsRingPointerIsEmpty(mySet->queue))
-            epicsEventMustWait(mySet->semWakeUp);
-
-        while ((ptr = epicsRingPointerPop(mySet->queue))) {
-            epicsCallback *pcallback = (epicsCallback *)ptr;
-            if(!epicsRingPointerIsEmpty(mySet->queue))
-                epicsEventMustTrigger(mySet->semWakeUp);
-            mySet->queueOverflow = FALSE;
-            (*pcallback->callback)(pcallback);
+        cbEntry ent;
+        epicsCallback *pcallback;
+        int found = workerPop(pw, &ent);
+        int i;
+
+        for (i = 1; !found && i < nWorkers; i++) {
+            found = workerPop(&mySet->workers[(me + i) % nWorkers], &ent);
+            if (found)
+                epicsAtomicIncrSizeT(&pw->nStolen);
         }
+        if (!found) {
+            epicsAtomicSetIntT(&pw->idle, 1);
+            epicsAtomicIncrIntT(&mySet->nIdle);
+            epicsEventMustWait(pw->wake);
+            epicsAtomicDecrIntT(&mySet->nIdle);
+            epicsAtomicSetIntT(&pw->idle, 0);
+            continue;
+        }
+
+        pcallback = ent.pcallback;
+        if (ent.queued) {
+            double wait = dbLatencySince(ent.queued);
+
+            epicsSpinLock(pw->lock);
+            dbLatencyAdd(&pw->latency, wait, (const void *)pcallback->callback,
+                pcallback->user);
+            epicsSpinUnlock(pw->lock);
+        }
+
+        epicsAtomicDecrIntT(&mySet->numUsed);
+        mySet->queueOverflow = FALSE;
+        epicsAtomicIncrSizeT(&pw->nRun);
+        (*pcallback->callback)(pcallback);
     }
 
     if(!epicsAtomicDecrIntT(&mySet->threadsRunning))
@@ -237,8 +456,12 @@ void callbackStop(void)
     if (epicsAtomicCmpAndSwapIntT(&cbState, cbRun, cbStop)!=cbRun) return;
 
     for (i = 0; i < NUM_CALLBACK_PRIORITIES; i++) {
-        epicsAtomicSetIntT(&callbackQueue[i].shutdown, 1);
-        epicsEventSignal(callbackQueue[i].semWakeUp);
+        cbQueueSet *mySet = &callbackQueue[i];
+        int j;
+
+        epicsAtomicSetIntT(&mySet->shutdown, 1);
+        for (j = 0; j < mySet->threadsConfigured; j++)
+            epicsEventSignal(mySet->workers[j].wake);
     }
 
     for (i = 0; i < NUM_CALLBACK_PRIORITIES; i++) {
@@ -246,7 +469,8 @@ void callbackStop(void)
         int j;
 
         while (epicsAtomicGetIntT(&mySet->threadsRunning)) {
-            epicsEventSignal(mySet->semWakeUp);
+            for (j = 0; j < mySet->threadsConfigured; j++)
+                epicsEventSignal(mySet->workers[j].wake);
             epicsEventWaitWithTimeout(startStopEvent, 0.1);
         }
         for(j=0; j<mySet->threadsConfigured; j++) {
@@ -265,12 +489,18 @@ void callbackCleanup(void)
 
     for (i = 0; i < NUM_CALLBACK_PRIORITIES; i++) {
         cbQueueSet *mySet = &callbackQueue[i];
+        int j;
 
         assert(epicsAtomicGetIntT(&mySet->threadsRunning)==0);
-        epicsEventDestroy(mySet->semWakeUp);
-        mySet->semWakeUp = NULL;
-        epicsRingPointerDelete(mySet->queue);
-        mySet->queue = NULL;
+        for (j = 0; j < mySet->threadsConfigured; j++) {
+            cbWorker *pw = &mySet->workers[j];
+
+            epicsEventDestroy(pw->wake);
+            epicsSpinDestroy(pw->lock);
+            free(pw->ring);
+        }
+        free(mySet->workers);
+        mySet->workers = NULL;
         free(mySet->threads);
         mySet->threads = NULL;
     }
@@ -293,16 +523,14 @@ void callbackInit(void)
     if(!startStopEvent)
         startStopEvent = epicsEventMustCreate(epicsEventEmpty);
 
+    if(!workerId)
+        workerId = epicsThreadPrivateCreate();
+
     timerQueue = epicsTimerQueueAllocate(0, epicsThreadPriorityScanHigh);
 
     for (i = 0; i < NUM_CALLBACK_PRIORITIES; i++) {
         epicsThreadId tid;
 
-        callbackQueue[i].semWakeUp = epicsEventMustCreate(epicsEventEmpty);
-        callbackQueue[i].queue = epicsRingPointerLockedCreate(callbackQueueSize);
-        if (callbackQueue[i].queue == 0)
-            cantProceed("epicsRingPointerLockedCreate failed for %s\n",
-                threadNamePrefix[i]);
         callbackQueue[i].queueOverflow = FALSE;
 
         if (callbackQueue[i].threadsConfigured == 0)
@@ -311,6 +539,21 @@ void callbackInit(void)
         callbackQueue[i].threads = callocMustSucceed(callbackQueue[i].threadsConfigured,
                                                      sizeof(*callbackQueue[i].threads),
                                                      "callbackInit");
+        callbackQueue[i].workers = callocMustSucceed(callbackQueue[i].threadsConfigured,
+                                                     sizeof(*callbackQueue[i].workers),
+                                                     "callbackInit");
+
+        for (j = 0; j < callbackQueue[i].threadsConfigured; j++) {
+            cbWorker *pw = &callbackQueue[i].workers[j];
+
+            pw->set = &callbackQueue[i];
+            pw->lock = epicsSpinMustCreate();
+            pw->size = callbackQueueSize > 0 ? callbackQueueSize : 1;
+            pw->ring = callocMustSucceed(pw->size, sizeof(*pw->ring),
+                                         "callbackInit");
+            pw->wake = epicsEventMustCreate(epicsEventEmpty);
+            callbackQueue[i].capacity += pw->size;
+        }
 
         for (j = 0; j < callbackQueue[i].threadsConfigured; j++) {
             epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
@@ -322,7 +565,7 @@ void callbackInit(void)
             else
                 strcpy(threadName, threadNamePrefix[i]);
             callbackQueue[i].threads[j] = tid = epicsThreadCreateOpt(threadName,
-                (EPICSTHREADFUNC)callbackTask, &priorityValue[i], &opts);
+                (EPICSTHREADFUNC)callbackTask, &callbackQueue[i].workers[j], &opts);
             if (tid == 0) {
                 cantProceed("Failed to spawn callback thread %s\n", threadName);
             } else {
@@ -338,7 +581,10 @@ int callbackRequest(epicsCallback *pcallback)
 {
     int priority;
     int pushOK;
+    int isr;
     cbQueueSet *mySet;
+    cbWorker *pw;
+    cbEntry ent;
 
     if (!pcallback) {
         epicsInterruptContextMessage("callbackRequest: " ERL_ERROR " pcallback was NULL\n");
@@ -354,13 +600,27 @@ int callbackRequest(epicsCallback *pcallback)
         return S_db_badChoice;
     }
     mySet = &callbackQueue[priority];
-    if (!mySet->queue) {
+    if (!mySet->workers) {
         epicsInterruptContextMessage("callbackRequest: " ERL_ERROR " Callbacks not initialized\n");
         return S_db_notInit;
     }
     if (mySet->queueOverflow) return S_db_bufFull;
 
-    pushOK = epicsRingPointerPush(mySet->queue, pcallback);
+    /* A callback thread queues for itself, others share them out */
+    pw = NULL;
+    isr = epicsInterruptIsInterruptContext();
+    if (!isr) {
+        pw = (cbWorker *)epicsThreadPrivateGet(workerId);
+        if (pw && pw->set != mySet)
+            pw = NULL;
+    }
+    if (!pw)
+        pw = &mySet->workers[epicsAtomicIncrSizeT(&mySet->nextWorker) %
+            (size_t)mySet->threadsConfigured];
+
+    ent.pcallback = pcallback;
+    ent.queued = callbackLatencyTiming && !isr ? epicsMonotonicGet() : 0;
+    pushOK = workerPush(pw, &ent);
 
     if (!pushOK) {
         epicsInterruptContextMessage(fullMessage[priority]);
@@ -368,7 +628,19 @@ int callbackRequest(epicsCallback *pcallback)
         epicsAtomicIncrIntT(&mySet->queueOverflows);
         return S_db_bufFull;
     }
-    epicsEventSignal(mySet->semWakeUp);
+    epicsEventSignal(pw->wake);
+
+    /* That thread is busy, so wake an idle one to take the request */
+    if (!epicsAtomicGetIntT(&pw->idle) && epicsAtomicGetIntT(&mySet->nIdle)) {
+        int j;
+
+        for (j = 0; j < mySet->threadsConfigured; j++) {
+            if (epicsAtomicGetIntT(&mySet->workers[j].idle)) {
+                epicsEventSignal(mySet->workers[j].wake);
+                break;
+            }
+        }
+    }
     return 0;
 }
 
@@ -52,12 +52,32 @@ typedef epicsCallback CALLBACK;
 typedef void    (*CALLBACKFUNC)(struct callbackPvt*);
 
 typedef struct callbackQueueStats {
-    int size;
+    int size;   /* initial queue size, see callbackSetQueueSize() */
     int numUsed[NUM_CALLBACK_PRIORITIES];
     int maxUsed[NUM_CALLBACK_PRIORITIES];
     int numOverflow[NUM_CALLBACK_PRIORITIES];
 } callbackQueueStats;
 
+#define CALLBACK_STATS_WORST 5
+
+/* Time requests spent queued, see callbackLatencyStatus().
+ * Times are in seconds.  The percentiles are upper limits of
+ * histogram buckets, which are about 20% wide.
+ */
+typedef struct callbackLatencyStats {
+    unsigned long count;    /* requests timed since reset */
+    double mean;
+    double p50;
+    double p99;
+    double max;
+    int nWorst;
+    struct {
+        CALLBACKFUNC callback;
+        void *user;
+        double time;        /* longest wait of this callback and user */
+    } worst[CALLBACK_STATS_WORST];
+} callbackLatencyStats;
+
 #define callbackSetCallback(PFUN, PCALLBACK) \
     ( (PCALLBACK)->callback = (PFUN) )
 #define callbackSetPriority(PRIORITY, PCALLBACK) \
@@ -69,6 +89,11 @@ typedef struct callbackQueueStats {
 #define callbackGetUser(USER, PCALLBACK) \
     ( (USER) = (PCALLBACK)->user )
 
+/* Most requests queued for each priority, see callbackQueueShow() */
+DBCORE_API extern int callbackQueueMaxSize;
+/* Set non-zero to time requests from callbackRequest() until they run */
+DBCORE_API extern int callbackLatencyTiming;
+
 DBCORE_API void callbackInit(void);
 DBCORE_API void callbackStop(void);
 DBCORE_API void callbackCleanup(void);
@@ -84,6 +109,8 @@ DBCORE_API void callbackRequestProcessCallbackDelayed(
     epicsCallback *pCallback, int Priority, void *pRec, double seconds);
 DBCORE_API int callbackSetQueueSize(int size);
 DBCORE_API int callbackQueueStatus(const int reset, callbackQueueStats *result);
+DBCORE_API int callbackLatencyStatus(int priority, const int reset,
+    callbackLatencyStats *result);
 DBCORE_API void callbackQueueShow(const int reset);
 DBCORE_API int callbackParallelThreads(int count, const char *prio);
 
@@ -53,6 +53,7 @@
 #include "dbNotify.h"
 #include "dbScan.h"
 #include "dbServer.h"
+#include "dbSnapshotPvt.h"
 #include "dbStaticLib.h"
 #include "dbStaticPvt.h"
 #include "devSup.h"
@@ -616,6 +617,8 @@ long dbProcess(dbCommon *precord)
     }
 
 all_done:
+    if (precord->snap)
+        dbSnapshotUpdate(precord);
     if (set_trace)
         *ptrace = 0;
     if (callNotifyCompletion && precord->ppn)
@@ -800,7 +803,7 @@ int dbLoadRecords(const char* file, const char* subs)
         printf("Usage: dbLoadRecords \"file\", \"subs\"\n");
         return -1;
     }
-    status = dbReadDatabase(&pdbbase, file, 0, subs);
+    status = dbReadDatabaseCached(&pdbbase, file, 0, subs);
     if(status==0) {
         if(dbLoadRecordsHook)
             dbLoadRecordsHook(file, subs);
@@ -1383,6 +1386,9 @@ long dbPut(DBADDR *paddr, short dbrType,
     }
     if (status) goto done;
 
+    if (precord->snap)
+        dbSnapshotUpdate(precord);
+
     /* Propagate monitor events for this field, */
     /* unless the field is VAL and PP is true. */
     pfldDes = paddr->pfldDes;
@@ -29,6 +29,8 @@ extern "C" {
 DBCORE_API extern struct dbBase *pdbbase;
 DBCORE_API extern volatile int interruptAccept;
 DBCORE_API extern int dbAccessDebugPUTF;
+/* Set before iocInit to let CA read scalar VAL fields without locking */
+DBCORE_API extern int dbReadSnapshots;
 
 /*  The database field and request types are defined in dbFldTypes.h*/
 /* Data Base Request Options    */
@@ -48,23 +48,26 @@ typedef struct evSubscrip evSubscrip;
 #ifdef EPICS_PRIVATE_API
 struct evSubscrip {
     ELLNODE             node;
+    /* this node added to the list for the field in dbCommon::mlix */
+    ELLNODE             fnode;
     struct dbChannel  * chan;
     /* user_sub==NULL used to indicate db_cancel_event() */
     EVENTFUNC         * user_sub;
     void              * user_arg;
     /* associated queue, may be shared with other evSubscrip */
     struct event_que  * ev_que;
-    /* NULL if !npend.  if npend!=0, pointer to last event added to event_que::valque */
-    db_field_log     ** pLastLog;
-    /* n times this event is on the queue */
-    unsigned long       npend;
+    /* ring and position of the last event added to the queue, valid if npend!=0 */
+    struct event_ring * pLastRing;
+    size_t              lastPos;
+    /* n times this event is on the queue (atomic) */
+    size_t              npend;
     /* n times replacing event on the queue */
     unsigned long       nreplace;
     /* DBE mask */
     unsigned char       select;
     /* if set, subscription will yield dbfl_type_val */
     char                useValque;
-    /* event_task is handling this subscription */
+    /* n events of this subscription being handled by event_task */
     char                callBackInProgress;
     /* this node added to dbCommon::mlis */
     char                enabled;
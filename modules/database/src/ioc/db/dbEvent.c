@@ -31,9 +31,11 @@
 #include "cantProceed.h"
 #include "dbDefs.h"
 #include "epicsAssert.h"
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsThread.h"
+#include "epicsExport.h"
 #include "errlog.h"
 #include "freeList.h"
 #include "taskwd.h"
@@ -61,24 +63,72 @@
 #define EVENTSPERQUE    36
 #define EVENTENTRIES    4      /* the number of que entries for each event */
 #define EVENTQUESIZE    (EVENTENTRIES  * EVENTSPERQUE)
-#define EVENTQEMPTY     ((struct evSubscrip *)NULL)
+#define EVENTBATCH      32     /* events taken from a ring per lock */
+
+/* Defaults for new event users, see db_event_queue_config() */
+int dbEventQueueEntries = EVENTENTRIES;
+int dbEventQueueMaxSize = 8192;
+epicsExportAddress(int, dbEventQueueEntries);
+epicsExportAddress(int, dbEventQueueMaxSize);
+
+/*
+ * One entry of an event_ring.  The sequence number tells who owns it:
+ * a producer may claim the entry at position pos when seq == pos, the
+ * entry holds a published event once seq == pos + 1, and the consumer
+ * returns it to producers for position pos + size.
+ */
+struct event_ent {
+    size_t                  seq;
+    struct evSubscrip       *pevent;
+    db_field_log            *pfl;
+};
+
+/*
+ * Bounded ring of events.  Threads posting events (one per lock set)
+ * claim entries by advancing tail without taking any lock.  The event
+ * task consumes from head.  Positions are free running counters, which
+ * are only ever compared by their difference.
+ *
+ * A ring is never resized.  When the event_que needs more room a larger
+ * ring replaces it, and the old one is retired by moving its tail out
+ * of reach of posting threads.  The event task empties a retired ring
+ * up to end before moving on to next.  Posting threads may still hold
+ * a pointer to a retired ring, so it is kept until the queue is freed.
+ */
+struct event_ring {
+    struct event_ring       *next;          /* replacement, once retired */
+    size_t                  tail;           /* next position to claim */
+    size_t                  head;           /* next position to consume */
+    size_t                  end;            /* tail when retired */
+    unsigned                size;           /* a power of 2 */
+    unsigned char           retired;
+    struct event_ent        ent[1];
+};
 
 /*
- * really a ring buffer
+ * The ring is allocated when the first subscription is added, with room
+ * for EVENTSPERQUE subscriptions, and doubles in size as more are added
+ * until it reaches the maximum size set for the event user.  Only then
+ * are further subscriptions placed on another event_que.
  */
 struct event_que {
-    /* lock writers to the ring buffer only */
-    /* readers must never slow up writers */
+    /* Serializes the event task, ring replacement and posting threads
+     * which must replace an event already in the ring.  Adding an event
+     * to the ring does not need it.
+     */
     epicsMutexId            writelock;
-    db_field_log            *valque[EVENTQUESIZE];
-    struct evSubscrip       *evque[EVENTQUESIZE];
+    struct event_ring       *ring;          /* posting threads add here */
+    struct event_ring       *readRing;      /* oldest ring with events */
+    struct event_ring       *firstRing;     /* all rings, chained by next */
     struct event_que        *nextque;       /* in case que quota exceeded */
     struct event_user       *evUser;        /* event user parent struct */
-    unsigned short          putix;
-    unsigned short          getix;
-    unsigned short          quota;          /* the number of assigned entries*/
-    unsigned short          nDuplicates;    /* N events duplicated on this q */
+    unsigned                size;           /* entries in ring */
+    unsigned                perEvent;       /* entries reserved per event */
+    unsigned                quota;          /* the number of assigned entries*/
+    size_t                  nDuplicates;    /* N events duplicated on this q */
+    size_t                  highWater;      /* most entries ever in use */
     unsigned                possibleStall;
+    unsigned long           nOverflow;      /* events replaced for lack of space */
 };
 
 struct event_user {
@@ -93,13 +143,19 @@ struct event_user {
     EXTRALABORFUNC      *extralabor_sub;/* off load to event task */
     void                *extralabor_arg;/* parameter to above */
 
+    EXTRALABORFUNC      *wakeup_sub;    /* notify external event servicing */
+    void                *wakeup_arg;    /* parameter to above */
+
     epicsThreadId       taskid;         /* event handler task id */
     epicsUInt32         pflush_seq;     /* worker cycle count for synchronization */
     unsigned            queovr;         /* event que overflow count */
+    unsigned            queEntries;     /* event_que::perEvent for new rings */
+    unsigned            queMaxSize;     /* largest ring size */
     unsigned char       pendexit;       /* exit pend task */
     unsigned char       extra_labor;    /* if set call extra labor func */
     unsigned char       flowCtrlMode;   /* replace existing monitor */
     unsigned char       extraLaborBusy;
+    unsigned char       external;       /* serviced by db_process_events() */
     void                (*init_func)(void *);
     void                *init_func_arg;
 };
@@ -109,15 +165,30 @@ typedef struct {
     epicsEventId wake;
 } event_waiter;
 
+/*
+ * The enabled subscriptions of a record grouped by field, so posting one
+ * field only visits the subscriptions to that field.  Buckets are kept
+ * sorted by field address, and stay when they become empty until the
+ * record is freed.  Protected by dbCommon::mlok.
+ */
+typedef struct {
+    void            *pField;
+    ELLLIST         subs;           /* evSubscrip::fnode */
+    unsigned char   select;         /* union of the subscription masks */
+} monitorBucket;
+
+struct dbMonitorIndex {
+    unsigned        count;          /* buckets in use */
+    unsigned        size;           /* buckets allocated */
+    monitorBucket   bucket[1];
+};
+
 /*
  * Reliable intertask communication requires copying the current value of the
  * channel for later queuing so 3 stepper motor steps of 10 each do not turn
  * into only 10 or 20 total steps part of the time.
  */
 
-#define RNGINC(OLD)\
-( (unsigned short) ( (OLD) >= (EVENTQUESIZE-1) ? 0 : (OLD)+1 ) )
-
 #define LOCKEVQUE(EV_QUE)   epicsMutexMustLock((EV_QUE)->writelock)
 #define UNLOCKEVQUE(EV_QUE) epicsMutexUnlock((EV_QUE)->writelock)
 #define LOCKREC(RECPTR)     epicsMutexMustLock((RECPTR)->mlok)
@@ -132,20 +203,219 @@ static char *EVENT_PEND_NAME = "eventTask";
 
 static epicsMutexId stopSync;
 
-/* unused space in queue (EVENTQUESIZE when empty) */
-static unsigned short ringSpace ( const struct event_que *pevq )
+/*
+ * Read a counter shared with other threads without a memory barrier.
+ * Only used where a stale value is harmless, because it is confirmed
+ * by a later compare and swap, or only makes the caller more cautious.
+ */
+static size_t peekSizeT ( const size_t *pTarget )
+{
+    return *( const volatile size_t * ) pTarget;
+}
+
+static struct event_ring * event_ring_create ( unsigned size )
 {
-    if ( pevq->evque[pevq->putix] == EVENTQEMPTY ) {
-        if ( pevq->getix > pevq->putix ) {
-            return ( unsigned short ) ( pevq->getix - pevq->putix );
+    struct event_ring * ring = calloc ( 1, sizeof ( *ring ) +
+        ( size - 1u ) * sizeof ( ring->ent[0] ) );
+    unsigned i;
+
+    if ( ring ) {
+        ring->size = size;
+        for ( i = 0u; i < size; i++ ) {
+            ring->ent[i].seq = i;
         }
-        else {
-            return ( unsigned short ) ( ( EVENTQUESIZE + pevq->getix ) - pevq->putix );
+    }
+    return ring;
+}
+
+/*
+ * Claim the entry at the tail of ring, provided fewer than limit entries
+ * are in use.  Returns FALSE if the ring is that full, or retired.
+ */
+static int event_ring_claim ( struct event_ring *ring, unsigned limit,
+    size_t *pPos )
+{
+    const size_t mask = ring->size - 1u;
+    size_t pos = peekSizeT ( &ring->tail );
+
+    while ( TRUE ) {
+        struct event_ent * const pent = &ring->ent[pos & mask];
+        size_t seq = peekSizeT ( &pent->seq );
+        size_t cur;
+
+        if ( seq != pos ) {
+            if ( (ptrdiff_t) ( seq - pos ) < 0 ) {
+                return FALSE;
+            }
+            /* claimed by another thread, try again at the new tail */
+            pos = peekSizeT ( &ring->tail );
+            continue;
+        }
+        if ( pos - peekSizeT ( &ring->head ) >= limit ) {
+            return FALSE;
+        }
+        cur = epicsAtomicCmpAndSwapSizeT ( &ring->tail, pos, pos + 1u );
+        if ( cur == pos ) {
+            *pPos = pos;
+            return TRUE;
+        }
+        pos = cur;
+    }
+}
+
+/* entries of ring not yet consumed, including any being filled in */
+static unsigned event_ring_used ( const struct event_ring *ring )
+{
+    size_t tail = ring->retired ? ring->end :
+        epicsAtomicGetSizeT ( &ring->tail );
+    return (unsigned) ( tail - ring->head );
+}
+
+/*
+ * event_que_used()
+ * event queue lock _must_ be applied
+ */
+static unsigned event_que_used ( const struct event_que *ev_que )
+{
+    const struct event_ring *ring;
+    unsigned nUsed = 0u;
+
+    for ( ring = ev_que->readRing; ring; ring = ring->next ) {
+        nUsed += event_ring_used ( ring );
+    }
+    return nUsed;
+}
+
+/* unused space in queue (size when empty) */
+static unsigned ringSpace ( const struct event_que *pevq )
+{
+    unsigned nUsed = event_que_used ( pevq );
+    return nUsed < pevq->size ? pevq->size - nUsed : 0u;
+}
+
+/*
+ * event_que_resize()
+ * event queue lock _must_ be applied
+ *
+ * Replace the ring by one of newSize entries.  Events already in the
+ * old ring are delivered from there.
+ */
+static int event_que_resize ( struct event_que *ev_que, unsigned newSize )
+{
+    struct event_ring * const ring = event_ring_create ( newSize );
+    struct event_ring * const old = ev_que->ring;
+
+    if ( ! ring ) {
+        return -1;
+    }
+    ev_que->size = newSize;
+    if ( ! old ) {
+        ev_que->firstRing = ev_que->readRing = ring;
+    }
+    else {
+        size_t tail = epicsAtomicGetSizeT ( &old->tail );
+        size_t cur;
+
+        old->next = ring;
+        /* no position of the old ring may now be claimed */
+        while ( ( cur = epicsAtomicCmpAndSwapSizeT ( &old->tail, tail,
+                    tail + 2u * old->size ) ) != tail ) {
+            tail = cur;
         }
+        old->end = tail;
+        old->retired = TRUE;
     }
+    epicsAtomicWriteMemoryBarrier ();
+    epicsAtomicSetPtrT ( (EpicsAtomicPtrT *) &ev_que->ring, ring );
     return 0;
 }
 
+static unsigned roundUpPow2 ( unsigned n )
+{
+    unsigned p = 1u;
+    while ( p < n ) {
+        p <<= 1u;
+    }
+    return p;
+}
+
+/*
+ * event_que_reserve()
+ * event queue lock _must_ be applied
+ *
+ * Assign ring entries to one more event, growing the ring if needed.
+ * Returns FALSE if the event must go on another event_que.
+ */
+static int event_que_reserve ( struct event_que *ev_que )
+{
+    const struct event_user *evUser = ev_que->evUser;
+
+    if ( ! ev_que->size ) {
+        unsigned size;
+
+        ev_que->perEvent = evUser->queEntries;
+        /* a power of 2 within the limit, unless that leaves no room */
+        size = roundUpPow2 ( ev_que->perEvent * EVENTSPERQUE );
+        while ( size > evUser->queMaxSize &&
+                size / 2u >= 2u * ev_que->perEvent ) {
+            size /= 2u;
+        }
+        if ( event_que_resize ( ev_que, size ) ) {
+            return FALSE;
+        }
+    }
+
+    if ( ev_que->quota >= ev_que->size - ev_que->perEvent ) {
+        if ( ev_que->size * 2u > evUser->queMaxSize ||
+                event_que_resize ( ev_que, ev_que->size * 2u ) ) {
+            return FALSE;
+        }
+    }
+
+    ev_que->quota += ev_que->perEvent;
+    return TRUE;
+}
+
+/* notify whoever services this event user that there is work to do */
+static void event_user_wake ( struct event_user *evUser )
+{
+    if ( evUser->wakeup_sub ) {
+        ( *evUser->wakeup_sub ) ( evUser->wakeup_arg );
+    }
+    else {
+        epicsEventSignal ( evUser->ppendsem );
+    }
+}
+
+static void event_que_free_rings ( struct event_que *ev_que )
+{
+    struct event_ring *ring = ev_que->firstRing;
+
+    while ( ring ) {
+        struct event_ring *next = ring->next;
+        free ( ring );
+        ring = next;
+    }
+}
+
+/* release the event queues chained after firstque */
+static void event_user_free_queues ( struct event_user *evUser )
+{
+    struct event_que *ev_que, *nextque;
+
+    epicsMutexDestroy(evUser->firstque.writelock);
+    event_que_free_rings(&evUser->firstque);
+
+    ev_que = evUser->firstque.nextque;
+    while (ev_que) {
+        nextque = ev_que->nextque;
+        epicsMutexDestroy(ev_que->writelock);
+        event_que_free_rings(ev_que);
+        freeListFree(dbevEventQueueFreeList, ev_que);
+        ev_que = nextque;
+    }
+}
+
 int db_event_list ( const char *pname, unsigned level )
 {
     return dbel ( pname, level );
@@ -191,22 +461,24 @@ int dbel ( const char *pname, unsigned level )
             if ( pevent->select & DBE_PROPERTY ) printf( "PROPERTY " );
             printf ( "}" );
 
-            if ( pevent->npend ) {
-                printf ( " undelivered=%ld", pevent->npend );
+            if ( epicsAtomicGetSizeT ( &pevent->npend ) ) {
+                printf ( " undelivered=%lu",
+                    (unsigned long) epicsAtomicGetSizeT ( &pevent->npend ) );
             }
 
             if ( level > 1 ) {
-                unsigned nEntriesFree;
+                unsigned nEntriesFree, size;
                 const void * taskId;
                 LOCKEVQUE(pevent->ev_que);
                 nEntriesFree = ringSpace ( pevent->ev_que );
+                size = pevent->ev_que->size;
                 taskId = ( void * ) pevent->ev_que->evUser->taskid;
                 UNLOCKEVQUE(pevent->ev_que);
                 if ( nEntriesFree == 0u ) {
                     printf ( ", thread=%p, queue full",
                         (void *) taskId );
                 }
-                else if ( nEntriesFree == EVENTQUESIZE ) {
+                else if ( nEntriesFree == size ) {
                     printf ( ", thread=%p, queue empty",
                         (void *) taskId );
                 }
@@ -217,7 +489,9 @@ int dbel ( const char *pname, unsigned level )
             }
 
             if ( level > 2 ) {
-                unsigned nDuplicates;
+                unsigned size, highWater;
+                unsigned long nOverflow;
+                size_t nDuplicates;
                 if ( pevent->nreplace ) {
                     printf (", discarded by replacement=%ld", pevent->nreplace);
                 }
@@ -225,11 +499,18 @@ int dbel ( const char *pname, unsigned level )
                     printf (", queueing disabled" );
                 }
                 LOCKEVQUE(pevent->ev_que);
-                nDuplicates = pevent->ev_que->nDuplicates;
+                nDuplicates = epicsAtomicGetSizeT ( &pevent->ev_que->nDuplicates );
+                size = pevent->ev_que->size;
+                highWater = (unsigned) epicsAtomicGetSizeT (
+                    &pevent->ev_que->highWater );
+                nOverflow = pevent->ev_que->nOverflow;
                 UNLOCKEVQUE(pevent->ev_que);
                 if  ( nDuplicates ) {
-                    printf (", duplicate count =%u\n", nDuplicates );
+                    printf (", duplicate count =%lu\n",
+                        (unsigned long) nDuplicates );
                 }
+                printf ( ", queue size=%u, high water=%u, overflows=%lu",
+                    size, highWater, nOverflow );
             }
 
             if ( level > 3 ) {
@@ -323,6 +604,11 @@ dbEventCtx db_init_events (void)
 
     evUser->flowCtrlMode = FALSE;
     evUser->extraLaborBusy = FALSE;
+    evUser->queEntries = EVENTENTRIES;
+    evUser->queMaxSize = EVENTQUESIZE;
+    db_event_queue_config ( (dbEventCtx) evUser,
+        dbEventQueueEntries > 0 ? (unsigned) dbEventQueueEntries : 0u,
+        dbEventQueueMaxSize > 0 ? (unsigned) dbEventQueueMaxSize : 0u );
     return (dbEventCtx) evUser;
 fail:
     if(evUser->lock)
@@ -387,6 +673,10 @@ void db_close_events (dbEventCtx ctx)
 
         epicsMutexMustLock ( evUser->lock );
     }
+    else if(evUser->external) {
+        /* no event task to release the queues on exit */
+        event_user_free_queues ( evUser );
+    }
 
     epicsMutexUnlock ( evUser->lock );
 
@@ -401,6 +691,62 @@ void db_close_events (dbEventCtx ctx)
     freeListFree(dbevEventUserFreeList, evUser);
 }
 
+/*
+ * DB_EVENT_QUEUE_CONFIG()
+ *
+ * Set the number of queue entries reserved for each subscription, and
+ * the size a queue may grow to before another queue is added.  Zero
+ * leaves a setting unchanged.  Queues which already hold subscriptions
+ * keep their number of entries per subscription.
+ */
+int db_event_queue_config ( dbEventCtx ctx, unsigned entriesPerEvent,
+    unsigned maxEntries )
+{
+    struct event_user * const evUser = (struct event_user *) ctx;
+
+    if ( entriesPerEvent > USHRT_MAX || maxEntries > UINT_MAX / 2u ) {
+        return DB_EVENT_ERROR;
+    }
+
+    epicsMutexMustLock ( evUser->lock );
+    if ( entriesPerEvent ) {
+        evUser->queEntries = entriesPerEvent;
+    }
+    if ( maxEntries ) {
+        evUser->queMaxSize = maxEntries;
+    }
+    epicsMutexUnlock ( evUser->lock );
+    return DB_EVENT_OK;
+}
+
+/*
+ * DB_EVENT_QUEUE_STATS()
+ */
+void db_event_queue_stats ( dbEventCtx ctx, dbEventQueueStats *pstats )
+{
+    struct event_user * const evUser = (struct event_user *) ctx;
+    struct event_que * ev_que;
+
+    memset ( pstats, 0, sizeof ( *pstats ) );
+
+    epicsMutexMustLock ( evUser->lock );
+    for ( ev_que = &evUser->firstque; ev_que; ev_que = ev_que->nextque ) {
+        LOCKEVQUE ( ev_que );
+        if ( ev_que->size ) {
+            pstats->nQueues++;
+        }
+        pstats->nEntries += ev_que->size;
+        pstats->nUsed += event_que_used ( ev_que );
+        if ( pstats->highWater < epicsAtomicGetSizeT ( &ev_que->highWater ) ) {
+            pstats->highWater = (unsigned) epicsAtomicGetSizeT (
+                &ev_que->highWater );
+        }
+        pstats->nOverflow += ev_que->nOverflow;
+        UNLOCKEVQUE ( ev_que );
+    }
+    epicsMutexUnlock ( evUser->lock );
+}
+
 /*
  * create_ev_que()
  */
@@ -450,10 +796,7 @@ dbEventSubscription db_add_event (
     while ( TRUE ) {
         int success = 0;
         LOCKEVQUE ( ev_que );
-        success = ( ev_que->quota < EVENTQUESIZE - EVENTENTRIES );
-        if ( success ) {
-            ev_que->quota += EVENTENTRIES;
-        }
+        success = event_que_reserve ( ev_que );
         UNLOCKEVQUE ( ev_que );
         if ( success ) {
             break;
@@ -480,8 +823,9 @@ dbEventSubscription db_add_event (
     pevent->user_arg =  user_arg;
     pevent->chan =      chan;
     pevent->select =    (unsigned char) select;
-    pevent->pLastLog =  NULL; /* not yet in the queue */
-    pevent->callBackInProgress = FALSE;
+    pevent->pLastRing = NULL; /* not yet in the queue */
+    pevent->lastPos =   0u;
+    pevent->callBackInProgress = 0;
     pevent->enabled =   FALSE;
     pevent->ev_que =    ev_que;
 
@@ -502,6 +846,92 @@ dbEventSubscription db_add_event (
     return pevent;
 }
 
+/*
+ * monitor_bucket_find()
+ *
+ * Binary search for the bucket of pField, returns its index or where
+ * it would be inserted.
+ */
+static unsigned monitor_bucket_find (const struct dbMonitorIndex *pix,
+    const void *pField)
+{
+    unsigned lo = 0u, hi = pix ? pix->count : 0u;
+
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2u;
+        size_t key = (size_t) pix->bucket[mid].pField;
+
+        if (key < (size_t) pField)
+            lo = mid + 1u;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * monitor_index_add()
+ *
+ * Called with LOCKREC held
+ */
+static void monitor_index_add (struct dbCommon *precord,
+    struct evSubscrip *pevent)
+{
+    struct dbMonitorIndex *pix = precord->mlix;
+    void *pField = dbChannelField(pevent->chan);
+    unsigned i = monitor_bucket_find(pix, pField);
+    monitorBucket *pb;
+
+    if (!pix || i >= pix->count || pix->bucket[i].pField != pField) {
+        if (!pix || pix->count == pix->size) {
+            unsigned size = pix ? 2u * pix->size : 4u;
+
+            /* ELLLISTs don't point back at themselves, so may be moved */
+            pix = realloc(pix, sizeof(*pix) +
+                (size - 1u) * sizeof(monitorBucket));
+            if (!pix)
+                cantProceed("monitor_index_add: out of memory\n");
+            if (!precord->mlix)
+                pix->count = 0u;
+            pix->size = size;
+            precord->mlix = pix;
+        }
+        memmove(&pix->bucket[i + 1u], &pix->bucket[i],
+            (pix->count - i) * sizeof(monitorBucket));
+        pix->count++;
+        pb = &pix->bucket[i];
+        pb->pField = pField;
+        ellInit(&pb->subs);
+        pb->select = 0u;
+    }
+    pb = &pix->bucket[i];
+    ellAdd(&pb->subs, &pevent->fnode);
+    pb->select |= pevent->select;
+}
+
+/*
+ * monitor_index_remove()
+ *
+ * Called with LOCKREC held
+ */
+static void monitor_index_remove (struct dbCommon *precord,
+    struct evSubscrip *pevent)
+{
+    struct dbMonitorIndex *pix = precord->mlix;
+    void *pField = dbChannelField(pevent->chan);
+    unsigned i = monitor_bucket_find(pix, pField);
+    monitorBucket *pb;
+    ELLNODE *cur;
+
+    assert(pix && i < pix->count && pix->bucket[i].pField == pField);
+    pb = &pix->bucket[i];
+    ellDelete(&pb->subs, &pevent->fnode);
+
+    pb->select = 0u;
+    for (cur = ellFirst(&pb->subs); cur; cur = ellNext(cur))
+        pb->select |= CONTAINER(cur, struct evSubscrip, fnode)->select;
+}
+
 /*
  * db_event_enable()
  */
@@ -513,6 +943,7 @@ void db_event_enable (dbEventSubscription event)
     LOCKREC (precord);
     if ( ! pevent->enabled ) {
         ellAdd (&precord->mlis, &pevent->node);
+        monitor_index_add (precord, pevent);
         pevent->enabled = TRUE;
     }
     UNLOCKREC (precord);
@@ -529,34 +960,12 @@ void db_event_disable (dbEventSubscription event)
     LOCKREC (precord);
     if ( pevent->enabled ) {
         ellDelete(&precord->mlis, &pevent->node);
+        monitor_index_remove (precord, pevent);
         pevent->enabled = FALSE;
     }
     UNLOCKREC (precord);
 }
 
-/*
- * event_remove()
- * event queue lock _must_ be applied
- * this nulls the entry in the queue, but doesn't delete the db_field_log chunk
- */
-static void event_remove ( struct event_que *ev_que,
-    unsigned short index, struct evSubscrip *placeHolder )
-{
-    struct evSubscrip * const pevent = ev_que->evque[index];
-
-    ev_que->evque[index] = placeHolder;
-    ev_que->valque[index] = NULL;
-    if ( pevent->npend == 1u ) {
-        pevent->pLastLog = NULL;
-    }
-    else {
-        assert ( pevent->npend > 1u );
-        assert ( ev_que->nDuplicates >= 1u );
-        ev_que->nDuplicates--;
-    }
-    pevent->npend--;
-}
-
 /*
  * DB_CANCEL_EVENT()
  *
@@ -581,13 +990,13 @@ void db_cancel_event (dbEventSubscription event)
         if(pevent->ev_que->evUser->taskid != epicsThreadGetIdSelf())
             sync = 1; /* concurrent to event_task, so wait */
 
-    } else if(pevent->npend) {
+    } else if(epicsAtomicGetSizeT(&pevent->npend)) {
         /* some (now defunct) events in the queue, defer free() to event_task */
 
     } else {
         /* no other references, cleanup now */
 
-        pevent->ev_que->quota -= EVENTENTRIES;
+        pevent->ev_que->quota -= pevent->ev_que->perEvent;
         freeListFree ( dbevEventSubscriptionFreeList, pevent );
     }
 
@@ -607,7 +1016,7 @@ void db_cancel_event (dbEventSubscription event)
         do {
             epicsMutexUnlock( evUser->lock );
             /* ensure worker will cycle at least once */
-            epicsEventMustTrigger(evUser->ppendsem);
+            event_user_wake(evUser);
 
             if(wait.wake) {
                 epicsEventMustWait(wait.wake);
@@ -682,12 +1091,87 @@ int db_post_extra_labor (dbEventCtx ctx)
     epicsMutexUnlock ( evUser->lock );
 
     if ( doit ) {
-        epicsEventSignal(evUser->ppendsem);
+        event_user_wake(evUser);
     }
 
     return DB_EVENT_OK;
 }
 
+struct dbArraySnapshot {
+    int                 refs;           /* atomic */
+    short               field_type;
+    short               field_size;
+    long                no_elements;
+    union {                             /* aligned for any element type */
+        epicsFloat64    f64;
+        epicsUInt64     u64;
+        void            *ptr;
+    } data[1];
+};
+
+/*
+ * DB_CREATE_ARRAY_SNAPSHOT()
+ *
+ * Returns a snapshot with room for no_elements elements, which the
+ * caller owns one reference to.
+ */
+dbArraySnapshot * db_create_array_snapshot ( short field_type,
+    short field_size, long no_elements )
+{
+    dbArraySnapshot *psnap;
+    size_t size = offsetof ( dbArraySnapshot, data );
+
+    if ( no_elements < 0 || field_size <= 0 ||
+            (size_t) no_elements > ( (size_t) -1 - sizeof ( *psnap ) ) /
+                (size_t) field_size ) {
+        return NULL;
+    }
+    size += (size_t) no_elements * (size_t) field_size;
+    if ( size < sizeof ( *psnap ) ) {
+        size = sizeof ( *psnap );
+    }
+    psnap = malloc ( size );
+    if ( psnap ) {
+        psnap->refs = 1;
+        psnap->field_type = field_type;
+        psnap->field_size = field_size;
+        psnap->no_elements = no_elements;
+    }
+    return psnap;
+}
+
+void * db_array_snapshot_data ( dbArraySnapshot *psnap )
+{
+    return psnap->data;
+}
+
+void db_release_array_snapshot ( dbArraySnapshot *psnap )
+{
+    if ( psnap && epicsAtomicDecrIntT ( &psnap->refs ) == 0 ) {
+        free ( psnap );
+    }
+}
+
+static void db_snapshot_log_dtor ( db_field_log *pfl )
+{
+    db_release_array_snapshot ( (dbArraySnapshot *) pfl->u.r.pvt );
+}
+
+/*
+ * DB_FIELD_LOG_SNAPSHOT()
+ *
+ * The snapshot pfl refers to, or NULL.  Filters may point such a field
+ * log at part of the snapshot's data, but must not change the data.
+ */
+dbArraySnapshot * db_field_log_snapshot ( const db_field_log *pfl )
+{
+    if ( pfl && pfl->type == dbfl_type_ref &&
+            pfl->dtor == db_snapshot_log_dtor ) {
+        return (dbArraySnapshot *) pfl->u.r.pvt;
+    }
+    return NULL;
+}
+
 static db_field_log* db_create_field_log (struct dbChannel *chan, int use_val)
 {
     db_field_log *pLog = (db_field_log *) freeListCalloc(dbevFieldLogFreeList);
@@ -744,6 +1228,28 @@ db_field_log* db_create_event_log (struct evSubscrip *pevent)
     return pLog;
 }
 
+/*
+ *  db_create_snapshot_log()
+ *
+ *  A field log for pevent sharing the array data of psnap
+ */
+static db_field_log* db_create_snapshot_log (struct evSubscrip *pevent,
+    dbArraySnapshot *psnap)
+{
+    db_field_log *pLog = db_create_event_log(pevent);
+
+    if (pLog && pLog->type == dbfl_type_ref) {
+        pLog->field_type  = psnap->field_type;
+        pLog->field_size  = psnap->field_size;
+        pLog->no_elements = psnap->no_elements;
+        pLog->u.r.field = psnap->data;
+        pLog->u.r.pvt = psnap;
+        pLog->dtor = db_snapshot_log_dtor;
+        epicsAtomicIncrIntT(&psnap->refs);
+    }
+    return pLog;
+}
+
 /*
  *  DB_CREATE_READ_LOG()
  *
@@ -760,87 +1266,148 @@ db_field_log* db_create_read_log (struct dbChannel *chan)
     return pLog;
 }
 
+/*
+ * event_ring_publish()
+ *
+ * Fill in the entry claimed at pos and hand it to the event task.
+ * Returns TRUE if the event task must be woken.
+ */
+static int event_ring_publish ( struct event_que *ev_que,
+    struct event_ring *ring, size_t pos, struct evSubscrip *pevent,
+    db_field_log *pLog )
+{
+    struct event_ent * const pent = &ring->ent[pos & ( ring->size - 1u )];
+    size_t head, used, highWater;
+
+    pent->pevent = pevent;
+    pent->pfl = pLog;
+    pevent->pLastRing = ring;
+    pevent->lastPos = pos;
+    if ( epicsAtomicIncrSizeT ( &pevent->npend ) > 1u ) {
+        epicsAtomicIncrSizeT ( &ev_que->nDuplicates );
+    }
+
+    /* a full barrier, so the event task finds the entry complete,
+     * and sees it if head is found unchanged below
+     */
+    epicsAtomicCmpAndSwapSizeT ( &pent->seq, pos, pos + 1u );
+
+    head = peekSizeT ( &ring->head );
+    used = pos + 1u - head;
+    highWater = peekSizeT ( &ev_que->highWater );
+    while ( (ptrdiff_t) used > 0 && used > highWater ) {
+        size_t cur = epicsAtomicCmpAndSwapSizeT ( &ev_que->highWater,
+            highWater, used );
+        if ( cur == highWater ) {
+            break;
+        }
+        highWater = cur;
+    }
+
+    /* the event task stops at the first entry not yet published */
+    return pos == head;
+}
+
 /*
  *  DB_QUEUE_EVENT_LOG()
  *
  */
 static void db_queue_event_log (evSubscrip *pevent, db_field_log *pLog)
 {
-    struct event_que    *ev_que;
+    struct event_que * const ev_que = pevent->ev_que;
+    const size_t npend = peekSizeT ( &pevent->npend );
+    struct event_ring *ring;
+    size_t pos;
     int firstEventFlag;
-    unsigned rngSpace;
 
-    ev_que = pevent->ev_que;
     /*
-     * evUser ring buffer must be locked for the multiple
-     * threads writing/reading it
+     * Posting threads for one subscription are serialized by its lock
+     * set, so only the event task can change npend meanwhile, and only
+     * to reduce it.  The first event on the queue, or a value copy when
+     * not in flow control mode, is added without taking the queue lock
+     * unless that would leave too little room for other subscriptions.
      */
-
-    LOCKEVQUE (ev_que);
-
-    /* if we have an event on the queue and both the last
-     * event on the queue and the current event reference
-     * a record field, simply ignore duplicate events.
-     */
-    if (pevent->npend > 0u
-            && !dbfl_has_copy(*pevent->pLastLog)
-            && !dbfl_has_copy(pLog)) {
-        db_delete_field_log(pLog);
-        UNLOCKEVQUE (ev_que);
-        return;
+    if ( ! npend || ( dbfl_has_copy ( pLog ) &&
+            ! db_field_log_snapshot ( pLog ) &&
+            ! ev_que->evUser->flowCtrlMode ) ) {
+        /* a replacement ring was complete before it was stored here */
+        ring = *( struct event_ring * volatile * ) &ev_que->ring;
+        if ( event_ring_claim ( ring, npend ?
+                ring->size - ring->size / ev_que->perEvent : ring->size,
+                &pos ) ) {
+            if ( event_ring_publish ( ev_que, ring, pos, pevent, pLog ) ) {
+                event_user_wake ( ev_que->evUser );
+            }
+            return;
+        }
     }
 
     /*
-     * add to task local event que
+     * Changing the last event of this subscription needs the queue
+     * lock, which keeps the event task from taking it meanwhile.
      */
+    LOCKEVQUE (ev_que);
 
-    /*
-     * if an event is on the queue and one of
-     * {flowCtrlMode, not room for one more of each monitor attached}
-     * then replace the last event on the queue (for this monitor)
-     */
-    rngSpace = ringSpace ( ev_que );
-    if ( pevent->npend>0u &&
-        (ev_que->evUser->flowCtrlMode || rngSpace<=EVENTSPERQUE) ) {
-        /*
-         * replace last event if no space is left
+    ring = ev_que->ring;
+
+    if ( npend > 0u && (ptrdiff_t) ( pevent->lastPos -
+            pevent->pLastRing->head ) >= 0 ) {
+        struct event_ring * const lastRing = pevent->pLastRing;
+        struct event_ent * const pLast =
+            &lastRing->ent[pevent->lastPos & ( lastRing->size - 1u )];
+
+        /* if we have an event on the queue and both the last
+         * event on the queue and the current event reference
+         * a record field, simply ignore duplicate events.
          */
-        if (*pevent->pLastLog) {
-            db_delete_field_log(*pevent->pLastLog);
-            *pevent->pLastLog = pLog;
+        if ( ! dbfl_has_copy ( pLast->pfl ) && ! dbfl_has_copy ( pLog ) ) {
+            db_delete_field_log ( pLog );
+            UNLOCKEVQUE (ev_que);
+            return;
         }
-        pevent->nreplace++;
-        /*
-         * the event task has already been notified about
-         * this so we don't need to post the semaphore
+
+        /* arrays are not queued up, so a new snapshot of the
+         * array replaces whatever the last event refers to.
          */
-        firstEventFlag = 0;
-    }
-    /*
-     * Otherwise, the current entry must be available.
-     * Fill it in and advance the ring buffer.
-     */
-    else {
-        assert ( ev_que->evque[ev_que->putix] == EVENTQEMPTY );
-        ev_que->evque[ev_que->putix] = pevent;
-        ev_que->valque[ev_que->putix] = pLog;
-        pevent->pLastLog = &ev_que->valque[ev_que->putix];
-        if (pevent->npend>0u) {
-            ev_que->nDuplicates++;
+        if ( db_field_log_snapshot ( pLog ) &&
+                ( ! dbfl_has_copy ( pLast->pfl ) ||
+                    db_field_log_snapshot ( pLast->pfl ) ) ) {
+            db_delete_field_log ( pLast->pfl );
+            pLast->pfl = pLog;
+            UNLOCKEVQUE (ev_que);
+            return;
         }
-        pevent->npend++;
+
         /*
-         * if the ring buffer was empty before
-         * adding this event
+         * if an event is on the queue and one of
+         * {flowCtrlMode, not room for one more of each monitor attached}
+         * then replace the last event on the queue (for this monitor)
+         *
+         * the event task has already been notified about
+         * this so we don't need to post the semaphore
          */
-        if (rngSpace==EVENTQUESIZE) {
-            firstEventFlag = 1;
-        }
-        else {
-            firstEventFlag = 0;
+        if ( ev_que->evUser->flowCtrlMode ||
+                ! event_ring_claim ( ring,
+                    ring->size - ring->size / ev_que->perEvent, &pos ) ) {
+            db_delete_field_log ( pLast->pfl );
+            pLast->pfl = pLog;
+            pevent->nreplace++;
+            if ( ! ev_que->evUser->flowCtrlMode ) {
+                ev_que->nOverflow++;
+            }
+            UNLOCKEVQUE (ev_que);
+            return;
         }
-        ev_que->putix = RNGINC ( ev_que->putix );
     }
+    else if ( ! event_ring_claim ( ring, ring->size, &pos ) ) {
+        /* each subscription's quota should prevent this */
+        db_delete_field_log ( pLog );
+        ev_que->nOverflow++;
+        UNLOCKEVQUE (ev_que);
+        return;
+    }
+
+    firstEventFlag = event_ring_publish ( ev_que, ring, pos, pevent, pLog );
 
     UNLOCKEVQUE (ev_que);
 
@@ -854,8 +1421,81 @@ static void db_queue_event_log (evSubscrip *pevent, db_field_log *pLog)
         /*
          * notify the event handler
          */
-        epicsEventSignal(ev_que->evUser->ppendsem);
+        event_user_wake(ev_que->evUser);
+    }
+}
+
+/*
+ *  db_post_one_event()
+ *
+ *  Called with LOCKREC held
+ */
+static void db_post_one_event(
+struct evSubscrip   *pevent,
+unsigned int        caEventMask,
+dbArraySnapshot     *psnap
+)
+{
+    db_field_log *pLog = psnap ?
+        db_create_snapshot_log(pevent, psnap) :
+        db_create_event_log(pevent);
+
+    if(pLog)
+        pLog->mask = caEventMask & pevent->select;
+    pLog = dbChannelRunPreChain(pevent->chan, pLog);
+    if (pLog) db_queue_event_log(pevent, pLog);
+}
+
+/*
+ *  db_post_events_snapshot()
+ *
+ *  Queue an event for each matching subscription.  If psnap is not NULL
+ *  array subscriptions refer to it, instead of the record field.
+ */
+static int db_post_events_snapshot(
+struct dbCommon     *prec,
+void                *pField,
+unsigned int        caEventMask,
+dbArraySnapshot     *psnap
+)
+{
+    struct evSubscrip *pevent;
+    struct dbMonitorIndex *pix;
+    ELLNODE *cur;
+    unsigned i;
+
+    if (prec->mlis.count == 0) return DB_EVENT_OK;       /* no monitors set */
+
+    LOCKREC (prec);
+
+    /*
+     * Only send event msg if they are waiting on the field which
+     * changed or pval==NULL, and are waiting on matching event
+     */
+    if (pField == NULL) {
+        for (cur = ellFirst(&prec->mlis); cur; cur = ellNext(cur)) {
+            pevent = (struct evSubscrip *) cur;
+            if (caEventMask & pevent->select)
+                db_post_one_event(pevent, caEventMask, psnap);
+        }
+        UNLOCKREC (prec);
+        return DB_EVENT_OK;
     }
+
+    pix = prec->mlix;
+    i = monitor_bucket_find(pix, pField);
+    if (pix && i < pix->count && pix->bucket[i].pField == pField &&
+            (caEventMask & pix->bucket[i].select)) {
+        for (cur = ellFirst(&pix->bucket[i].subs); cur; cur = ellNext(cur)) {
+            pevent = CONTAINER(cur, struct evSubscrip, fnode);
+            if (caEventMask & pevent->select)
+                db_post_one_event(pevent, caEventMask, psnap);
+        }
+    }
+
+    UNLOCKREC (prec);
+    return DB_EVENT_OK;
+
 }
 
 /*
@@ -870,33 +1510,75 @@ void            *pField,
 unsigned int    caEventMask
 )
 {
-    struct dbCommon   * const prec = (struct dbCommon *) pRecord;
-    struct evSubscrip *pevent;
+    return db_post_events_snapshot((struct dbCommon *) pRecord, pField,
+        caEventMask, NULL);
+}
 
-    if (prec->mlis.count == 0) return DB_EVENT_OK;       /* no monitors set */
+/*
+ *  DB_POST_ARRAY_SNAPSHOT()
+ *
+ *  Like db_post_events(), with psnap holding the value of the array
+ *  field pField.  The caller keeps its reference to psnap.
+ *
+ *  NOTE: This assumes that the db scan lock is already applied
+ *
+ */
+int db_post_array_snapshot(
+void            *pRecord,
+void            *pField,
+unsigned int    caEventMask,
+dbArraySnapshot *psnap
+)
+{
+    return db_post_events_snapshot((struct dbCommon *) pRecord, pField,
+        caEventMask, psnap);
+}
 
-    LOCKREC (prec);
+/*
+ *  DB_ARRAY_SNAPSHOT_WANTED()
+ *
+ *  A single subscription without filters reads the field when its
+ *  update is sent, so copying the array into a snapshot first would
+ *  only add work.
+ *
+ *  NOTE: This assumes that the db scan lock is already applied
+ *
+ */
+int db_array_snapshot_wanted(
+void            *pRecord,
+void            *pField,
+unsigned int    caEventMask
+)
+{
+    struct dbCommon *prec = (struct dbCommon *) pRecord;
+    struct dbMonitorIndex *pix;
+    ELLNODE *cur;
+    unsigned i;
+    int count = 0;
 
-    for (pevent = (struct evSubscrip *) prec->mlis.node.next;
-        pevent; pevent = (struct evSubscrip *) pevent->node.next){
+    if (prec->mlis.count == 0) return 0;
 
-        /*
-         * Only send event msg if they are waiting on the field which
-         * changed or pval==NULL, and are waiting on matching event
-         */
-        if ( (dbChannelField(pevent->chan) == (void *)pField || pField==NULL) &&
-            (caEventMask & pevent->select)) {
-            db_field_log *pLog = db_create_event_log(pevent);
-            if(pLog)
-                pLog->mask = caEventMask & pevent->select;
-            pLog = dbChannelRunPreChain(pevent->chan, pLog);
-            if (pLog) db_queue_event_log(pevent, pLog);
+    LOCKREC (prec);
+
+    pix = prec->mlix;
+    i = monitor_bucket_find(pix, pField);
+    if (pix && i < pix->count && pix->bucket[i].pField == pField &&
+            (caEventMask & pix->bucket[i].select)) {
+        for (cur = ellFirst(&pix->bucket[i].subs); cur && count < 2;
+                cur = ellNext(cur)) {
+            struct evSubscrip *pevent =
+                CONTAINER(cur, struct evSubscrip, fnode);
+
+            if (!(caEventMask & pevent->select))
+                continue;
+            count++;
+            if (ellCount(&pevent->chan->filters))
+                count = 2;
         }
     }
 
     UNLOCKREC (prec);
-    return DB_EVENT_OK;
-
+    return count > 1;
 }
 
 /*
@@ -917,17 +1599,69 @@ void db_post_single_event (dbEventSubscription event)
     dbScanUnlock (prec);
 }
 
+/*
+ * event_que_take()
+ * event queue lock _must_ be applied
+ *
+ * Take up to EVENTBATCH events from the queue, oldest first, and set
+ * *pMore if others are already waiting.
+ */
+static unsigned event_que_take ( struct event_que *ev_que,
+    struct event_ent *batch, int *pMore )
+{
+    struct event_ring *ring = ev_que->readRing;
+    size_t pos = ring->head;
+    unsigned n = 0u;
+
+    *pMore = FALSE;
+    while ( TRUE ) {
+        struct event_ent * const pent = &ring->ent[pos & ( ring->size - 1u )];
+
+        if ( ring->retired && pos == ring->end ) {
+            epicsAtomicCmpAndSwapSizeT ( &ring->head, ring->head, pos );
+            ev_que->readRing = ring = ring->next;
+            pos = ring->head;
+            continue;
+        }
+        if ( peekSizeT ( &pent->seq ) != pos + 1u ) {
+            if ( ring->head == pos ) {
+                break;
+            }
+            /* posting threads wake us if they find head unchanged
+             * after publishing, so look again once it is set
+             */
+            epicsAtomicCmpAndSwapSizeT ( &ring->head, ring->head, pos );
+            continue;
+        }
+        if ( n == EVENTBATCH ) {
+            *pMore = TRUE;
+            break;
+        }
+        epicsAtomicReadMemoryBarrier ();
+        batch[n].pevent = pent->pevent;
+        batch[n].pfl = pent->pfl;
+        batch[n].pevent->callBackInProgress++;
+        n++;
+
+        /* a full barrier, the entry is read before it can be reused */
+        epicsAtomicCmpAndSwapSizeT ( &pent->seq, pos + 1u, pos + ring->size );
+        pos++;
+    }
+    if ( ring->head != pos ) {
+        epicsAtomicCmpAndSwapSizeT ( &ring->head, ring->head, pos );
+    }
+    return n;
+}
+
 /*
  * EVENT_READ()
  */
 static int event_read ( struct event_que *ev_que )
 {
+    struct event_ent batch[EVENTBATCH];
     int notifiedRemaining = 0;
+    int more = TRUE;
 
-    /*
-     * evUser ring buffer must be locked for the multiple
-     * threads writing/reading it
-     */
     LOCKEVQUE (ev_que);
 
     /*
@@ -935,63 +1669,70 @@ static int event_read ( struct event_que *ev_que )
      * suspend processing events until flow control
      * mode is over
      */
-    if ( ev_que->evUser->flowCtrlMode && ev_que->nDuplicates == 0u ) {
+    if ( ! ev_que->readRing ||
+            ( ev_que->evUser->flowCtrlMode &&
+                epicsAtomicGetSizeT ( &ev_que->nDuplicates ) == 0u ) ) {
         UNLOCKEVQUE (ev_que);
         return DB_EVENT_OK;
     }
 
-    while ( ev_que->evque[ev_que->getix] != EVENTQEMPTY ) {
-        struct evSubscrip *pevent = ev_que->evque[ev_que->getix];
-        int eventsRemaining;
-        db_field_log *pfl = ev_que->valque[ev_que->getix];
-
-        /*
-         * Simple type values queued up for reliable interprocess
-         * communication. (for other types they get whatever happens
-         * to be there upon wakeup)
-         */
-
-        event_remove ( ev_que, ev_que->getix, EVENTQEMPTY );
-        ev_que->getix = RNGINC ( ev_que->getix );
-        eventsRemaining = ev_que->evque[ev_que->getix] != EVENTQEMPTY;
+    while ( more ) {
+        unsigned n = event_que_take ( ev_que, batch, &more );
+        unsigned i;
 
         /*
-         * Next event pointer can be used by event tasks to determine
-         * if more events are waiting in the queue
-         *
          * Must remove the lock here so that we don't deadlock if
          * this calls dbGetField() and blocks on the record lock,
          * dbPutField() is in progress in another task, it has the
          * record lock, and it is calling db_post_events() waiting
          * for the event queue lock (which this thread now has).
          */
-        if ( pevent->user_sub ) {
-            EVENTFUNC* user_sub = pevent->user_sub;
-            pevent->callBackInProgress = TRUE;
+        UNLOCKEVQUE (ev_que);
 
-            UNLOCKEVQUE (ev_que);
+        for ( i = 0u; i < n; i++ ) {
+            struct evSubscrip * const pevent = batch[i].pevent;
+            /* an earlier callback may have called db_cancel_event() */
+            EVENTFUNC * const user_sub = pevent->user_sub;
+            db_field_log *pfl = batch[i].pfl;
 
-            /* Run post-event-queue filter chain */
-            if (ellCount(&pevent->chan->post_chain)) {
-                pfl = dbChannelRunPostChain(pevent->chan, pfl);
-            }
-            if (pfl) {
-                /* Issue user callback */
-                ( *user_sub ) ( pevent->user_arg, pevent->chan,
-                                eventsRemaining, pfl );
-                notifiedRemaining = eventsRemaining;
+            /*
+             * Next event pointer can be used by event tasks to determine
+             * if more events are waiting in the queue
+             */
+            int eventsRemaining = i + 1u < n || more;
+
+            if ( user_sub ) {
+                /* Run post-event-queue filter chain */
+                if (ellCount(&pevent->chan->post_chain)) {
+                    pfl = dbChannelRunPostChain(pevent->chan, pfl);
+                }
+                if (pfl) {
+                    /* Issue user callback */
+                    ( *user_sub ) ( pevent->user_arg, pevent->chan,
+                                    eventsRemaining, pfl );
+                    notifiedRemaining = eventsRemaining;
+                }
             }
+            db_delete_field_log(pfl);
+        }
 
-            LOCKEVQUE (ev_que);
+        LOCKEVQUE (ev_que);
 
-            pevent->callBackInProgress = FALSE;
-        }
-        /* callback may have called db_cancel_event(), so must check user_sub again */
-        if(!pevent->user_sub && !pevent->npend) {
-            pevent->ev_que->quota -= EVENTENTRIES;
-            freeListFree ( dbevEventSubscriptionFreeList, pevent );
+        for ( i = 0u; i < n; i++ ) {
+            struct evSubscrip * const pevent = batch[i].pevent;
+            size_t npend = epicsAtomicDecrSizeT ( &pevent->npend );
+
+            if ( npend ) {
+                epicsAtomicDecrSizeT ( &ev_que->nDuplicates );
+            }
+            pevent->callBackInProgress--;
+            /* callback may have called db_cancel_event(), so must check user_sub again */
+            if ( ! pevent->user_sub && ! npend &&
+                    ! pevent->callBackInProgress ) {
+                ev_que->quota -= ev_que->perEvent;
+                freeListFree ( dbevEventSubscriptionFreeList, pevent );
+            }
         }
-        db_delete_field_log(pfl);
     }
 
     if(notifiedRemaining && !ev_que->possibleStall) {
@@ -1004,10 +1745,68 @@ static int event_read ( struct event_que *ev_que )
     return DB_EVENT_OK;
 }
 
+/*
+ * EVENT_TASK_CYCLE()
+ *
+ * One pass through the extra labor and all event queues.
+ * Returns the pendexit flag as seen at the end of the pass.
+ */
+static unsigned char event_task_cycle ( struct event_user * const evUser )
+{
+    struct event_que * ev_que;
+    unsigned char pendexit;
+    void (*pExtraLaborSub) (void *);
+    void *pExtraLaborArg;
+
+    /*
+     * check to see if the caller has offloaded
+     * labor to this task
+     */
+    epicsMutexMustLock ( evUser->lock );
+    evUser->extraLaborBusy = TRUE;
+    if ( evUser->extra_labor && evUser->extralabor_sub ) {
+        evUser->extra_labor = FALSE;
+        pExtraLaborSub = evUser->extralabor_sub;
+        pExtraLaborArg = evUser->extralabor_arg;
+    }
+    else {
+        pExtraLaborSub = NULL;
+        pExtraLaborArg = NULL;
+    }
+    if ( pExtraLaborSub ) {
+        epicsMutexUnlock ( evUser->lock );
+        (*pExtraLaborSub)(pExtraLaborArg);
+        epicsMutexMustLock ( evUser->lock );
+    }
+    evUser->extraLaborBusy = FALSE;
+
+    for ( ev_que = &evUser->firstque; ev_que; ev_que = ev_que->nextque ) {
+        /* unlock during iteration is safe as event_que will not be free'd */
+        epicsMutexUnlock ( evUser->lock );
+        event_read (ev_que);
+        epicsMutexMustLock ( evUser->lock );
+    }
+    pendexit = evUser->pendexit;
+
+    evUser->pflush_seq++;
+    if(ellCount(&evUser->waiters)) {
+        /* hold lock throughout to avoid race between event trigger and destroy */
+        ELLNODE *cur;
+        for(cur = ellFirst(&evUser->waiters); cur; cur = ellNext(cur)) {
+            event_waiter *w = CONTAINER(cur, event_waiter, node);
+            if(w->wake)
+                epicsEventMustTrigger(w->wake);
+        }
+    }
+
+    epicsMutexUnlock ( evUser->lock );
+
+    return pendexit;
+}
+
 static void event_task (void *pParm)
 {
     struct event_user * const evUser = (struct event_user *) pParm;
-    struct event_que * ev_que;
     unsigned char pendexit;
 
     /* init hook */
@@ -1018,68 +1817,13 @@ static void event_task (void *pParm)
     taskwdInsert ( epicsThreadGetIdSelf(), NULL, NULL );
 
     do {
-        void (*pExtraLaborSub) (void *);
-        void *pExtraLaborArg;
         epicsEventMustWait(evUser->ppendsem);
 
-        /*
-         * check to see if the caller has offloaded
-         * labor to this task
-         */
-        epicsMutexMustLock ( evUser->lock );
-        evUser->extraLaborBusy = TRUE;
-        if ( evUser->extra_labor && evUser->extralabor_sub ) {
-            evUser->extra_labor = FALSE;
-            pExtraLaborSub = evUser->extralabor_sub;
-            pExtraLaborArg = evUser->extralabor_arg;
-        }
-        else {
-            pExtraLaborSub = NULL;
-            pExtraLaborArg = NULL;
-        }
-        if ( pExtraLaborSub ) {
-            epicsMutexUnlock ( evUser->lock );
-            (*pExtraLaborSub)(pExtraLaborArg);
-            epicsMutexMustLock ( evUser->lock );
-        }
-        evUser->extraLaborBusy = FALSE;
-
-        for ( ev_que = &evUser->firstque; ev_que; ev_que = ev_que->nextque ) {
-            /* unlock during iteration is safe as event_que will not be free'd */
-            epicsMutexUnlock ( evUser->lock );
-            event_read (ev_que);
-            epicsMutexMustLock ( evUser->lock );
-        }
-        pendexit = evUser->pendexit;
-
-        evUser->pflush_seq++;
-        if(ellCount(&evUser->waiters)) {
-            /* hold lock throughout to avoid race between event trigger and destroy */
-            ELLNODE *cur;
-            for(cur = ellFirst(&evUser->waiters); cur; cur = ellNext(cur)) {
-                event_waiter *w = CONTAINER(cur, event_waiter, node);
-                if(w->wake)
-                    epicsEventMustTrigger(w->wake);
-            }
-        }
-
-        epicsMutexUnlock ( evUser->lock );
+        pendexit = event_task_cycle ( evUser );
 
     } while( ! pendexit );
 
-    epicsMutexDestroy(evUser->firstque.writelock);
-
-    {
-        struct event_que    *nextque;
-
-        ev_que = evUser->firstque.nextque;
-        while (ev_que) {
-            nextque = ev_que->nextque;
-            epicsMutexDestroy(ev_que->writelock);
-            freeListFree(dbevEventQueueFreeList, ev_que);
-            ev_que = nextque;
-        }
-    }
+    event_user_free_queues ( evUser );
 
     taskwdRemove(epicsThreadGetIdSelf());
 
@@ -1119,6 +1863,10 @@ int db_start_events (
          epicsMutexUnlock ( evUser->lock );
          return DB_EVENT_OK;
      }
+     if (evUser->external) {
+         epicsMutexUnlock ( evUser->lock );
+         return DB_EVENT_ERROR;
+     }
 
      evUser->init_func = init_func;
      evUser->init_func_arg = init_func_arg;
@@ -1136,6 +1884,56 @@ int db_start_events (
      return DB_EVENT_OK;
 }
 
+/*
+ * DB_START_EVENTS_EXTERNAL()
+ *
+ * Alternative to db_start_events() for callers which multiplex many
+ * event users onto their own threads.  No event task is created.
+ * Instead wakeup_func is called (from any thread, possibly with database
+ * locks held, so it must not block) whenever db_process_events() should
+ * be called for this context.  A context must always be serviced by the
+ * same thread.
+ */
+int db_start_events_external (
+    dbEventCtx ctx, EXTRALABORFUNC *wakeup_func, void *wakeup_arg )
+{
+    struct event_user * const evUser = (struct event_user *) ctx;
+
+    if ( ! wakeup_func ) {
+        return DB_EVENT_ERROR;
+    }
+
+    epicsMutexMustLock ( evUser->lock );
+    if ( evUser->taskid || evUser->external ) {
+        epicsMutexUnlock ( evUser->lock );
+        return DB_EVENT_ERROR;
+    }
+    evUser->wakeup_sub = wakeup_func;
+    evUser->wakeup_arg = wakeup_arg;
+    evUser->external = TRUE;
+    epicsMutexUnlock ( evUser->lock );
+    return DB_EVENT_OK;
+}
+
+/*
+ * DB_PROCESS_EVENTS()
+ *
+ * Perform the work of one event task cycle in the calling thread
+ * for a context started with db_start_events_external().
+ */
+int db_process_events ( dbEventCtx ctx )
+{
+    struct event_user * const evUser = (struct event_user *) ctx;
+
+    if ( ! evUser->external ) {
+        return DB_EVENT_ERROR;
+    }
+    /* db_cancel_event() compares against this to detect self cancellation */
+    evUser->taskid = epicsThreadGetIdSelf ();
+    (void) event_task_cycle ( evUser );
+    return DB_EVENT_OK;
+}
+
 /*
  * db_event_change_priority()
  */
@@ -1143,6 +1941,8 @@ void db_event_change_priority ( dbEventCtx ctx,
                                         unsigned epicsPriority )
 {
     struct event_user * const evUser = ( struct event_user * ) ctx;
+    /* an external servicing thread manages its own priority */
+    if ( evUser->external ) return;
     epicsThreadSetPriority ( evUser->taskid, epicsPriority );
 }
 
@@ -1159,7 +1959,7 @@ void db_event_flow_ctrl_mode_on (dbEventCtx ctx)
     /*
      * notify the event handler task
      */
-    epicsEventSignal(evUser->ppendsem);
+    event_user_wake(evUser);
 }
 
 /*
@@ -1175,7 +1975,7 @@ void db_event_flow_ctrl_mode_off (dbEventCtx ctx)
     /*
      * notify the event handler task
      */
-    epicsEventSignal (evUser->ppendsem);
+    event_user_wake (evUser);
 }
 
 /*
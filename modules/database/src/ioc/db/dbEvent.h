@@ -48,11 +48,37 @@ DBCORE_API int dbel (
 DBCORE_API int db_post_events (
     void *pRecord, void *pField, unsigned caEventMask );
 
+/*
+ * Reference counted, immutable copy of an array.  Record support fills
+ * one in and posts it with db_post_array_snapshot() so that every
+ * subscriber to the field, and their filters, share the one copy.
+ * Each field log referring to a snapshot holds a reference to it,
+ * which db_delete_field_log() releases.
+ */
+typedef struct dbArraySnapshot dbArraySnapshot;
+DBCORE_API dbArraySnapshot * db_create_array_snapshot (
+    short field_type, short field_size, long no_elements );
+DBCORE_API void * db_array_snapshot_data ( dbArraySnapshot *psnap );
+DBCORE_API void db_release_array_snapshot ( dbArraySnapshot *psnap );
+DBCORE_API int db_post_array_snapshot (
+    void *pRecord, void *pField, unsigned caEventMask,
+    dbArraySnapshot *psnap );
+/* Non-zero if a snapshot would save copies, because more than one
+ * subscription would get the update or a filter may copy it.
+ */
+DBCORE_API int db_array_snapshot_wanted (
+    void *pRecord, void *pField, unsigned caEventMask );
+DBCORE_API dbArraySnapshot * db_field_log_snapshot (
+    const struct db_field_log *pfl );
+
 typedef void EXTRALABORFUNC (void *extralabor_arg);
 DBCORE_API dbEventCtx db_init_events (void);
 DBCORE_API int db_start_events (
     dbEventCtx ctx, const char *taskname, void (*init_func)(void *),
     void *init_func_arg, unsigned osiPriority );
+DBCORE_API int db_start_events_external (
+    dbEventCtx ctx, EXTRALABORFUNC *wakeup_func, void *wakeup_arg );
+DBCORE_API int db_process_events (dbEventCtx ctx);
 DBCORE_API void db_close_events (dbEventCtx ctx);
 DBCORE_API void db_event_flow_ctrl_mode_on (dbEventCtx ctx);
 DBCORE_API void db_event_flow_ctrl_mode_off (dbEventCtx ctx);
@@ -61,6 +87,18 @@ DBCORE_API int db_add_extra_labor_event (
 DBCORE_API void db_flush_extra_labor_event (dbEventCtx);
 DBCORE_API int db_post_extra_labor (dbEventCtx ctx);
 DBCORE_API void db_event_change_priority ( dbEventCtx ctx, unsigned epicsPriority );
+DBCORE_API int db_event_queue_config ( dbEventCtx ctx,
+    unsigned entriesPerEvent, unsigned maxEntries );
+
+typedef struct dbEventQueueStats {
+    unsigned nQueues;           /* event queues in use */
+    unsigned nEntries;          /* total queue entries */
+    unsigned nUsed;             /* entries holding undelivered events */
+    unsigned highWater;         /* most entries ever used in one queue */
+    unsigned long nOverflow;    /* events replaced for lack of space */
+} dbEventQueueStats;
+DBCORE_API void db_event_queue_stats ( dbEventCtx ctx,
+    dbEventQueueStats *pstats );
 
 #ifdef EPICS_PRIVATE_API
 DBCORE_API void db_cleanup_events(void);
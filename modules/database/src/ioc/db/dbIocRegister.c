@@ -401,6 +401,20 @@ static const iocshFuncDef dblsrFuncDef = {"dblsr",2,dblsrArgs,
 static void dblsrCallFunc(const iocshArgBuf *args)
 { dblsr(args[0].sval,args[1].ival);}
 
+/* dblcr */
+static const iocshArg dblcrArg0 = { "count",iocshArgInt};
+static const iocshArg dblcrArg1 = { "reset",iocshArgInt};
+static const iocshArg * const dblcrArgs[2] = {&dblcrArg0,&dblcrArg1};
+static const iocshFuncDef dblcrFuncDef = {"dblcr",2,dblcrArgs,
+                                          "Database Lock Contention Report.\n"
+                                          "List the lock sets which threads waited for, longest total wait first.\n"
+                                          "count - Show this many lock sets, or all if 0.\n"
+                                          "reset - Clear the counters afterwards.\n"
+                                          "Set dbLockTiming=1 to count waits.\n\n"
+                                          "Example: dblcr 10\n"};
+static void dblcrCallFunc(const iocshArgBuf *args)
+{ dblcr(args[0].ival,args[1].ival);}
+
 /* dbLockShowLocked */
 static const iocshArg dbLockShowLockedArg0 = { "interest level",iocshArgInt};
 static const iocshArg * const dbLockShowLockedArgs[1] = {&dbLockShowLockedArg0};
@@ -419,13 +433,26 @@ static const iocshArg scanOnceSetQueueSizeArg0 = { "size",iocshArgInt};
 static const iocshArg * const scanOnceSetQueueSizeArgs[1] =
     {&scanOnceSetQueueSizeArg0};
 static const iocshFuncDef scanOnceSetQueueSizeFuncDef = {"scanOnceSetQueueSize",1,scanOnceSetQueueSizeArgs,
-                                                         "Change size of Scan once queue.\n"
+                                                         "Change the most requests which may wait in each scan once queue.\n"
                                                          "Must be called before iocInit().\n"};
 static void scanOnceSetQueueSizeCallFunc(const iocshArgBuf *args)
 {
     scanOnceSetQueueSize(args[0].ival);
 }
 
+/* scanOnceSetThreads */
+static const iocshArg scanOnceSetThreadsArg0 = { "nThreads",iocshArgInt};
+static const iocshArg * const scanOnceSetThreadsArgs[1] =
+    {&scanOnceSetThreadsArg0};
+static const iocshFuncDef scanOnceSetThreadsFuncDef = {"scanOnceSetThreads",1,scanOnceSetThreadsArgs,
+                                                       "Process scan once requests on nThreads threads.\n"
+                                                       "Requests for records in one lock set stay in order.\n"
+                                                       "Must be called before iocInit().\n"};
+static void scanOnceSetThreadsCallFunc(const iocshArgBuf *args)
+{
+    scanOnceSetThreads(args[0].ival);
+}
+
 /* scanOnceQueueShow */
 static const iocshArg scanOnceQueueShowArg0 = { "reset",iocshArgInt};
 static const iocshArg * const scanOnceQueueShowArgs[1] =
@@ -437,6 +464,35 @@ static void scanOnceQueueShowCallFunc(const iocshArgBuf *args)
     scanOnceQueueShow(args[0].ival);
 }
 
+/* scanPeriodicSetThreads */
+static const iocshArg scanPeriodicSetThreadsArg0 = { "period",iocshArgDouble};
+static const iocshArg scanPeriodicSetThreadsArg1 = { "nThreads",iocshArgInt};
+static const iocshArg * const scanPeriodicSetThreadsArgs[2] =
+    {&scanPeriodicSetThreadsArg0,&scanPeriodicSetThreadsArg1};
+static const iocshFuncDef scanPeriodicSetThreadsFuncDef = {"scanPeriodicSetThreads",2,scanPeriodicSetThreadsArgs,
+                                                           "Process a periodic scan list on nThreads threads,\n"
+                                                           "splitting its records by lock set.\n"
+                                                           "If period == 0.0, all periodic lists are set.\n"
+                                                           "Must be called before iocInit().\n"};
+static void scanPeriodicSetThreadsCallFunc(const iocshArgBuf *args)
+{
+    scanPeriodicSetThreads(args[0].dval, args[1].ival);
+}
+
+/* scanPeriodicShow */
+static const iocshArg scanPeriodicShowArg0 = { "rate",iocshArgDouble};
+static const iocshArg scanPeriodicShowArg1 = { "reset",iocshArgInt};
+static const iocshArg * const scanPeriodicShowArgs[2] =
+    {&scanPeriodicShowArg0,&scanPeriodicShowArg1};
+static const iocshFuncDef scanPeriodicShowFuncDef = {"scanPeriodicShow",2,scanPeriodicShowArgs,
+                                                     "Show cycle timing of periodic scan lists.\n"
+                                                     "If rate == 0.0, all lists with records are shown.\n"
+                                                     "Set scanRecordTiming=1 to also find the slowest records.\n"};
+static void scanPeriodicShowCallFunc(const iocshArgBuf *args)
+{
+    scanPeriodicShow(args[0].dval, args[1].ival);
+}
+
 /* scanppl */
 static const iocshArg scanpplArg0 = { "rate",iocshArgDouble};
 static const iocshArg * const scanpplArgs[1] = {&scanpplArg0};
@@ -475,7 +531,8 @@ static const iocshArg callbackSetQueueSizeArg0 = { "bufsize",iocshArgInt};
 static const iocshArg * const callbackSetQueueSizeArgs[1] =
     {&callbackSetQueueSizeArg0};
 static const iocshFuncDef callbackSetQueueSizeFuncDef = {"callbackSetQueueSize",1,callbackSetQueueSizeArgs,
-                                                         "Change depth of queue for callback workers.\n"
+                                                         "Change initial depth of the queue of each callback worker.\n"
+                                                         "Queues grow up to callbackQueueMaxSize per priority.\n"
                                                          "Must be called before iocInit().\n"};
 static void callbackSetQueueSizeCallFunc(const iocshArgBuf *args)
 {
@@ -605,10 +662,14 @@ void dbIocRegister(void)
     iocshRegister(&dbPutAttrFuncDef,dbPutAttrCallFunc);
     iocshRegister(&tpnFuncDef,tpnCallFunc);
     iocshRegister(&dblsrFuncDef,dblsrCallFunc);
+    iocshRegister(&dblcrFuncDef,dblcrCallFunc);
     iocshRegister(&dbLockShowLockedFuncDef,dbLockShowLockedCallFunc);
 
     iocshRegister(&scanOnceSetQueueSizeFuncDef,scanOnceSetQueueSizeCallFunc);
+    iocshRegister(&scanOnceSetThreadsFuncDef,scanOnceSetThreadsCallFunc);
     iocshRegister(&scanOnceQueueShowFuncDef,scanOnceQueueShowCallFunc);
+    iocshRegister(&scanPeriodicSetThreadsFuncDef,scanPeriodicSetThreadsCallFunc);
+    iocshRegister(&scanPeriodicShowFuncDef,scanPeriodicShowCallFunc);
     iocshRegister(&scanpplFuncDef,scanpplCallFunc);
     iocshRegister(&scanpelFuncDef,scanpelCallFunc);
     iocshRegister(&postEventFuncDef,postEventCallFunc);
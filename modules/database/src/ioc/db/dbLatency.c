@@ -0,0 +1,115 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Latency histograms for the callback and scanOnce queues, and the
+ * periodic scan timing of dbScan.c
+ */
+
+#include <math.h>
+
+#include "epicsTime.h"
+
+#include "dbLatencyPvt.h"
+
+unsigned dbLatencyBucket(double seconds)
+{
+    int exp;
+    double mant = frexp(seconds * 1e6, &exp);
+    int i;
+
+    if (seconds < 1e-6)
+        return 0;
+    i = 4 * (exp - 1) + (int)((mant - 0.5) * 8.0);
+    return i < DB_LATENCY_BUCKETS ? i : DB_LATENCY_BUCKETS - 1;
+}
+
+/* Upper limit of a bucket, in seconds */
+static double bucketLimit(unsigned i)
+{
+    return ldexp(0.5 + (i % 4 + 1) / 8.0, i / 4 + 1) * 1e-6;
+}
+
+double dbLatencyPercentile(const unsigned long *histogram,
+    unsigned long count, double max, double fraction)
+{
+    unsigned long target = (unsigned long) ceil(fraction * count);
+    unsigned long sum = 0;
+    unsigned i;
+
+    if (!count)
+        return 0.0;
+    for (i = 0; i < DB_LATENCY_BUCKETS - 1; i++) {
+        sum += histogram[i];
+        if (sum >= target)
+            break;
+    }
+    return bucketLimit(i) < max ? bucketLimit(i) : max;
+}
+
+void dbLatencyWorstAdd(dbLatencyWorst *worst, int *pnWorst, int max,
+    double seconds, const void *key, const void *user)
+{
+    int i, n = *pnWorst;
+
+    for (i = 0; i < n; i++) {
+        if (worst[i].key == key && worst[i].user == user)
+            break;
+    }
+    if (i < n) {
+        if (seconds <= worst[i].time)
+            return;
+    }
+    else if (n < max)
+        i = (*pnWorst)++;
+    else if (seconds > worst[n - 1].time)
+        i = n - 1;
+    else
+        return;
+
+    while (i > 0 && worst[i - 1].time < seconds) {
+        worst[i] = worst[i - 1];
+        i--;
+    }
+    worst[i].key = key;
+    worst[i].user = user;
+    worst[i].time = seconds;
+}
+
+void dbLatencyAdd(dbLatency *pl, double seconds,
+    const void *key, const void *user)
+{
+    pl->count++;
+    pl->sum += seconds;
+    if (seconds > pl->max)
+        pl->max = seconds;
+    pl->histogram[dbLatencyBucket(seconds)]++;
+    if (pl->nWorst < DB_LATENCY_WORST ||
+        seconds > pl->worst[pl->nWorst - 1].time)
+        dbLatencyWorstAdd(pl->worst, &pl->nWorst, DB_LATENCY_WORST,
+            seconds, key, user);
+}
+
+void dbLatencyMerge(dbLatency *dst, const dbLatency *src)
+{
+    int i;
+
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max)
+        dst->max = src->max;
+    for (i = 0; i < DB_LATENCY_BUCKETS; i++)
+        dst->histogram[i] += src->histogram[i];
+    for (i = 0; i < src->nWorst; i++)
+        dbLatencyWorstAdd(dst->worst, &dst->nWorst, DB_LATENCY_WORST,
+            src->worst[i].time, src->worst[i].key, src->worst[i].user);
+}
+
+double dbLatencySince(epicsUInt64 queued)
+{
+    if (!queued)
+        return -1.0;
+    return (epicsMonotonicGet() - queued) * 1e-9;
+}
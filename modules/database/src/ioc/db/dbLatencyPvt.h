@@ -0,0 +1,58 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Histograms of times spent queued or processing, shared by callback.c
+ * and dbScan.c.  None of these functions lock, callers guard each
+ * dbLatency with their own lock.
+ */
+
+#ifndef DBLATENCYPVT_H
+#define DBLATENCYPVT_H
+
+#include "epicsTypes.h"
+
+/* Times are counted in 4 buckets per octave, from 1 us */
+#define DB_LATENCY_BUCKETS 112
+
+#define DB_LATENCY_WORST 5
+
+typedef struct dbLatencyWorst {
+    const void          *key;   /* what was waiting, distinct entries */
+    const void          *user;
+    double              time;
+} dbLatencyWorst;
+
+typedef struct dbLatency {
+    unsigned long       count;
+    double              sum;
+    double              max;
+    unsigned long       histogram[DB_LATENCY_BUCKETS];
+    int                 nWorst;
+    dbLatencyWorst      worst[DB_LATENCY_WORST];    /* by decreasing time */
+} dbLatency;
+
+unsigned dbLatencyBucket(double seconds);
+double dbLatencyPercentile(const unsigned long *histogram,
+    unsigned long count, double max, double fraction);
+
+/* Add one sample, keeping the worst key and user pairs */
+void dbLatencyAdd(dbLatency *pl, double seconds,
+    const void *key, const void *user);
+/* Add the samples of src to dst */
+void dbLatencyMerge(dbLatency *dst, const dbLatency *src);
+
+/* Keep the max worst entries, by decreasing time, in worst[*pnWorst].
+ * A key and user pair already there only keeps its longest time.
+ */
+void dbLatencyWorstAdd(dbLatencyWorst *worst, int *pnWorst, int max,
+    double seconds, const void *key, const void *user);
+
+/* Seconds from a queued epicsMonotonicGet() time until now,
+ * or -1 if queued is 0 meaning the entry wasn't timed.
+ */
+double dbLatencySince(epicsUInt64 queued);
+
+#endif /* DBLATENCYPVT_H */
@@ -23,6 +23,7 @@
 #include "epicsSpin.h"
 #include "epicsStdio.h"
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "errMdef.h"
 
 #include "dbAccessDefs.h"
@@ -34,6 +35,7 @@
 #include "dbLockPvt.h"
 #include "dbStaticLib.h"
 #include "link.h"
+#include "epicsExport.h"
 
 typedef struct dbScanLockNode dbScanLockNode;
 
@@ -56,6 +58,9 @@ static epicsMutexId lockSetsGuard;
 static size_t recomputeCnt;
 #endif
 
+int dbLockTiming = 0;
+epicsExportAddress(int, dbLockTiming);
+
 /*private routines */
 static void dbLockOnce(void* ignore)
 {
@@ -77,7 +82,12 @@ static lockSet* makeSet(void)
     epicsMutexMustLock(lockSetsGuard);
 #ifndef LOCKSET_NOFREE
     ls = (lockSet*)ellGet(&lockSetsFree);
-    if(!ls) {
+    if(ls) {
+        /* statistics of the lockSet's previous life */
+        ls->nLock = ls->nContended = 0;
+        ls->waitSum = ls->waitMax = 0.0;
+        ls->holder[0] = ls->maxHolder[0] = '\0';
+    } else {
         epicsMutexUnlock(lockSetsGuard);
 #endif
 
@@ -181,6 +191,49 @@ unsigned long dbLockGetLockId(dbCommon *precord)
     return id;
 }
 
+size_t dbLockRecomputeCount(void)
+{
+#ifndef LOCKSET_NOCNT
+    return epicsAtomicGetSizeT(&recomputeCnt);
+#else
+    /* no cheap way to tell, so always report a change */
+    static size_t cnt;
+    return epicsAtomicIncrSizeT(&cnt);
+#endif
+}
+
+/* Lock a lockSet, counting the wait if dbLockTiming is set.
+ * The name of the holder is read without the lock, it is only a hint.
+ */
+static void lockSetLock(lockSet *ls)
+{
+    char holder[DBLOCK_NAME_SIZE];
+    epicsUInt64 start;
+    double wait;
+
+    if(!dbLockTiming) {
+        epicsMutexMustLock(ls->lock);
+        return;
+    }
+
+    if(epicsMutexTryLock(ls->lock)!=epicsMutexLockOK) {
+        memcpy(holder, ls->holder, sizeof(holder));
+        holder[sizeof(holder)-1] = '\0';
+        start = epicsMonotonicGet();
+        epicsMutexMustLock(ls->lock);
+        wait = (epicsMonotonicGet() - start) * 1e-9;
+
+        ls->nContended++;
+        ls->waitSum += wait;
+        if(wait > ls->waitMax) {
+            ls->waitMax = wait;
+            strcpy(ls->maxHolder, holder);
+        }
+    }
+    ls->nLock++;
+    strncpy(ls->holder, epicsThreadGetNameSelf(), sizeof(ls->holder)-1);
+}
+
 void dbScanLock(dbCommon *precord)
 {
     int cnt;
@@ -193,7 +246,7 @@ void dbScanLock(dbCommon *precord)
     assert(epicsAtomicGetIntT(&ls->refcount)>0);
 
 retry:
-    epicsMutexMustLock(ls->lock);
+    lockSetLock(ls);
 
     epicsSpinLock(lr->spin);
     if(ls!=lr->plockSet) {
@@ -409,7 +462,7 @@ retry:
             continue;
         plock = ref->plockSet;
 
-        epicsMutexMustLock(plock->lock);
+        lockSetLock(plock);
         assert(plock->ownerlocker==NULL);
         plock->ownerlocker = locker;
         ellAdd(&locker->locked, &plock->lockernode);
@@ -972,6 +1025,138 @@ long dbLockShowLocked(int level)
     return 0;
 }
 
+/* Copy the statistics, and optionally the name of the set's first
+ * record, which must have room for PVNAME_STRINGSZ characters.
+ */
+static void lockSetStatus(lockSet *ls, int reset, dbLockStats *result,
+    char *first)
+{
+    lockRecord *lr;
+
+    epicsMutexMustLock(ls->lock);
+    if(result) {
+        result->id = ls->id;
+        result->records = ellCount(&ls->lockRecordList);
+        result->locks = ls->nLock;
+        result->contended = ls->nContended;
+        result->waitSum = ls->waitSum;
+        result->waitMax = ls->waitMax;
+        strcpy(result->maxHolder, ls->maxHolder);
+    }
+    if(reset) {
+        ls->nLock = ls->nContended = 0;
+        ls->waitSum = ls->waitMax = 0.0;
+        ls->maxHolder[0] = '\0';
+    }
+    if(first) {
+        lr = (lockRecord *)ellFirst(&ls->lockRecordList);
+        strcpy(first, lr ? lr->precord->name : "");
+    }
+    epicsMutexUnlock(ls->lock);
+}
+
+int dbLockStatus(dbCommon *precord, int reset, dbLockStats *result)
+{
+    lockSet *ls;
+
+    if(!precord->lset)
+        return -1;
+    ls = dbLockGetRef(precord->lset);
+    lockSetStatus(ls, reset, result, NULL);
+    dbLockDecRef(ls);
+    return 0;
+}
+
+typedef struct {
+    dbLockStats stats;
+    char first[PVNAME_STRINGSZ];
+} lockSetReport;
+
+static int waitcompare(const void *rawA, const void *rawB)
+{
+    const lockSetReport *A = rawA, *B = rawB;
+
+    if(A->stats.waitSum > B->stats.waitSum)
+        return -1;
+    else if(A->stats.waitSum < B->stats.waitSum)
+        return 1;
+    else if(A->stats.contended > B->stats.contended)
+        return -1;
+    else if(A->stats.contended < B->stats.contended)
+        return 1;
+    return 0;
+}
+
+long dblcr(int count, int reset)
+{
+    lockSet **sets;
+    lockSetReport *report;
+    ELLNODE *cur;
+    int i, n, shown = 0;
+
+    if(!lockSetsGuard) {
+        printf("Lock sets not initialized\n");
+        return 0;
+    }
+
+    /* Sets can't be locked while holding lockSetsGuard, so take refs
+     * to them all first.  Skip any whose last ref is being dropped.
+     */
+    epicsMutexMustLock(lockSetsGuard);
+    n = ellCount(&lockSetsActive);
+    sets = calloc(n ? n : 1, sizeof(*sets));
+    report = calloc(n ? n : 1, sizeof(*report));
+    if(!sets || !report) {
+        epicsMutexUnlock(lockSetsGuard);
+        free(sets);
+        free(report);
+        printf("Out of memory\n");
+        return -1;
+    }
+    for(cur = ellFirst(&lockSetsActive), i = 0; cur && i < n;
+        cur = ellNext(cur)) {
+        lockSet *ls = CONTAINER(cur, lockSet, node);
+        int cnt;
+
+        do {
+            cnt = epicsAtomicGetIntT(&ls->refcount);
+        } while(cnt > 0 &&
+            epicsAtomicCmpAndSwapIntT(&ls->refcount, cnt, cnt + 1) != cnt);
+        if(cnt > 0)
+            sets[i++] = ls;
+    }
+    n = i;
+    epicsMutexUnlock(lockSetsGuard);
+
+    for(i = 0; i < n; i++) {
+        lockSetStatus(sets[i], reset, &report[i].stats, report[i].first);
+        dbLockDecRef(sets[i]);
+    }
+    free(sets);
+
+    qsort(report, n, sizeof(*report), &waitcompare);
+
+    if(!dbLockTiming)
+        printf("Set dbLockTiming=1 to time lock waits\n");
+    for(i = 0; i < n && (!count || shown < count); i++) {
+        const dbLockStats *ps = &report[i].stats;
+
+        if(!ps->contended)
+            break;
+        if(!shown++)
+            printf("     SET  RECORDS       LOCKS   CONTENDED  WAIT TOTAL"
+                "   WAIT MEAN    WAIT MAX  MAX HOLDER        FIRST RECORD\n");
+        printf("%8lu %8lu %11lu %11lu %11.6f %11.6f %11.6f  %-16s  %s\n",
+            ps->id, ps->records, ps->locks, ps->contended, ps->waitSum,
+            ps->waitSum / ps->contended, ps->waitMax,
+            ps->maxHolder[0] ? ps->maxHolder : "?", report[i].first);
+    }
+    if(!shown)
+        printf("No lock set waits counted\n");
+    free(report);
+    return 0;
+}
+
 int * dbLockSetAddrTrace(dbCommon *precord)
 {
     lockRecord  *plockRecord = precord->lset;
@@ -24,6 +24,31 @@ extern "C" {
 
 struct dbCommon;
 struct dbBase;
+
+/** @brief Time how long dbScanLock() and dbScanLockMany() wait
+ *
+ * May be changed at any time, see dbLockStatus() and dblcr().
+ * @since 7.0.9
+ */
+DBCORE_API extern int dbLockTiming;
+
+/** @brief Length of the thread names in dbLockStats */
+#define DBLOCK_NAME_SIZE 24
+
+/** @brief Contention of a lock set, see dbLockStatus()
+ *
+ * Times are in seconds.
+ * @since 7.0.9
+ */
+typedef struct dbLockStats {
+    unsigned long id;               /**< As dbLockGetLockId() */
+    unsigned long records;          /**< Members of the lock set */
+    unsigned long locks;            /**< Times it was locked */
+    unsigned long contended;        /**< Times a thread had to wait */
+    double waitSum;
+    double waitMax;
+    char maxHolder[DBLOCK_NAME_SIZE]; /**< Thread that held it at waitMax */
+} dbLockStats;
 /** @brief Lock multiple records.
  *
  * A dbLocker allows a caller to simultaneously lock multiple records.
@@ -91,6 +116,28 @@ DBCORE_API void dbLockInitRecords(struct dbBase *pdbbase);
 DBCORE_API void dbLockCleanupRecords(struct dbBase *pdbbase);
 
 
+/** @brief Contention statistics of the lock set of a record
+ *
+ * Counts only while dbLockTiming is set.
+ * @param precord Any record of the lock set
+ * @param reset Clear the counters after reading them
+ * @param result Filled in if not NULL
+ * @return Zero on success, -1 before iocInit()
+ * @since 7.0.9
+ */
+DBCORE_API int dbLockStatus(struct dbCommon *precord, int reset,
+    dbLockStats *result);
+
+/** @brief Lock Contention Report
+ *
+ * Lists lock sets which threads have waited for, longest total wait
+ * first.  Sets merged by links can serialize unrelated processing.
+ * @param count Show this many sets, or all if 0
+ * @param reset Clear the counters of all sets afterwards
+ * @since 7.0.9
+ */
+DBCORE_API long dblcr(int count, int reset);
+
 /* Lock Set Report */
 DBCORE_API long dblsr(char *recordname,int level);
 /* If recordname NULL then all records*/
@@ -40,6 +40,14 @@ typedef struct dbLockSet {
     ELLNODE             lockernode;
 
     int                 trace; /*For field TPRO*/
+
+    /* Contention statistics, kept while dbLockTiming is set */
+    unsigned long       nLock;
+    unsigned long       nContended;
+    double              waitSum;
+    double              waitMax;
+    char                holder[DBLOCK_NAME_SIZE];   /* last to lock */
+    char                maxHolder[DBLOCK_NAME_SIZE]; /* at waitMax */
 } lockSet;
 
 struct lockRecord;
@@ -106,6 +114,9 @@ void dbLockerPrepare(struct dbLocker *locker,
                      size_t nrecs);
 void dbLockerFinalize(dbLocker *);
 
+/* Changes whenever any record moves to another lockSet */
+size_t dbLockRecomputeCount(void);
+
 void dbLockSetMerge(struct dbLocker *locker,
                     struct dbCommon *pfirst,
                     struct dbCommon *psecond);
@@ -17,6 +17,7 @@
 
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <math.h>
@@ -25,11 +26,12 @@
 #include "cantProceed.h"
 #include "dbDefs.h"
 #include "ellLib.h"
+#include "epicsAssert.h"
 #include "epicsAtomic.h"
 #include "epicsEvent.h"
+#include "epicsExport.h"
 #include "epicsMutex.h"
 #include "epicsPrint.h"
-#include "epicsRingBytes.h"
 #include "epicsStdio.h"
 #include "epicsStdlib.h"
 #include "epicsString.h"
@@ -43,7 +45,9 @@
 #include "dbBase.h"
 #include "dbCommon.h"
 #include "dbFldTypes.h"
+#include "dbLatencyPvt.h"
 #include "dbLock.h"
+#include "dbLockPvt.h"
 #include "dbScan.h"
 #include "dbStaticLib.h"
 #include "devSup.h"
@@ -61,12 +65,51 @@ static volatile enum ctl scanCtl;
 
 /* SCAN ONCE */
 
+/* Each once thread has a bounded queue with many producers and one
+ * consumer.  A producer claims a slot with a compare and swap of tail and
+ * publishes the entry by advancing the slot's sequence number, so
+ * scanOnce() takes no lock and may be called from an ISR.  The consumer
+ * takes up to ONCE_BATCH entries at a time.  The ring of slots is
+ * allocated by initOnce(), rounded up to a power of 2 from onceQueueSize,
+ * which still limits how many entries may wait.
+ */
+#define ONCE_BATCH 64
+
+typedef struct {
+    struct dbCommon *prec;
+    once_complete cb;
+    void *usr;
+    epicsUInt64 queued;     /* epicsMonotonicGet(), 0 if not timed */
+} onceEntry;
+
+typedef struct onceSlot {
+    size_t seq;             /* ready to fill when seq == pos, use atomic */
+    onceEntry ent;
+} onceSlot;
+
+typedef struct onceQueue {
+    size_t tail;            /* next position to fill, use atomic */
+    size_t head;            /* next position to take, use atomic */
+    int maxUsed;            /* use atomic */
+    unsigned ring;          /* slots, a power of 2 */
+    onceSlot *slots;
+    int sleeping;           /* onceTask() waiting on wake, use atomic */
+    epicsEventId wake;
+    epicsThreadId tid;
+} onceQueue;
+
 static int onceQueueSize = 1000;
-static epicsEventId onceSem;
-static epicsRingBytesId onceQ;
+static int onceThreads = 1;
+static int nOnceQueues;
+static onceQueue *onceQueues;
 static int onceQOverruns = 0;
-static epicsThreadId onceTaskId;
 static void *exitOnce;
+static epicsMutexId onceLatencyLock;
+static dbLatency onceLatency;   /* guarded by onceLatencyLock */
+
+/* Time requests from scanOnce() until onceTask() processes them */
+int scanOnceLatencyTiming = 0;
+epicsExportAddress(int, scanOnceLatencyTiming);
 
 
 /* All other scan types */
@@ -74,6 +117,8 @@ typedef struct scan_list{
     epicsMutexId        lock;
     ELLLIST             list;
     short               modified;/*has list been modified?*/
+    unsigned            generation;/*incremented on every modification*/
+    struct scan_timing  *ptiming;/*periodic lists only*/
 } scan_list;
 /*scan_elements are allocated and the address stored in dbCommon.spvt*/
 typedef struct scan_element{
@@ -87,6 +132,36 @@ typedef struct scan_element{
 
 #define OVERRUN_REPORT_DELAY 10.0   /* Time between initial reports */
 #define OVERRUN_REPORT_MAX 3600.0   /* Maximum time between reports */
+
+/* Time dbProcess() for each record of the periodic lists */
+int scanRecordTiming = 0;
+epicsExportAddress(int, scanRecordTiming);
+
+/* Timing statistics of a periodic list, guarded by its scan_list::lock */
+typedef struct scan_timing {
+    unsigned long       cycles;
+    double              lateSum;
+    double              lateMax;
+    double              durationLast;
+    double              durationMax;
+    unsigned long       histogram[DB_LATENCY_BUCKETS];
+    int                 nSlowest;
+    dbLatencyWorst      slowest[SCAN_STATS_SLOWEST];    /* key is the record */
+} scan_timing;
+
+/* One partition of a periodic scan list, processed by its own thread.
+ * Partition 0 is processed by the periodicTask() thread itself.
+ */
+typedef struct periodic_partition {
+    struct periodic_scan_list *ppsl;
+    epicsThreadId       tid;
+    epicsEventId        start;
+    scan_element        **elements;
+    unsigned            count;
+    unsigned            size;
+    int                 exit;
+} periodic_partition;
+
 typedef struct periodic_scan_list {
     scan_list           scan_list;
     double              period;
@@ -94,12 +169,30 @@ typedef struct periodic_scan_list {
     unsigned long       overruns;
     volatile enum ctl   scanCtl;
     epicsEventId        loopEvent;
+    int                 nThreads;   /* 1 unless partitioned */
+    periodic_partition  *partitions;
+    epicsEventId        doneEvent;
+    int                 nBusy;      /* partitions still running this cycle */
+    int                 partitioned;
+    unsigned            generation; /* of scan_list when partitioned */
+    size_t              recompute;  /* dbLockRecomputeCount() then */
+    scan_timing         timing;
 } periodic_scan_list;
 
 static int nPeriodic = 0;
 static periodic_scan_list **papPeriodic; /* pointer to array of pointers */
 static epicsThreadId *periodicTaskId;    /* array of thread ids */
 
+/* Requested by scanPeriodicSetThreads() */
+typedef struct periodic_threads {
+    ELLNODE             node;
+    double              period;
+    int                 nThreads;
+} periodic_threads;
+
+static ELLLIST periodicThreads = ELLLIST_INIT;
+static int periodicThreadsAll = 1;
+
 
 static char *priorityName[NUM_CALLBACK_PRIORITIES] = {
     "Low", "Medium", "High"
@@ -108,20 +201,52 @@ static char *priorityName[NUM_CALLBACK_PRIORITIES] = {
 
 /* EVENT */
 
+/* Named events are found through a hash table.  Events are never deleted,
+ * and each is filled in before it is added to its hash chain, so lookups
+ * only take event_lock when they have to create a new event.
+ */
+#define EVENT_HASH_SIZE 1024    /* buckets, a power of 2 */
+
+STATIC_ASSERT(SCAN_EVENT_PRIORITIES == NUM_CALLBACK_PRIORITIES);
+
+/* Guarded by the scan_list::lock of the same priority */
+typedef struct event_stats {
+    unsigned long       runs;       /* scan list processed */
+    unsigned long       records;    /* in the list, summed over runs */
+    double              timeSum;
+    double              timeMax;
+} event_stats;
+
 typedef struct event_list {
     epicsCallback            callback[NUM_CALLBACK_PRIORITIES];
     scan_list           scan_list[NUM_CALLBACK_PRIORITIES];
     struct event_list   *next;
+    struct event_list   *hashNext;  /* set before the event is visible */
+    size_t              posts;      /* use atomic */
+    size_t              dropped;    /* callbackRequest() failed, atomic */
+    event_stats         stats[NUM_CALLBACK_PRIORITIES];
     char                eventname[1]; /* actually arbitrary size */
 } event_list;
 static event_list * volatile pevent_list[256];
+static event_list *event_hash[EVENT_HASH_SIZE]; /* use atomic */
 static epicsMutexId event_lock;
 
 /* IO_EVENT*/
 
+/* States of a coalescing io_scan_list */
+enum ioscanState {
+    ioscanIdle,
+    ioscanQueued,       /* callback requested, not yet running */
+    ioscanRunning,
+    ioscanRepeat        /* running, queue again when done */
+};
+
 typedef struct io_scan_list {
     epicsCallback callback;
     scan_list scan_list;
+    int state;          /* enum ioscanState, use atomic */
+    size_t requests;    /* use atomic */
+    size_t coalesced;   /* use atomic */
 } io_scan_list;
 
 typedef struct ioscan_head {
@@ -129,6 +254,7 @@ typedef struct ioscan_head {
     struct io_scan_list iosl[NUM_CALLBACK_PRIORITIES];
     io_scan_complete cb;
     void *arg;
+    int coalesce;
 } ioscan_head;
 
 static ioscan_head *pioscan_list = NULL;
@@ -139,8 +265,11 @@ static void onceTask(void *);
 static void initOnce(void);
 static void periodicTask(void *arg);
 static void initPeriodic(void);
+static int oncePush(onceQueue *pq, const onceEntry *pent);
+static void deleteOnce(void);
 static void deletePeriodic(void);
 static void spawnPeriodic(int ind);
+static void scanPartitioned(periodic_scan_list *ppsl);
 static void eventCallback(epicsCallback *pcallback);
 static void ioscanInit(void);
 static void ioscanCallback(epicsCallback *pcallback);
@@ -172,9 +301,18 @@ void scanStop(void)
         epicsThreadMustJoin(periodicTaskId[i]);
     }
 
-    scanOnce((dbCommon *)&exitOnce);
-    epicsEventWait(startStopEvent);
-    epicsThreadMustJoin(onceTaskId);
+    for (i = 0; i < nOnceQueues; i++) {
+        onceQueue *pq = &onceQueues[i];
+        onceEntry ent;
+
+        memset(&ent, 0, sizeof(ent));
+        ent.prec = (dbCommon *)&exitOnce;
+        while (!oncePush(pq, &ent))
+            epicsThreadSleep(0.01);
+        epicsEventSignal(pq->wake);
+        epicsEventWait(startStopEvent);
+        epicsThreadMustJoin(pq->tid);
+    }
 }
 
 void scanCleanup(void)
@@ -183,7 +321,7 @@ void scanCleanup(void)
     deletePeriodic();
     ioscanDestroy();
 
-    epicsRingBytesDelete(onceQ);
+    deleteOnce();
 
     free(periodicTaskId);
     papPeriodic = NULL;
@@ -376,6 +514,167 @@ double scanPeriod(int scan) {
     return ppsl ? ppsl->period : 0.0;
 }
 
+int scanPeriodicSetThreads(double period, int nThreads)
+{
+    periodic_threads *pthr;
+
+    if (papPeriodic) {
+        fprintf(stderr, "scanPeriodicSetThreads: Must be called before "
+            "iocInit\n");
+        return -1;
+    }
+    if (nThreads < 1)
+        nThreads = 1;
+
+    if (period <= 0.0) {
+        periodicThreadsAll = nThreads;
+        ellFree(&periodicThreads);
+        return 0;
+    }
+    for (pthr = (periodic_threads *)ellFirst(&periodicThreads); pthr;
+         pthr = (periodic_threads *)ellNext(&pthr->node)) {
+        if (pthr->period == period)
+            break;
+    }
+    if (!pthr) {
+        pthr = dbCalloc(1, sizeof(periodic_threads));
+        pthr->period = period;
+        ellAdd(&periodicThreads, &pthr->node);
+    }
+    pthr->nThreads = nThreads;
+    return 0;
+}
+
+static double timingPercentile(const scan_timing *pt, double fraction)
+{
+    return dbLatencyPercentile(pt->histogram, pt->cycles, pt->durationMax,
+        fraction);
+}
+
+/* Called with the scan_list::lock held */
+static void timingSlowest(scan_timing *pt, struct dbCommon *precord,
+    double time)
+{
+    dbLatencyWorstAdd(pt->slowest, &pt->nSlowest, SCAN_STATS_SLOWEST,
+        time, precord, NULL);
+}
+
+static void timingCycle(periodic_scan_list *ppsl, double late,
+    double duration)
+{
+    scan_timing *pt = &ppsl->timing;
+
+    if (late < 0.0)
+        late = 0.0;
+
+    epicsMutexMustLock(ppsl->scan_list.lock);
+    pt->cycles++;
+    pt->lateSum += late;
+    if (late > pt->lateMax)
+        pt->lateMax = late;
+    pt->durationLast = duration;
+    if (duration > pt->durationMax)
+        pt->durationMax = duration;
+    pt->histogram[dbLatencyBucket(duration)]++;
+    epicsMutexUnlock(ppsl->scan_list.lock);
+}
+
+static periodic_scan_list *findPeriodic(double period)
+{
+    int i;
+
+    for (i = 0; i < nPeriodic; i++) {
+        periodic_scan_list *ppsl = papPeriodic[i];
+
+        if (ppsl && fabs(period - ppsl->period) < 1e-3 * ppsl->period)
+            return ppsl;
+    }
+    return NULL;
+}
+
+int scanPeriodicStatus(double period, int reset, scanPeriodicStats *result)
+{
+    periodic_scan_list *ppsl;
+    scan_timing *pt;
+    int i;
+
+    if (!papPeriodic)
+        return -1;
+    ppsl = findPeriodic(period);
+    if (!ppsl)
+        return -2;
+    pt = &ppsl->timing;
+
+    epicsMutexMustLock(ppsl->scan_list.lock);
+    if (result) {
+        result->period = ppsl->period;
+        result->nThreads = ppsl->nThreads;
+        result->cycles = pt->cycles;
+        result->overruns = ppsl->overruns;
+        result->lateMean = pt->cycles ? pt->lateSum / pt->cycles : 0.0;
+        result->lateMax = pt->lateMax;
+        result->durationLast = pt->durationLast;
+        result->durationP50 = timingPercentile(pt, 0.50);
+        result->durationP99 = timingPercentile(pt, 0.99);
+        result->durationMax = pt->durationMax;
+        result->nSlowest = pt->nSlowest;
+        for (i = 0; i < pt->nSlowest; i++) {
+            result->slowest[i].precord = (struct dbCommon *)pt->slowest[i].key;
+            result->slowest[i].time = pt->slowest[i].time;
+        }
+    }
+    if (reset)
+        memset(pt, 0, sizeof(*pt));
+    epicsMutexUnlock(ppsl->scan_list.lock);
+    return 0;
+}
+
+void scanPeriodicShow(double period, int reset)
+{
+    int i, j;
+
+    if (!papPeriodic) {
+        fprintf(stderr, "scanPeriodicShow: dbScan subsystem not "
+            "initialized\n");
+        return;
+    }
+    if (period > 0.0 && !findPeriodic(period)) {
+        fprintf(stderr, "scanPeriodicShow: No periodic scan list with "
+            "period %g\n", period);
+        return;
+    }
+
+    for (i = 0; i < nPeriodic; i++) {
+        periodic_scan_list *ppsl = papPeriodic[i];
+        scanPeriodicStats stats;
+
+        if (!ppsl ||
+            (period > 0.0 && ppsl != findPeriodic(period)) ||
+            (period <= 0.0 && !ellCount(&ppsl->scan_list.list)))
+            continue;
+        scanPeriodicStatus(ppsl->period, reset, &stats);
+
+        printf("SCAN = '%s': %lu cycles, %lu over-runs",
+            ppsl->name, stats.cycles, stats.overruns);
+        if (stats.nThreads > 1)
+            printf(", %d threads", stats.nThreads);
+        printf("\n");
+        printf("    Start delay  mean %.6f  max %.6f\n",
+            stats.lateMean, stats.lateMax);
+        printf("    Duration     last %.6f  p50 %.6f  p99 %.6f  max %.6f\n",
+            stats.durationLast, stats.durationP50, stats.durationP99,
+            stats.durationMax);
+        if (stats.nSlowest) {
+            printf("    Slowest records (dbProcess seconds):\n");
+            for (j = 0; j < stats.nSlowest; j++)
+                printf("        %.6f  %s\n", stats.slowest[j].time,
+                    stats.slowest[j].precord->name);
+        }
+    }
+    if (!scanRecordTiming)
+        printf("Set scanRecordTiming=1 to find the slowest records\n");
+}
+
 int scanppl(double period)      /* print periodic scan list(s) */
 {
     dbMenu *pmenu = dbFindMenu(pdbbase, "menuScan");
@@ -401,13 +700,50 @@ int scanppl(double period)      /* print periodic scan list(s) */
             (fabs(period - ppsl->period) > 0.05))
             continue;
 
-        sprintf(message, "Records with SCAN = '%s' (%lu over-runs):",
-            ppsl->name, ppsl->overruns);
+        if (ppsl->nThreads > 1)
+            sprintf(message, "Records with SCAN = '%s' (%lu over-runs, "
+                "%d threads):", ppsl->name, ppsl->overruns, ppsl->nThreads);
+        else
+            sprintf(message, "Records with SCAN = '%s' (%lu over-runs):",
+                ppsl->name, ppsl->overruns);
         printList(&ppsl->scan_list, message);
     }
     return 0;
 }
 
+int scanEventStatus(EVENTPVT pel, int reset, scanEventStats *result)
+{
+    int prio;
+
+    if (!pel)
+        return -1;
+    if (result) {
+        result->posts = epicsAtomicGetSizeT(&pel->posts);
+        result->dropped = epicsAtomicGetSizeT(&pel->dropped);
+    }
+    if (reset) {
+        epicsAtomicSetSizeT(&pel->posts, 0);
+        epicsAtomicSetSizeT(&pel->dropped, 0);
+    }
+    for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
+        scan_list *psl = &pel->scan_list[prio];
+        event_stats *pstats = &pel->stats[prio];
+
+        epicsMutexMustLock(psl->lock);
+        if (result) {
+            result->prio[prio].runs = pstats->runs;
+            result->prio[prio].records = pstats->records;
+            result->prio[prio].timeMean = pstats->runs ?
+                pstats->timeSum / pstats->runs : 0.0;
+            result->prio[prio].timeMax = pstats->timeMax;
+        }
+        if (reset)
+            memset(pstats, 0, sizeof(*pstats));
+        epicsMutexUnlock(psl->lock);
+    }
+    return 0;
+}
+
 int scanpel(const char* eventname)   /* print event list */
 {
     char message[80];
@@ -416,10 +752,20 @@ int scanpel(const char* eventname)   /* print event list */
 
     for (pel = pevent_list[0]; pel; pel = pel->next) {
         if (!eventname || epicsStrGlobMatch(pel->eventname, eventname)) {
-            printf("Event \"%s\"\n", pel->eventname);
+            scanEventStats stats;
+
+            scanEventStatus(pel, 0, &stats);
+            printf("Event \"%s\": %lu posts", pel->eventname,
+                (unsigned long)stats.posts);
+            if (stats.dropped)
+                printf(", %lu dropped", (unsigned long)stats.dropped);
+            printf("\n");
             for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
                 if (ellCount(&pel->scan_list[prio].list) == 0) continue;
-                sprintf(message, " Priority %s", priorityName[prio]);
+                sprintf(message, " Priority %s: %lu runs, %lu records, "
+                    "time mean %.6f max %.6f", priorityName[prio],
+                    stats.prio[prio].runs, stats.prio[prio].records,
+                    stats.prio[prio].timeMean, stats.prio[prio].timeMax);
                 printList(&pel->scan_list[prio], message);
             }
         }
@@ -440,10 +786,17 @@ int scanpiol(void)                  /* print pioscan_list */
 
         for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
             io_scan_list *piosl = &piosh->iosl[prio];
-            char message[80];
-
-            sprintf(message, "IO Event %p: Priority %s",
-                piosh, priorityName[prio]);
+            char message[128];
+
+            if (piosh->coalesce)
+                sprintf(message, "IO Event %p: Priority %s: %lu requests, "
+                    "%lu coalesced", piosh, priorityName[prio],
+                    (unsigned long)epicsAtomicGetSizeT(&piosl->requests),
+                    (unsigned long)epicsAtomicGetSizeT(&piosl->coalesced));
+            else
+                sprintf(message, "IO Event %p: Priority %s: %lu requests",
+                    piosh, priorityName[prio],
+                    (unsigned long)epicsAtomicGetSizeT(&piosl->requests));
             printList(&piosl->scan_list, message);
         }
         piosh = piosh->next;
@@ -454,10 +807,50 @@ int scanpiol(void)                  /* print pioscan_list */
 
 static void eventCallback(epicsCallback *pcallback)
 {
+    event_list *pel;
+    int prio;
     scan_list *psl;
+    event_stats *pstats;
+    epicsUInt64 start;
+    int count;
+    double time;
+
+    callbackGetUser(pel, pcallback);
+    callbackGetPriority(prio, pcallback);
+    psl = &pel->scan_list[prio];
+    pstats = &pel->stats[prio];
 
-    callbackGetUser(psl, pcallback);
+    epicsMutexMustLock(psl->lock);
+    count = ellCount(&psl->list);
+    epicsMutexUnlock(psl->lock);
+
+    start = epicsMonotonicGet();
     scanList(psl);
+    time = (epicsMonotonicGet() - start) * 1e-9;
+
+    epicsMutexMustLock(psl->lock);
+    pstats->runs++;
+    pstats->records += count;
+    pstats->timeSum += time;
+    if (time > pstats->timeMax)
+        pstats->timeMax = time;
+    epicsMutexUnlock(psl->lock);
+}
+
+/* Search a hash chain, without locking */
+static event_list *eventFind(unsigned hash, const char *eventname,
+    size_t namelength)
+{
+    event_list *pel = (event_list *)
+        epicsAtomicGetPtrT((EpicsAtomicPtrT *)&event_hash[hash]);
+
+    epicsAtomicReadMemoryBarrier();
+    for (; pel; pel = pel->hashNext) {
+        if (strncmp(pel->eventname, eventname, namelength) == 0
+            && pel->eventname[namelength] == 0)
+            break;
+    }
+    return pel;
 }
 
 static void eventOnce(void *arg)
@@ -472,6 +865,8 @@ event_list *eventNameToHandle(const char *eventname)
     static epicsThreadOnceId onceId = EPICS_THREAD_ONCE_INIT;
     double eventnumber = 0;
     size_t namelength;
+    char number[16];
+    unsigned hash;
 
     if (!eventname) return NULL;
     while (isspace((int) eventname[0])) eventname++;
@@ -497,34 +892,40 @@ event_list *eventNameToHandle(const char *eventname)
         else
             eventnumber = 0; /* not a numeric event between 1 and 255 */
     }
+    if (eventnumber > 0) {
+        /* backward compatibility: make all numeric events look like integers */
+        sprintf(number, "%i", (int)eventnumber);
+        eventname = number;
+        namelength = strlen(number);
+    }
+
+    hash = epicsMemHash(eventname, namelength, 0) & (EVENT_HASH_SIZE - 1);
+    pel = eventFind(hash, eventname, namelength);
+    if (pel)
+        return pel;
 
     epicsThreadOnce(&onceId, eventOnce, NULL);
     epicsMutexMustLock(event_lock);
-    for (pel = pevent_list[0]; pel; pel=pel->next) {
-        if (strncmp(pel->eventname, eventname, namelength) == 0
-            && pel->eventname[namelength] == 0)
-            break;
-    }
+    pel = eventFind(hash, eventname, namelength);
     if (pel == NULL) {
         pel = calloc(1, sizeof(event_list) + namelength);
         if (!pel)
             goto done;
-        if (eventnumber > 0) {
-            /* backward compatibility: make all numeric events look like integers */
-            sprintf(pel->eventname, "%i", (int)eventnumber);
-            pevent_list[(int)eventnumber] = pel;
-        }
-        else
-            strncpy(pel->eventname, eventname, namelength);
+        strncpy(pel->eventname, eventname, namelength);
         for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-            callbackSetUser(&pel->scan_list[prio], &pel->callback[prio]);
+            callbackSetUser(pel, &pel->callback[prio]);
             callbackSetPriority(prio, &pel->callback[prio]);
             callbackSetCallback(eventCallback, &pel->callback[prio]);
             pel->scan_list[prio].lock = epicsMutexMustCreate();
             ellInit(&pel->scan_list[prio].list);
         }
         pel->next=pevent_list[0];
+        pel->hashNext = event_hash[hash];
+        epicsAtomicWriteMemoryBarrier();
         pevent_list[0]=pel;
+        epicsAtomicSetPtrT((EpicsAtomicPtrT *)&event_hash[hash], pel);
+        if (eventnumber > 0)
+            pevent_list[(int)eventnumber] = pel;
     }
 done:
     epicsMutexUnlock(event_lock);
@@ -537,9 +938,11 @@ void postEvent(event_list *pel)
 
     if (scanCtl != ctlRun) return;
     if (!pel) return;
+    epicsAtomicIncrSizeT(&pel->posts);
     for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-        if (ellCount(&pel->scan_list[prio].list) >0)
-            callbackRequest(&pel->callback[prio]);
+        if (ellCount(&pel->scan_list[prio].list) >0 &&
+            callbackRequest(&pel->callback[prio]))
+            epicsAtomicIncrSizeT(&pel->dropped);
     }
 }
 
@@ -606,6 +1009,37 @@ void scanIoInit(IOSCANPVT *pioscanpvt)
     *pioscanpvt = piosh;
 }
 
+/* Queue a scan unless one is already queued, or will be queued when the
+ * running scan finishes.  Returns 1 only if this call queued the scan,
+ * 0 if callbackRequest() failed or the request was merged into another.
+ */
+static int ioscanCoalesce(io_scan_list *piosl)
+{
+    for (;;) {
+        int state = epicsAtomicGetIntT(&piosl->state);
+
+        switch (state) {
+        case ioscanIdle:
+            if (epicsAtomicCmpAndSwapIntT(&piosl->state, state,
+                    ioscanQueued) != state)
+                continue;
+            if (callbackRequest(&piosl->callback)) {
+                epicsAtomicSetIntT(&piosl->state, ioscanIdle);
+                return 0;
+            }
+            return 1;
+        case ioscanRunning:
+            if (epicsAtomicCmpAndSwapIntT(&piosl->state, state,
+                    ioscanRepeat) != state)
+                continue;
+            return 0;
+        default:
+            epicsAtomicIncrSizeT(&piosl->coalesced);
+            return 0;
+        }
+    }
+}
+
 /* Return a bit mask indicating each priority level
  * in which a callback request was successfully queued.
  */
@@ -620,9 +1054,15 @@ unsigned int scanIoRequest(IOSCANPVT piosh)
     for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
         io_scan_list *piosl = &piosh->iosl[prio];
 
-        if (ellCount(&piosl->scan_list.list) > 0)
+        if (ellCount(&piosl->scan_list.list) == 0)
+            continue;
+        epicsAtomicIncrSizeT(&piosl->requests);
+        if (!piosh->coalesce) {
             if (!callbackRequest(&piosl->callback))
                 queued |= 1 << prio;
+        }
+        else if (ioscanCoalesce(piosl))
+            queued |= 1 << prio;
     }
 
     return queued;
@@ -657,64 +1097,157 @@ void scanIoSetComplete(IOSCANPVT piosh, io_scan_complete cb, void *arg)
     piosh->arg = arg;
 }
 
+/* May not be called while a scan request is queued or running */
+void scanIoSetCoalesce(IOSCANPVT piosh, int coalesce)
+{
+    int prio;
+
+    piosh->coalesce = !!coalesce;
+    for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++)
+        epicsAtomicSetIntT(&piosh->iosl[prio].state, ioscanIdle);
+}
+
+static int oncePush(onceQueue *pq, const onceEntry *pent)
+{
+    size_t pos = epicsAtomicGetSizeT(&pq->tail);
+    onceSlot *pslot;
+    int used;
+
+    for (;;) {
+        size_t seq, prev;
+
+        if (pos - epicsAtomicGetSizeT(&pq->head) >= (size_t)onceQueueSize)
+            return 0;
+        pslot = &pq->slots[pos & (pq->ring - 1)];
+        seq = epicsAtomicGetSizeT(&pslot->seq);
+        epicsAtomicReadMemoryBarrier();
+        if (seq != pos) {
+            /* Another producer claimed pos, or the consumer hasn't
+             * finished with the slot yet */
+            if ((ptrdiff_t)(seq - pos) < 0)
+                return 0;
+            pos = epicsAtomicGetSizeT(&pq->tail);
+            continue;
+        }
+        prev = epicsAtomicCmpAndSwapSizeT(&pq->tail, pos, pos + 1);
+        if (prev == pos)
+            break;
+        pos = prev;
+    }
+    pslot->ent = *pent;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetSizeT(&pslot->seq, pos + 1);
+
+    used = (int)(pos + 1 - epicsAtomicGetSizeT(&pq->head));
+    if (used > epicsAtomicGetIntT(&pq->maxUsed))
+        epicsAtomicSetIntT(&pq->maxUsed, used);
+    return 1;
+}
+
+/* Take up to max entries, called by the queue's onceTask() only */
+static unsigned oncePopBatch(onceQueue *pq, onceEntry *batch, unsigned max)
+{
+    size_t pos = pq->head;
+    unsigned n = 0;
+
+    while (n < max) {
+        onceSlot *pslot = &pq->slots[pos & (pq->ring - 1)];
+
+        if (epicsAtomicGetSizeT(&pslot->seq) != pos + 1)
+            break;
+        epicsAtomicReadMemoryBarrier();
+        batch[n++] = pslot->ent;
+        epicsAtomicWriteMemoryBarrier();
+        epicsAtomicSetSizeT(&pslot->seq, pos + pq->ring);
+        pos++;
+    }
+    epicsAtomicSetSizeT(&pq->head, pos);
+    return n;
+}
+
+static onceQueue *onceQueueFor(struct dbCommon *precord)
+{
+    /* Requests for one lock set are processed in order by one thread.
+     * dbLockGetLockId() only takes the record's spin lock.
+     */
+    if (nOnceQueues > 1 && precord->lset)
+        return &onceQueues[dbLockGetLockId(precord) % nOnceQueues];
+    return &onceQueues[0];
+}
+
 int scanOnce(struct dbCommon *precord) {
     return scanOnceCallback(precord, NULL, NULL);
 }
 
-typedef struct {
-    struct dbCommon *prec;
-    once_complete cb;
-    void *usr;
-} onceEntry;
-
 int scanOnceCallback(struct dbCommon *precord, once_complete cb, void *usr)
 {
     static int newOverflow = TRUE;
+    onceQueue *pq = onceQueueFor(precord);
     onceEntry ent;
     int pushOK;
 
     ent.prec = precord;
     ent.cb = cb;
     ent.usr = usr;
+    ent.queued = scanOnceLatencyTiming ? epicsMonotonicGet() : 0;
 
-    pushOK = epicsRingBytesPut(onceQ, (void*)&ent, sizeof(ent));
+    pushOK = oncePush(pq, &ent);
 
     if (!pushOK) {
-        if (newOverflow) errlogPrintf("scanOnce: Ring buffer overflow\n");
+        if (newOverflow) errlogPrintf("scanOnce: Queue overflow\n");
         newOverflow = FALSE;
         epicsAtomicIncrIntT(&onceQOverruns);
     } else {
         newOverflow = TRUE;
     }
-    epicsEventSignal(onceSem);
+    if (epicsAtomicGetIntT(&pq->sleeping) &&
+        epicsAtomicCmpAndSwapIntT(&pq->sleeping, 1, 0) == 1)
+        epicsEventSignal(pq->wake);
 
     return !pushOK;
 }
 
 static void onceTask(void *arg)
 {
+    onceQueue *pq = (onceQueue *)arg;
+    onceEntry batch[ONCE_BATCH];
+
     taskwdInsert(0, NULL, NULL);
     epicsEventSignal(startStopEvent);
 
     while (TRUE) {
+        unsigned n = oncePopBatch(pq, batch, ONCE_BATCH);
+        unsigned i;
+
+        if (!n) {
+            /* scanOnceCallback() checks sleeping after it queues */
+            epicsAtomicSetIntT(&pq->sleeping, 1);
+            n = oncePopBatch(pq, batch, ONCE_BATCH);
+            if (!n) {
+                epicsEventMustWait(pq->wake);
+                continue;
+            }
+            epicsAtomicSetIntT(&pq->sleeping, 0);
+        }
+
+        for (i = 0; i < n; i++) {
+            onceEntry *pent = &batch[i];
+
+            if (pent->prec == (void*)&exitOnce) goto shutdown;
 
-        epicsEventMustWait(onceSem);
-        while(1) {
-            onceEntry ent;
-            int bytes = epicsRingBytesGet(onceQ, (void*)&ent, sizeof(ent));
-            if(bytes==0)
-                break;
-            if(bytes!=sizeof(ent)) {
-                errlogPrintf("onceTask: received incomplete %d of %u\n",
-                             bytes, (unsigned)sizeof(ent));
-                continue; /* what to do? */
-            } else if (ent.prec == (void*)&exitOnce) goto shutdown;
-
-            dbScanLock(ent.prec);
-            dbProcess(ent.prec);
-            dbScanUnlock(ent.prec);
-            if(ent.cb)
-                ent.cb(ent.usr, ent.prec);
+            if (pent->queued) {
+                double wait = dbLatencySince(pent->queued);
+
+                epicsMutexMustLock(onceLatencyLock);
+                dbLatencyAdd(&onceLatency, wait, pent->prec, NULL);
+                epicsMutexUnlock(onceLatencyLock);
+            }
+
+            dbScanLock(pent->prec);
+            dbProcess(pent->prec);
+            dbScanUnlock(pent->prec);
+            if(pent->cb)
+                pent->cb(pent->usr, pent->prec);
         }
     }
 
@@ -729,28 +1262,99 @@ int scanOnceSetQueueSize(int size)
     return 0;
 }
 
+int scanOnceSetThreads(int nThreads)
+{
+    if (onceQueues) {
+        fprintf(stderr, "scanOnceSetThreads: Must be called before "
+            "iocInit\n");
+        return -1;
+    }
+    onceThreads = nThreads > 0 ? nThreads : 1;
+    return 0;
+}
+
 int scanOnceQueueStatus(const int reset, scanOnceQueueStats *result)
 {
     int ret;
-    if (!onceQ) return -1;
+    int i;
+
+    if (!onceQueues) return -1;
     if (result) {
-        result->size = epicsRingBytesSize(onceQ) / sizeof(onceEntry);
-        result->numUsed = epicsRingBytesUsedBytes(onceQ) / sizeof(onceEntry);
-        result->maxUsed = epicsRingBytesHighWaterMark(onceQ) / sizeof(onceEntry);
+        result->size = onceQueueSize * nOnceQueues;
+        result->numUsed = 0;
+        result->maxUsed = 0;
+        for (i = 0; i < nOnceQueues; i++) {
+            onceQueue *pq = &onceQueues[i];
+
+            result->numUsed += (int)(epicsAtomicGetSizeT(&pq->tail) -
+                epicsAtomicGetSizeT(&pq->head));
+            result->maxUsed += epicsAtomicGetIntT(&pq->maxUsed);
+        }
         result->numOverflow = epicsAtomicGetIntT(&onceQOverruns);
         ret = 0;
     } else {
         ret = -2;
     }
     if (reset) {
-        epicsRingBytesResetHighWaterMark(onceQ);
+        for (i = 0; i < nOnceQueues; i++) {
+            onceQueue *pq = &onceQueues[i];
+
+            epicsAtomicSetIntT(&pq->maxUsed,
+                (int)(epicsAtomicGetSizeT(&pq->tail) -
+                    epicsAtomicGetSizeT(&pq->head)));
+        }
     }
     return ret;
 }
 
+static void scanOnceShowLatency(const int reset)
+{
+    scanOnceLatencyStats lat;
+    int i;
+
+    scanOnceLatencyStatus(reset, &lat);
+    printf("PRIORITY  REQUESTS TIMED  MEAN WAIT  P50 WAIT  P99 WAIT  MAX WAIT\n");
+    printf("%8s  %14lu  %9.6f  %8.6f  %8.6f  %8.6f\n", "scanOnce",
+           lat.count, lat.mean, lat.p50, lat.p99, lat.max);
+    for (i = 0; i < lat.nWorst; i++)
+        printf("          %.6f  process %s\n", lat.worst[i].time,
+               lat.worst[i].precord->name);
+    if (!scanOnceLatencyTiming)
+        printf("Set scanOnceLatencyTiming=1 to time queued requests\n");
+}
+
+int scanOnceLatencyStatus(const int reset, scanOnceLatencyStats *result)
+{
+    dbLatency *pl = &onceLatency;
+    int i;
+
+    if (!onceQueues) return -1;
+    epicsMutexMustLock(onceLatencyLock);
+    if (result) {
+        result->count = pl->count;
+        result->mean = pl->count ? pl->sum / pl->count : 0.0;
+        result->p50 = dbLatencyPercentile(pl->histogram, pl->count, pl->max,
+            0.50);
+        result->p99 = dbLatencyPercentile(pl->histogram, pl->count, pl->max,
+            0.99);
+        result->max = pl->max;
+        result->nWorst = pl->nWorst;
+        for (i = 0; i < pl->nWorst; i++) {
+            result->worst[i].precord = (struct dbCommon *)pl->worst[i].key;
+            result->worst[i].time = pl->worst[i].time;
+        }
+    }
+    if (reset)
+        memset(pl, 0, sizeof(*pl));
+    epicsMutexUnlock(onceLatencyLock);
+    return 0;
+}
+
 void scanOnceQueueShow(const int reset)
 {
     scanOnceQueueStats stats;
+    int i;
+
     if (scanOnceQueueStatus(reset, &stats) == -1) {
         fprintf(stderr, "scanOnce system not initialized, yet. Please run "
             "iocInit before using this command.\n");
@@ -760,25 +1364,82 @@ void scanOnceQueueShow(const int reset)
         printf("%8s  %15d  %10d  %6d  %6.1f  %11d\n", "scanOnce", stats.maxUsed,
                stats.numUsed, stats.size, qusage,
                epicsAtomicGetIntT(&onceQOverruns));
+        printf("    THREAD  HIGH-WATER MARK  ITEMS IN Q\n");
+        for (i = 0; i < nOnceQueues; i++) {
+            onceQueue *pq = &onceQueues[i];
+            char name[20];
+
+            if (nOnceQueues > 1)
+                sprintf(name, "scanOnce-%d", i);
+            else
+                strcpy(name, "scanOnce");
+            printf("%10s  %15d  %10u\n", name,
+                   epicsAtomicGetIntT(&pq->maxUsed),
+                   (unsigned)(epicsAtomicGetSizeT(&pq->tail) -
+                       epicsAtomicGetSizeT(&pq->head)));
+        }
+        scanOnceShowLatency(reset);
     }
 }
 
 static void initOnce(void)
 {
     epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    unsigned ring = 1;
+    int i;
+
     opts.joinable = 1;
     opts.priority = epicsThreadPriorityScanLow + nPeriodic;
     opts.stackSize = epicsThreadStackBig;
-    if ((onceQ = epicsRingBytesLockedCreate(sizeof(onceEntry)*onceQueueSize)) == NULL) {
-        cantProceed("initOnce: Ring buffer create failed\n");
+
+    if (onceQueueSize < 1)
+        onceQueueSize = 1;
+    while (ring < (unsigned)onceQueueSize)
+        ring *= 2;
+
+    nOnceQueues = onceThreads;
+    onceQueues = dbCalloc(nOnceQueues, sizeof(onceQueue));
+    if(!onceLatencyLock)
+        onceLatencyLock = epicsMutexMustCreate();
+    memset(&onceLatency, 0, sizeof(onceLatency));
+
+    for (i = 0; i < nOnceQueues; i++) {
+        onceQueue *pq = &onceQueues[i];
+        char name[20];
+        unsigned j;
+
+        pq->ring = ring;
+        pq->slots = dbCalloc(ring, sizeof(onceSlot));
+        for (j = 0; j < ring; j++)
+            pq->slots[j].seq = j;
+        pq->wake = epicsEventMustCreate(epicsEventEmpty);
+        if (nOnceQueues > 1)
+            sprintf(name, "scanOnce-%d", i);
+        else
+            strcpy(name, "scanOnce");
+        pq->tid = epicsThreadCreateOpt(name, onceTask, pq, &opts);
+        if (!pq->tid)
+            cantProceed("initOnce: Failed to spawn %s\n", name);
+
+        epicsEventWait(startStopEvent);
     }
-    if(!onceSem)
-        onceSem = epicsEventMustCreate(epicsEventEmpty);
-    onceTaskId = epicsThreadCreateOpt("scanOnce", onceTask, 0, &opts);
+}
 
-    epicsEventWait(startStopEvent);
+static void deleteOnce(void)
+{
+    int i;
+
+    for (i = 0; i < nOnceQueues; i++) {
+        onceQueue *pq = &onceQueues[i];
+
+        free(pq->slots);
+        epicsEventDestroy(pq->wake);
+    }
+    free(onceQueues);
+    onceQueues = NULL;
+    nOnceQueues = 0;
 }
-
+
 static void periodicTask(void *arg)
 {
     periodic_scan_list *ppsl = (periodic_scan_list *)arg;
@@ -800,8 +1461,18 @@ static void periodicTask(void *arg)
         double delay;
         epicsTimeStamp now;
 
-        if (ppsl->scanCtl == ctlRun)
-            scanList(&ppsl->scan_list);
+        if (ppsl->scanCtl == ctlRun) {
+            epicsTimeStamp start, stop;
+
+            epicsTimeGetMonotonic(&start);
+            if (ppsl->nThreads > 1)
+                scanPartitioned(ppsl);
+            else
+                scanList(&ppsl->scan_list);
+            epicsTimeGetMonotonic(&stop);
+            timingCycle(ppsl, epicsTimeDiffInSeconds(&start, &next),
+                epicsTimeDiffInSeconds(&stop, &start));
+        }
 
         epicsTimeAddSeconds(&next, ppsl->period);
         epicsTimeGetMonotonic(&now);
@@ -846,15 +1517,146 @@ static void periodicTask(void *arg)
         epicsEventWaitWithTimeout(ppsl->loopEvent, delay);
     }
 
+    if (ppsl->nThreads > 1) {
+        int i;
+
+        for (i = 1; i < ppsl->nThreads; i++) {
+            ppsl->partitions[i].exit = TRUE;
+            epicsEventMustTrigger(ppsl->partitions[i].start);
+        }
+        for (i = 1; i < ppsl->nThreads; i++)
+            epicsThreadMustJoin(ppsl->partitions[i].tid);
+    }
+
     taskwdRemove(0);
     epicsEventSignal(startStopEvent);
 }
 
+/* Sort the records of a periodic list into its partitions by lockSet,
+ * keeping the PHAS order within each partition.
+ */
+static void partitionList(periodic_scan_list *ppsl)
+{
+    scan_list *psl = &ppsl->scan_list;
+    size_t recompute = dbLockRecomputeCount();
+    scan_element *pse;
+    int i;
+
+    epicsMutexMustLock(psl->lock);
+    if (ppsl->partitioned &&
+        ppsl->generation == psl->generation &&
+        ppsl->recompute == recompute) {
+        epicsMutexUnlock(psl->lock);
+        return;
+    }
+
+    for (i = 0; i < ppsl->nThreads; i++)
+        ppsl->partitions[i].count = 0;
+
+    for (pse = (scan_element *)ellFirst(&psl->list); pse;
+         pse = (scan_element *)ellNext(&pse->node)) {
+        periodic_partition *ppart = &ppsl->partitions[
+            dbLockGetLockId(pse->precord) % ppsl->nThreads];
+
+        if (ppart->count == ppart->size) {
+            ppart->size = ppart->size ? 2 * ppart->size : 64;
+            ppart->elements = realloc(ppart->elements,
+                ppart->size * sizeof(scan_element *));
+            if (!ppart->elements)
+                cantProceed("partitionList: out of memory\n");
+        }
+        ppart->elements[ppart->count++] = pse;
+    }
+    ppsl->partitioned = TRUE;
+    ppsl->generation = psl->generation;
+    ppsl->recompute = recompute;
+    epicsMutexUnlock(psl->lock);
+}
+
+static void scanPartition(periodic_partition *ppart)
+{
+    scan_list *psl = &ppart->ppsl->scan_list;
+    scan_timing *pt = psl->ptiming;
+    const int timed = scanRecordTiming;
+    unsigned i;
+
+    for (i = 0; i < ppart->count; i++) {
+        scan_element *pse = ppart->elements[i];
+        struct dbCommon *precord = pse->precord;
+        epicsTimeStamp start, stop;
+        double time;
+
+        /* SCAN is changed with the record locked, so a record which
+         * has left this list since it was partitioned is skipped.
+         */
+        dbScanLock(precord);
+        if (pse->pscan_list != psl) {
+            dbScanUnlock(precord);
+            continue;
+        }
+        if (timed)
+            epicsTimeGetMonotonic(&start);
+        dbProcess(precord);
+        if (timed)
+            epicsTimeGetMonotonic(&stop);
+        dbScanUnlock(precord);
+
+        if (!timed)
+            continue;
+        time = epicsTimeDiffInSeconds(&stop, &start);
+        /* unlocked peek, the list only changes under the lock */
+        if (pt->nSlowest < SCAN_STATS_SLOWEST ||
+            time > pt->slowest[SCAN_STATS_SLOWEST - 1].time) {
+            epicsMutexMustLock(psl->lock);
+            timingSlowest(pt, precord, time);
+            epicsMutexUnlock(psl->lock);
+        }
+    }
+}
+
+static void partitionTask(void *arg)
+{
+    periodic_partition *ppart = (periodic_partition *)arg;
+    periodic_scan_list *ppsl = ppart->ppsl;
+
+    taskwdInsert(0, NULL, NULL);
+
+    while (TRUE) {
+        epicsEventMustWait(ppart->start);
+        if (ppart->exit)
+            break;
+
+        scanPartition(ppart);
+
+        if (epicsAtomicDecrIntT(&ppsl->nBusy) == 0)
+            epicsEventMustTrigger(ppsl->doneEvent);
+    }
+
+    taskwdRemove(0);
+}
+
+/* Process each partition on its own thread, and wait for them all */
+static void scanPartitioned(periodic_scan_list *ppsl)
+{
+    int i;
+
+    partitionList(ppsl);
+
+    epicsAtomicSetIntT(&ppsl->nBusy, ppsl->nThreads - 1);
+    for (i = 1; i < ppsl->nThreads; i++)
+        epicsEventMustTrigger(ppsl->partitions[i].start);
+
+    scanPartition(&ppsl->partitions[0]);
+
+    epicsEventMustWait(ppsl->doneEvent);
+}
+
 
 static void initPeriodic(void)
 {
     dbMenu *pmenu = dbFindMenu(pdbbase, "menuScan");
     double quantum = epicsThreadSleepQuantum();
+    periodic_threads *pthr;
     int i;
 
     if (!pmenu) {
@@ -901,9 +1703,16 @@ static void initPeriodic(void)
 
         ppsl->scan_list.lock = epicsMutexMustCreate();
         ellInit(&ppsl->scan_list.list);
+        ppsl->scan_list.ptiming = &ppsl->timing;
         ppsl->name = choice;
         ppsl->scanCtl = ctlPause;
         ppsl->loopEvent = epicsEventMustCreate(epicsEventEmpty);
+        ppsl->nThreads = periodicThreadsAll;
+        for (pthr = (periodic_threads *)ellFirst(&periodicThreads); pthr;
+             pthr = (periodic_threads *)ellNext(&pthr->node)) {
+            if (fabs(pthr->period - ppsl->period) < 1e-3 * ppsl->period)
+                ppsl->nThreads = pthr->nThreads;
+        }
 
         number = ppsl->period / quantum;
         if ((ppsl->period < 2 * quantum) ||
@@ -925,6 +1734,17 @@ static void deletePeriodic(void)
 
         if (!ppsl) continue;
         ellFree(&ppsl->scan_list.list);
+        if (ppsl->partitions) {
+            int j;
+
+            for (j = 0; j < ppsl->nThreads; j++) {
+                if (ppsl->partitions[j].start)
+                    epicsEventDestroy(ppsl->partitions[j].start);
+                free(ppsl->partitions[j].elements);
+            }
+            free(ppsl->partitions);
+            epicsEventDestroy(ppsl->doneEvent);
+        }
         epicsEventDestroy(ppsl->loopEvent);
         epicsMutexDestroy(ppsl->scan_list.lock);
         free(ppsl);
@@ -937,7 +1757,7 @@ static void deletePeriodic(void)
 static void spawnPeriodic(int ind)
 {
     periodic_scan_list *ppsl = papPeriodic[ind];
-    char taskName[20];
+    char taskName[32];
     epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
     opts.joinable = 1;
     opts.priority = epicsThreadPriorityScanLow + ind;
@@ -945,6 +1765,24 @@ static void spawnPeriodic(int ind)
 
     if (!ppsl) return;
 
+    if (ppsl->nThreads > 1) {
+        int i;
+
+        ppsl->partitions = dbCalloc(ppsl->nThreads,
+            sizeof(periodic_partition));
+        ppsl->doneEvent = epicsEventMustCreate(epicsEventEmpty);
+        ppsl->partitions[0].ppsl = ppsl;
+        for (i = 1; i < ppsl->nThreads; i++) {
+            periodic_partition *ppart = &ppsl->partitions[i];
+
+            ppart->ppsl = ppsl;
+            ppart->start = epicsEventMustCreate(epicsEventEmpty);
+            sprintf(taskName, "scan-%g-%d", ppsl->period, i);
+            ppart->tid = epicsThreadCreateOpt(
+                taskName, partitionTask, (void *)ppart, &opts);
+        }
+    }
+
     sprintf(taskName, "scan-%g", ppsl->period);
     periodicTaskId[ind] = epicsThreadCreateOpt(
         taskName, periodicTask, (void *)ppsl, &opts);
@@ -955,13 +1793,25 @@ static void spawnPeriodic(int ind)
 static void ioscanCallback(epicsCallback *pcallback)
 {
     ioscan_head *piosh;
+    io_scan_list *piosl;
     int prio;
 
     callbackGetUser(piosh, pcallback);
     callbackGetPriority(prio, pcallback);
-    scanList(&piosh->iosl[prio].scan_list);
+    piosl = &piosh->iosl[prio];
+    if (piosh->coalesce)
+        epicsAtomicSetIntT(&piosl->state, ioscanRunning);
+    scanList(&piosl->scan_list);
     if (piosh->cb)
         piosh->cb(piosh->arg, piosh, prio);
+    if (piosh->coalesce &&
+        epicsAtomicCmpAndSwapIntT(&piosl->state, ioscanRunning,
+            ioscanIdle) == ioscanRepeat) {
+        /* Requests arrived while running, scan once more for them */
+        epicsAtomicSetIntT(&piosl->state, ioscanQueued);
+        if (callbackRequest(&piosl->callback))
+            epicsAtomicSetIntT(&piosl->state, ioscanIdle);
+    }
 }
 
 static void printList(scan_list *psl, char *message)
@@ -998,6 +1848,7 @@ static void scanList(scan_list *psl)
     scan_element *pse;
     scan_element *prev = NULL;
     scan_element *next = NULL;
+    const int timed = psl->ptiming && scanRecordTiming;
 
     epicsMutexMustLock(psl->lock);
     psl->modified = FALSE;
@@ -1007,12 +1858,20 @@ static void scanList(scan_list *psl)
 
     while (pse) {
         struct dbCommon *precord = pse->precord;
+        epicsTimeStamp start, stop;
 
         dbScanLock(precord);
+        if (timed)
+            epicsTimeGetMonotonic(&start);
         dbProcess(precord);
+        if (timed)
+            epicsTimeGetMonotonic(&stop);
         dbScanUnlock(precord);
 
         epicsMutexMustLock(psl->lock);
+        if (timed)
+            timingSlowest(psl->ptiming, precord,
+                epicsTimeDiffInSeconds(&stop, &start));
         if (!psl->modified) {
             prev = pse;
             pse = (scan_element *)ellNext(&pse->node);
@@ -1088,6 +1947,7 @@ static void addToList(struct dbCommon *precord, scan_list *psl)
     }
     ellInsert(&psl->list, (ptemp ? &ptemp->node : NULL), &pse->node);
     psl->modified = TRUE;
+    psl->generation++;
     epicsMutexUnlock(psl->lock);
 }
 
@@ -1114,5 +1974,6 @@ static void deleteFromList(struct dbCommon *precord, scan_list *psl)
     pse->pscan_list = NULL;
     ellDelete(&psl->list, &pse->node);
     psl->modified = TRUE;
+    psl->generation++;
     epicsMutexUnlock(psl->lock);
 }
@@ -16,6 +16,7 @@
 #define INCdbScanH
 
 #include <limits.h>
+#include <stddef.h>
 
 #include "menuScan.h"
 #include "dbCoreAPI.h"
@@ -50,14 +51,91 @@ typedef struct scanOnceQueueStats {
     int numOverflow;
 } scanOnceQueueStats;
 
+#define SCAN_STATS_SLOWEST 10
+/* NUM_CALLBACK_PRIORITIES, without needing callback.h */
+#define SCAN_EVENT_PRIORITIES 3
+#define SCAN_STATS_WORST 5
+
+/** Set non-zero to time scanOnce() requests until they are processed */
+DBCORE_API extern int scanOnceLatencyTiming;
+
+/** @brief Time requests spent in the Once queue, see scanOnceLatencyStatus()
+ *
+ * Times are in seconds.  The percentiles are upper limits of
+ * histogram buckets, which are about 20% wide.
+ */
+typedef struct scanOnceLatencyStats {
+    unsigned long count;            /**< Requests timed since reset */
+    double mean;
+    double p50;
+    double p99;
+    double max;
+    int nWorst;
+    struct {
+        struct dbCommon *precord;
+        double time;                /**< Longest wait of this record */
+    } worst[SCAN_STATS_WORST];
+} scanOnceLatencyStats;
+
+/** Set non-zero to time dbProcess() of periodically scanned records */
+DBCORE_API extern int scanRecordTiming;
+
+/** @brief Timing of a periodic scan list, see scanPeriodicStatus()
+ *
+ * Times are in seconds.  The duration percentiles are upper limits of
+ * histogram buckets, which are about 20% wide.
+ */
+typedef struct scanPeriodicStats {
+    double period;
+    int nThreads;
+    unsigned long cycles;           /**< Scan cycles since reset */
+    unsigned long overruns;         /**< Total, as shown by scanppl */
+    double lateMean;                /**< Cycle start after its due time */
+    double lateMax;
+    double durationLast;            /**< Processing time of cycles */
+    double durationP50;
+    double durationP99;
+    double durationMax;
+    int nSlowest;                   /**< Needs scanRecordTiming set */
+    struct {
+        struct dbCommon *precord;
+        double time;                /**< Longest dbProcess() call */
+    } slowest[SCAN_STATS_SLOWEST];
+} scanPeriodicStats;
+
 DBCORE_API long scanInit(void);
 DBCORE_API void scanRun(void);
 DBCORE_API void scanPause(void);
 DBCORE_API void scanStop(void);
 DBCORE_API void scanCleanup(void);
 
+/** @brief Find or create the named event
+ *
+ * Finding an existing event doesn't take a lock.  The handle stays valid
+ * until the IOC exits, so drivers can look it up once and keep it.
+ */
 DBCORE_API EVENTPVT eventNameToHandle(const char* event);
 DBCORE_API void postEvent(EVENTPVT epvt);
+/** @brief Counters of a named event, see scanEventStatus()
+ *
+ * Times are in seconds, for processing the event's scan list once.
+ */
+typedef struct scanEventStats {
+    size_t posts;                   /**< postEvent() calls while running */
+    size_t dropped;                 /**< Callback queue was full */
+    struct {
+        unsigned long runs;         /**< Scan list processed */
+        unsigned long records;      /**< Records processed, summed */
+        double timeMean;
+        double timeMax;
+    } prio[SCAN_EVENT_PRIORITIES];
+} scanEventStats;
+/** @brief Read and optionally reset the counters of an event
+ *
+ * @return 0, or -1 if epvt is NULL
+ */
+DBCORE_API int scanEventStatus(EVENTPVT epvt, int reset,
+    scanEventStats *result);
 DBCORE_API void post_event(int event);
 DBCORE_API void scanAdd(struct dbCommon *);
 DBCORE_API void scanDelete(struct dbCommon *);
@@ -85,9 +163,46 @@ DBCORE_API int scanOnceCallback(struct dbCommon *prec, once_complete cb, void *u
  * @return Zero on success
  */
 DBCORE_API int scanOnceSetQueueSize(int size);
+/** @brief Process scanOnce() requests on several threads
+ *
+ * Each thread has its own queue of the size set by scanOnceSetQueueSize().
+ * Requests for records of one lock set always go to the same thread, so
+ * they are processed in order.  A lock set may move to another thread when
+ * a link change merges or splits lock sets.  Call before iocInit.
+ */
+DBCORE_API int scanOnceSetThreads(int nThreads);
 DBCORE_API int scanOnceQueueStatus(const int reset, scanOnceQueueStats *result);
+DBCORE_API int scanOnceLatencyStatus(const int reset,
+    scanOnceLatencyStats *result);
 DBCORE_API void scanOnceQueueShow(const int reset);
 
+/** @brief Process a periodic scan list on several threads
+ *
+ * Must be called prior to iocInit().  The records of the list are split
+ * by lock set between nThreads threads, and each scan cycle waits for
+ * all of them to finish.  PHAS ordering is only kept between records
+ * handled by the same thread.
+ *
+ * @param period Scan period in seconds, or 0.0 to set all periodic lists
+ * @param nThreads Threads per list, 1 to process the list serially
+ * @return Zero on success
+ */
+DBCORE_API int scanPeriodicSetThreads(double period, int nThreads);
+
+/** @brief Get timing statistics of a periodic scan list
+ *
+ * Safe to call from any thread, for example by device support which
+ * monitors the health of the scan lists.
+ *
+ * @param period Scan period in seconds
+ * @param reset Clear the statistics after reading them
+ * @param result NULL or where to store the statistics
+ * @return Zero on success, -1 before iocInit(), -2 for an unknown period
+ */
+DBCORE_API int scanPeriodicStatus(double period, int reset,
+    scanPeriodicStats *result);
+DBCORE_API void scanPeriodicShow(double period, int reset);
+
 /*print periodic lists*/
 DBCORE_API int scanppl(double rate);
 
@@ -131,6 +246,25 @@ DBCORE_API unsigned int scanIoImmediate(IOSCANPVT pios, int prio);
  * @since 3.15.0.2
  */
 DBCORE_API void scanIoSetComplete(IOSCANPVT, io_scan_complete, void *usr);
+/** @brief Collapse bursts of scanIoRequest() calls
+ *
+ * When enabled, a scanIoRequest() made while a scan of the same priority
+ * is queued doesn't queue another, and requests made while the scan is
+ * running queue only one more scan after it.  The records are processed
+ * at least once after each request, but not once per request.
+ * scanpiol shows how many requests were coalesced.
+ *
+ * scanIoRequest() then only sets the bit for a priority when that call
+ * queued a scan, so a zero bit no longer implies that the request failed.
+ * The scanIoSetComplete() callback runs once for each scan, which includes
+ * the one extra scan for requests made while a scan was running, so it may
+ * be called more often than scanIoRequest() returned a bit.
+ *
+ * @param pios The scan list
+ * @param coalesce Non-zero to enable
+ * @since 7.0.9
+ */
+DBCORE_API void scanIoSetCoalesce(IOSCANPVT pios, int coalesce);
 
 #ifdef __cplusplus
 }
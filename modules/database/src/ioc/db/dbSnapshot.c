@@ -0,0 +1,90 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Lock-free read snapshots of scalar VAL fields, see dbSnapshotPvt.h */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbDefs.h"
+#include "epicsAtomic.h"
+#include "errlog.h"
+
+#include "epicsExport.h"
+#include "dbAccessDefs.h"
+#include "dbBase.h"
+#include "dbCommon.h"
+#include "dbFldTypes.h"
+#include "special.h"
+#include "dbSnapshotPvt.h"
+
+/* Readers give up and lock after this many changes under them */
+#define SNAPSHOT_TRIES 4
+
+int dbReadSnapshots = 0;
+epicsExportAddress(int, dbReadSnapshots);
+
+void dbSnapshotInit(dbCommon *prec)
+{
+    dbFldDes *pfldDes = prec->rdes->pvalFldDes;
+    dbSnapshot *psnap;
+
+    if (!dbReadSnapshots || prec->snap || !pfldDes ||
+        pfldDes->special == SPC_DBADDR)
+        return;
+    if (pfldDes->field_type == DBF_STRING) {
+        if (pfldDes->size > MAX_STRING_SIZE)
+            return;
+    }
+    else if (pfldDes->field_type < DBF_CHAR ||
+        pfldDes->field_type > DBF_ENUM)
+        return;
+
+    psnap = calloc(1, sizeof(*psnap));
+    if (!psnap) {
+        errlogPrintf("dbSnapshotInit: No memory for %s\n", prec->name);
+        return;
+    }
+    psnap->field_type = pfldDes->field_type;
+    psnap->size = pfldDes->size;
+    psnap->offset = pfldDes->offset;
+    prec->snap = psnap;
+    dbSnapshotUpdate(prec);
+}
+
+void dbSnapshotUpdate(dbCommon *prec)
+{
+    dbSnapshot *psnap = prec->snap;
+    size_t seq = psnap->seq;
+
+    epicsAtomicSetSizeT(&psnap->seq, seq + 1);
+    epicsAtomicWriteMemoryBarrier();
+    psnap->stat = prec->stat;
+    psnap->sevr = prec->sevr;
+    psnap->time = prec->time;
+    memcpy(&psnap->value, (char *)prec + psnap->offset, psnap->size);
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetSizeT(&psnap->seq, seq + 2);
+}
+
+int dbSnapshotRead(const dbCommon *prec, dbSnapshot *pcopy)
+{
+    dbSnapshot *psnap = prec->snap;
+    int tries;
+
+    for (tries = 0; tries < SNAPSHOT_TRIES; tries++) {
+        size_t seq = epicsAtomicGetSizeT(&psnap->seq);
+
+        if (seq & 1)
+            continue;
+        epicsAtomicReadMemoryBarrier();
+        *pcopy = *psnap;
+        epicsAtomicReadMemoryBarrier();
+        if (epicsAtomicGetSizeT(&psnap->seq) == seq)
+            return 0;
+    }
+    return -1;
+}
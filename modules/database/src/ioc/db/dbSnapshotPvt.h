@@ -0,0 +1,55 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Copies of a record's scalar VAL with its alarm status and time stamp,
+ * which channel access reads without taking the record's lock.
+ *
+ * Writers hold the lock set's dbScanLock(), so there is only ever one.
+ * Readers retry while the sequence count is odd or changes under them.
+ */
+
+#ifndef DBSNAPSHOTPVT_H
+#define DBSNAPSHOTPVT_H
+
+#include <stddef.h>
+
+#include "epicsTime.h"
+#include "epicsTypes.h"
+#include "dbDefs.h"
+
+struct dbCommon;
+
+typedef struct dbSnapshot {
+    size_t              seq;        /* odd while being written */
+    short               field_type; /* DBF type of VAL */
+    unsigned short      size;
+    unsigned short      offset;     /* of VAL in the record */
+    epicsEnum16         stat;
+    epicsEnum16         sevr;
+    epicsTimeStamp      time;
+    union {
+        epicsFloat64    d;
+        epicsInt64      q;
+        char            s[MAX_STRING_SIZE];
+    } value;
+} dbSnapshot;
+
+/* Called by iocInit() after init_record(), gives the record a snapshot
+ * if dbReadSnapshots is set and its VAL field can be copied.
+ */
+void dbSnapshotInit(struct dbCommon *prec);
+
+/* Copy the record's fields, caller holds dbScanLock() and has checked
+ * that prec->snap is set.
+ */
+void dbSnapshotUpdate(struct dbCommon *prec);
+
+/* Take a consistent copy without the lock.  Returns 0 on success, or
+ * non-zero when a writer kept changing it and the caller should lock.
+ */
+int dbSnapshotRead(const struct dbCommon *prec, dbSnapshot *pcopy);
+
+#endif /* DBSNAPSHOTPVT_H */
@@ -38,9 +38,11 @@
 #include "dbBase.h"
 #include "dbChannel.h"
 #include "dbCommon.h"
+#include "dbConvertFast.h"
 #include "dbEvent.h"
 #include "dbLock.h"
 #include "dbNotify.h"
+#include "dbSnapshotPvt.h"
 #include "dbStaticLib.h"
 #include "recSup.h"
 
@@ -137,6 +139,72 @@ int dbChannel_get(struct dbChannel *chan,
     return result;
 }
 
+/* Offsets of the value, and the new DBR types, of the plain, STS and
+ * TIME requests that can be read from a record's snapshot.
+ */
+static const struct {
+    unsigned short offset;
+    short dbrType;
+} snapshotTypes[oldDBR_TIME_DOUBLE + 1] = {
+    {0, DBR_STRING}, {0, DBR_SHORT}, {0, DBR_FLOAT}, {0, DBR_ENUM},
+    {0, DBR_CHAR}, {0, DBR_LONG}, {0, DBR_DOUBLE},
+    {offsetof(struct dbr_sts_string, value), DBR_STRING},
+    {offsetof(struct dbr_sts_short, value), DBR_SHORT},
+    {offsetof(struct dbr_sts_float, value), DBR_FLOAT},
+    {offsetof(struct dbr_sts_enum, value), DBR_ENUM},
+    {offsetof(struct dbr_sts_char, value), DBR_CHAR},
+    {offsetof(struct dbr_sts_long, value), DBR_LONG},
+    {offsetof(struct dbr_sts_double, value), DBR_DOUBLE},
+    {offsetof(struct dbr_time_string, value), DBR_STRING},
+    {offsetof(struct dbr_time_short, value), DBR_SHORT},
+    {offsetof(struct dbr_time_float, value), DBR_FLOAT},
+    {offsetof(struct dbr_time_enum, value), DBR_ENUM},
+    {offsetof(struct dbr_time_char, value), DBR_CHAR},
+    {offsetof(struct dbr_time_long, value), DBR_LONG},
+    {offsetof(struct dbr_time_double, value), DBR_DOUBLE}
+};
+
+/* Serve a scalar read of a VAL field from the record's snapshot without
+ * taking its lock.  Returns non-zero if the caller must do it the slow
+ * way: no snapshot, filters, arrays, conversions that need the record
+ * support such as enum strings, or a writer busy with the snapshot.
+ */
+static int snapshotGet(struct dbChannel *chan, int buffer_type,
+    void *pbuffer, long *nRequest)
+{
+    dbCommon *precord = dbChannelRecord(chan);
+    dbSnapshot snap;
+    short dbrType;
+
+    if (!precord->snap || buffer_type < 0 ||
+        buffer_type > oldDBR_TIME_DOUBLE || *nRequest < 1 ||
+        dbChannelElements(chan) != 1 ||
+        dbChannelField(chan) != (char *)precord + precord->snap->offset ||
+        ellCount(&chan->pre_chain) || ellCount(&chan->post_chain))
+        return -1;
+
+    dbrType = snapshotTypes[buffer_type].dbrType;
+    if ((dbrType == DBR_STRING) != (precord->snap->field_type == DBF_STRING))
+        return -1;
+
+    if (dbSnapshotRead(precord, &snap) ||
+        dbFastGetConvertRoutine[snap.field_type][dbrType](&snap.value,
+            (char *)pbuffer + snapshotTypes[buffer_type].offset,
+            &chan->addr))
+        return -1;
+
+    if (buffer_type >= oldDBR_STS_STRING) {
+        struct dbr_time_string *pold = (struct dbr_time_string *)pbuffer;
+
+        pold->status = snap.stat;
+        pold->severity = snap.sevr;
+        if (buffer_type >= oldDBR_TIME_STRING)
+            pold->stamp = snap.time;    /* structure copy */
+    }
+    *nRequest = 1;
+    return 0;
+}
+
 /* Performs the work of the public db_get_field API, but also returns the number
  * of elements actually copied to the buffer.  The caller is responsible for
  * zeroing the remaining part of the buffer. */
@@ -154,6 +222,9 @@ int dbChannel_get_count(
     * in the dbAccess.c dbGet() and getOptions() routines.
     */
 
+    if (!pfl && !snapshotGet(chan, buffer_type, pbuffer, nRequest))
+        return 0;
+
     dbScanLock(dbChannelRecord(chan));
 
     switch(buffer_type) {
@@ -100,6 +100,8 @@ struct dbfl_val {
  * must explicitly call the dtor function.
  * If the dtor is NULL and no_elements > 0, then this means the array
  * data is still owned by a record. See the macro dbfl_has_copy below.
+ * Array data from a dbArraySnapshot (see dbEvent.h) is shared with
+ * other field logs, and must not be modified.
  */
 struct dbfl_ref {
     void              *pvt;   /* Private pointer */
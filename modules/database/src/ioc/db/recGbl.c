@@ -42,6 +42,7 @@
 #include "dbLink.h"
 #include "dbNotify.h"
 #include "dbScan.h"
+#include "dbSnapshotPvt.h"
 #include "devSup.h"
 #include "link.h"
 #include "recGbl.h"
@@ -283,6 +284,9 @@ void recGblFwdLink(void *precord)
 {
     dbCommon *pdbc = precord;
 
+    /* Async records complete here rather than in dbProcess() */
+    if (pdbc->snap)
+        dbSnapshotUpdate(pdbc);
     dbScanFwdLink(&pdbc->flnk);
     /*Handle dbPutFieldNotify record completions*/
     if(pdbc->ppn) dbNotifyCompletion(pdbc);
@@ -0,0 +1,761 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Binary cache of the records loaded by dbLoadRecords()
+ *
+ * A cache file holds the record, field, info and alias definitions that
+ * one .db file produced with one set of macro substitutions, as the
+ * strings the parser finally handed to dbStaticLib.  Loading it again
+ * skips reading the text through macLib and the parser.
+ *
+ * The file is named after a hash of the file name, search path and
+ * substitutions.  It is only used if it was made with the same record
+ * types, menus and device support, and if every file the parser read
+ * is still the same.  For that each file's name is kept as the parser
+ * was given it, with the search path in effect, and looked up again:
+ * it must lead to the same path, and the contents there must not have
+ * changed.  Otherwise the file is parsed and the cache written again.
+ *
+ * Layout, in host byte order:
+ *   "EPICSDBC", u32 byte order, u32 version, u64 dbd hash,
+ *   strings: file name, search path, substitutions
+ *   operations: u8 op, strings...; ending with dbCacheEnd
+ *   u32 records, f64 parse time, u32 files,
+ *     {string name, string search path, string path, u64 hash}...
+ *   u64 hash of all the above
+ * Strings are a u32 length, including the nil, then the characters.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbDefs.h"
+#include "ellLib.h"
+#include "epicsStdio.h"
+#include "epicsString.h"
+#include "epicsTime.h"
+#include "epicsTypes.h"
+#include "errlog.h"
+#include "macLib.h"
+#include "osiFileName.h"
+
+#include "dbBase.h"
+#include "dbStaticLib.h"
+#include "dbStaticPvt.h"
+#include "dbCachePvt.h"
+#include "iocInit.h"
+
+#define CACHE_MAGIC     "EPICSDBC"
+#define CACHE_ORDER     0x01020304u
+#define CACHE_VERSION   2u
+
+#define HASH_INIT       14695981039346656037ull
+#define HASH_PRIME      1099511628211ull
+
+static const int opArgs[dbCacheOps] = {0, 2, 2, 1, 1, 2, 2, 1, 2};
+
+struct dbCacheFile {
+    ELLNODE         node;
+    char            *name;      /* before macEnvExpand() */
+    char            *dirs;      /* the search path */
+    char            *path;      /* where it was found */
+    epicsUInt64     hash;
+};
+
+struct dbCacheWriter {
+    FILE            *fp;
+    char            *name;
+    char            *tmpName;
+    epicsUInt64     hash;       /* of everything written */
+    ELLLIST         files;
+    unsigned long   records;
+    int             ok;
+};
+
+/* One dbReadDatabaseCached() call, for dbRecordCacheShow() */
+typedef struct cacheLoad {
+    ELLNODE         node;
+    char            *filename;
+    int             loaded;
+    int             saved;
+    unsigned long   records;
+    double          time;
+    double          parseTime;  /* when it was parsed */
+} cacheLoad;
+
+typedef struct cacheReader {
+    const char      *pos;
+    const char      *end;
+    int             bad;
+} cacheReader;
+
+static char *cacheDir;
+static ELLLIST cacheLoads = ELLLIST_INIT;
+static dbRecordCacheInfo cacheInfo;
+
+/* FNV-1a, which unlike epicsMemHash() may be fed in pieces */
+static epicsUInt64 hashBytes(epicsUInt64 hash, const void *pbuf, size_t len)
+{
+    const unsigned char *p = pbuf;
+
+    while (len--) {
+        hash ^= *p++;
+        hash *= HASH_PRIME;
+    }
+    return hash;
+}
+
+static epicsUInt64 hashString(epicsUInt64 hash, const char *str)
+{
+    if (!str)
+        str = "";
+    return hashBytes(hash, str, strlen(str) + 1);
+}
+
+static epicsUInt64 hashInt(epicsUInt64 hash, long value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+/* Everything the .dbd files defined that a .db file could refer to */
+static epicsUInt64 dbdHash(DBBASE *pdbbase)
+{
+    epicsUInt64 hash = HASH_INIT;
+    ELLNODE *cur;
+    int i;
+
+    for (cur = ellFirst(&pdbbase->menuList); cur; cur = ellNext(cur)) {
+        dbMenu *pmenu = CONTAINER(cur, dbMenu, node);
+
+        hash = hashString(hash, pmenu->name);
+        for (i = 0; i < pmenu->nChoice; i++)
+            hash = hashString(hash, pmenu->papChoiceValue[i]);
+    }
+    for (cur = ellFirst(&pdbbase->recordTypeList); cur; cur = ellNext(cur)) {
+        dbRecordType *prt = CONTAINER(cur, dbRecordType, node);
+        ELLNODE *pdev;
+
+        hash = hashString(hash, prt->name);
+        hash = hashInt(hash, prt->rec_size);
+        for (i = 0; i < prt->no_fields; i++) {
+            dbFldDes *pfld = prt->papFldDes[i];
+
+            hash = hashString(hash, pfld->name);
+            hash = hashInt(hash, pfld->field_type);
+            hash = hashInt(hash, pfld->size);
+            hash = hashInt(hash, pfld->offset);
+        }
+        for (pdev = ellFirst(&prt->devList); pdev; pdev = ellNext(pdev)) {
+            devSup *pdevSup = CONTAINER(pdev, devSup, node);
+
+            hash = hashString(hash, pdevSup->name);
+            hash = hashString(hash, pdevSup->choice);
+            hash = hashInt(hash, pdevSup->link_type);
+        }
+    }
+    for (cur = ellFirst(&pdbbase->drvList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, drvSup, node)->name);
+    for (cur = ellFirst(&pdbbase->linkList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, linkSup, node)->name);
+    for (cur = ellFirst(&pdbbase->registrarList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, dbText, node)->text);
+    for (cur = ellFirst(&pdbbase->functionList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, dbText, node)->text);
+    for (cur = ellFirst(&pdbbase->variableList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, dbVariableDef, node)->name);
+    for (cur = ellFirst(&pdbbase->bptList); cur; cur = ellNext(cur))
+        hash = hashString(hash, CONTAINER(cur, brkTable, node)->name);
+    return hash;
+}
+
+int dbRecordCache(const char *directory)
+{
+    if (getIocState() != iocVoid) {
+        errlogPrintf("dbRecordCache: Must be called before iocInit\n");
+        return -1;
+    }
+    free(cacheDir);
+    cacheDir = NULL;
+    if (directory && *directory)
+        cacheDir = epicsStrDup(directory);
+    return 0;
+}
+
+/* Writer */
+
+static void putBytes(dbCacheWriter *pwriter, const void *pbuf, size_t len)
+{
+    pwriter->hash = hashBytes(pwriter->hash, pbuf, len);
+    if (fwrite(pbuf, 1, len, pwriter->fp) != len)
+        pwriter->ok = 0;
+}
+
+static void putU32(dbCacheWriter *pwriter, epicsUInt32 value)
+{
+    putBytes(pwriter, &value, sizeof(value));
+}
+
+static void putU64(dbCacheWriter *pwriter, epicsUInt64 value)
+{
+    putBytes(pwriter, &value, sizeof(value));
+}
+
+static void putString(dbCacheWriter *pwriter, const char *str)
+{
+    size_t len = strlen(str) + 1;
+
+    putU32(pwriter, (epicsUInt32) len);
+    putBytes(pwriter, str, len);
+}
+
+static dbCacheWriter * writerCreate(const char *name, const char *filename,
+    const char *path, const char *substitutions, epicsUInt64 dbd)
+{
+    dbCacheWriter *pwriter = dbCalloc(1, sizeof(*pwriter));
+
+    pwriter->name = epicsStrDup(name);
+    pwriter->tmpName = dbMalloc(strlen(name) + 5);
+    strcpy(pwriter->tmpName, name);
+    strcat(pwriter->tmpName, ".tmp");
+    pwriter->fp = fopen(pwriter->tmpName, "wb");
+    if (!pwriter->fp) {
+        errlogPrintf("dbRecordCache: Can't create \"%s\"\n",
+            pwriter->tmpName);
+        free(pwriter->tmpName);
+        free(pwriter->name);
+        free(pwriter);
+        return NULL;
+    }
+    pwriter->hash = HASH_INIT;
+    pwriter->ok = 1;
+    putBytes(pwriter, CACHE_MAGIC, 8);
+    putU32(pwriter, CACHE_ORDER);
+    putU32(pwriter, CACHE_VERSION);
+    putU64(pwriter, dbd);
+    putString(pwriter, filename);
+    putString(pwriter, path);
+    putString(pwriter, substitutions);
+    return pwriter;
+}
+
+void dbCacheAdd(dbCacheWriter *pwriter, enum dbCacheOp op,
+    const char *arg1, const char *arg2)
+{
+    unsigned char code = op;
+
+    putBytes(pwriter, &code, 1);
+    putString(pwriter, arg1);
+    if (opArgs[op] > 1)
+        putString(pwriter, arg2);
+    if (op == dbCacheRecord || op == dbCacheVisibleRecord)
+        pwriter->records++;
+}
+
+void dbCacheDisable(dbCacheWriter *pwriter)
+{
+    pwriter->ok = 0;
+}
+
+/* Where dbOpenFile() found the file */
+static char * filePath(const char *directory, const char *filename)
+{
+    char *path;
+
+    if (!directory)
+        return epicsStrDup(filename);
+    path = dbMalloc(strlen(directory) + strlen(filename) + 2);
+    strcpy(path, directory);
+    strcat(path, "/");
+    strcat(path, filename);
+    return path;
+}
+
+/* The directories dbOpenFile() searches, as a path for dbPath() */
+static char * searchDirs(DBBASE *pdbbase)
+{
+    ELLLIST *ppathList = (ELLLIST *) pdbbase->pathPvt;
+    ELLNODE *cur;
+    size_t len = 1;
+    char *dirs;
+
+    if (ppathList) {
+        for (cur = ellFirst(ppathList); cur; cur = ellNext(cur))
+            len += strlen(CONTAINER(cur, dbPathNode, node)->directory) +
+                strlen(OSI_PATH_LIST_SEPARATOR);
+    }
+    dirs = dbCalloc(1, len);
+    if (ppathList) {
+        for (cur = ellFirst(ppathList); cur; cur = ellNext(cur)) {
+            if (cur != ellFirst(ppathList))
+                strcat(dirs, OSI_PATH_LIST_SEPARATOR);
+            strcat(dirs, CONTAINER(cur, dbPathNode, node)->directory);
+        }
+    }
+    return dirs;
+}
+
+dbCacheFile * dbCacheAddFile(dbCacheWriter *pwriter, DBBASE *pdbbase,
+    const char *name, const char *directory, const char *filename)
+{
+    dbCacheFile *pfile = dbCalloc(1, sizeof(*pfile));
+
+    pfile->name = epicsStrDup(name);
+    pfile->dirs = searchDirs(pdbbase);
+    pfile->path = filePath(directory, filename);
+    pfile->hash = HASH_INIT;
+    ellAdd(&pwriter->files, &pfile->node);
+    return pfile;
+}
+
+void dbCacheData(dbCacheFile *pfile, const char *buf, size_t len)
+{
+    pfile->hash = hashBytes(pfile->hash, buf, len);
+}
+
+/* Returns non-zero if the cache file was written */
+static int writerFinish(dbCacheWriter *pwriter, int ok, double parseTime)
+{
+    dbCacheFile *pfile;
+    unsigned char code = dbCacheEnd;
+
+    putBytes(pwriter, &code, 1);
+    putU32(pwriter, (epicsUInt32) pwriter->records);
+    putBytes(pwriter, &parseTime, sizeof(parseTime));
+    putU32(pwriter, (epicsUInt32) ellCount(&pwriter->files));
+    for (pfile = (dbCacheFile *) ellFirst(&pwriter->files); pfile;
+         pfile = (dbCacheFile *) ellNext(&pfile->node)) {
+        putString(pwriter, pfile->name);
+        putString(pwriter, pfile->dirs);
+        putString(pwriter, pfile->path);
+        putU64(pwriter, pfile->hash);
+    }
+    putU64(pwriter, pwriter->hash);
+    if (fclose(pwriter->fp))
+        pwriter->ok = 0;
+
+    ok = ok && pwriter->ok;
+    if (ok && rename(pwriter->tmpName, pwriter->name)) {
+        /* Windows won't rename over an existing file */
+        remove(pwriter->name);
+        if (rename(pwriter->tmpName, pwriter->name)) {
+            errlogPrintf("dbRecordCache: Can't write \"%s\"\n",
+                pwriter->name);
+            ok = 0;
+        }
+    }
+    if (!ok)
+        remove(pwriter->tmpName);
+
+    while ((pfile = (dbCacheFile *) ellGet(&pwriter->files))) {
+        free(pfile->name);
+        free(pfile->dirs);
+        free(pfile->path);
+        free(pfile);
+    }
+    free(pwriter->tmpName);
+    free(pwriter->name);
+    free(pwriter);
+    return ok;
+}
+
+/* Reader */
+
+static void getBytes(cacheReader *prd, void *pbuf, size_t len)
+{
+    if (prd->bad || (size_t)(prd->end - prd->pos) < len) {
+        prd->bad = 1;
+        memset(pbuf, 0, len);
+        return;
+    }
+    memcpy(pbuf, prd->pos, len);
+    prd->pos += len;
+}
+
+static epicsUInt32 getU32(cacheReader *prd)
+{
+    epicsUInt32 value;
+
+    getBytes(prd, &value, sizeof(value));
+    return value;
+}
+
+static epicsUInt64 getU64(cacheReader *prd)
+{
+    epicsUInt64 value;
+
+    getBytes(prd, &value, sizeof(value));
+    return value;
+}
+
+/* Points into the buffer, the strings are stored with their nil */
+static const char * getString(cacheReader *prd)
+{
+    epicsUInt32 len = getU32(prd);
+    const char *str = prd->pos;
+
+    if (prd->bad || !len || (size_t)(prd->end - prd->pos) < len ||
+        str[len - 1]) {
+        prd->bad = 1;
+        return "";
+    }
+    prd->pos += len;
+    return str;
+}
+
+/* Move past the operations, returns the first one */
+static const char * skipOps(cacheReader *prd)
+{
+    const char *ops = prd->pos;
+
+    while (!prd->bad) {
+        unsigned char code;
+        int i;
+
+        getBytes(prd, &code, 1);
+        if (code == dbCacheEnd)
+            break;
+        if (code >= dbCacheOps) {
+            prd->bad = 1;
+            break;
+        }
+        for (i = 0; i < opArgs[code]; i++)
+            getString(prd);
+    }
+    return ops;
+}
+
+/* Look the name up again like the parser would now.  Returns 0 if it
+ * leads to another file, like one that now shadows the old one on the
+ * search path, or to the same file with other contents.
+ */
+static int fileUnchanged(const char *name, const char *dirs,
+    const char *path, epicsUInt64 hash)
+{
+    DBBASE search;      /* only for its search path */
+    char *expanded, *found;
+    char buf[8192];
+    epicsUInt64 fileHash = HASH_INIT;
+    FILE *fp;
+    size_t n;
+    int same;
+
+    expanded = macEnvExpand(name);
+    if (!expanded)
+        return 0;
+    memset(&search, 0, sizeof(search));
+    dbPath(&search, dirs);
+    found = filePath(dbOpenFile(&search, expanded, &fp), expanded);
+    dbFreePath(&search);
+    free(expanded);
+    same = fp && strcmp(found, path) == 0;
+    free(found);
+    if (!fp)
+        return 0;
+    while (same && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        fileHash = hashBytes(fileHash, buf, n);
+    fclose(fp);
+    return same && fileHash == hash;
+}
+
+static void cacheError(const char *name, DBENTRY *pdbentry,
+    const char *what, const char *arg)
+{
+    fprintf(stderr, ERL_ERROR ": %s \"%s\"", what, arg);
+    if (pdbentry && pdbentry->precnode)
+        fprintf(stderr, " in record \"%s\"", dbGetRecordName(pdbentry));
+    fprintf(stderr, "\n  from record cache \"%s\"\n", name);
+}
+
+/* Create the records, returns 0 on success */
+static long cacheApply(DBBASE *pdbbase, cacheReader *prd, const char *name)
+{
+    DBENTRY entry;
+    long status = 0;
+
+    dbInitEntry(pdbbase, &entry);
+    while (!status) {
+        unsigned char code;
+        const char *arg1, *arg2 = NULL;
+
+        getBytes(prd, &code, 1);
+        if (code == dbCacheEnd)
+            break;
+        arg1 = getString(prd);
+        if (opArgs[code] > 1)
+            arg2 = getString(prd);
+
+        switch (code) {
+        case dbCacheRecord:
+        case dbCacheVisibleRecord:
+            if (dbFindRecordType(&entry, arg1)) {
+                cacheError(name, NULL, "Unknown record type", arg1);
+                status = -1;
+                break;
+            }
+            status = dbCreateRecord(&entry, arg2);
+            if (status == S_dbLib_recExists) {
+                if (strcmp(arg1, dbGetRecordTypeName(&entry)) != 0) {
+                    cacheError(name, NULL, "Record redefined with new type",
+                        arg2);
+                    break;
+                }
+                if (dbRecordsOnceOnly) {
+                    cacheError(name, NULL, "Record already defined", arg2);
+                    break;
+                }
+                status = 0;
+            }
+            else if (status) {
+                cacheError(name, NULL, "Can't create record", arg2);
+                break;
+            }
+            if (code == dbCacheVisibleRecord)
+                dbVisibleRecord(&entry);
+            break;
+        case dbCacheAppend:
+            status = dbFindRecord(&entry, arg1);
+            if (status)
+                cacheError(name, NULL, "Record not found", arg1);
+            break;
+        case dbCacheDelete:
+            if (!dbFindRecord(&entry, arg1))
+                dbDeleteRecord(&entry);
+            else
+                fprintf(stderr, ERL_WARNING ": Unable to delete record "
+                    "\"%s\".  Not found.\n", arg1);
+            break;
+        case dbCacheField:
+            status = dbFindField(&entry, arg1);
+            if (!status)
+                status = dbPutString(&entry, arg2);
+            if (status)
+                cacheError(name, &entry, "Can't set field", arg1);
+            break;
+        case dbCacheInfo:
+            status = dbPutInfo(&entry, arg1, arg2);
+            if (status)
+                cacheError(name, &entry, "Can't set info", arg1);
+            break;
+        case dbCacheRecordAlias:
+            status = dbCreateAlias(&entry, arg1);
+            if (status)
+                cacheError(name, &entry, "Can't create alias", arg1);
+            break;
+        case dbCacheAlias: {
+            DBENTRY target;
+
+            dbInitEntry(pdbbase, &target);
+            status = dbFindRecord(&target, arg1);
+            if (!status)
+                status = dbCreateAlias(&target, arg2);
+            if (status)
+                cacheError(name, NULL, "Can't create alias", arg2);
+            dbFinishEntry(&target);
+            break;
+        }
+        default:
+            prd->bad = 1;
+        }
+        if (prd->bad) {
+            cacheError(name, NULL, "Corrupt operation", "");
+            status = -1;
+        }
+    }
+    dbFinishEntry(&entry);
+    return status ? -1 : 0;
+}
+
+/* Returns 0 if the records were loaded, -1 on error, or 1 if the cache
+ * can't be used.
+ */
+static long cacheRead(DBBASE *pdbbase, const char *name,
+    const char *filename, const char *path, const char *substitutions,
+    epicsUInt64 dbd, cacheLoad *pload)
+{
+    FILE *fp = fopen(name, "rb");
+    cacheReader rd;
+    char *buf;
+    const char *ops;
+    char magic[8];
+    long size, status = 1;
+    epicsUInt32 nFiles, i;
+    epicsUInt64 sum;
+
+    if (!fp)
+        return 1;
+    if (fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 16 ||
+        fseek(fp, 0, SEEK_SET)) {
+        fclose(fp);
+        return 1;
+    }
+    buf = dbMalloc(size);
+    if (fread(buf, 1, size, fp) != (size_t) size) {
+        fclose(fp);
+        free(buf);
+        return 1;
+    }
+    fclose(fp);
+
+    rd.pos = buf + size - sizeof(sum);
+    rd.end = buf + size;
+    rd.bad = 0;
+    sum = getU64(&rd);
+    if (sum != hashBytes(HASH_INIT, buf, size - sizeof(sum)))
+        goto done;
+
+    rd.pos = buf;
+    rd.end = buf + size - sizeof(sum);
+    getBytes(&rd, magic, sizeof(magic));
+    if (memcmp(magic, CACHE_MAGIC, sizeof(magic)) ||
+        getU32(&rd) != CACHE_ORDER ||
+        getU32(&rd) != CACHE_VERSION ||
+        getU64(&rd) != dbd ||
+        strcmp(getString(&rd), filename) ||
+        strcmp(getString(&rd), path) ||
+        strcmp(getString(&rd), substitutions) ||
+        rd.bad)
+        goto done;
+
+    ops = skipOps(&rd);
+    pload->records = getU32(&rd);
+    getBytes(&rd, &pload->parseTime, sizeof(pload->parseTime));
+    nFiles = getU32(&rd);
+    for (i = 0; i < nFiles && !rd.bad; i++) {
+        const char *file = getString(&rd);
+        const char *dirs = getString(&rd);
+        const char *path = getString(&rd);
+
+        if (rd.bad || !fileUnchanged(file, dirs, path, getU64(&rd)))
+            goto done;
+    }
+    if (rd.bad)
+        goto done;
+
+    rd.pos = ops;
+    status = cacheApply(pdbbase, &rd, name);
+
+done:
+    free(buf);
+    return status;
+}
+
+static int cmpRecordNode(const ELLNODE *lhs, const ELLNODE *rhs)
+{
+    return strcmp(CONTAINER(lhs, dbRecordNode, node)->recordname,
+        CONTAINER(rhs, dbRecordNode, node)->recordname);
+}
+
+long dbReadDatabaseCached(DBBASE **ppdbbase, const char *filename,
+    const char *path, const char *substitutions)
+{
+    cacheLoad *pload;
+    dbCacheWriter *pwriter;
+    char *expanded, *name;
+    const char *searchPath = path;
+    epicsUInt64 dbd, key, start;
+    long status;
+
+    if (!cacheDir || !filename || !*ppdbbase || getIocState() != iocVoid)
+        return dbReadDatabase(ppdbbase, filename, path, substitutions);
+
+    if (!searchPath || !*searchPath)
+        searchPath = getenv("EPICS_DB_INCLUDE_PATH");
+    if (!searchPath)
+        searchPath = ".";
+    if (!substitutions)
+        substitutions = "";
+    expanded = macEnvExpand(filename);
+    if (!expanded)
+        return dbReadDatabase(ppdbbase, filename, path, substitutions);
+
+    start = epicsMonotonicGet();
+    dbd = dbdHash(*ppdbbase);
+    key = hashString(dbd, expanded);
+    key = hashString(key, searchPath);
+    key = hashString(key, substitutions);
+    name = dbMalloc(strlen(cacheDir) + 22);
+    sprintf(name, "%s/%08x%08x.dbc", cacheDir,
+        (unsigned) (key >> 32), (unsigned) key);
+
+    pload = dbCalloc(1, sizeof(*pload));
+    pload->filename = expanded;
+    status = cacheRead(*ppdbbase, name, expanded, searchPath, substitutions,
+        dbd, pload);
+    if (status <= 0) {
+        pload->loaded = 1;
+        if (dbRecordsAbcSorted) {
+            ELLNODE *cur;
+
+            for (cur = ellFirst(&(*ppdbbase)->recordTypeList); cur;
+                 cur = ellNext(cur))
+                ellSortStable(&CONTAINER(cur, dbRecordType, node)->recList,
+                    &cmpRecordNode);
+        }
+    }
+    else {
+        pwriter = writerCreate(name, expanded, searchPath, substitutions, dbd);
+        if (pwriter) {
+            status = dbReadDatabaseCache(ppdbbase, filename, path,
+                substitutions, pwriter);
+            pload->records = pwriter->records;
+            pload->parseTime = (epicsMonotonicGet() - start) * 1e-9;
+            /* Don't save files that defined record types or the like */
+            pload->saved = writerFinish(pwriter,
+                !status && dbdHash(*ppdbbase) == dbd, pload->parseTime);
+        }
+        else {
+            status = dbReadDatabase(ppdbbase, filename, path, substitutions);
+            pload->parseTime = (epicsMonotonicGet() - start) * 1e-9;
+        }
+    }
+    pload->time = (epicsMonotonicGet() - start) * 1e-9;
+    free(name);
+
+    if (pload->loaded) {
+        cacheInfo.loaded++;
+        cacheInfo.loadTime += pload->time;
+        cacheInfo.parseTimeSaved += pload->parseTime;
+    }
+    else {
+        cacheInfo.parsed++;
+        cacheInfo.parseTime += pload->time;
+        cacheInfo.saved += pload->saved;
+    }
+    ellAdd(&cacheLoads, &pload->node);
+    return status;
+}
+
+void dbRecordCacheStats(dbRecordCacheInfo *pinfo)
+{
+    *pinfo = cacheInfo;
+}
+
+void dbRecordCacheShow(int level)
+{
+    cacheLoad *pload;
+
+    if (!cacheDir)
+        printf("Record cache is off\n");
+    else
+        printf("Record cache in \"%s\"\n", cacheDir);
+    printf("%lu files loaded from the cache in %.3f s, parsing them took"
+        " %.3f s\n", cacheInfo.loaded, cacheInfo.loadTime,
+        cacheInfo.parseTimeSaved);
+    printf("%lu files parsed in %.3f s, %lu of them cached\n",
+        cacheInfo.parsed, cacheInfo.parseTime, cacheInfo.saved);
+    if (level < 1 || !ellCount(&cacheLoads))
+        return;
+
+    printf("%-8s %8s %10s %10s  %s\n",
+        "SOURCE", "RECORDS", "TIME", "PARSING", "FILE");
+    for (pload = (cacheLoad *) ellFirst(&cacheLoads); pload;
+         pload = (cacheLoad *) ellNext(&pload->node)) {
+        printf("%-8s %8lu %10.6f %10.6f  %s\n",
+            pload->loaded ? "cache" : pload->saved ? "saved" : "parsed",
+            pload->records, pload->time, pload->parseTime, pload->filename);
+    }
+}
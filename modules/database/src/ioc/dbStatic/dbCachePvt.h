@@ -0,0 +1,71 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Binary cache of the records read by dbLoadRecords(), see dbCache.c
+ *
+ * While the parser reads a .db file for the cache it reports every
+ * record, field, info item and alias it creates, after macro expansion
+ * and quote removal, with dbCacheAdd().  It also passes the raw text of
+ * each input file to dbCacheData(), so the cache can check later that
+ * none of them changed.
+ */
+
+#ifndef INC_dbCachePvt_H
+#define INC_dbCachePvt_H
+
+#include <stddef.h>
+
+#include "dbStaticLib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct dbCacheWriter dbCacheWriter;
+typedef struct dbCacheFile dbCacheFile;
+
+/* Operations, followed by their string arguments */
+enum dbCacheOp {
+    dbCacheEnd,
+    dbCacheRecord,          /* type, name */
+    dbCacheVisibleRecord,   /* type, name, from grecord() */
+    dbCacheAppend,          /* name, from record("*", name) */
+    dbCacheDelete,          /* name, from record("#", name) */
+    dbCacheField,           /* name, value */
+    dbCacheInfo,            /* name, value */
+    dbCacheRecordAlias,     /* alias */
+    dbCacheAlias,           /* record, alias */
+    dbCacheOps
+};
+
+void dbCacheAdd(dbCacheWriter *pwriter, enum dbCacheOp op,
+    const char *arg1, const char *arg2);
+
+/* Don't save the cache, the file did something that replaying it
+ * wouldn't repeat, like warn about undefined macros.
+ */
+void dbCacheDisable(dbCacheWriter *pwriter);
+
+/* Called for every input file the parser opens, with the name it was
+ * given, before macEnvExpand(), and the directory dbOpenFile() found the
+ * expanded filename in.  The search path is taken from pdbbase.
+ */
+dbCacheFile * dbCacheAddFile(dbCacheWriter *pwriter, DBBASE *pdbbase,
+    const char *name, const char *directory, const char *filename);
+void dbCacheData(dbCacheFile *pfile, const char *buf, size_t len);
+
+/* dbReadDatabase() reporting to pwriter, in dbLexRoutines.c */
+long dbReadDatabaseCache(DBBASE **ppdbbase, const char *filename,
+    const char *path, const char *substitutions, dbCacheWriter *pwriter);
+
+extern int dbRecordsOnceOnly;
+extern int dbRecordsAbcSorted;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_dbCachePvt_H */
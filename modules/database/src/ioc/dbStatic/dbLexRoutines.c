@@ -32,6 +32,7 @@
 #include "dbFldTypes.h"
 #include "dbStaticLib.h"
 #include "dbStaticPvt.h"
+#include "dbCachePvt.h"
 #include "epicsExport.h"
 #include "link.h"
 #include "special.h"
@@ -107,12 +108,15 @@ typedef struct inputFile{
     const char  *filename;
     FILE        *fp;
     int         line_num;
+    dbCacheFile *pcache;
 }inputFile;
 static ELLLIST inputFileList = ELLLIST_INIT;
 
 static inputFile *pinputFileNow = NULL;
 /* The DBBASE most recently allocated/used by dbReadCOM() */
 static DBBASE *savedPdbbase = NULL;
+/* Set while dbReadDatabaseCache() reads a file for the record cache */
+static dbCacheWriter *pcacheWriter = NULL;
 
 typedef struct tempListNode {
     ELLNODE     node;
@@ -287,6 +291,9 @@ static long dbReadCOM(DBBASE **ppdbbase,const char *filename, FILE *fp,
         fp = NULL;
     }
     pinputFile->line_num = 0;
+    if (pcacheWriter)
+        pinputFile->pcache = dbCacheAddFile(pcacheWriter, savedPdbbase,
+            filename, pinputFile->path, pinputFile->filename);
     pinputFileNow = pinputFile;
     my_buffer[0] = '\0';
     my_buffer_ptr = my_buffer;
@@ -352,6 +359,17 @@ long dbReadDatabase(DBBASE **ppdbbase,const char *filename,
 long dbReadDatabaseFP(DBBASE **ppdbbase,FILE *fp,
         const char *path,const char *substitutions)
 {return (dbReadCOM(ppdbbase,0,fp,path,substitutions));}
+
+long dbReadDatabaseCache(DBBASE **ppdbbase, const char *filename,
+    const char *path, const char *substitutions, dbCacheWriter *pwriter)
+{
+    long status;
+
+    pcacheWriter = pwriter;
+    status = dbReadCOM(ppdbbase, filename, 0, path, substitutions);
+    pcacheWriter = NULL;
+    return status;
+}
 
 static int db_yyinput(char *buf, int max_size)
 {
@@ -370,11 +388,15 @@ static int db_yyinput(char *buf, int max_size)
                     if (exp < 0) {
                         fprintf(stderr, "Warning: '%s' line %d has undefined macros\n",
                             pinputFileNow->filename, pinputFileNow->line_num+1);
+                        if (pcacheWriter)
+                            dbCacheDisable(pcacheWriter);
                     }
                 }
             } else {
                 fgetsRtn = fgets(my_buffer,MY_BUFFER_SIZE,pinputFileNow->fp);
             }
+            if (fgetsRtn && pinputFileNow->pcache)
+                dbCacheData(pinputFileNow->pcache, fgetsRtn, strlen(fgetsRtn));
             if(fgetsRtn) break;
             if(fclose(pinputFileNow->fp))
                 errPrintf(0,__FILE__, __LINE__,
@@ -441,6 +463,9 @@ static void dbIncludeNew(char *filename)
         return;
     }
     pinputFile->fp = fp;
+    if (pcacheWriter)
+        pinputFile->pcache = dbCacheAddFile(pcacheWriter, savedPdbbase,
+            filename, pinputFile->path, pinputFile->filename);
     ellAdd(&inputFileList,&pinputFile->node);
     pinputFileNow = pinputFile;
 }
@@ -1078,12 +1103,16 @@ int dbRecordNameValidate(const char *name)
             /* first character restrictions */
             if(c=='-' || c=='+' || c=='[' || c=='{') {
                 fprintf(stderr, "Warning: Record/Alias name '%s' should not begin with '%c'\n", name, c);
+                if (pcacheWriter)
+                    dbCacheDisable(pcacheWriter);
             }
         }
         /* any character restrictions */
         if(c < ' ') {
             fprintf(stderr, "Warning: Record/Alias name '%s' should not contain non-printable 0x%02x\n",
                          name, c);
+            if (pcacheWriter)
+                dbCacheDisable(pcacheWriter);
 
         } else if(c==' ' || c=='\t' || c=='"' || c=='\'' || c=='.' || c=='$') {
             fprintf(stderr, ERL_ERROR ": Bad character '%c' in Record/Alias name \"%s\"\n",
@@ -1111,8 +1140,11 @@ static void dbRecordHead(char *recordType, char *name, int visible)
 
     if (recordType[0] == '*' && recordType[1] == 0) {
         status = dbFindRecord(pdbentry, name);
-        if (status == 0)
+        if (status == 0) {
+            if (pcacheWriter)
+                dbCacheAdd(pcacheWriter, dbCacheAppend, name, NULL);
             return; /* done */
+        }
         fprintf(stderr, ERL_ERROR ": Record \"%s\" not found\n", name);
         yyerror(NULL);
         duplicate = TRUE;
@@ -1120,6 +1152,8 @@ static void dbRecordHead(char *recordType, char *name, int visible)
     }
 
     if (recordType[0] == '#' && recordType[1] == 0) {
+        if (pcacheWriter)
+            dbCacheAdd(pcacheWriter, dbCacheDelete, name, NULL);
         status = dbFindRecord(pdbentry, name);
         if (status == 0) {
             dbDeleteRecord(pdbentry);
@@ -1168,6 +1202,9 @@ static void dbRecordHead(char *recordType, char *name, int visible)
 
     if (visible)
         dbVisibleRecord(pdbentry);
+    if (pcacheWriter)
+        dbCacheAdd(pcacheWriter,
+            visible ? dbCacheVisibleRecord : dbCacheRecord, recordType, name);
 }
 
 static void dbRecordField(char *name,char *value)
@@ -1231,6 +1268,8 @@ static void dbRecordField(char *name,char *value)
         yyerror(NULL);
         return;
     }
+    if (pcacheWriter)
+        dbCacheAdd(pcacheWriter, dbCacheField, name, value);
 }
 
 static void dbRecordInfo(char *name, char *value)
@@ -1261,6 +1300,8 @@ static void dbRecordInfo(char *name, char *value)
         yyerror(NULL);
         return;
     }
+    if (pcacheWriter)
+        dbCacheAdd(pcacheWriter, dbCacheInfo, name, value);
 }
 
 static void dbRecordAlias(char *name)
@@ -1282,6 +1323,8 @@ static void dbRecordAlias(char *name)
         yyerror(NULL);
         return;
     }
+    if (pcacheWriter)
+        dbCacheAdd(pcacheWriter, dbCacheRecordAlias, name, NULL);
 }
 
 static void dbAlias(char *name, char *alias)
@@ -1303,6 +1346,8 @@ static void dbAlias(char *name, char *alias)
                     alias, name);
         yyerror(NULL);
     }
+    else if (pcacheWriter)
+        dbCacheAdd(pcacheWriter, dbCacheAlias, name, alias);
     dbFinishEntry(pdbEntry);
 }
 
@@ -17,31 +17,269 @@
 
 #include "dbDefs.h"
 #include "ellLib.h"
+#include "epicsAtomic.h"
 #include "epicsMutex.h"
 #include "epicsStdio.h"
 #include "epicsString.h"
+#include "epicsTime.h"
 
 #include "dbBase.h"
 #include "dbStaticLib.h"
 #include "dbStaticPvt.h"
-
+#include "epicsExport.h"
+
+/* Blocked Bloom filter of all names in the directory.
+ * dbPvdFind() rejects most names which are not present without taking
+ * any lock.  Each name sets FILTER_PROBES bits in one block of
+ * FILTER_BLOCK_BITS bits, so a lookup touches a single cache line.
+ * Names of deleted records can't be cleared, they only cause false
+ * positives until the filter is next rebuilt.
+ */
+#define FILTER_BLOCK_WORDS 16
+#define FILTER_BLOCK_BITS (FILTER_BLOCK_WORDS * 32)
+#define FILTER_PROBES 3
+#define FILTER_BITS_PER_NAME 16
+#define FILTER_MIN_BLOCKS 128
+#define FILTER_MAX_BLOCKS (1u << 18)
+
+typedef struct dbPvdFilter {
+    struct dbPvdFilter *prev;   /* replaced filters, readers may still use */
+    unsigned int nblocks;       /* power of 2 */
+    unsigned int nnames;        /* names added, including deleted ones */
+    epicsUInt32 bits[1];        /* nblocks * FILTER_BLOCK_WORDS */
+} dbPvdFilter;
+
+/* The directory is an open addressing hash table with linear probing.
+ * Each slot keeps the hash of its name next to the entry, so a probe
+ * rarely has to look at the entry itself.  dbPvdFind() takes no lock:
+ * a slot's entry is published after its hash, and only ever changes
+ * from NULL to an entry and from that to PVD_DELETED.  A full table is
+ * replaced by a larger copy, and neither the replaced tables nor the
+ * deleted entries are freed before dbPvdFreeMem(), so a lookup which
+ * raced with a change still reads valid memory.  Changes are serialized
+ * by dbPvd.lock.
+ * The record node and its name are freed by the caller of dbPvdDelete()
+ * though, so records may only be deleted while nothing else looks names
+ * up, i.e. before iocInit or after the IOC has stopped.
+ */
 typedef struct {
-    ELLLIST      list;
-    epicsMutexId lock;
-} dbPvdBucket;
+    unsigned int hash;
+    PVDENTRY     *entry;
+} dbPvdSlot;
 
-typedef struct dbPvd {
-    unsigned int size;
+typedef struct dbPvdTable {
+    struct dbPvdTable *prev;    /* replaced tables, readers may still use */
+    unsigned int size;          /* power of 2 */
     unsigned int mask;
-    dbPvdBucket **buckets;
+    dbPvdSlot slots[1];         /* size */
+} dbPvdTable;
+
+static PVDENTRY pvdDeleted;
+#define PVD_DELETED (&pvdDeleted)
+
+typedef struct dbPvd {
+    dbPvdTable *table;
+    epicsMutexId lock;          /* serializes changes */
+    dbPvdFilter *filter;
+    unsigned int nentries;      /* guarded by lock */
+    unsigned int nused;         /* slots not NULL, guarded by lock */
+    ELLLIST deleted;            /* deleted entries, guarded by lock */
+    size_t nrejected;           /* counters only kept if dbPvdCountLookups */
+    size_t npassed;
+    size_t nfalse;
 } dbPvd;
 
 unsigned int dbPvdHashTableSize = 0;
 
+/* The lookup counters are shared by all threads, so they cost an atomic
+ * operation on a contended cache line and are only kept on request.
+ */
+int dbPvdCountLookups = 0;
+epicsExportAddress(int, dbPvdCountLookups);
+
 #define MIN_SIZE 256
 #define DEFAULT_SIZE 512
-#define MAX_SIZE 65536
+#define MAX_SIZE (1u << 24)
+
+/* Most names dbPvdDump() times lookups of */
+#define DUMP_SAMPLES 100000
+
+
+/* Murmur3 finalizer, spreads a name hash across all bits.  The low bits
+ * of epicsStrHash() are too similar for names which only differ at the
+ * end to index the table or the filter directly.
+ */
+static epicsUInt32 hashMix(epicsUInt32 h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static dbPvdFilter * filterCreate(unsigned int nblocks)
+{
+    dbPvdFilter *pfilter = dbCalloc(1, sizeof(dbPvdFilter) +
+        (nblocks * FILTER_BLOCK_WORDS - 1) * sizeof(epicsUInt32));
+
+    pfilter->nblocks = nblocks;
+    return pfilter;
+}
+
+static void filterSet(dbPvdFilter *pfilter, unsigned int hash)
+{
+    epicsUInt32 x = hashMix(hash);
+    epicsUInt32 *pblock = &pfilter->bits[FILTER_BLOCK_WORDS *
+        (x & (pfilter->nblocks - 1))];
+    int i;
+
+    x = hashMix(x);
+    for (i = 0; i < FILTER_PROBES; i++, x >>= 9) {
+        unsigned int bit = x & (FILTER_BLOCK_BITS - 1);
+        pblock[bit >> 5] |= 1u << (bit & 31);
+    }
+    pfilter->nnames++;
+}
+
+static int filterTest(const dbPvdFilter *pfilter, unsigned int hash)
+{
+    epicsUInt32 x = hashMix(hash);
+    const epicsUInt32 *pblock = &pfilter->bits[FILTER_BLOCK_WORDS *
+        (x & (pfilter->nblocks - 1))];
+    int i;
+
+    x = hashMix(x);
+    for (i = 0; i < FILTER_PROBES; i++, x >>= 9) {
+        unsigned int bit = x & (FILTER_BLOCK_BITS - 1);
+        if (!(pblock[bit >> 5] & (1u << (bit & 31))))
+            return 0;
+    }
+    return 1;
+}
+
+/* Called with lock held, after the new name was added to the table */
+static void filterAdd(dbPvd *ppvd, unsigned int hash)
+{
+    dbPvdFilter *pfilter = ppvd->filter;
+    dbPvdTable *ptable = ppvd->table;
+    unsigned int nblocks = pfilter->nblocks;
+    unsigned int h;
+
+    if (pfilter->nnames < nblocks * (FILTER_BLOCK_BITS / FILTER_BITS_PER_NAME) ||
+        nblocks >= FILTER_MAX_BLOCKS) {
+        filterSet(pfilter, hash);
+        epicsAtomicWriteMemoryBarrier();
+        return;
+    }
 
+    /* Full, rebuild from the directory, which also drops deleted names */
+    while (nblocks < FILTER_MAX_BLOCKS &&
+           ppvd->nentries >= nblocks * (FILTER_BLOCK_BITS / FILTER_BITS_PER_NAME / 2))
+        nblocks <<= 1;
+    pfilter = filterCreate(nblocks);
+    for (h = 0; h < ptable->size; h++) {
+        const dbPvdSlot *pslot = &ptable->slots[h];
+
+        if (pslot->entry && pslot->entry != PVD_DELETED)
+            filterSet(pfilter, pslot->hash);
+    }
+    pfilter->prev = ppvd->filter;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *) &ppvd->filter, pfilter);
+}
+
+static dbPvdTable * tableCreate(unsigned int size)
+{
+    dbPvdTable *ptable = dbCalloc(1, sizeof(dbPvdTable) +
+        (size - 1) * sizeof(dbPvdSlot));
+
+    ptable->size = size;
+    ptable->mask = size - 1;
+    return ptable;
+}
+
+static unsigned int tableSlot(const dbPvdTable *ptable, unsigned int hash)
+{
+    return hashMix(hash) & ptable->mask;
+}
+
+static PVDENTRY * tableFind(const dbPvdTable *ptable, const char *name,
+    size_t lenName, unsigned int hash, unsigned int *pprobes)
+{
+    unsigned int h = tableSlot(ptable, hash);
+    unsigned int probes = 1;
+    PVDENTRY *ppvdNode;
+
+    for (;; h = (h + 1) & ptable->mask, probes++) {
+        const dbPvdSlot *pslot = &ptable->slots[h];
+
+        ppvdNode = (PVDENTRY *) epicsAtomicGetPtrT((EpicsAtomicPtrT *) &pslot->entry);
+        if (ppvdNode == NULL)
+            break;
+        if (ppvdNode == PVD_DELETED)
+            continue;
+        epicsAtomicReadMemoryBarrier();
+        if (pslot->hash == hash) {
+            const char *recordname = ppvdNode->precnode->recordname;
+
+            if (strncmp(name, recordname, lenName) == 0 &&
+                recordname[lenName] == 0)
+                break;
+        }
+    }
+    if (pprobes)
+        *pprobes = probes;
+    return ppvdNode;
+}
+
+/* Called with lock held, the name must not be in the table yet */
+static void tableInsert(dbPvdTable *ptable, unsigned int hash,
+    PVDENTRY *ppvdNode)
+{
+    unsigned int h = tableSlot(ptable, hash);
+
+    while (ptable->slots[h].entry)
+        h = (h + 1) & ptable->mask;
+    ptable->slots[h].hash = hash;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *) &ptable->slots[h].entry, ppvdNode);
+}
+
+/* Called with lock held.  Copies the entries to a table at most half
+ * full, which also drops the slots of deleted entries.
+ */
+static void tableGrow(dbPvd *ppvd)
+{
+    dbPvdTable *pold = ppvd->table;
+    dbPvdTable *ptable;
+    unsigned int size = pold->size;
+    unsigned int h;
+
+    while ((ppvd->nentries + 1) * 2 > size)
+        size <<= 1;
+    ptable = tableCreate(size);
+    for (h = 0; h < pold->size; h++) {
+        const dbPvdSlot *pslot = &pold->slots[h];
+
+        if (pslot->entry && pslot->entry != PVD_DELETED)
+            tableInsert(ptable, pslot->hash, pslot->entry);
+    }
+    ptable->prev = pold;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *) &ppvd->table, ptable);
+    ppvd->nused = ppvd->nentries;
+}
+
+static dbPvdTable * tableGet(dbPvd *ppvd)
+{
+    dbPvdTable *ptable = (dbPvdTable *)
+        epicsAtomicGetPtrT((EpicsAtomicPtrT *) &ppvd->table);
+
+    epicsAtomicReadMemoryBarrier();
+    return ptable;
+}
 
 int dbPvdTableSize(int size)
 {
@@ -71,9 +309,12 @@ void dbPvdInitPvt(dbBase *pdbbase)
     }
 
     ppvd = (dbPvd *)dbMalloc(sizeof(dbPvd));
-    ppvd->size    = dbPvdHashTableSize;
-    ppvd->mask    = dbPvdHashTableSize - 1;
-    ppvd->buckets = dbCalloc(ppvd->size, sizeof(dbPvdBucket *));
+    ppvd->table = tableCreate(dbPvdHashTableSize);
+    ppvd->lock = epicsMutexMustCreate();
+    ppvd->filter = filterCreate(FILTER_MIN_BLOCKS);
+    ppvd->nentries = ppvd->nused = 0;
+    ellInit(&ppvd->deleted);
+    ppvd->nrejected = ppvd->npassed = ppvd->nfalse = 0;
 
     pdbbase->ppvd = ppvd;
     return;
@@ -82,119 +323,185 @@ void dbPvdInitPvt(dbBase *pdbbase)
 PVDENTRY *dbPvdFind(dbBase *pdbbase, const char *name, size_t lenName)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
     PVDENTRY *ppvdNode;
+    dbPvdFilter *pfilter;
+    unsigned int hash = epicsMemHash(name, lenName, 0);
+
+    pfilter = (dbPvdFilter *) epicsAtomicGetPtrT((EpicsAtomicPtrT *) &ppvd->filter);
+    epicsAtomicReadMemoryBarrier();
+    if (!filterTest(pfilter, hash)) {
+        if (dbPvdCountLookups)
+            epicsAtomicIncrSizeT(&ppvd->nrejected);
+        return NULL;
+    }
 
-    pbucket = ppvd->buckets[epicsMemHash(name, lenName, 0) & ppvd->mask];
-    if (pbucket == NULL) return NULL;
-
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        const char *recordname = ppvdNode->precnode->recordname;
-
-        if (strncmp(name, recordname, lenName) == 0 &&
-            strlen(recordname) == lenName)
-            break;
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
+    ppvdNode = tableFind(tableGet(ppvd), name, lenName, hash, NULL);
+    if (dbPvdCountLookups) {
+        epicsAtomicIncrSizeT(&ppvd->npassed);
+        if (!ppvdNode)
+            epicsAtomicIncrSizeT(&ppvd->nfalse);
     }
-    epicsMutexUnlock(pbucket->lock);
     return ppvdNode;
 }
-
+
 PVDENTRY *dbPvdAdd(dbBase *pdbbase, dbRecordType *precordType,
     dbRecordNode *precnode)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
     PVDENTRY *ppvdNode;
     char *name = precnode->recordname;
-    unsigned int h;
+    unsigned int hash = epicsStrHash(name, 0);
 
-    h = epicsStrHash(name, 0) & ppvd->mask;
-    pbucket = ppvd->buckets[h];
-    if (pbucket == NULL) {
-        pbucket = dbCalloc(1, sizeof(dbPvdBucket));
-        ellInit(&pbucket->list);
-        pbucket->lock = epicsMutexCreate();
-        ppvd->buckets[h] = pbucket;
-    }
-
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        if (strcmp(name, ppvdNode->precnode->recordname) == 0) {
-            epicsMutexUnlock(pbucket->lock);
-            return NULL;
-        }
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
+    epicsMutexMustLock(ppvd->lock);
+    if (tableFind(ppvd->table, name, strlen(name), hash, NULL)) {
+        epicsMutexUnlock(ppvd->lock);
+        return NULL;
     }
+    /* Keep at least a quarter of the slots NULL, so probes stay short */
+    if ((ppvd->nused + 1) * 4 > ppvd->table->size * 3)
+        tableGrow(ppvd);
+
     ppvdNode = dbCalloc(1, sizeof(PVDENTRY));
     ppvdNode->precordType = precordType;
     ppvdNode->precnode = precnode;
-    ellAdd(&pbucket->list, (ELLNODE *)ppvdNode);
-    epicsMutexUnlock(pbucket->lock);
+    tableInsert(ppvd->table, hash, ppvdNode);
+    ppvd->nused++;
+    ppvd->nentries++;
+    filterAdd(ppvd, hash);
+    epicsMutexUnlock(ppvd->lock);
     return ppvdNode;
 }
 
 void dbPvdDelete(dbBase *pdbbase, dbRecordNode *precnode)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
-    PVDENTRY *ppvdNode;
+    dbPvdTable *ptable;
     char *name = precnode->recordname;
+    unsigned int hash = epicsStrHash(name, 0);
+    unsigned int h;
 
-    pbucket = ppvd->buckets[epicsStrHash(name, 0) & ppvd->mask];
-    if (pbucket == NULL) return;
+    epicsMutexMustLock(ppvd->lock);
+    ptable = ppvd->table;
+    for (h = tableSlot(ptable, hash); ptable->slots[h].entry;
+         h = (h + 1) & ptable->mask) {
+        dbPvdSlot *pslot = &ptable->slots[h];
+        PVDENTRY *ppvdNode = pslot->entry;
 
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        if (ppvdNode->precnode &&
+        if (ppvdNode != PVD_DELETED && pslot->hash == hash &&
+            ppvdNode->precnode &&
             ppvdNode->precnode->recordname &&
             strcmp(name, ppvdNode->precnode->recordname) == 0) {
-            ellDelete(&pbucket->list, (ELLNODE *)ppvdNode);
-            free(ppvdNode);
+            epicsAtomicSetPtrT((EpicsAtomicPtrT *) &pslot->entry, PVD_DELETED);
+            ellAdd(&ppvd->deleted, (ELLNODE *)ppvdNode);
+            ppvd->nentries--;
             break;
         }
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
     }
-    epicsMutexUnlock(pbucket->lock);
+    epicsMutexUnlock(ppvd->lock);
     return;
 }
 
 void dbPvdFreeMem(dbBase *pdbbase)
 {
     dbPvd *ppvd = pdbbase->ppvd;
+    dbPvdTable *ptable;
     unsigned int h;
 
     if (ppvd == NULL) return;
     pdbbase->ppvd = NULL;
 
-    for (h = 0; h < ppvd->size; h++) {
-        dbPvdBucket *pbucket = ppvd->buckets[h];
-        PVDENTRY *ppvdNode;
+    ptable = ppvd->table;
+    for (h = 0; h < ptable->size; h++) {
+        PVDENTRY *ppvdNode = ptable->slots[h].entry;
 
-        if (pbucket == NULL) continue;
-        epicsMutexMustLock(pbucket->lock);
-        ppvd->buckets[h] = NULL;
-        while ((ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list))) {
-            ellDelete(&pbucket->list, (ELLNODE *)ppvdNode);
+        if (ppvdNode && ppvdNode != PVD_DELETED)
             free(ppvdNode);
-        }
-        epicsMutexUnlock(pbucket->lock);
-        epicsMutexDestroy(pbucket->lock);
-        free(pbucket);
     }
-    free(ppvd->buckets);
+    ellFree(&ppvd->deleted);
+    while (ppvd->table) {
+        ptable = ppvd->table;
+        ppvd->table = ptable->prev;
+        free(ptable);
+    }
+    while (ppvd->filter) {
+        dbPvdFilter *pfilter = ppvd->filter;
+
+        ppvd->filter = pfilter->prev;
+        free(pfilter);
+    }
+    epicsMutexDestroy(ppvd->lock);
     free(ppvd);
 }
 
+void dbPvdFilterStats(dbBase *pdbbase, dbPvdFilterInfo *pinfo)
+{
+    dbPvd *ppvd = pdbbase ? pdbbase->ppvd : NULL;
+    const dbPvdFilter *pfilter;
+    size_t i, nwords;
+
+    memset(pinfo, 0, sizeof(*pinfo));
+    if (ppvd == NULL) return;
+
+    epicsMutexMustLock(ppvd->lock);
+    pfilter = ppvd->filter;
+    nwords = (size_t) pfilter->nblocks * FILTER_BLOCK_WORDS;
+    pinfo->bits = nwords * 32;
+    for (i = 0; i < nwords; i++) {
+        epicsUInt32 w = pfilter->bits[i];
+
+        while (w) {
+            w &= w - 1;
+            pinfo->bitsSet++;
+        }
+    }
+    pinfo->names = pfilter->nnames;
+    pinfo->entries = ppvd->nentries;
+    epicsMutexUnlock(ppvd->lock);
+
+    pinfo->rejected = epicsAtomicGetSizeT(&ppvd->nrejected);
+    pinfo->passed = epicsAtomicGetSizeT(&ppvd->npassed);
+    pinfo->falsePositive = epicsAtomicGetSizeT(&ppvd->nfalse);
+}
+
+/* Time lookups of the names given, as they are or with a character
+ * appended so they are missing.  Returns 0 if any lookup had the wrong
+ * result.  Called with lock held.
+ */
+static int dumpTiming(dbPvd *ppvd, const char **names, unsigned int n,
+    int missing, double *pns)
+{
+    const dbPvdTable *ptable = ppvd->table;
+    const dbPvdFilter *pfilter = ppvd->filter;
+    char name[PVNAME_STRINGSZ + 2];
+    unsigned int i, found = 0;
+    epicsUInt64 start = epicsMonotonicGet();
+
+    for (i = 0; i < n; i++) {
+        const char *pname = names[i];
+        size_t len = strlen(pname);
+        unsigned int hash;
+
+        if (missing) {
+            memcpy(name, pname, len);
+            name[len++] = '\x7f';
+            pname = name;
+        }
+        hash = epicsMemHash(pname, len, 0);
+        if (filterTest(pfilter, hash) &&
+            tableFind(ptable, pname, len, hash, NULL))
+            found++;
+    }
+    *pns = n ? (double) (epicsMonotonicGet() - start) / n : 0.0;
+    return found == (missing ? 0 : n);
+}
+
 void dbPvdDump(dbBase *pdbbase, int verbose)
 {
-    unsigned int empty = 0;
     dbPvd *ppvd;
-    unsigned int h;
+    dbPvdTable *ptable;
+    unsigned int h, n = 0, nsamples = 0, maxProbes = 0;
+    double totalProbes = 0.0, hitNs, missNs;
+    const char **samples;
 
     if (!pdbbase) {
         fprintf(stderr,"pdbbase not specified\n");
@@ -203,27 +510,58 @@ void dbPvdDump(dbBase *pdbbase, int verbose)
     ppvd = pdbbase->ppvd;
     if (ppvd == NULL) return;
 
-    printf("Process Variable Directory has %u buckets", ppvd->size);
+    samples = dbCalloc(DUMP_SAMPLES, sizeof(const char *));
+    epicsMutexMustLock(ppvd->lock);
+    ptable = ppvd->table;
+    printf("Process Variable Directory has %u slots, %u names, %u deleted",
+        ptable->size, ppvd->nentries, ppvd->nused - ppvd->nentries);
 
-    for (h = 0; h < ppvd->size; h++) {
-        dbPvdBucket *pbucket = ppvd->buckets[h];
-        PVDENTRY *ppvdNode;
-        int i = 1;
+    for (h = 0; h < ptable->size; h++) {
+        const dbPvdSlot *pslot = &ptable->slots[h];
+        unsigned int probes;
 
-        if (pbucket == NULL) {
-            empty++;
+        if (!pslot->entry || pslot->entry == PVD_DELETED)
             continue;
+        if (nsamples < DUMP_SAMPLES &&
+            strlen(pslot->entry->precnode->recordname) < PVNAME_STRINGSZ)
+            samples[nsamples++] = pslot->entry->precnode->recordname;
+        probes = ((h - tableSlot(ptable, pslot->hash)) & ptable->mask) + 1;
+        totalProbes += probes;
+        if (probes > maxProbes)
+            maxProbes = probes;
+        if (verbose) {
+            if (!(n % 3))
+                printf("\n");
+            printf("  [%6u] %2u %-20s", h, probes,
+                pslot->entry->precnode->recordname);
         }
-        epicsMutexMustLock(pbucket->lock);
-        ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-        printf("\n [%4u] %4d  ", h, ellCount(&pbucket->list));
-        while (ppvdNode && verbose) {
-            if (!(++i % 4))
-                printf("\n         ");
-            printf("  %s", ppvdNode->precnode->recordname);
-            ppvdNode = (PVDENTRY *) ellNext((ELLNODE*)ppvdNode);
-        }
-        epicsMutexUnlock(pbucket->lock);
+        n++;
+    }
+    printf("\n");
+    if (n)
+        printf("Finding a name takes %.2f probes on average, at most %u.\n",
+            totalProbes / n, maxProbes);
+    if (nsamples &&
+        dumpTiming(ppvd, samples, nsamples, 0, &hitNs) &&
+        dumpTiming(ppvd, samples, nsamples, 1, &missNs))
+        printf("Lookups take %.0f ns for present names, "
+            "%.0f ns for missing ones.\n", hitNs, missNs);
+    epicsMutexUnlock(ppvd->lock);
+    free(samples);
+
+    {
+        dbPvdFilterInfo info;
+
+        dbPvdFilterStats(pdbbase, &info);
+        printf("Name filter of %lu bits, %.1f%% set, for %u names (%u current).\n",
+            (unsigned long) info.bits, 100.0 * info.bitsSet / info.bits,
+            info.names, info.entries);
+        if (dbPvdCountLookups)
+            printf("%lu lookups rejected by the filter, %lu passed, "
+                "%lu of those not found.\n",
+                (unsigned long) info.rejected, (unsigned long) info.passed,
+                (unsigned long) info.falsePositive);
+        else
+            printf("Set dbPvdCountLookups to count the lookups.\n");
     }
-    printf("\n%u buckets empty.\n", empty);
 }
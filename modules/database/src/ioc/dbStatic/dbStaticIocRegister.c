@@ -181,10 +181,11 @@ static const iocshFuncDef dbPvdDumpFuncDef = {
     "dbPvdDump",
     2,
     dbPvdDumpArgs,
-    "Dump the various buckets of the process variable directory.\n"
-    "If verbose is greater than 0, also print the process variables in each bucket.\n"
+    "Show how full the process variable directory is, how many probes\n"
+    "finding a name takes, and how long lookups take.\n"
+    "If verbose is greater than 0, also print every slot in use.\n"
     "Example: dbPvdDump pdbbase 1\n"
-    "If the last argument(s) are missing, dump all buckets as though verbose is 0.\n",
+    "If the last argument(s) are missing, dump as though verbose is 0.\n",
 };
 static void dbPvdDumpCallFunc(const iocshArgBuf *args)
 {
@@ -199,9 +200,9 @@ static const iocshFuncDef dbPvdTableSizeFuncDef = {
     "dbPvdTableSize",
     1,
     dbPvdTableSizeArgs,
-    "Change the number of buckets in the process variable directory.\n\n"
+    "Change the initial number of slots in the process variable directory.\n\n"
     "The process variable directory size should be set before loading the database.\n"
-    "The size of the process variable directory can automatically grow.\n"
+    "The size of the process variable directory grows automatically.\n"
     "The size must be a power of 2.\n\n"
     "Example: dbPvdTableSize 1024\n",
 };
@@ -210,6 +211,44 @@ static void dbPvdTableSizeCallFunc(const iocshArgBuf *args)
     dbPvdTableSize(args[0].ival);
 }
 
+/* dbRecordCache */
+static const iocshArg dbRecordCacheArg0 = { "directory",iocshArgStringPath};
+static const iocshArg * const dbRecordCacheArgs[1] =
+    {&dbRecordCacheArg0};
+static const iocshFuncDef dbRecordCacheFuncDef = {
+    "dbRecordCache",
+    1,
+    dbRecordCacheArgs,
+    "Keep the records created by later dbLoadRecords commands in binary\n"
+    "cache files in the given directory, which must exist.\n\n"
+    "A cache file is used instead of parsing the .db file again if the\n"
+    ".db file, the files it includes, the substitutions and the record\n"
+    "type definitions are the same.  Without a directory the cache is off.\n\n"
+    "Example: dbRecordCache /var/cache/myioc\n",
+};
+static void dbRecordCacheCallFunc(const iocshArgBuf *args)
+{
+    iocshSetError(dbRecordCache(args[0].sval));
+}
+
+/* dbRecordCacheShow */
+static const iocshArg dbRecordCacheShowArg0 = { "level",iocshArgInt};
+static const iocshArg * const dbRecordCacheShowArgs[1] =
+    {&dbRecordCacheShowArg0};
+static const iocshFuncDef dbRecordCacheShowFuncDef = {
+    "dbRecordCacheShow",
+    1,
+    dbRecordCacheShowArgs,
+    "Show how long loading .db files through the record cache took,\n"
+    "compared with parsing them.\n"
+    "If level is greater than 0, list every file loaded.\n\n"
+    "Example: dbRecordCacheShow 1\n",
+};
+static void dbRecordCacheShowCallFunc(const iocshArgBuf *args)
+{
+    dbRecordCacheShow(args[0].ival);
+}
+
 /* dbReportDeviceConfig */
 static const iocshArg * const dbReportDeviceConfigArgs[] = {&argPdbbase};
 static const iocshFuncDef dbReportDeviceConfigFuncDef = {
@@ -276,6 +315,8 @@ void dbStaticIocRegister(void)
     iocshRegister(&dbDumpBreaktableFuncDef, dbDumpBreaktableCallFunc);
     iocshRegister(&dbPvdDumpFuncDef, dbPvdDumpCallFunc);
     iocshRegister(&dbPvdTableSizeFuncDef,dbPvdTableSizeCallFunc);
+    iocshRegister(&dbRecordCacheFuncDef,dbRecordCacheCallFunc);
+    iocshRegister(&dbRecordCacheShowFuncDef,dbRecordCacheShowCallFunc);
     iocshRegister(&dbReportDeviceConfigFuncDef, dbReportDeviceConfigCallFunc);
     iocshRegister(&dbCreateAliasFuncDef, dbCreateAliasCallFunc);
 }
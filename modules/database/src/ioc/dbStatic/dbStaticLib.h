@@ -79,6 +79,21 @@ DBCORE_API long dbReadDatabase(DBBASE **ppdbbase,
  */
 DBCORE_API long dbReadDatabaseFP(DBBASE **ppdbbase,
     FILE *fp, const char *path, const char *substitutions);
+/** \brief Read a .db file like dbReadDatabase(), through the record cache.
+ *
+ *  If dbRecordCache() named a directory, the records are created from a
+ *  cache file there when one was made from the same files with the same
+ *  arguments and record type definitions.  Otherwise the file is parsed
+ *  and the cache file written.
+ *  \since 7.0.9
+ */
+DBCORE_API long dbReadDatabaseCached(DBBASE **ppdbbase,
+    const char *filename, const char *path, const char *substitutions);
+/** \brief Set the directory of the record cache, NULL or "" turns it off.
+ *  \return 0, or -1 after iocInit
+ *  \since 7.0.9
+ */
+DBCORE_API int dbRecordCache(const char *directory);
 DBCORE_API long dbPath(DBBASE *pdbbase, const char *path);
 DBCORE_API long dbAddPath(DBBASE *pdbbase, const char *path);
 DBCORE_API char * dbGetPromptGroupNameFromKey(DBBASE *pdbbase,
@@ -136,6 +151,9 @@ DBCORE_API int dbGetPromptGroup(DBENTRY *pdbentry);
 
 DBCORE_API long dbCreateRecord(DBENTRY *pdbentry,
     const char *pname);
+/* Records may only be deleted while no other thread looks up names,
+ * i.e. not while the IOC is running.
+ */
 DBCORE_API long dbDeleteRecord(DBENTRY *pdbentry);
 DBCORE_API long dbFreeRecords(DBBASE *pdbbase);
 DBCORE_API long dbFindRecordPart(DBENTRY *pdbentry,
@@ -240,6 +258,35 @@ DBCORE_API void dbDumpVariable(DBBASE *pdbbase);
 DBCORE_API void dbDumpBreaktable(DBBASE *pdbbase,
     const char *name);
 DBCORE_API void dbPvdDump(DBBASE *pdbbase, int verbose);
+
+/** Statistics of the record name filter used by the PV directory */
+typedef struct dbPvdFilterInfo {
+    size_t bits;            /**< Size of the filter */
+    size_t bitsSet;         /**< Bits currently set */
+    unsigned names;         /**< Names added, including deleted ones */
+    unsigned entries;       /**< Names currently in the directory */
+    size_t rejected;        /**< Lookups rejected by the filter */
+    size_t passed;          /**< Lookups passed on to the hash table */
+    size_t falsePositive;   /**< Passed lookups which found nothing */
+} dbPvdFilterInfo;
+
+DBCORE_API void dbPvdFilterStats(DBBASE *pdbbase, dbPvdFilterInfo *pinfo);
+
+/** Lookups are only counted in dbPvdFilterInfo while this is set */
+DBCORE_API extern int dbPvdCountLookups;
+
+/** Counters of the record cache, see dbReadDatabaseCached() */
+typedef struct dbRecordCacheInfo {
+    unsigned long loaded;   /**< Files loaded from the cache */
+    unsigned long parsed;   /**< Files parsed, there was no usable cache */
+    unsigned long saved;    /**< Parsed files written to the cache */
+    double loadTime;        /**< Seconds spent loading from the cache */
+    double parseTimeSaved;  /**< Seconds parsing the loaded files took */
+    double parseTime;       /**< Seconds spent parsing */
+} dbRecordCacheInfo;
+
+DBCORE_API void dbRecordCacheStats(dbRecordCacheInfo *pinfo);
+DBCORE_API void dbRecordCacheShow(int level);
 DBCORE_API void dbReportDeviceConfig(DBBASE *pdbbase,
     FILE *report);
 
@@ -26,11 +26,17 @@
 #include "dbDefs.h"
 #include "ellLib.h"
 #include "envDefs.h"
+#include "epicsAtomic.h"
 #include "epicsExit.h"
 #include "epicsGeneralTime.h"
+#include "epicsMutex.h"
 #include "epicsPrint.h"
 #include "epicsSignal.h"
+#include "epicsStdio.h"
+#include "epicsString.h"
 #include "epicsThread.h"
+#include "epicsThreadPool.h"
+#include "epicsTime.h"
 #include "errMdef.h"
 #include "iocsh.h"
 #include "taskwd.h"
@@ -54,6 +60,7 @@
 #include "dbNotify.h"
 #include "dbScan.h"
 #include "dbServer.h"
+#include "dbSnapshotPvt.h"
 #include "dbStaticLib.h"
 #include "dbStaticPvt.h"
 #include "devSup.h"
@@ -98,6 +105,29 @@ static void iterateRecords(recIterFunc func, void *user);
 int dbThreadRealtimeLock = 1;
 epicsExportAddress(int, dbThreadRealtimeLock);
 
+int iocInitTiming = 0;
+epicsExportAddress(int, iocInitTiming);
+
+/* Parallel record initialization, set by iocInitParallel() */
+static int initThreads;
+static char *initSafeTypes;
+
+int iocInitParallel(int nThreads, const char *recordTypes)
+{
+    if (iocState != iocVoid) {
+        errlogPrintf("iocInitParallel: Must be called before iocInit\n");
+        return -1;
+    }
+    free(initSafeTypes);
+    initSafeTypes = NULL;
+    initThreads = 0;
+    if (nThreads > 1 && recordTypes && *recordTypes) {
+        initSafeTypes = epicsStrDup(recordTypes);
+        initThreads = nThreads;
+    }
+    return 0;
+}
+
 enum iocStateEnum getIocState(void)
 {
     return iocState;
@@ -555,18 +585,313 @@ static void doInitRecord1(dbRecordType *pdbRecordType, dbCommon *precord,
 
     if (prset->init_record)
         prset->init_record(precord, 1);
+    dbSnapshotInit(precord);
+}
+
+/*
+ * Record initialization, optionally on several threads.
+ *
+ * Each pass finishes for all records before the next one starts, and
+ * the record types are done in the usual order.  In pass 1 the records
+ * of a type declared thread-safe by iocInitParallel() are shared among
+ * the pool's threads by lock set, so records linked by DB links are
+ * initialized in order by one thread.  Lock sets are only merged while
+ * links are resolved, which is done serially, so pass 0 must be serial
+ * too: before that every record is in a lock set of its own.
+ */
+enum initPhase {initPass0, initLinks, initPass1, initPhases};
+
+static const char * const initPhaseName[initPhases] = {
+    "pass 0", "links", "pass 1"
+};
+
+typedef struct initType {
+    dbRecordType    *prt;
+    int             parallel;
+    unsigned long   count;
+    double          time[initPhases];   /* summed over all records */
+} initType;
+
+typedef struct initEntry {
+    unsigned long   lockId;
+    size_t          order;
+    dbCommon        *precord;
+} initEntry;
+
+typedef struct initWork {
+    recIterFunc     func;
+    initType        *pit;
+    enum initPhase  phase;
+    initEntry       *entries;
+    size_t          *groups;    /* start of each lock set, plus the end */
+    size_t          nGroups;
+    size_t          next;       /* next group to claim, atomic */
+    epicsMutexId    lock;       /* guards pit->time */
+} initWork;
+
+/* Most threads iocInitParallel() will use */
+#define INIT_MAX_THREADS 64
+
+static epicsThreadPool *initPool;
+static initType *initTypes;
+static int nInitTypes;
+
+static int typeIsSafe(const char *name)
+{
+    const char *p = initSafeTypes;
+    size_t len = strlen(name);
+
+    if (!p)
+        return 0;
+    while (*p) {
+        size_t n;
+
+        p += strspn(p, " ,");
+        n = strcspn(p, " ,");
+        if ((n == 1 && *p == '*') || (n == len && !strncmp(p, name, n)))
+            return 1;
+        p += n;
+    }
+    return 0;
+}
+
+static void initRecordTimed(recIterFunc func, dbRecordType *prt,
+    dbCommon *precord, double *ptime)
+{
+    epicsUInt64 start;
+
+    if (!iocInitTiming) {
+        func(prt, precord, NULL);
+        return;
+    }
+    start = epicsMonotonicGet();
+    func(prt, precord, NULL);
+    *ptime += (epicsMonotonicGet() - start) * 1e-9;
+}
+
+static void initJob(void *arg, epicsJobMode mode)
+{
+    initWork *pw = arg;
+    double time = 0.0;
+    size_t g, i;
+
+    if (mode != epicsJobModeRun)
+        return;
+    while ((g = epicsAtomicIncrSizeT(&pw->next) - 1) < pw->nGroups) {
+        for (i = pw->groups[g]; i < pw->groups[g + 1]; i++)
+            initRecordTimed(pw->func, pw->pit->prt, pw->entries[i].precord,
+                &time);
+    }
+    epicsMutexMustLock(pw->lock);
+    pw->pit->time[pw->phase] += time;
+    epicsMutexUnlock(pw->lock);
+}
+
+static int entryCompare(const void *a, const void *b)
+{
+    const initEntry *pa = a, *pb = b;
+
+    if (pa->lockId != pb->lockId)
+        return pa->lockId < pb->lockId ? -1 : 1;
+    return pa->order < pb->order ? -1 : pa->order > pb->order;
+}
+
+/* Returns non-zero if the records could not be shared among threads */
+static int initTypeParallel(initType *pit, enum initPhase phase,
+    recIterFunc func)
+{
+    initWork work;
+    epicsJob *jobs[INIT_MAX_THREADS];
+    dbRecordNode *pdbRecordNode;
+    size_t n = 0, i;
+    int j;
+
+    work.entries = calloc(pit->count + 1, sizeof(*work.entries));
+    work.groups = calloc(pit->count + 1, sizeof(*work.groups));
+    work.lock = epicsMutexCreate();
+    if (!work.entries || !work.groups || !work.lock) {
+        free(work.entries);
+        free(work.groups);
+        if (work.lock)
+            epicsMutexDestroy(work.lock);
+        return -1;
+    }
+
+    for (pdbRecordNode = (dbRecordNode *)ellFirst(&pit->prt->recList);
+         pdbRecordNode;
+         pdbRecordNode = (dbRecordNode *)ellNext(&pdbRecordNode->node)) {
+        dbCommon *precord = pdbRecordNode->precord;
+
+        if (!precord->name[0] ||
+            pdbRecordNode->flags & DBRN_FLAGS_ISALIAS)
+            continue;
+        work.entries[n].lockId = dbLockGetLockId(precord);
+        work.entries[n].order = n;
+        work.entries[n].precord = precord;
+        n++;
+    }
+    qsort(work.entries, n, sizeof(*work.entries), entryCompare);
+
+    work.nGroups = 0;
+    for (i = 0; i < n; i++) {
+        if (!i || work.entries[i].lockId != work.entries[i - 1].lockId)
+            work.groups[work.nGroups++] = i;
+    }
+    work.groups[work.nGroups] = n;
+    work.func = func;
+    work.pit = pit;
+    work.phase = phase;
+    work.next = 0;
+
+    for (j = 0; j < initThreads; j++) {
+        jobs[j] = epicsJobCreate(initPool, initJob, &work);
+        if (jobs[j] && epicsJobQueue(jobs[j])) {
+            epicsJobDestroy(jobs[j]);
+            jobs[j] = NULL;
+        }
+        if (!jobs[j])
+            break;
+    }
+    /* This thread helps, and does it all if no job could be queued */
+    initJob(&work, epicsJobModeRun);
+    epicsThreadPoolWait(initPool, -1.0);
+    while (j-- > 0)
+        epicsJobDestroy(jobs[j]);
+
+    free(work.entries);
+    free(work.groups);
+    epicsMutexDestroy(work.lock);
+    return 0;
+}
+
+static void initTypesCreate(void)
+{
+    dbRecordType *pdbRecordType;
+    int nParallel = 0;
+    int i = 0;
+
+    nInitTypes = ellCount(&pdbbase->recordTypeList);
+    initTypes = dbCalloc(nInitTypes ? nInitTypes : 1, sizeof(*initTypes));
+    for (pdbRecordType = (dbRecordType *)ellFirst(&pdbbase->recordTypeList);
+         pdbRecordType && i < nInitTypes;
+         pdbRecordType = (dbRecordType *)ellNext(&pdbRecordType->node)) {
+        initType *pit = &initTypes[i++];
+        dbRecordNode *pdbRecordNode;
+
+        pit->prt = pdbRecordType;
+        for (pdbRecordNode = (dbRecordNode *)ellFirst(&pdbRecordType->recList);
+             pdbRecordNode;
+             pdbRecordNode = (dbRecordNode *)ellNext(&pdbRecordNode->node)) {
+            dbCommon *precord = pdbRecordNode->precord;
+
+            if (precord->name[0] &&
+                !(pdbRecordNode->flags & DBRN_FLAGS_ISALIAS))
+                pit->count++;
+        }
+        pit->parallel = initThreads > 1 && pit->count > 1 &&
+            typeIsSafe(pdbRecordType->name);
+        nParallel += pit->parallel;
+    }
+
+    if (nParallel) {
+        epicsThreadPoolConfig conf;
+
+        epicsThreadPoolConfigDefaults(&conf);
+        if (initThreads > INIT_MAX_THREADS)
+            initThreads = INIT_MAX_THREADS;
+        conf.initialThreads = conf.maxThreads = initThreads;
+        initPool = epicsThreadPoolCreate(&conf);
+        if (!initPool) {
+            errlogPrintf("iocInit: Can't create threads, "
+                "initializing records serially\n");
+            for (i = 0; i < nInitTypes; i++)
+                initTypes[i].parallel = 0;
+        }
+    }
+}
+
+static void initTypesReport(const double *wall)
+{
+    int i, phase;
+
+    printf("Record initialization took");
+    for (phase = 0; phase < initPhases; phase++)
+        printf("%s %s %.3f s", phase ? "," : "", initPhaseName[phase],
+            wall[phase]);
+    if (initPool)
+        printf(", on %d threads", initThreads);
+    printf("\n RECORD TYPE        RECORDS     PASS 0      LINKS     PASS 1"
+        "  PARALLEL\n");
+    for (i = 0; i < nInitTypes; i++) {
+        const initType *pit = &initTypes[i];
+
+        if (!pit->count)
+            continue;
+        printf(" %-16s %9lu %10.3f %10.3f %10.3f  %s\n", pit->prt->name,
+            pit->count, pit->time[initPass0], pit->time[initLinks],
+            pit->time[initPass1], pit->parallel ? "yes" : "no");
+    }
+}
+
+static void initTypesDestroy(void)
+{
+    if (initPool)
+        epicsThreadPoolDestroy(initPool);
+    initPool = NULL;
+    free(initTypes);
+    initTypes = NULL;
+    nInitTypes = 0;
+}
+
+static void initRecords(enum initPhase phase, recIterFunc func)
+{
+    int i;
+
+    for (i = 0; i < nInitTypes; i++) {
+        initType *pit = &initTypes[i];
+        dbRecordNode *pdbRecordNode;
+
+        if (phase == initPass1 && pit->parallel &&
+            !initTypeParallel(pit, phase, func))
+            continue;
+
+        for (pdbRecordNode = (dbRecordNode *)ellFirst(&pit->prt->recList);
+             pdbRecordNode;
+             pdbRecordNode = (dbRecordNode *)ellNext(&pdbRecordNode->node)) {
+            dbCommon *precord = pdbRecordNode->precord;
+
+            if (!precord->name[0] ||
+                pdbRecordNode->flags & DBRN_FLAGS_ISALIAS)
+                continue;
+            initRecordTimed(func, pit->prt, precord, &pit->time[phase]);
+        }
+    }
 }
 
 static void initDatabase(void)
 {
+    static const recIterFunc phaseFunc[initPhases] = {
+        doInitRecord0, doResolveLinks, doInitRecord1
+    };
+    double wall[initPhases];
+    int phase;
+
     dbChannelInit();
-    iterateRecords(doInitRecord0, NULL);
-    iterateRecords(doResolveLinks, NULL);
-    iterateRecords(doInitRecord1, NULL);
+    initTypesCreate();
+    for (phase = 0; phase < initPhases; phase++) {
+        epicsUInt64 start = epicsMonotonicGet();
+
+        initRecords(phase, phaseFunc[phase]);
+        wall[phase] = (epicsMonotonicGet() - start) * 1e-9;
+    }
+    if (iocInitTiming)
+        initTypesReport(wall);
+    initTypesDestroy();
 
     epicsAtExit(exitDatabase, NULL);
     return;
 }
+
 
 /*
  *  Process database records at initialization ordered by phase
@@ -704,6 +1029,8 @@ static void doFreeRecord(dbRecordType *pdbRecordType, dbCommon *precord,
     }
 
     epicsMutexDestroy(precord->mlok);
+    free(precord->mlix); /* may be allocated in dbEvent.c */
+    free(precord->snap); /* may be allocated in dbSnapshot.c */
     free(precord->ppnr); /* may be allocated in dbNotify.c */
 }
 
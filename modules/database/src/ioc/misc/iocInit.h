@@ -30,6 +30,26 @@ DBCORE_API int iocRun(void);
 DBCORE_API int iocPause(void);
 DBCORE_API int iocShutdown(void);
 
+/** @brief Initialize the records of some types on several threads
+ *
+ * Must be called before iocInit().  In the second init_record() pass the
+ * records of each listed type are shared among nThreads threads, by lock
+ * set.  Their record and device support must be safe to call from
+ * different threads for records in different lock sets.  The first pass
+ * runs before links have merged the lock sets and stays serial.  The
+ * order of the passes and of the record types is kept.
+ * @param nThreads Threads to use, 0 or 1 to initialize serially
+ * @param recordTypes Names separated by spaces or commas, "*" for all
+ * @return 0, or -1 after iocInit()
+ * @since 7.0.9
+ */
+DBCORE_API int iocInitParallel(int nThreads, const char *recordTypes);
+
+/** @brief Print how long each record type took to initialize
+ * @since 7.0.9
+ */
+DBCORE_API extern int iocInitTiming;
+
 #ifdef __cplusplus
 }
 #endif
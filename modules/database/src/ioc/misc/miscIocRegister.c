@@ -26,6 +26,22 @@ static void iocInitCallFunc(const iocshArgBuf *args)
     iocshSetError(iocInit());
 }
 
+/* iocInitParallel */
+static const iocshArg iocInitParallelArg0 = { "nThreads",iocshArgInt};
+static const iocshArg iocInitParallelArg1 = { "recordTypes",iocshArgString};
+static const iocshArg * const iocInitParallelArgs[2] =
+    {&iocInitParallelArg0,&iocInitParallelArg1};
+static const iocshFuncDef iocInitParallelFuncDef = {"iocInitParallel",2,iocInitParallelArgs,
+             "Run init_record pass 1 of the listed types on nThreads threads, by lock set.\n"
+             "Their record and device support must be thread-safe.\n"
+             "recordTypes are separated by spaces or commas, \"*\" means all types.\n"
+             "Must be called before iocInit.  Set iocInitTiming=1 to time record init.\n\n"
+             "Example: iocInitParallel 4 \"ai ao calc\"\n"};
+static void iocInitParallelCallFunc(const iocshArgBuf *args)
+{
+    iocshSetError(iocInitParallel(args[0].ival, args[1].sval));
+}
+
 /* iocBuild */
 static const iocshFuncDef iocBuildFuncDef = {"iocBuild",0,NULL,
              "First step of the IOC initialization, puts the IOC into a ready-to-run (quiescent) state.\n"
@@ -65,6 +81,7 @@ static void coreReleaseCallFunc(const iocshArgBuf *args)
 void miscIocRegister(void)
 {
     iocshRegister(&iocInitFuncDef,iocInitCallFunc);
+    iocshRegister(&iocInitParallelFuncDef,iocInitParallelCallFunc);
     iocshRegister(&iocBuildFuncDef,iocBuildCallFunc);
     iocshRegister(&iocRunFuncDef,iocRunCallFunc);
     iocshRegister(&iocPauseFuncDef,iocPauseCallFunc);
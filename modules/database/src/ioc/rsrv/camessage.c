@@ -24,6 +24,8 @@
 #include <stdarg.h>
 #include <limits.h>
 
+#include "epicsAtomic.h"
+#include "epicsEndian.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsStdio.h"
@@ -42,6 +44,7 @@
 #include "callback.h"
 #include "db_access.h"
 #include "db_access_routines.h"
+#include "db_convert.h"
 #include "dbChannel.h"
 #include "dbCommon.h"
 #include "dbEvent.h"
@@ -378,7 +381,11 @@ static int tcp_version_action ( caHdrLargeArray *mp, void *pPayload,
     tmp += epicsThreadPriorityCAServerLow;
     epicsPriorityNew = (unsigned) tmp;
     epicsPrioritySelf = epicsThreadGetPrioritySelf();
-    if ( epicsPriorityNew != epicsPrioritySelf ) {
+    if ( client->ioWorker ) {
+        /* the I/O thread is shared, priority is not per client */
+        client->priority = mp->m_dataType;
+    }
+    else if ( epicsPriorityNew != epicsPrioritySelf ) {
         epicsThreadBooleanStatus tbs;
         unsigned priorityOfEvents;
         tbs  = epicsThreadHighestPriorityLevelBelow ( epicsPriorityNew, &priorityOfEvents );
@@ -479,6 +486,102 @@ static void no_read_access_event ( struct client *pClient,
     }
 }
 
+/*
+ *  read_reply_zero_copy()
+ *
+ *  Large arrays which the field log holds in a buffer of its own, and
+ *  which need no conversion for the requested type, are sent straight
+ *  from that buffer instead of being copied into the send buffer.
+ *  Only the alarm, time and limit fields which precede the array are
+ *  fetched separately. Without byte swapping the array is only usable
+ *  as is for single byte elements on little endian hosts.
+ *
+ *  Returns FALSE if the reply must be built in the send buffer.
+ */
+static int read_reply_zero_copy ( struct event_ext *pevext,
+    struct client *pClient, struct dbChannel *dbch, db_field_log *pfl )
+{
+#ifdef RSRV_HAVE_SENDMSG
+    ca_uint16_t dbrType = pevext->msg.m_dataType;
+    ca_uint16_t valueType;
+    union db_access_val meta;
+    unsigned metaSize;
+    long item_count;
+    long zero = 0;
+    ca_uint32_t payload_size;
+
+    if ( ! pfl || pfl->type != dbfl_type_ref || ! pfl->dtor ||
+            ! pfl->u.r.field || pfl->no_elements <= 0 ||
+            dbrType > DBR_CTRL_DOUBLE ) {
+        return FALSE;
+    }
+
+    valueType = dbrType % ( LAST_TYPE + 1 );
+    switch ( valueType ) {
+    case DBR_CHAR:
+        break;
+    case DBR_SHORT:
+    case DBR_LONG:
+    case DBR_FLOAT:
+        if ( EPICS_BYTE_ORDER != EPICS_ENDIAN_BIG ) {
+            return FALSE;
+        }
+        break;
+    case DBR_DOUBLE:
+        if ( EPICS_BYTE_ORDER != EPICS_ENDIAN_BIG ||
+                EPICS_FLOAT_WORD_ORDER != EPICS_ENDIAN_BIG ) {
+            return FALSE;
+        }
+        break;
+    default:
+        return FALSE;
+    }
+
+    /* signed and unsigned bytes are both sent as DBR_CHAR */
+    if ( pfl->field_type != dbDBRoldToDBFnew[valueType] &&
+            ! ( valueType == DBR_CHAR && pfl->field_type >= 0 &&
+                pfl->field_type <= newDBR_ENUM &&
+                dbDBRnewToDBRold[pfl->field_type] == DBR_CHAR ) ) {
+        return FALSE;
+    }
+    if ( pfl->field_size != dbr_value_size[dbrType] ) {
+        return FALSE;
+    }
+
+    /* a short array would be padded with zeros by the copying path */
+    item_count = pevext->msg.m_count ? pevext->msg.m_count : pfl->no_elements;
+    if ( item_count > pfl->no_elements ) {
+        return FALSE;
+    }
+
+    /* small replies are cheaper to batch up in the send buffer */
+    payload_size = dbr_size_n ( dbrType, item_count );
+    if ( payload_size <= MAX_TCP ) {
+        return FALSE;
+    }
+
+    /* a zero count fetches everything but the array */
+    metaSize = dbr_value_offset[dbrType];
+    if ( metaSize ) {
+        if ( dbChannel_get_count ( dbch, dbrType, &meta, &zero, pfl ) < 0 ||
+                caNetConvert ( dbrType, &meta, &meta, TRUE, 0 ) != ECA_NORMAL ) {
+            return FALSE;
+        }
+    }
+
+    if ( cas_send_bs_msg_ref ( pClient, pevext->msg.m_cmmd, payload_size,
+            dbrType, item_count, ECA_NORMAL, pevext->msg.m_available,
+            &meta, metaSize, pfl->u.r.field ) != ECA_NORMAL ) {
+        return FALSE;
+    }
+    epicsAtomicIncrSizeT ( &rsrvZeroCopySends );
+    epicsAtomicAddSizeT ( &rsrvZeroCopyBytes, payload_size - metaSize );
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
 /*
  *  read_reply()
  */
@@ -509,11 +612,30 @@ static void read_reply ( void *pArg, struct dbChannel *dbch,
     item_count =
         autosize ? paddr->no_elements : pevext->msg.m_count;
     payload_size = dbr_size_n(pevext->msg.m_dataType, item_count);
+
+    /* If filters are involved in a read, create field log and run filters */
+    if (readAccess && !pfl &&
+        (ellCount(&dbch->pre_chain) || ellCount(&dbch->post_chain))) {
+        pfl = db_create_read_log(dbch);
+        if (pfl) {
+            local_fl = 1;
+            pfl = dbChannelRunPreChain(dbch, pfl);
+            pfl = dbChannelRunPostChain(dbch, pfl);
+        }
+    }
+
+    if ( readAccess && read_reply_zero_copy ( pevext, pClient, dbch, pfl ) ) {
+        if (local_fl) db_delete_field_log(pfl);
+        SEND_UNLOCK ( pClient );
+        return;
+    }
+
     status = cas_copy_in_header(
         pClient, pevext->msg.m_cmmd, payload_size,
         pevext->msg.m_dataType, item_count, cid, pevext->msg.m_available,
         &pPayload );
     if ( status != ECA_NORMAL ) {
+        if (local_fl) db_delete_field_log(pfl);
         send_err ( &pevext->msg, status, pClient,
             "server unable to load read (or subscription update) response "
             "into protocol buffer PV=\"%s\" dbf=%u count=%ld avail=%u max bytes=%u",
@@ -535,16 +657,6 @@ static void read_reply ( void *pArg, struct dbChannel *dbch,
         return;
     }
 
-    /* If filters are involved in a read, create field log and run filters */
-    if (!pfl && (ellCount(&dbch->pre_chain) || ellCount(&dbch->post_chain))) {
-        pfl = db_create_read_log(dbch);
-        if (pfl) {
-            local_fl = 1;
-            pfl = dbChannelRunPreChain(dbch, pfl);
-            pfl = dbChannelRunPostChain(dbch, pfl);
-        }
-    }
-
     status = dbChannel_get_count ( dbch, pevext->msg.m_dataType,
                   pPayload, &item_count, pfl);
 
@@ -1370,6 +1482,11 @@ static int claim_ciu_action ( caHdrLargeArray *mp,
 
     epicsMutexUnlock(pClient->putNotifyLock);
 
+    if ( pClient->ioWorker ) {
+        /* the I/O thread may be waiting in write_notify_action() */
+        epicsEventSignal ( pClient->blockSem );
+    }
+
     /*
      * offload the labor for this to the
      * event task so that we never block
@@ -1691,7 +1808,34 @@ static int write_notify_action ( caHdrLargeArray *mp, void *pPayload,
         epicsMutexMustLock(client->putNotifyLock);
         while(pciu->pPutNotify->busy){
             epicsMutexUnlock(client->putNotifyLock);
-            status = epicsEventWaitWithTimeout(client->blockSem,60.0);
+            if ( client->ioWorker ) {
+                /*
+                 * this thread also delivers extra labor for the client
+                 * so send any completed put notify replies now
+                 */
+                write_notify_reply ( client );
+                epicsMutexMustLock(client->putNotifyLock);
+                if ( ! pciu->pPutNotify->busy ) {
+                    break;
+                }
+                epicsMutexUnlock(client->putNotifyLock);
+
+                /*
+                 * don't block the other circuits of this thread,
+                 * try again when the put notify completes
+                 */
+                if ( ! client->ioParkedUntil ) {
+                    client->ioParkedUntil = epicsMonotonicGet () +
+                        (epicsUInt64) 60u * 1000000000u;
+                }
+                if ( epicsMonotonicGet () < client->ioParkedUntil ) {
+                    return RSRV_PARKED;
+                }
+                status = epicsEventWaitTimeout;
+            }
+            else {
+                status = epicsEventWaitWithTimeout(client->blockSem,60.0);
+            }
             if ( status != epicsEventWaitOK ) {
                 char busyTmp;
                 void * asWritePvtTmp = 0;
@@ -1730,6 +1874,7 @@ static int write_notify_action ( caHdrLargeArray *mp, void *pPayload,
             epicsMutexMustLock(client->putNotifyLock);
         }
         epicsMutexUnlock(client->putNotifyLock);
+        client->ioParkedUntil = 0u;
     }
     else {
         pciu->pPutNotify = rsrvAllocPutNotify ( pciu );
@@ -2190,10 +2335,12 @@ static int search_reply_udp ( caHdrLargeArray *mp, void *pPayload, struct client
     pName[mp->m_postsize-1] = '\0';
 
     /* Exit quickly if channel not on this node */
+    client->nSearches++;
     if (dbChannelTest(pName)) {
         DLOG ( 2, ( "CAS: Lookup for channel \"%s\" failed\n", pName ) );
         return RSRV_OK;
     }
+    client->nSearchesFound++;
 
     /*
      * stop further use of server if memory becomes scarce
@@ -2544,6 +2691,10 @@ int camessage ( struct client *client )
         else {
             if ( msg.m_cmmd < NELEMENTS(tcpJumpTable) ) {
                 status = ( *tcpJumpTable[msg.m_cmmd] ) ( &msg, pBody, client );
+                if ( status == RSRV_PARKED ) {
+                    /* process it again later */
+                    break;
+                }
                 if ( status != RSRV_OK ) {
                     status = RSRV_ERROR;
                     break;
@@ -2555,6 +2706,11 @@ int camessage ( struct client *client )
         }
 
         client->recv.stk += msgsize;
+
+        /* the I/O thread pool continues once earlier replies were sent */
+        if ( client->ioBacklogBytes ) {
+            break;
+        }
     }
 
     return status;
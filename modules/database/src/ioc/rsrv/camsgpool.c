@@ -0,0 +1,776 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+/*
+ *  Event driven alternative to camsgtask()
+ *
+ *  By default each TCP circuit is served by two threads, camsgtask()
+ *  receiving requests and a dbEvent task delivering subscription updates
+ *  and extra labor.  When EPICS_CAS_IO_THREADS is set to a positive number
+ *  a fixed pool of that many threads serves all circuits instead.  Each
+ *  circuit is pinned to one worker which waits for requests with epoll()
+ *  and also runs the circuit's dbEvent work (see db_start_events_external())
+ *  so all activity for one circuit is still serialized on one thread.
+ *
+ *  A put notify request for a channel whose previous put notify has not
+ *  completed would block the worker.  Instead the request is left in the
+ *  circuit's receive buffer and the worker stops reading the circuit
+ *  until the previous put notify completes or times out.
+ *
+ *  The sockets don't block either.  Output which a socket doesn't take
+ *  is kept with the circuit, and the worker stops reading the circuit
+ *  and delivering its events until that was sent when the socket became
+ *  writable again.  A client which stops reading is disconnected once
+ *  too much output was kept for it.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "dbDefs.h"
+#include "envDefs.h"
+#include "epicsMutex.h"
+#include "epicsSignal.h"
+#include "epicsStdio.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "errlog.h"
+#include "osiSock.h"
+#include "taskwd.h"
+#include "cantProceed.h"
+
+#include "dbEvent.h"
+#include "rsrv.h"
+#include "server.h"
+
+#if defined(__linux__)
+#  include <unistd.h>
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  define RSRV_HAVE_IO_POOL
+#endif
+
+#ifdef RSRV_HAVE_IO_POOL
+
+/* max. number of ready sockets handled per epoll_wait() */
+#define RSRV_IO_MAX_EVENTS 64
+/* ms between checks for parked requests which timed out */
+#define RSRV_IO_PARK_POLL 1000
+/* max. output kept for one circuit, in large buffers */
+#define RSRV_IO_BACKLOG_BUFS 16
+
+/* unsent output, client::ioBacklog */
+typedef struct rsrv_io_chunk {
+    ELLNODE             node;
+    size_t              size;       /* bytes stored */
+    size_t              sent;       /* of those already sent */
+    size_t              capacity;
+    char                data[1];
+} rsrv_io_chunk;
+
+typedef struct rsrv_io_worker {
+    unsigned            index;
+    epicsThreadId       tid;
+    int                 epfd;       /* epoll instance for client sockets */
+    int                 wakefd;     /* eventfd, signaled when pending non-empty */
+    epicsMutexId        lock;
+    ELLLIST             pending;    /* client::ioNode, have dbEvent work */
+    unsigned            nclients;   /* guarded by lock */
+    ELLLIST             parked;     /* client::ioParkNode, worker only */
+    ELLLIST             retry;      /* client::ioRetryNode, worker only */
+    epicsUInt64         retryNS;    /* when those are retried next */
+    /* statistics, only updated by the worker itself */
+    epicsUInt64         nRecv;      /* receive dispatches */
+    epicsUInt64         nEvent;     /* dbEvent dispatches */
+    epicsUInt64         nBacklog;   /* times output had to be kept */
+    epicsUInt64         busyNS;     /* time spent outside of epoll_wait() */
+    epicsUInt64         startNS;
+} rsrv_io_worker;
+
+static rsrv_io_worker *ioWorkers;
+static unsigned nIoWorkers;
+
+static void rsrvIoPoolWakeup ( void *pArg );
+
+/*
+ * A send failed for another reason than a full socket.  Called with
+ * SEND_LOCK() held.
+ */
+static void rsrvIoPoolSendFailed ( struct client *pClient, int anerrno )
+{
+    if ( anerrno != SOCK_ECONNABORTED && anerrno != SOCK_ECONNRESET &&
+            anerrno != SOCK_EPIPE && anerrno != SOCK_ETIMEDOUT ) {
+        char sockErrBuf[64];
+        char buf[64];
+
+        ipAddrToDottedIP ( &pClient->addr, buf, sizeof ( buf ) );
+        epicsSocketConvertErrorToString (
+            sockErrBuf, sizeof ( sockErrBuf ), anerrno );
+        errlogPrintf ( "CAS: TCP send to %s failed: %s\n",
+            buf, sockErrBuf );
+    }
+    pClient->disconnect = TRUE;
+    ellFree ( &pClient->ioBacklog );
+    pClient->ioBacklogBytes = 0u;
+}
+
+static void rsrvIoWorkerClose ( rsrv_io_worker *pWorker,
+    struct client *pClient )
+{
+    if ( pClient->ioParked ) {
+        ellDelete ( &pWorker->parked, &pClient->ioParkNode );
+        pClient->ioParked = FALSE;
+    }
+    if ( pClient->ioRetrying ) {
+        ellDelete ( &pWorker->retry, &pClient->ioRetryNode );
+        pClient->ioRetrying = FALSE;
+    }
+
+    LOCK_CLIENTQ;
+    ellDelete ( &clientQ, &pClient->node );
+    UNLOCK_CLIENTQ;
+
+    destroy_tcp_client ( pClient );
+}
+
+/*
+ * Register for what the circuit waits for next: room in the socket while
+ * output is kept, otherwise requests unless one is parked.
+ */
+static int rsrvIoWorkerInterest ( rsrv_io_worker *pWorker,
+    struct client *pClient )
+{
+    struct epoll_event ev;
+    unsigned events = 0u;
+    int retry = pClient->ioBacklogBytes && pClient->ioSendRetry;
+    int op;
+
+    if ( pClient->ioBacklogBytes ) {
+        /* after ENOBUFS the socket may be writable, poll instead */
+        if ( ! retry ) {
+            events = EPOLLOUT;
+        }
+    }
+    else if ( ! pClient->ioParked ) {
+        events = EPOLLIN;
+    }
+
+    if ( retry && ! pClient->ioRetrying ) {
+        ellAdd ( &pWorker->retry, &pClient->ioRetryNode );
+    }
+    else if ( ! retry && pClient->ioRetrying ) {
+        ellDelete ( &pWorker->retry, &pClient->ioRetryNode );
+    }
+    pClient->ioRetrying = (char) retry;
+
+    if ( events == pClient->ioEvents ) {
+        return RSRV_OK;
+    }
+    op = ! pClient->ioEvents ? EPOLL_CTL_ADD :
+        events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    memset ( &ev, 0, sizeof ( ev ) );
+    ev.events = events;
+    ev.data.ptr = pClient;
+    if ( epoll_ctl ( pWorker->epfd, op, pClient->sock, &ev ) ) {
+        return RSRV_ERROR;
+    }
+    pClient->ioEvents = events;
+    return RSRV_OK;
+}
+
+/*
+ * After a circuit was served, close it or wait for what it needs next.
+ * A circuit returning RSRV_PARKED stops reading until its first request
+ * can be processed.
+ */
+static void rsrvIoWorkerDone ( rsrv_io_worker *pWorker,
+    struct client *pClient, int status )
+{
+    if ( status == RSRV_PARKED && ! pClient->ioParked ) {
+        pClient->ioParked = TRUE;
+        ellAdd ( &pWorker->parked, &pClient->ioParkNode );
+    }
+    if ( status == RSRV_ERROR || pClient->disconnect ||
+            rsrvIoWorkerInterest ( pWorker, pClient ) != RSRV_OK ) {
+        rsrvIoWorkerClose ( pWorker, pClient );
+    }
+}
+
+/*
+ * Try the requests left in the receive buffer of a parked circuit again.
+ */
+static int rsrvIoWorkerResume ( rsrv_io_worker *pWorker,
+    struct client *pClient )
+{
+    ellDelete ( &pWorker->parked, &pClient->ioParkNode );
+    pClient->ioParked = FALSE;
+    return casProcessRecv ( pClient );
+}
+
+/*
+ * Send the output kept for a circuit.  Once all of it was sent continue
+ * with the requests and events which were left waiting for that.
+ */
+static int rsrvIoWorkerFlush ( rsrv_io_worker *pWorker,
+    struct client *pClient )
+{
+    ELLNODE *cur;
+    int status = RSRV_OK;
+
+    SEND_LOCK ( pClient );
+    while ( ( cur = ellFirst ( &pClient->ioBacklog ) ) &&
+            ! pClient->disconnect ) {
+        rsrv_io_chunk *pChunk = CONTAINER ( cur, rsrv_io_chunk, node );
+        int n = send ( pClient->sock, &pChunk->data[pChunk->sent],
+            pChunk->size - pChunk->sent, 0 );
+
+        if ( n < 0 ) {
+            if ( SOCKERRNO == SOCK_EINTR ) {
+                continue;
+            }
+            if ( ! rsrvIoPoolWouldBlock ( pClient, SOCKERRNO ) ) {
+                rsrvIoPoolSendFailed ( pClient, SOCKERRNO );
+            }
+            break;
+        }
+        pClient->ioSendRetry = FALSE;
+        pChunk->sent += (size_t) n;
+        pClient->ioBacklogBytes -= (size_t) n;
+        if ( pChunk->sent == pChunk->size ) {
+            ellDelete ( &pClient->ioBacklog, cur );
+            free ( pChunk );
+        }
+    }
+    if ( ! pClient->ioBacklogBytes ) {
+        epicsTimeGetCurrent ( &pClient->time_at_last_send );
+    }
+    SEND_UNLOCK ( pClient );
+
+    if ( pClient->ioBacklogBytes || pClient->disconnect ) {
+        return RSRV_OK;
+    }
+
+    if ( pClient->ioParked ) {
+        status = rsrvIoWorkerResume ( pWorker, pClient );
+    }
+    else if ( pClient->recv.cnt ) {
+        status = casProcessRecv ( pClient );
+    }
+    cas_send_bs_msg ( pClient, TRUE );
+    if ( pClient->ioEventsDeferred ) {
+        pClient->ioEventsDeferred = FALSE;
+        rsrvIoPoolWakeup ( pClient );
+    }
+    return status;
+}
+
+static void rsrvIoWorkerTask ( void *pParm )
+{
+    rsrv_io_worker *pWorker = (rsrv_io_worker *) pParm;
+    struct epoll_event events[RSRV_IO_MAX_EVENTS];
+
+    epicsSignalInstallSigAlarmIgnore ();
+    epicsSignalInstallSigPipeIgnore ();
+    taskwdInsert ( epicsThreadGetIdSelf (), NULL, NULL );
+
+    pWorker->startNS = epicsMonotonicGet ();
+
+    while ( TRUE ) {
+        epicsUInt64 start;
+        ELLNODE *cur;
+        int i, n;
+
+        n = epoll_wait ( pWorker->epfd, events, NELEMENTS(events),
+            ellCount ( &pWorker->parked ) || ellCount ( &pWorker->retry ) ?
+                RSRV_IO_PARK_POLL : -1 );
+        if ( n < 0 ) {
+            char sockErrBuf[64];
+
+            if ( errno == EINTR ) {
+                continue;
+            }
+            epicsSocketConvertErrnoToString (
+                sockErrBuf, sizeof ( sockErrBuf ) );
+            errlogPrintf ( "CAS: epoll_wait " ERL_ERROR ": %s\n",
+                sockErrBuf );
+            epicsThreadSleep ( 1.0 );
+            continue;
+        }
+
+        start = epicsMonotonicGet ();
+
+        for ( i = 0; i < n; i++ ) {
+            struct client *pClient = (struct client *) events[i].data.ptr;
+            int status;
+
+            if ( ! pClient ) {
+                epicsUInt64 junk;
+                /* reset the eventfd, pending list is checked below */
+                if ( read ( pWorker->wakefd, &junk, sizeof ( junk ) ) < 0 &&
+                        errno != EAGAIN ) {
+                    errlogPrintf ( "CAS: I/O worker wakeup read failed\n" );
+                }
+                continue;
+            }
+
+            epicsThreadPrivateSet ( rsrvCurrentClient, pClient );
+
+            if ( castcp_ctl != ctlRun || pClient->disconnect ) {
+                rsrvIoWorkerClose ( pWorker, pClient );
+                continue;
+            }
+            if ( pClient->ioBacklogBytes ) {
+                /* writable, or an error which the send reports */
+                status = rsrvIoWorkerFlush ( pWorker, pClient );
+            }
+            else {
+                pWorker->nRecv++;
+                status = casRecvAndProcess ( pClient, MSG_DONTWAIT );
+                if ( status != RSRV_ERROR ) {
+                    casSendIfIdle ( pClient );
+                }
+            }
+            rsrvIoWorkerDone ( pWorker, pClient, status );
+        }
+
+        epicsMutexMustLock ( pWorker->lock );
+        while ( TRUE ) {
+            ELLNODE *cur = ellGet ( &pWorker->pending );
+            struct client *pClient;
+            int status = RSRV_OK;
+
+            if ( ! cur ) {
+                break;
+            }
+            pClient = CONTAINER ( cur, struct client, ioNode );
+            pClient->ioPending = FALSE;
+            epicsMutexUnlock ( pWorker->lock );
+
+            if ( pClient->ioBacklogBytes ) {
+                /* left queued, where dbEvent keeps only the latest
+                 * updates once the queue is full */
+                pClient->ioEventsDeferred = TRUE;
+                epicsMutexMustLock ( pWorker->lock );
+                continue;
+            }
+
+            pWorker->nEvent++;
+            epicsThreadPrivateSet ( rsrvCurrentClient, pClient );
+
+            db_process_events ( pClient->evuser );
+            /* maybe a put notify completed which a parked request waits for */
+            if ( pClient->ioParked && ! pClient->disconnect &&
+                    ! pClient->ioBacklogBytes ) {
+                status = rsrvIoWorkerResume ( pWorker, pClient );
+            }
+            cas_send_bs_msg ( pClient, TRUE );
+            rsrvIoWorkerDone ( pWorker, pClient, status );
+
+            epicsMutexMustLock ( pWorker->lock );
+        }
+        epicsMutexUnlock ( pWorker->lock );
+
+        /* parked requests which timed out are processed with an error */
+        cur = ellFirst ( &pWorker->parked );
+        while ( cur ) {
+            struct client *pClient = CONTAINER ( cur, struct client,
+                ioParkNode );
+            int status;
+
+            cur = ellNext ( cur );
+            if ( pClient->ioBacklogBytes ||
+                    epicsMonotonicGet () < pClient->ioParkedUntil ) {
+                continue;
+            }
+            epicsThreadPrivateSet ( rsrvCurrentClient, pClient );
+            status = rsrvIoWorkerResume ( pWorker, pClient );
+            cas_send_bs_msg ( pClient, TRUE );
+            rsrvIoWorkerDone ( pWorker, pClient, status );
+        }
+
+        /* sends which failed with ENOBUFS */
+        if ( ellCount ( &pWorker->retry ) &&
+                epicsMonotonicGet () >= pWorker->retryNS ) {
+            pWorker->retryNS = epicsMonotonicGet () +
+                (epicsUInt64) RSRV_IO_PARK_POLL * 1000000u;
+            cur = ellFirst ( &pWorker->retry );
+            while ( cur ) {
+                struct client *pClient = CONTAINER ( cur, struct client,
+                    ioRetryNode );
+
+                cur = ellNext ( cur );
+                epicsThreadPrivateSet ( rsrvCurrentClient, pClient );
+                rsrvIoWorkerDone ( pWorker, pClient,
+                    rsrvIoWorkerFlush ( pWorker, pClient ) );
+            }
+        }
+
+        epicsThreadPrivateSet ( rsrvCurrentClient, NULL );
+
+        pWorker->busyNS += epicsMonotonicGet () - start;
+    }
+}
+
+/*
+ * Send without blocking for a circuit of the I/O thread pool.  What the
+ * socket doesn't take is kept, and sent by the worker once the socket
+ * becomes writable.  Called with SEND_LOCK() held, and as only the
+ * worker sends for its circuits, only ever by the worker.
+ */
+void rsrvIoPoolSend ( struct client *pClient, const char *pBuf,
+    unsigned size )
+{
+    while ( size && ! pClient->ioBacklogBytes && ! pClient->disconnect ) {
+        int n = send ( pClient->sock, pBuf, size, 0 );
+
+        if ( n >= 0 ) {
+            pClient->ioSendRetry = FALSE;
+            pBuf += n;
+            size -= (unsigned) n;
+            if ( ! size ) {
+                epicsTimeGetCurrent ( &pClient->time_at_last_send );
+            }
+        }
+        else if ( SOCKERRNO == SOCK_EINTR ) {
+            continue;
+        }
+        else if ( rsrvIoPoolWouldBlock ( pClient, SOCKERRNO ) ) {
+            break;
+        }
+        else {
+            rsrvIoPoolSendFailed ( pClient, SOCKERRNO );
+        }
+    }
+    rsrvIoPoolDefer ( pClient, pBuf, size );
+}
+
+/*
+ * Keep output which can't be sent yet, after what is already kept.
+ * Called with SEND_LOCK() held.
+ */
+void rsrvIoPoolDefer ( struct client *pClient, const char *pBuf,
+    size_t size )
+{
+    ELLNODE *last = ellLast ( &pClient->ioBacklog );
+    rsrv_io_chunk *pChunk = last ?
+        CONTAINER ( last, rsrv_io_chunk, node ) : NULL;
+
+    if ( ! size || pClient->disconnect ) {
+        return;
+    }
+
+    if ( pClient->ioBacklogBytes + size >
+            (size_t) RSRV_IO_BACKLOG_BUFS * rsrvSizeofLargeBufTCP ) {
+        char buf[64];
+
+        ipAddrToDottedIP ( &pClient->addr, buf, sizeof ( buf ) );
+        errlogPrintf ( "CAS: %s stopped reading replies, disconnecting\n",
+            buf );
+        rsrvIoPoolSendFailed ( pClient, SOCK_ECONNABORTED );
+        return;
+    }
+    else if ( ! pChunk || pChunk->capacity - pChunk->size < size ) {
+        size_t capacity = size > MAX_TCP ? size : MAX_TCP;
+
+        pChunk = malloc ( offsetof ( rsrv_io_chunk, data ) + capacity );
+        if ( pChunk ) {
+            pChunk->size = 0u;
+            pChunk->sent = 0u;
+            pChunk->capacity = capacity;
+            ellAdd ( &pClient->ioBacklog, &pChunk->node );
+        }
+        else {
+            errlogPrintf ( "CAS: no memory for unsent replies,"
+                " disconnecting\n" );
+            rsrvIoPoolSendFailed ( pClient, SOCK_ECONNABORTED );
+            return;
+        }
+    }
+
+    if ( ! pClient->ioBacklogBytes ) {
+        pClient->ioWorker->nBacklog++;
+    }
+    memcpy ( &pChunk->data[pChunk->size], pBuf, size );
+    pChunk->size += size;
+    pClient->ioBacklogBytes += size;
+}
+
+/*
+ * Returns TRUE if a send failed only because the socket can't take more
+ * now.  For ENOBUFS the worker tries again after a while, as the socket
+ * may already be writable.
+ */
+int rsrvIoPoolWouldBlock ( struct client *pClient, int sockErrno )
+{
+    if ( sockErrno == SOCK_ENOBUFS ) {
+        if ( ! pClient->ioSendRetry ) {
+            errlogPrintf ( "CAS: Out of network buffers, retrying send\n" );
+            pClient->ioSendRetry = TRUE;
+        }
+        return TRUE;
+    }
+    return sockErrno == SOCK_EWOULDBLOCK;
+}
+
+/*
+ * dbEvent wakeup callback.  May be called from any thread,
+ * possibly with database locks held.
+ */
+static void rsrvIoPoolWakeup ( void *pArg )
+{
+    struct client *pClient = (struct client *) pArg;
+    rsrv_io_worker *pWorker = pClient->ioWorker;
+    int notify = FALSE;
+
+    epicsMutexMustLock ( pWorker->lock );
+    if ( ! pClient->ioPending && ! pClient->ioClosing ) {
+        pClient->ioPending = TRUE;
+        ellAdd ( &pWorker->pending, &pClient->ioNode );
+        notify = ellCount ( &pWorker->pending ) == 1;
+    }
+    epicsMutexUnlock ( pWorker->lock );
+
+    if ( notify ) {
+        epicsUInt64 one = 1u;
+        if ( write ( pWorker->wakefd, &one, sizeof ( one ) ) < 0 &&
+                errno != EAGAIN ) {
+            errlogPrintf ( "CAS: I/O worker wakeup write failed\n" );
+        }
+    }
+}
+
+void rsrvIoPoolInit ( void )
+{
+    long nThreads;
+    unsigned i;
+
+    if ( envGetLongConfigParam ( &EPICS_CAS_IO_THREADS, &nThreads ) ||
+            nThreads <= 0 ) {
+        return;
+    }
+
+    ioWorkers = callocMustSucceed ( nThreads, sizeof ( *ioWorkers ),
+        "rsrvIoPoolInit" );
+
+    for ( i = 0; i < (unsigned) nThreads; i++ ) {
+        rsrv_io_worker *pWorker = &ioWorkers[i];
+        struct epoll_event ev;
+        char name[24];
+
+        pWorker->index = i;
+        pWorker->lock = epicsMutexMustCreate ();
+        ellInit ( &pWorker->pending );
+        ellInit ( &pWorker->parked );
+        ellInit ( &pWorker->retry );
+
+        pWorker->epfd = epoll_create1 ( EPOLL_CLOEXEC );
+        pWorker->wakefd = eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        if ( pWorker->epfd < 0 || pWorker->wakefd < 0 )
+            cantProceed ( "CAS: unable to create I/O worker descriptors\n" );
+
+        memset ( &ev, 0, sizeof ( ev ) );
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL; /* marks the wakeup eventfd */
+        if ( epoll_ctl ( pWorker->epfd, EPOLL_CTL_ADD, pWorker->wakefd, &ev ) )
+            cantProceed ( "CAS: unable to register I/O worker wakeup\n" );
+
+        epicsSnprintf ( name, sizeof ( name ), "CAS-io%u", i );
+        pWorker->tid = epicsThreadMustCreate ( name,
+            epicsThreadPriorityCAServerLow,
+            epicsThreadGetStackSize ( epicsThreadStackBig ),
+            rsrvIoWorkerTask, pWorker );
+    }
+    nIoWorkers = (unsigned) nThreads;
+}
+
+int rsrvIoPoolActive ( void )
+{
+    return nIoWorkers > 0;
+}
+
+/*
+ * Bind a new client to the least loaded worker.
+ * Replaces db_start_events() for this client.
+ */
+int rsrvIoPoolAttach ( struct client *pClient )
+{
+    rsrv_io_worker *pWorker = NULL;
+    unsigned i, least = UINT_MAX;
+
+    for ( i = 0; i < nIoWorkers; i++ ) {
+        unsigned n;
+        epicsMutexMustLock ( ioWorkers[i].lock );
+        n = ioWorkers[i].nclients;
+        epicsMutexUnlock ( ioWorkers[i].lock );
+        if ( n < least ) {
+            least = n;
+            pWorker = &ioWorkers[i];
+        }
+    }
+    if ( ! pWorker ) {
+        return RSRV_ERROR;
+    }
+
+    epicsMutexMustLock ( pWorker->lock );
+    pWorker->nclients++;
+    epicsMutexUnlock ( pWorker->lock );
+    pClient->ioWorker = pWorker;
+
+    if ( db_start_events_external ( pClient->evuser,
+            rsrvIoPoolWakeup, pClient ) != DB_EVENT_OK ) {
+        return RSRV_ERROR;
+    }
+    return RSRV_OK;
+}
+
+/*
+ * Begin servicing an attached client.  Called once the
+ * client has been added to clientQ.
+ */
+int rsrvIoPoolStart ( struct client *pClient )
+{
+    rsrv_io_worker *pWorker = pClient->ioWorker;
+    osiSockIoctl_t yes = TRUE;
+    struct epoll_event ev;
+
+    if ( socket_ioctl ( pClient->sock, FIONBIO, &yes ) ) {
+        errlogPrintf ( "CAS: unable to make a client socket non-blocking\n" );
+        return RSRV_ERROR;
+    }
+
+    memset ( &ev, 0, sizeof ( ev ) );
+    ev.events = EPOLLIN;
+    ev.data.ptr = pClient;
+    pClient->ioEvents = EPOLLIN;
+    if ( epoll_ctl ( pWorker->epfd, EPOLL_CTL_ADD, pClient->sock, &ev ) ) {
+        char sockErrBuf[64];
+        epicsSocketConvertErrnoToString (
+            sockErrBuf, sizeof ( sockErrBuf ) );
+        errlogPrintf ( "CAS: epoll_ctl " ERL_ERROR ": %s\n", sockErrBuf );
+        return RSRV_ERROR;
+    }
+
+    /* have the worker send the version reply queued by create_tcp_client() */
+    rsrvIoPoolWakeup ( pClient );
+    return RSRV_OK;
+}
+
+/*
+ * Called by destroy_tcp_client() before the client's
+ * subscriptions are cancelled.
+ */
+void rsrvIoPoolDetach ( struct client *pClient )
+{
+    rsrv_io_worker *pWorker = pClient->ioWorker;
+
+    if ( pClient->sock != INVALID_SOCKET ) {
+        /* may fail if never added or the socket was already shut down */
+        (void) epoll_ctl ( pWorker->epfd, EPOLL_CTL_DEL, pClient->sock, NULL );
+    }
+
+    /* nothing is sent from here on */
+    SEND_LOCK ( pClient );
+    pClient->disconnect = TRUE;
+    ellFree ( &pClient->ioBacklog );
+    pClient->ioBacklogBytes = 0u;
+    SEND_UNLOCK ( pClient );
+
+    epicsMutexMustLock ( pWorker->lock );
+    pClient->ioClosing = TRUE;
+    if ( pClient->ioPending ) {
+        ellDelete ( &pWorker->pending, &pClient->ioNode );
+        pClient->ioPending = FALSE;
+    }
+    pWorker->nclients--;
+    epicsMutexUnlock ( pWorker->lock );
+}
+
+unsigned rsrvIoPoolWorkerIndex ( const struct client *pClient )
+{
+    return pClient->ioWorker ? pClient->ioWorker->index : 0u;
+}
+
+void rsrvIoPoolShow ( unsigned level )
+{
+    epicsUInt64 now = epicsMonotonicGet ();
+    unsigned i;
+
+    if ( ! nIoWorkers ) {
+        return;
+    }
+
+    printf ( "%u CAS-io thread%s serving TCP circuits:\n",
+        nIoWorkers, nIoWorkers == 1 ? "" : "s" );
+
+    for ( i = 0; i < nIoWorkers; i++ ) {
+        rsrv_io_worker *pWorker = &ioWorkers[i];
+        epicsUInt64 elapsed = now - pWorker->startNS;
+        unsigned nclients, npending;
+
+        epicsMutexMustLock ( pWorker->lock );
+        nclients = pWorker->nclients;
+        npending = (unsigned) ellCount ( &pWorker->pending );
+        epicsMutexUnlock ( pWorker->lock );
+
+        printf ( "    CAS-io%u: %u client%s, %llu receive, %llu event dispatches,"
+            " %llu full sockets, %.1f%% busy\n",
+            i, nclients, nclients == 1 ? "" : "s",
+            (unsigned long long) pWorker->nRecv,
+            (unsigned long long) pWorker->nEvent,
+            (unsigned long long) pWorker->nBacklog,
+            elapsed && pWorker->startNS ?
+                100.0 * (double) pWorker->busyNS / (double) elapsed : 0.0 );
+        if ( level >= 2u ) {
+            printf ( "\tThread Id = %p, %u circuit%s with pending events\n",
+                (void *) pWorker->tid, npending, npending == 1 ? "" : "s" );
+        }
+    }
+}
+
+#else /* RSRV_HAVE_IO_POOL */
+
+void rsrvIoPoolInit ( void )
+{
+    long nThreads;
+
+    if ( ! envGetLongConfigParam ( &EPICS_CAS_IO_THREADS, &nThreads ) &&
+            nThreads > 0 ) {
+        errlogPrintf ( "CAS: EPICS_CAS_IO_THREADS is not supported on this"
+            " target, using a thread per client\n" );
+    }
+}
+
+int rsrvIoPoolActive ( void )
+{
+    return FALSE;
+}
+
+int rsrvIoPoolAttach ( struct client *pClient )
+{
+    return RSRV_ERROR;
+}
+
+int rsrvIoPoolStart ( struct client *pClient )
+{
+    return RSRV_ERROR;
+}
+
+void rsrvIoPoolDetach ( struct client *pClient )
+{
+}
+
+unsigned rsrvIoPoolWorkerIndex ( const struct client *pClient )
+{
+    return 0u;
+}
+
+void rsrvIoPoolShow ( unsigned level )
+{
+}
+
+#endif /* RSRV_HAVE_IO_POOL */
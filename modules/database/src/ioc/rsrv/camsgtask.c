@@ -34,122 +34,169 @@
 #include "server.h"
 
 /*
- *  camsgtask()
+ *  casSendIfIdle()
  *
- *  CA server TCP client task (one spawned for each client)
+ *  Flush the send buffer unless more requests are already waiting
+ *  (allow messages to batch up if more are coming)
  */
-void camsgtask ( void *pParm )
+void casSendIfIdle ( struct client *client )
 {
-    struct client *client = (struct client *) pParm;
+    osiSockIoctl_t check_nchars;
+    int status;
+
+    status = socket_ioctl (client->sock, FIONREAD, &check_nchars);
+    if (status < 0) {
+        char sockErrBuf[64];
+
+        epicsSocketConvertErrnoToString (
+            sockErrBuf, sizeof ( sockErrBuf ) );
+        errlogPrintf("CAS: FIONREAD " ERL_ERROR ": %s\n",
+            sockErrBuf);
+        cas_send_bs_msg(client, TRUE);
+    }
+    else if (check_nchars == 0){
+        cas_send_bs_msg(client, TRUE);
+    }
+}
 
-    casAttachThreadToClient ( client );
+/*
+ *  casRecvAndProcess()
+ *
+ *  Receive whatever is available from a TCP client and process all
+ *  complete requests.  Returns RSRV_ERROR when the circuit should be
+ *  shut down.
+ */
+int casRecvAndProcess ( struct client *client, int recvFlags )
+{
+    long nchars;
+
+    assert ( client->recv.maxstk >= client->recv.cnt );
+    nchars = recv ( client->sock, &client->recv.buf[client->recv.cnt],
+            (int) ( client->recv.maxstk - client->recv.cnt ), recvFlags );
+    if ( nchars == 0 ){
+        if ( CASDEBUG > 0 ) {
+            /* convert to u long so that %lu works on both 32 and 64 bit archs */
+            unsigned long cnt = sizeof ( client->recv.buf ) - client->recv.cnt;
+            errlogPrintf ( "CAS: nill message disconnect ( %lu bytes request )\n",
+                cnt );
+        }
+        return RSRV_ERROR;
+    }
+    else if ( nchars < 0 ) {
+        int anerrno = SOCKERRNO;
 
-    while (castcp_ctl == ctlRun && !client->disconnect) {
-        osiSockIoctl_t check_nchars;
-        long nchars;
-        int status;
+        if ( anerrno == SOCK_EINTR ) {
+            return RSRV_OK;
+        }
+
+        if ( anerrno == SOCK_EWOULDBLOCK ) {
+            /* only with non-blocking recvFlags, nothing to do */
+            return RSRV_OK;
+        }
+
+        if ( anerrno == SOCK_ENOBUFS && ( recvFlags & MSG_DONTWAIT ) ) {
+            /* the I/O thread pool mustn't sleep, tried again when readable */
+            return RSRV_OK;
+        }
+
+        if ( anerrno == SOCK_ENOBUFS ) {
+            errlogPrintf (
+                "CAS: Out of network buffers, retring receive in 15 seconds\n" );
+            epicsThreadSleep ( 15.0 );
+            return RSRV_OK;
+        }
 
         /*
-         * allow message to batch up if more are coming
+         * normal conn lost conditions
          */
-        status = socket_ioctl (client->sock, FIONREAD, &check_nchars);
-        if (status < 0) {
+        if (    ( anerrno != SOCK_ECONNABORTED &&
+            anerrno != SOCK_ECONNRESET &&
+            anerrno != SOCK_ETIMEDOUT ) ||
+            CASDEBUG > 2 ) {
             char sockErrBuf[64];
 
-            epicsSocketConvertErrnoToString (
-                sockErrBuf, sizeof ( sockErrBuf ) );
-            errlogPrintf("CAS: FIONREAD " ERL_ERROR ": %s\n",
-                sockErrBuf);
-            cas_send_bs_msg(client, TRUE);
-        }
-        else if (check_nchars == 0){
-            cas_send_bs_msg(client, TRUE);
+            epicsSocketConvertErrorToString(
+                sockErrBuf, sizeof ( sockErrBuf ), anerrno);
+            errlogPrintf ( "CAS: Client disconnected - %s\n",
+                sockErrBuf );
         }
+        return RSRV_ERROR;
+    }
 
-        client->recv.stk = 0;
-        assert ( client->recv.maxstk >= client->recv.cnt );
-        nchars = recv ( client->sock, &client->recv.buf[client->recv.cnt],
-                (int) ( client->recv.maxstk - client->recv.cnt ), 0 );
-        if ( nchars == 0 ){
-            if ( CASDEBUG > 0 ) {
-                /* convert to u long so that %lu works on both 32 and 64 bit archs */
-                unsigned long cnt = sizeof ( client->recv.buf ) - client->recv.cnt;
-                errlogPrintf ( "CAS: nill message disconnect ( %lu bytes request )\n",
-                    cnt );
-            }
-            break;
-        }
-        else if ( nchars < 0 ) {
-            int anerrno = SOCKERRNO;
+    epicsTimeGetCurrent ( &client->time_at_last_recv );
+    client->recv.cnt += ( unsigned ) nchars;
 
-            if ( anerrno == SOCK_EINTR ) {
-                continue;
-            }
+    return casProcessRecv ( client );
+}
 
-            if ( anerrno == SOCK_ENOBUFS ) {
-                errlogPrintf (
-                    "CAS: Out of network buffers, retring receive in 15 seconds\n" );
-                epicsThreadSleep ( 15.0 );
-                continue;
-            }
+/*
+ *  casProcessRecv()
+ *
+ *  Process all complete requests in the receive buffer.  Returns
+ *  RSRV_PARKED if a request was left in the buffer to be retried.
+ */
+int casProcessRecv ( struct client *client )
+{
+    int status;
 
-            /*
-             * normal conn lost conditions
-             */
-            if (    ( anerrno != SOCK_ECONNABORTED &&
-                anerrno != SOCK_ECONNRESET &&
-                anerrno != SOCK_ETIMEDOUT ) ||
-                CASDEBUG > 2 ) {
-                char sockErrBuf[64];
-
-                epicsSocketConvertErrorToString(
-                    sockErrBuf, sizeof ( sockErrBuf ), anerrno);
-                errlogPrintf ( "CAS: Client disconnected - %s\n",
-                    sockErrBuf );
-            }
-            break;
-        }
+    client->recv.stk = 0;
+    status = camessage ( client );
+    if ( status != RSRV_ERROR ) {
+        /*
+         * if there is a partial message
+         * align it with the start of the buffer
+         */
+        if (client->recv.cnt > client->recv.stk) {
+            unsigned bytes_left;
 
-        epicsTimeGetCurrent ( &client->time_at_last_recv );
-        client->recv.cnt += ( unsigned ) nchars;
+            bytes_left = client->recv.cnt - client->recv.stk;
 
-        status = camessage ( client );
-        if (status == 0) {
             /*
-             * if there is a partial message
-             * align it with the start of the buffer
+             * overlapping regions handled
+             * properly by memmove
              */
-            if (client->recv.cnt > client->recv.stk) {
-                unsigned bytes_left;
-
-                bytes_left = client->recv.cnt - client->recv.stk;
-
-                /*
-                 * overlapping regions handled
-                 * properly by memmove
-                 */
-                memmove (client->recv.buf,
-                    &client->recv.buf[client->recv.stk], bytes_left);
-                client->recv.cnt = bytes_left;
-            }
-            else {
-                client->recv.cnt = 0ul;
-            }
+            memmove (client->recv.buf,
+                &client->recv.buf[client->recv.stk], bytes_left);
+            client->recv.cnt = bytes_left;
         }
         else {
-            char buf[64];
+            client->recv.cnt = 0ul;
+        }
+    }
+    else {
+        char buf[64];
 
-            /* flush any queued messages before shutdown */
-            cas_send_bs_msg(client, 1);
+        /* flush any queued messages before shutdown */
+        cas_send_bs_msg(client, 1);
 
-            client->recv.cnt = 0ul;
+        client->recv.cnt = 0ul;
 
-            /*
-             * disconnect when there are severe message errors
-             */
-            ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
-            epicsPrintf ("CAS: forcing disconnect from %s\n", buf);
-                break;
+        /*
+         * disconnect when there are severe message errors
+         */
+        ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
+        epicsPrintf ("CAS: forcing disconnect from %s\n", buf);
+        return RSRV_ERROR;
+    }
+    return status;
+}
+
+/*
+ *  camsgtask()
+ *
+ *  CA server TCP client task (one spawned for each client)
+ */
+void camsgtask ( void *pParm )
+{
+    struct client *client = (struct client *) pParm;
+
+    casAttachThreadToClient ( client );
+
+    while (castcp_ctl == ctlRun && !client->disconnect) {
+        casSendIfIdle ( client );
+
+        if ( casRecvAndProcess ( client, 0 ) != RSRV_OK ) {
+            break;
         }
     }
 
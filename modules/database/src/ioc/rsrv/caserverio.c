@@ -32,6 +32,96 @@
 
 #include "server.h"
 
+#ifdef RSRV_HAVE_SENDMSG
+#  include <sys/uio.h>
+#endif
+
+/*
+ *  cas_send_failed()
+ *
+ *  Handle a failed TCP send. Returns TRUE if the send should be
+ *  retried, otherwise the client has been marked for disconnect.
+ *
+ *  send lock must be on while in this routine
+ */
+static int cas_send_failed ( struct client *pclient )
+{
+    int causeWasSocketHangup = 0;
+    int anerrno = SOCKERRNO;
+    char buf[64];
+
+    if ( pclient->disconnect ) {
+        pclient->send.stk = 0u;
+        return FALSE;
+    }
+
+    if ( anerrno == SOCK_EINTR ) {
+        return TRUE;
+    }
+
+    /* circuits of the I/O thread pool keep the output instead,
+     * see rsrvIoPoolWouldBlock() */
+    if ( anerrno == SOCK_ENOBUFS ) {
+        errlogPrintf (
+            "CAS: Out of network buffers, retrying send in 15 seconds\n" );
+        epicsThreadSleep ( 15.0 );
+        return TRUE;
+    }
+
+    ipAddrToDottedIP ( &pclient->addr, buf, sizeof(buf) );
+
+    if (
+        anerrno == SOCK_ECONNABORTED ||
+        anerrno == SOCK_ECONNRESET ||
+        anerrno == SOCK_EPIPE ||
+        anerrno == SOCK_ETIMEDOUT ) {
+        causeWasSocketHangup = 1;
+    }
+    else {
+        char sockErrBuf[64];
+        epicsSocketConvertErrnoToString (
+            sockErrBuf, sizeof ( sockErrBuf ) );
+        errlogPrintf ( "CAS: TCP send to %s failed: %s\n",
+            buf, sockErrBuf);
+    }
+    pclient->disconnect = TRUE;
+    pclient->send.stk = 0u;
+
+    /*
+     * wakeup the receive thread
+     */
+    if ( ! causeWasSocketHangup ) {
+        enum epicsSocketSystemCallInterruptMechanismQueryInfo info  =
+            epicsSocketSystemCallInterruptMechanismQuery ();
+        switch ( info ) {
+        case esscimqi_socketCloseRequired:
+            if ( pclient->sock != INVALID_SOCKET ) {
+                epicsSocketDestroy ( pclient->sock );
+                pclient->sock = INVALID_SOCKET;
+            }
+            break;
+        case esscimqi_socketBothShutdownRequired:
+            {
+                int status = shutdown ( pclient->sock, SHUT_RDWR );
+                if ( status ) {
+                    char sockErrBuf[64];
+                    epicsSocketConvertErrnoToString (
+                        sockErrBuf, sizeof ( sockErrBuf ) );
+                    errlogPrintf ("CAS: Socket shutdown " ERL_ERROR ": %s\n",
+                        sockErrBuf );
+                }
+            }
+            break;
+        case esscimqi_socketSigAlarmRequired:
+            epicsSignalRaiseSigAlarm ( pclient->tid );
+            break;
+        default:
+            break;
+        };
+    }
+    return FALSE;
+}
+
 /*
  *  cas_send_bs_msg()
  *
@@ -63,6 +153,12 @@ void cas_send_bs_msg ( struct client *pclient, int lock_needed )
         return;
     }
 
+    if ( pclient->ioWorker ) {
+        /* never blocks, what the socket doesn't take is kept */
+        rsrvIoPoolSend ( pclient, pclient->send.buf, pclient->send.stk );
+        pclient->send.stk = 0u;
+    }
+
     while ( pclient->send.stk && ! pclient->disconnect ) {
         status = send ( pclient->sock, pclient->send.buf, pclient->send.stk, 0 );
         if ( status >= 0 ) {
@@ -79,91 +175,166 @@ void cas_send_bs_msg ( struct client *pclient, int lock_needed )
                 pclient->send.stk = bytesLeft;
             }
         }
-        else {
-            int causeWasSocketHangup = 0;
-            int anerrno = SOCKERRNO;
-            char buf[64];
+        else if ( ! cas_send_failed ( pclient ) ) {
+            break;
+        }
+    }
 
-            if ( pclient->disconnect ) {
-                pclient->send.stk = 0u;
-                break;
-            }
+    if ( lock_needed ) {
+        SEND_UNLOCK(pclient);
+    }
 
-            if ( anerrno == SOCK_EINTR ) {
-                continue;
-            }
+    DLOG ( 3, ( "------------------------------\n\n" ) );
 
-            if ( anerrno == SOCK_ENOBUFS ) {
-                errlogPrintf (
-                    "CAS: Out of network buffers, retrying send in 15 seconds\n" );
-                epicsThreadSleep ( 15.0 );
-                continue;
-            }
+    return;
+}
 
-            ipAddrToDottedIP ( &pclient->addr, buf, sizeof(buf) );
+#ifdef RSRV_HAVE_SENDMSG
 
-            if (
-                anerrno == SOCK_ECONNABORTED ||
-                anerrno == SOCK_ECONNRESET ||
-                anerrno == SOCK_EPIPE ||
-                anerrno == SOCK_ETIMEDOUT ) {
-                causeWasSocketHangup = 1;
-            }
-            else {
-                char sockErrBuf[64];
-                epicsSocketConvertErrnoToString (
-                    sockErrBuf, sizeof ( sockErrBuf ) );
-                errlogPrintf ( "CAS: TCP send to %s failed: %s\n",
-                    buf, sockErrBuf);
-            }
-            pclient->disconnect = TRUE;
-            pclient->send.stk = 0u;
-
-            /*
-             * wakeup the receive thread
-             */
-            if ( ! causeWasSocketHangup ) {
-                enum epicsSocketSystemCallInterruptMechanismQueryInfo info  =
-                    epicsSocketSystemCallInterruptMechanismQuery ();
-                switch ( info ) {
-                case esscimqi_socketCloseRequired:
-                    if ( pclient->sock != INVALID_SOCKET ) {
-                        epicsSocketDestroy ( pclient->sock );
-                        pclient->sock = INVALID_SOCKET;
-                    }
-                    break;
-                case esscimqi_socketBothShutdownRequired:
-                    {
-                        int status = shutdown ( pclient->sock, SHUT_RDWR );
-                        if ( status ) {
-                            char sockErrBuf[64];
-                            epicsSocketConvertErrnoToString (
-                                sockErrBuf, sizeof ( sockErrBuf ) );
-                            errlogPrintf ("CAS: Socket shutdown " ERL_ERROR ": %s\n",
-                                sockErrBuf );
-                        }
-                    }
-                    break;
-                case esscimqi_socketSigAlarmRequired:
-                    epicsSignalRaiseSigAlarm ( pclient->tid );
-                    break;
-                default:
-                    break;
-                };
-                break;
-            }
+/*
+ *  cas_send_bs_msg_ref()
+ *
+ *  Send a message whose array data is referenced rather than copied
+ *  into the send buffer. The header and the metaSize bytes at pMeta
+ *  which precede the array are appended to the send buffer, which is
+ *  then handed to the kernel together with the array and its padding
+ *  by sendmsg(). Everything must already be in network byte order,
+ *  and the array must stay unchanged until this routine returns.
+ *
+ *  send lock must be on while in this routine
+ *
+ *  Returns ECA_NORMAL unless the message can't be sent this way,
+ *  in which case nothing has been queued.
+ */
+int cas_send_bs_msg_ref (
+    struct client *pclient, ca_uint16_t response, ca_uint32_t payloadSize,
+    ca_uint16_t dataType, ca_uint32_t nElem, ca_uint32_t cid,
+    ca_uint32_t responseSpecific, const void *pMeta, unsigned metaSize,
+    const void *pData )
+{
+    static const char pad[8];
+    ca_uint32_t alignedPayloadSize;
+    unsigned headSize = sizeof ( caHdr ) + metaSize;
+    caHdr *pMsg;
+    char *pHead;
+    struct iovec iov[3];
+    struct msghdr msg;
+    unsigned first = 0u;
+
+    if ( pclient->proto != IPPROTO_TCP || metaSize > payloadSize ||
+            payloadSize > UINT_MAX - sizeof ( caHdr ) - 8u ) {
+        return ECA_TOLARGE;
+    }
+
+    alignedPayloadSize = CA_MESSAGE_ALIGN ( payloadSize );
+    if ( alignedPayloadSize >= 0xffff || nElem >= 0xffff ) {
+        if ( ! CA_V49 ( pclient->minor_version_number ) ) {
+            return ECA_16KARRAYCLIENT;
         }
+        headSize += 2 * sizeof ( ca_uint32_t );
     }
 
-    if ( lock_needed ) {
-        SEND_UNLOCK(pclient);
+    /* honor EPICS_CA_MAX_ARRAY_BYTES as the copying path would */
+    if ( rsrvLargeBufFreeListTCP &&
+            alignedPayloadSize > rsrvSizeofLargeBufTCP - headSize + metaSize ) {
+        return ECA_TOLARGE;
     }
 
-    DLOG ( 3, ( "------------------------------\n\n" ) );
+    if ( headSize > pclient->send.maxstk ) {
+        return ECA_TOLARGE;
+    }
+    if ( pclient->send.stk > pclient->send.maxstk - headSize ) {
+        cas_send_bs_msg ( pclient, FALSE );
+    }
+    if ( pclient->disconnect ) {
+        pclient->send.stk = 0u;
+        return ECA_NORMAL;
+    }
 
-    return;
+    pHead = &pclient->send.buf[pclient->send.stk];
+    pMsg = ( caHdr * ) pHead;
+    pMsg->m_cmmd = htons ( response );
+    pMsg->m_dataType = htons ( dataType );
+    pMsg->m_cid = htonl ( cid );
+    pMsg->m_available = htonl ( responseSpecific );
+    if ( alignedPayloadSize < 0xffff && nElem < 0xffff ) {
+        pMsg->m_postsize = htons ( ( ca_uint16_t ) alignedPayloadSize );
+        pMsg->m_count = htons ( ( ca_uint16_t ) nElem );
+        pHead = ( char * ) ( pMsg + 1 );
+    }
+    else {
+        ca_uint32_t *pW32 = ( ca_uint32_t * ) ( pMsg + 1 );
+        pMsg->m_postsize = htons ( 0xffff );
+        pMsg->m_count = htons ( 0u );
+        pW32[0] = htonl ( alignedPayloadSize );
+        pW32[1] = htonl ( nElem );
+        pHead = ( char * ) ( pW32 + 2 );
+    }
+    memcpy ( pHead, pMeta, metaSize );
+    pclient->send.stk += headSize;
+
+    iov[0].iov_base = pclient->send.buf;
+    iov[0].iov_len = pclient->send.stk;
+    iov[1].iov_base = ( void * ) pData;
+    iov[1].iov_len = payloadSize - metaSize;
+    iov[2].iov_base = ( void * ) pad;
+    iov[2].iov_len = alignedPayloadSize - payloadSize;
+
+    while ( ! pclient->disconnect ) {
+        ssize_t status;
+
+        while ( first < NELEMENTS ( iov ) && iov[first].iov_len == 0u ) {
+            first++;
+        }
+        if ( first == NELEMENTS ( iov ) ) {
+            epicsTimeGetCurrent ( &pclient->time_at_last_send );
+            break;
+        }
+
+        memset ( &msg, 0, sizeof ( msg ) );
+        msg.msg_iov = &iov[first];
+        msg.msg_iovlen = NELEMENTS ( iov ) - first;
+
+        /* earlier output which is still waiting must go first */
+        if ( pclient->ioWorker && pclient->ioBacklogBytes ) {
+            status = -1;
+        }
+        else {
+            status = sendmsg ( pclient->sock, &msg, 0 );
+        }
+        if ( status < 0 && pclient->ioWorker && ( pclient->ioBacklogBytes ||
+                rsrvIoPoolWouldBlock ( pclient, SOCKERRNO ) ) ) {
+            /* the array may change once this returns, so copy the rest */
+            for ( ; first < NELEMENTS ( iov ); first++ ) {
+                rsrvIoPoolDefer ( pclient, iov[first].iov_base,
+                    iov[first].iov_len );
+            }
+            break;
+        }
+        if ( status >= 0 ) {
+            size_t transferSize = ( size_t ) status;
+            unsigned i;
+
+            for ( i = first; i < NELEMENTS ( iov ) && transferSize; i++ ) {
+                size_t n = transferSize < iov[i].iov_len ?
+                    transferSize : iov[i].iov_len;
+                iov[i].iov_base = ( char * ) iov[i].iov_base + n;
+                iov[i].iov_len -= n;
+                transferSize -= n;
+            }
+        }
+        else if ( ! cas_send_failed ( pclient ) ) {
+            break;
+        }
+    }
+
+    pclient->send.stk = 0u;
+
+    return ECA_NORMAL;
 }
 
+#endif /* RSRV_HAVE_SENDMSG */
+
 /*
  *  cas_send_dg_msg()
  *
@@ -200,8 +371,14 @@ void cas_send_dg_msg ( struct client * pclient )
         sizeDG -= sizeof (caHdr);
     }
 
-    status = sendto ( pclient->sock, pDG, sizeDG, 0,
-       (struct sockaddr *)&pclient->addr, sizeof(pclient->addr) );
+    if ( pclient->udpBatch ) {
+        /* queued for sendmmsg(), errors are reported when flushed */
+        status = rsrvUdpBatchQueue ( pclient, pDG, sizeDG );
+    }
+    else {
+        status = sendto ( pclient->sock, pDG, sizeDG, 0,
+           (struct sockaddr *)&pclient->addr, sizeof(pclient->addr) );
+    }
     if ( status >= 0 ) {
         if ( status >= sizeDG ) {
             epicsTimeGetCurrent ( &pclient->time_at_last_send );
@@ -37,11 +37,13 @@
 
 #include "epicsExport.h"
 
+#include "dbAccessDefs.h"
 #include "dbChannel.h"
 #include "dbCommon.h"
 #include "dbEvent.h"
 #include "db_field_log.h"
 #include "dbServer.h"
+#include "dbStaticLib.h"
 #include "rsrv.h"
 
 #define GLBLSOURCE
@@ -106,6 +108,18 @@ static void req_server (void *pParm)
             ellAdd ( &clientQ, &pClient->node );
             UNLOCK_CLIENTQ;
 
+            if ( pClient->ioWorker ) {
+                if ( rsrvIoPoolStart ( pClient ) != RSRV_OK ) {
+                    LOCK_CLIENTQ;
+                    ellDelete ( &clientQ, &pClient->node );
+                    UNLOCK_CLIENTQ;
+                    destroy_tcp_client ( pClient );
+                    errlogPrintf ( "CAS: I/O thread registration for new client failed\n" );
+                    epicsThreadSleep ( 15.0 );
+                }
+                continue;
+            }
+
             id = epicsThreadCreate ( "CAS-client", epicsThreadPriorityCAServerLow,
                     epicsThreadGetStackSize ( epicsThreadStackBig ),
                     camsgtask, pClient );
@@ -545,6 +559,8 @@ void rsrv_init (void)
 
     rsrv_build_addr_lists();
 
+    rsrvIoPoolInit ();
+
     castcp_startStopEvent = epicsEventMustCreate(epicsEventEmpty);
     casudp_startStopEvent = epicsEventMustCreate(epicsEventEmpty);
     beacon_startStopEvent = epicsEventMustCreate(epicsEventEmpty);
@@ -559,6 +575,8 @@ void rsrv_init (void)
      * Started later per TCP client
      *  TCP receiver: epicsThreadPriorityCAServerLow
      *  TCP sender : epicsThreadPriorityCAServerLow-1
+     * or with EPICS_CAS_IO_THREADS, started above
+     *  TCP I/O workers: epicsThreadPriorityCAServerLow
      */
     {
         unsigned i;
@@ -598,6 +616,7 @@ void rsrv_init (void)
      */
     {
         int havesometcp = 0;
+        unsigned nUdpReceivers = rsrvUdpReceivers ();
         ELLNODE *cur;
         int i;
 
@@ -710,6 +729,25 @@ void rsrv_init (void)
 
 #endif /* !(defined(_WIN32) || defined(__CYGWIN__)) */
 
+            /* additional unicast receivers sharing the UDP port */
+            if(nUdpReceivers > 1) {
+                unsigned j;
+
+                conf->udpx = callocMustSucceed(nUdpReceivers - 1,
+                    sizeof(*conf->udpx), "rsrv_init");
+                conf->xclient = callocMustSucceed(nUdpReceivers - 1,
+                    sizeof(*conf->xclient), "rsrv_init");
+                for(j=0; j<nUdpReceivers-1; j++) {
+                    SOCKET sock = rsrvUdpReceiverCreate(&conf->udpAddr);
+                    if(sock==INVALID_SOCKET) {
+                        errlogPrintf("CAS: Only %u UDP receivers on %s\n",
+                            conf->nudpx + 1, ifaceName);
+                        break;
+                    }
+                    conf->udpx[conf->nudpx++] = sock;
+                }
+            }
+
             ellAdd(&servers, &conf->node);
 
             /* have all sockets, time to start some threads */
@@ -740,6 +778,18 @@ void rsrv_init (void)
             }
 #endif /* !(defined(_WIN32) || defined(__CYGWIN__)) */
 
+            for(conf->startx=1; conf->startx<=conf->nudpx; conf->startx++) {
+                char name[20];
+
+                epicsSnprintf(name, sizeof(name), "CAS-UDP-%u", conf->startx);
+                epicsThreadMustCreate(name, threadPrios[4],
+                        epicsThreadGetStackSize(epicsThreadStackMedium),
+                        &cast_server, conf);
+
+                epicsEventMustWait(casudp_startStopEvent);
+            }
+            conf->startx = 0;
+
             havesometcp = 1;
             continue;
         cleanup:
@@ -859,15 +909,21 @@ static void log_one_client (struct client *client, unsigned level)
         send_delay = epicsTimeDiffInSeconds(&current,&client->time_at_last_send);
         recv_delay = epicsTimeDiffInSeconds(&current,&client->time_at_last_recv);
 
-        printf ("\tTask Id = %p, Socket FD = %d\n",
-            (void *) client->tid, (int)client->sock);
+        if ( client->ioWorker ) {
+            printf ("\tI/O thread CAS-io%u, Socket FD = %d\n",
+                rsrvIoPoolWorkerIndex ( client ), (int)client->sock);
+        }
+        else {
+            printf ("\tTask Id = %p, Socket FD = %d\n",
+                (void *) client->tid, (int)client->sock);
+        }
         printf(
         "\t%.2f secs since last send, %.2f secs since last receive\n",
             send_delay, recv_delay);
         printf(
         "\tUnprocessed request bytes = %u, Undelivered response bytes = %u\n",
             client->recv.cnt - client->recv.stk,
-            client->send.stk );
+            client->send.stk + (unsigned) client->ioBacklogBytes );
         printf(
         "\tState = %s%s%s\n",
             state[client->disconnect?1:0],
@@ -901,6 +957,15 @@ static void log_one_client (struct client *client, unsigned level)
     }
 }
 
+static void countSearches (const struct client *client, size_t *pn,
+    size_t *pfound)
+{
+    if (client) {
+        *pn += client->nSearches;
+        *pfound += client->nSearchesFound;
+    }
+}
+
 /*
  *  casr()
  */
@@ -955,22 +1020,75 @@ void casr (unsigned level)
                 printf("    CAS-UDP name server on %s\n", buf);
                 if (level >= 2)
                     log_one_client(iface->client, level - 2);
+                rsrvUdpBatchShow(iface->client, level);
             }
             else {
                 printf("    CAS-UDP unicast name server on %s\n", buf);
                 if (level >= 2)
                     log_one_client(iface->client, level - 2);
+                rsrvUdpBatchShow(iface->client, level);
                 ipAddrToDottedIP (&iface->udpbcastAddr.ia, buf, sizeof(buf));
                 printf("    CAS-UDP broadcast name server on %s\n", buf);
                 if (level >= 2)
                     log_one_client(iface->bclient, level - 2);
+                rsrvUdpBatchShow(iface->bclient, level);
             }
 #endif
+            {
+                unsigned j;
+
+                for (j = 0; j < iface->nudpx; j++) {
+                    printf("    CAS-UDP-%u additional unicast receiver\n", j + 1);
+                    if (level >= 2)
+                        log_one_client(iface->xclient[j], level - 2);
+                    rsrvUdpBatchShow(iface->xclient[j], level);
+                }
+            }
 
             iface = (rsrv_iface_config *) ellNext(&iface->node);
         }
     }
 
+    if (level>=1) {
+        rsrvIoPoolShow ( level );
+    }
+
+    if (level>=1) {
+        printf("%lu large array replies, %lu bytes, sent without copying\n",
+            (unsigned long) rsrvZeroCopySends,
+            (unsigned long) rsrvZeroCopyBytes);
+    }
+
+    if (level>=1) {
+        rsrv_iface_config *iface = (rsrv_iface_config *) ellFirst ( &servers );
+        size_t nSearches = 0, nFound = 0;
+        dbPvdFilterInfo info;
+
+        /* read without locks, each receiver only updates its own */
+        while (iface) {
+            unsigned j;
+
+            countSearches(iface->client, &nSearches, &nFound);
+            countSearches(iface->bclient, &nSearches, &nFound);
+            for (j = 0; j < iface->nudpx; j++)
+                countSearches(iface->xclient[j], &nSearches, &nFound);
+            iface = (rsrv_iface_config *) ellNext(&iface->node);
+        }
+        printf("%lu UDP name searches, %lu found\n",
+            (unsigned long) nSearches, (unsigned long) nFound);
+
+        dbPvdFilterStats ( pdbbase, &info );
+        if (dbPvdCountLookups)
+            printf("    Name filter rejected %lu lookups, passed %lu"
+                " of which %lu were not found\n",
+                (unsigned long) info.rejected, (unsigned long) info.passed,
+                (unsigned long) info.falsePositive);
+        if (level >= 2 && info.bits)
+            printf("    Name filter of %lu bits, %.1f%% set, for %u names\n",
+                (unsigned long) info.bits, 100.0 * info.bitsSet / info.bits,
+                info.names);
+    }
+
     if (level>=1) {
         osiSockAddrNode * pAddr;
         char buf[40];
@@ -1044,6 +1162,12 @@ void casr (unsigned level)
             MAX_TCP,
             (unsigned int)(rsrvLargeBufFreeListTCP ? freeListItemsAvail ( rsrvLargeBufFreeListTCP ) : -1),
             rsrvSizeofLargeBufTCP );
+        if (level>=5u) {
+            printf( "Channels:\n");
+            freeListShow ( rsrvChanFreeList, level-5u );
+            printf( "Monitor events:\n");
+            freeListShow ( rsrvEventFreeList, level-5u );
+        }
         printf( "Server resource id table:\n");
         LOCK_CLIENTQ;
         bucketShow (pCaBucket);
@@ -1206,6 +1330,11 @@ void destroy_tcp_client ( struct client *client )
         errlogPrintf ( "CAS: Connection %d Terminated\n", (int)client->sock );
     }
 
+    if ( client->ioWorker ) {
+        /* stop wakeups before the event facility is torn down */
+        rsrvIoPoolDetach ( client );
+    }
+
     if ( client->evuser ) {
         /*
          * turn off extra labor callbacks from the event thread
@@ -1310,6 +1439,18 @@ struct client * create_client ( SOCKET sock, int proto )
     epicsTimeGetCurrent ( &client->time_at_last_recv );
     client->minor_version_number = CA_UKN_MINOR_VERSION;
     client->recvBytesToDrain = 0u;
+    client->ioWorker = NULL;
+    client->ioPending = FALSE;
+    client->ioClosing = FALSE;
+    client->ioParked = FALSE;
+    client->ioParkedUntil = 0u;
+    ellInit ( &client->ioBacklog );
+    client->ioBacklogBytes = 0u;
+    client->ioSendRetry = FALSE;
+    client->ioEventsDeferred = FALSE;
+    client->ioEvents = 0u;
+    client->ioRetrying = FALSE;
+    client->udpBatch = NULL;
 
     return client;
 }
@@ -1503,21 +1644,29 @@ struct client *create_tcp_client (SOCKET sock , const osiSockAddr *peerAddr)
         return NULL;
     }
 
-    {
+    if ( rsrvIoPoolActive () ) {
+        /* events are delivered by the I/O worker serving this client */
+        if ( rsrvIoPoolAttach ( client ) != RSRV_OK ) {
+            errlogPrintf ( "CAS: unable to attach to an I/O thread\n" );
+            destroy_tcp_client ( client );
+            return NULL;
+        }
+    }
+    else {
         epicsThreadBooleanStatus    tbs;
 
         tbs  = epicsThreadHighestPriorityLevelBelow ( epicsThreadPriorityCAServerLow, &priorityOfEvents );
         if ( tbs != epicsThreadBooleanStatusSuccess ) {
             priorityOfEvents = epicsThreadPriorityCAServerLow;
         }
-    }
 
-    status = db_start_events ( client->evuser, "CAS-event",
-                NULL, NULL, priorityOfEvents );
-    if ( status != DB_EVENT_OK ) {
-        errlogPrintf ( "CAS: unable to start the event facility\n" );
-        destroy_tcp_client ( client );
-        return NULL;
+        status = db_start_events ( client->evuser, "CAS-event",
+                    NULL, NULL, priorityOfEvents );
+        if ( status != DB_EVENT_OK ) {
+            errlogPrintf ( "CAS: unable to start the event facility\n" );
+            destroy_tcp_client ( client );
+            return NULL;
+        }
     }
 
     /*
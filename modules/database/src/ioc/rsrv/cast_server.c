@@ -39,6 +39,7 @@
 
 #include "dbDefs.h"
 #include "envDefs.h"
+#include "epicsStdio.h"
 #include "epicsMutex.h"
 #include "epicsTime.h"
 #include "errlog.h"
@@ -51,6 +52,10 @@
 
 #define TIMEOUT 60.0 /* sec */
 
+#if defined(__linux__)
+#  define RSRV_HAVE_MMSG
+#endif
+
 /*
  * clean_addrq
  */
@@ -104,6 +109,525 @@ static void clean_addrq(struct client *client)
     }
 }
 
+#ifdef RSRV_HAVE_MMSG
+
+/*
+ * Linux fast path.  Up to RSRV_UDP_BATCH datagrams are received with
+ * one recvmmsg() and the replies to all of them are sent with one
+ * sendmmsg().  Search storms (eg. after many clients restart at once)
+ * are then handled with a fraction of the system calls.
+ */
+
+/* max. number of datagrams received or sent per system call */
+#define RSRV_UDP_BATCH 32
+/* receive slot size, rounded up to keep each slot 8 byte aligned */
+#define RSRV_UDP_SLOT ( ( MAX_UDP_RECV + 7u ) & ~7u )
+/* batch size histogram bins: 1, 2-3, 4-7, 8-15, 16-31, 32 */
+#define RSRV_UDP_NBINS 6
+
+typedef union {
+    struct cmsghdr  align;
+    char            buf[CMSG_SPACE ( sizeof ( struct in_pktinfo ) ) +
+                        CMSG_SPACE ( sizeof ( epicsUInt32 ) )];
+} rsrv_udp_cmsg;
+
+typedef struct rsrv_udp_batch {
+    unsigned            index;      /* 0 also handles broadcasts */
+    struct mmsghdr      rmsg[RSRV_UDP_BATCH];
+    struct iovec        riov[RSRV_UDP_BATCH];
+    struct sockaddr_in  raddr[RSRV_UDP_BATCH];
+    rsrv_udp_cmsg       rctl[RSRV_UDP_BATCH];
+    char                *rbuf[RSRV_UDP_BATCH];
+    char                *rslots;    /* backs rbuf[1...] */
+    struct mmsghdr      smsg[RSRV_UDP_BATCH];
+    struct iovec        siov[RSRV_UDP_BATCH];
+    struct sockaddr_in  saddr[RSRV_UDP_BATCH];
+    char                sbuf[RSRV_UDP_BATCH][MAX_UDP_SEND];
+    unsigned            nsend;      /* replies queued in sbuf */
+    epicsUInt32         rxqOvfl;    /* last SO_RXQ_OVFL count seen */
+    /* statistics, only updated by the owning cast_server() */
+    epicsUInt64         nRecvCalls;
+    epicsUInt64         nRecvMsgs;
+    epicsUInt64         nSendCalls;
+    epicsUInt64         nSendMsgs;
+    epicsUInt64         nSendErrs;
+    epicsUInt64         nDropped;   /* receive queue overflows */
+    epicsUInt64         nIgnored;   /* EPICS_CAS_IGNORE_ADDR_LIST */
+    epicsUInt64         nSkipped;   /* broadcasts left to receiver 0 */
+    epicsUInt64         hist[RSRV_UDP_NBINS];
+} rsrv_udp_batch;
+
+static rsrv_udp_batch * cast_batch_create ( struct client *client,
+    SOCKET sock, unsigned index )
+{
+    rsrv_udp_batch *pBatch;
+    unsigned i;
+
+    pBatch = calloc ( 1, sizeof ( *pBatch ) );
+    if ( ! pBatch ) {
+        return NULL;
+    }
+    /* pages are only touched by the kernel as far as datagrams reach */
+    pBatch->rslots = malloc ( ( RSRV_UDP_BATCH - 1 ) * RSRV_UDP_SLOT );
+    if ( ! pBatch->rslots ) {
+        free ( pBatch );
+        return NULL;
+    }
+    pBatch->index = index;
+    pBatch->rbuf[0] = client->recv.buf;
+    for ( i = 1; i < RSRV_UDP_BATCH; i++ ) {
+        pBatch->rbuf[i] = pBatch->rslots + ( i - 1 ) * RSRV_UDP_SLOT;
+    }
+    for ( i = 0; i < RSRV_UDP_BATCH; i++ ) {
+        pBatch->riov[i].iov_base = pBatch->rbuf[i];
+        pBatch->rmsg[i].msg_hdr.msg_iov = &pBatch->riov[i];
+        pBatch->rmsg[i].msg_hdr.msg_iovlen = 1;
+        pBatch->rmsg[i].msg_hdr.msg_name = &pBatch->raddr[i];
+        pBatch->rmsg[i].msg_hdr.msg_control = pBatch->rctl[i].buf;
+
+        pBatch->siov[i].iov_base = pBatch->sbuf[i];
+        pBatch->smsg[i].msg_hdr.msg_iov = &pBatch->siov[i];
+        pBatch->smsg[i].msg_hdr.msg_iovlen = 1;
+        pBatch->smsg[i].msg_hdr.msg_name = &pBatch->saddr[i];
+        pBatch->smsg[i].msg_hdr.msg_namelen = sizeof ( pBatch->saddr[i] );
+    }
+
+#ifdef SO_RXQ_OVFL
+    {
+        int yes = TRUE;
+        if ( setsockopt ( sock, SOL_SOCKET, SO_RXQ_OVFL,
+                (char *) &yes, sizeof ( yes ) ) < 0 ) {
+            errlogPrintf ( "CAS: UDP receive drops will not be counted\n" );
+        }
+    }
+#endif
+
+    client->udpBatch = pBatch;
+    return pBatch;
+}
+
+static void cast_batch_destroy ( struct client *client )
+{
+    rsrv_udp_batch *pBatch = client->udpBatch;
+
+    if ( pBatch ) {
+        client->recv.buf = pBatch->rbuf[0];
+        client->udpBatch = NULL;
+        free ( pBatch->rslots );
+        free ( pBatch );
+    }
+}
+
+static int cast_batch_recv ( SOCKET sock, rsrv_udp_batch *pBatch )
+{
+    unsigned i, bin;
+    int n;
+
+    for ( i = 0; i < RSRV_UDP_BATCH; i++ ) {
+        pBatch->riov[i].iov_len = MAX_UDP_RECV;
+        pBatch->rmsg[i].msg_hdr.msg_namelen = sizeof ( pBatch->raddr[i] );
+        pBatch->rmsg[i].msg_hdr.msg_controllen = sizeof ( pBatch->rctl[i] );
+        pBatch->rmsg[i].msg_hdr.msg_flags = 0;
+    }
+
+    /* block for the first datagram, then take what is already queued */
+    n = recvmmsg ( sock, pBatch->rmsg, RSRV_UDP_BATCH, MSG_WAITFORONE, NULL );
+    if ( n > 0 ) {
+        pBatch->nRecvCalls++;
+        pBatch->nRecvMsgs += n;
+        for ( bin = 0; bin < RSRV_UDP_NBINS - 1 &&
+                ( 2u << bin ) <= (unsigned) n; bin++ ) {
+        }
+        pBatch->hist[bin]++;
+    }
+    return n;
+}
+
+/*
+ * Look at the ancillary data of one received datagram.  Returns FALSE
+ * if this receiver should not answer it.
+ */
+static int cast_batch_accept ( rsrv_udp_batch *pBatch, unsigned i )
+{
+    struct msghdr *pHdr = &pBatch->rmsg[i].msg_hdr;
+    struct cmsghdr *pCmsg;
+    int accept = TRUE;
+
+    for ( pCmsg = CMSG_FIRSTHDR ( pHdr ); pCmsg;
+            pCmsg = CMSG_NXTHDR ( pHdr, pCmsg ) ) {
+#ifdef SO_RXQ_OVFL
+        if ( pCmsg->cmsg_level == SOL_SOCKET &&
+                pCmsg->cmsg_type == SO_RXQ_OVFL ) {
+            epicsUInt32 count;
+
+            /* datagrams dropped by this socket before this one was queued */
+            memcpy ( &count, CMSG_DATA ( pCmsg ), sizeof ( count ) );
+            pBatch->nDropped += (epicsUInt32) ( count - pBatch->rxqOvfl );
+            pBatch->rxqOvfl = count;
+        }
+#endif
+        if ( pCmsg->cmsg_level == IPPROTO_IP &&
+                pCmsg->cmsg_type == IP_PKTINFO && pBatch->index > 0 ) {
+            struct in_pktinfo info;
+
+            /* Unicast is delivered to only one socket of a SO_REUSEPORT
+             * group, broadcasts and multicasts to all of them.  Only for
+             * the latter does the destination differ from the local
+             * address, so leave those to the first receiver.
+             */
+            memcpy ( &info, CMSG_DATA ( pCmsg ), sizeof ( info ) );
+            if ( info.ipi_addr.s_addr != info.ipi_spec_dst.s_addr ) {
+                pBatch->nSkipped++;
+                accept = FALSE;
+            }
+        }
+    }
+    return accept;
+}
+
+static void cast_batch_flush ( struct client *client )
+{
+    rsrv_udp_batch *pBatch = client->udpBatch;
+    unsigned done = 0u;
+
+    while ( done < pBatch->nsend ) {
+        int n = sendmmsg ( client->sock, &pBatch->smsg[done],
+            pBatch->nsend - done, 0 );
+        if ( n < 0 ) {
+            char sockErrBuf[64];
+            char buf[128];
+
+            if ( SOCKERRNO == SOCK_EINTR ) {
+                continue;
+            }
+            /* skip the datagram which failed */
+            epicsSocketConvertErrnoToString (
+                sockErrBuf, sizeof ( sockErrBuf ) );
+            ipAddrToDottedIP ( &pBatch->saddr[done], buf, sizeof(buf) );
+            errlogPrintf( "CAS: UDP send to %s failed: %s\n",
+                buf, sockErrBuf);
+            pBatch->nSendErrs++;
+            done++;
+        }
+        else {
+            pBatch->nSendCalls++;
+            pBatch->nSendMsgs += n;
+            done += n;
+        }
+    }
+    pBatch->nsend = 0u;
+}
+
+int rsrvUdpBatchQueue ( struct client *pClient, const char *pDG,
+    unsigned sizeDG )
+{
+    rsrv_udp_batch *pBatch = pClient->udpBatch;
+    unsigned i = pBatch->nsend++;
+
+    assert ( sizeDG <= sizeof ( pBatch->sbuf[i] ) );
+    memcpy ( pBatch->sbuf[i], pDG, sizeDG );
+    pBatch->siov[i].iov_len = sizeDG;
+    pBatch->saddr[i] = pClient->addr;
+
+    if ( pBatch->nsend >= RSRV_UDP_BATCH ) {
+        cast_batch_flush ( pClient );
+    }
+    return (int) sizeDG;
+}
+
+void rsrvUdpBatchShow ( const struct client *pClient, unsigned level )
+{
+    const rsrv_udp_batch *pBatch = pClient ? pClient->udpBatch : NULL;
+
+    if ( ! pBatch ) {
+        return;
+    }
+    printf ( "\t%llu datagrams in %llu receive calls, "
+        "%llu replies in %llu send calls\n",
+        (unsigned long long) pBatch->nRecvMsgs,
+        (unsigned long long) pBatch->nRecvCalls,
+        (unsigned long long) pBatch->nSendMsgs,
+        (unsigned long long) pBatch->nSendCalls );
+    printf ( "\t%llu dropped by the kernel, %llu ignored, %llu send errors",
+        (unsigned long long) pBatch->nDropped,
+        (unsigned long long) pBatch->nIgnored,
+        (unsigned long long) pBatch->nSendErrs );
+    if ( pBatch->index > 0 ) {
+        printf ( ", %llu broadcasts skipped",
+            (unsigned long long) pBatch->nSkipped );
+    }
+    printf ( "\n" );
+    if ( level >= 2 ) {
+        printf ( "\tBatch sizes 1: %llu, 2-3: %llu, 4-7: %llu, 8-15: %llu,"
+            " 16-31: %llu, %u: %llu\n",
+            (unsigned long long) pBatch->hist[0],
+            (unsigned long long) pBatch->hist[1],
+            (unsigned long long) pBatch->hist[2],
+            (unsigned long long) pBatch->hist[3],
+            (unsigned long long) pBatch->hist[4],
+            RSRV_UDP_BATCH,
+            (unsigned long long) pBatch->hist[5] );
+    }
+}
+
+/* set by rsrvUdpReceivers() before any receiver starts */
+static int cast_have_mmsg;
+
+/*
+ * A kernel or a seccomp filter may refuse recvmmsg() with ENOSYS, which
+ * a non-blocking call on an unbound socket finds out.
+ */
+static int cast_probe_mmsg ( void )
+{
+    struct mmsghdr msg;
+    char buf[1];
+    struct iovec iov;
+    SOCKET sock;
+    int n, err;
+
+    sock = epicsSocketCreate ( AF_INET, SOCK_DGRAM, 0 );
+    if ( sock == INVALID_SOCKET ) {
+        return FALSE;
+    }
+    memset ( &msg, 0, sizeof ( msg ) );
+    iov.iov_base = buf;
+    iov.iov_len = sizeof ( buf );
+    msg.msg_hdr.msg_iov = &iov;
+    msg.msg_hdr.msg_iovlen = 1;
+    n = recvmmsg ( sock, &msg, 1, MSG_DONTWAIT, NULL );
+    err = SOCKERRNO;
+    epicsSocketDestroy ( sock );
+    return n >= 0 || err != ENOSYS;
+}
+
+unsigned rsrvUdpReceivers ( void )
+{
+    long n;
+
+    cast_have_mmsg = cast_probe_mmsg ();
+    if ( envGetLongConfigParam ( &EPICS_CAS_UDP_THREADS, &n ) || n <= 1 ) {
+        n = 1;
+    }
+    if ( ! cast_have_mmsg ) {
+        errlogPrintf ( "CAS: recvmmsg() not available, "
+            "receiving one datagram at a time%s\n",
+            n > 1 ? " with one receiver per socket" : "" );
+        return 1u;
+    }
+    return (unsigned) n;
+}
+
+SOCKET rsrvUdpReceiverCreate ( const osiSockAddr *pAddr )
+{
+    SOCKET sock;
+    int yes = TRUE;
+
+    sock = epicsSocketCreate ( AF_INET, SOCK_DGRAM, 0 );
+    if ( sock == INVALID_SOCKET ) {
+        return sock;
+    }
+    /* also sets SO_REUSEPORT, required to share pAddr */
+    epicsSocketEnableAddressUseForDatagramFanout ( sock );
+
+    if ( setsockopt ( sock, IPPROTO_IP, IP_PKTINFO,
+                (char *) &yes, sizeof ( yes ) ) < 0 ||
+            bind ( sock, &pAddr->sa, sizeof ( *pAddr ) ) < 0 ) {
+        char sockErrBuf[64];
+
+        epicsSocketConvertErrnoToString (
+            sockErrBuf, sizeof ( sockErrBuf ) );
+        errlogPrintf ( "CAS: UDP receiver setup " ERL_ERROR ": %s\n",
+            sockErrBuf );
+        epicsSocketDestroy ( sock );
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+#else /* RSRV_HAVE_MMSG */
+
+int rsrvUdpBatchQueue ( struct client *pClient, const char *pDG,
+    unsigned sizeDG )
+{
+    return -1;
+}
+
+void rsrvUdpBatchShow ( const struct client *pClient, unsigned level )
+{
+}
+
+unsigned rsrvUdpReceivers ( void )
+{
+    long n;
+
+    if ( ! envGetLongConfigParam ( &EPICS_CAS_UDP_THREADS, &n ) && n > 1 ) {
+        errlogPrintf ( "CAS: EPICS_CAS_UDP_THREADS is not supported on this"
+            " target, using one receiver per socket\n" );
+    }
+    return 1u;
+}
+
+SOCKET rsrvUdpReceiverCreate ( const osiSockAddr *pAddr )
+{
+    return INVALID_SOCKET;
+}
+
+#endif /* RSRV_HAVE_MMSG */
+
+/*
+ * Returns TRUE if the sender is in EPICS_CAS_IGNORE_ADDR_LIST
+ */
+static int cast_ignored ( const struct sockaddr_in *pAddr )
+{
+    size_t idx;
+
+    for(idx=0; casIgnoreAddrs[idx]; idx++)
+    {
+        if(pAddr->sin_addr.s_addr==casIgnoreAddrs[idx]) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Process one datagram of nBytes already in client->recv.buf
+ */
+static void cast_process ( struct client *client,
+    const struct sockaddr_in *pAddr, unsigned nBytes )
+{
+    int status;
+    int count=0;
+
+    client->recv.cnt = nBytes;
+    client->recv.stk = 0ul;
+    epicsTimeGetCurrent(&client->time_at_last_recv);
+
+    client->minor_version_number = CA_UKN_MINOR_VERSION;
+    client->seqNoOfReq = 0;
+
+    /*
+     * If we are talking to a new client flush to the old one
+     * in case we are holding UDP messages waiting to
+     * see if the next message is for this same client.
+     */
+    if (client->send.stk>sizeof(caHdr)) {
+        status = memcmp(&client->addr,
+            pAddr, sizeof(*pAddr));
+        if(status){
+            /*
+             * if the address is different
+             */
+            cas_send_dg_msg(client);
+            client->addr = *pAddr;
+        }
+    }
+    else {
+        client->addr = *pAddr;
+    }
+
+    if (CASDEBUG>1) {
+        char    buf[40];
+
+        ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
+        errlogPrintf ("CAS: cast server msg of %d bytes from addr %s\n",
+            client->recv.cnt, buf);
+    }
+
+    if (CASDEBUG>2)
+        count = ellCount (&client->chanList);
+
+    status = camessage ( client );
+    if(status == RSRV_OK){
+        if(client->recv.cnt !=
+            client->recv.stk){
+            char buf[40];
+
+            ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
+
+            epicsPrintf ("CAS: partial (damaged?) UDP msg of %d bytes from %s ?\n",
+                client->recv.cnt - client->recv.stk, buf);
+
+            epicsTimeToStrftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S",
+                &client->time_at_last_recv);
+            epicsPrintf ("CAS: message received at %s\n", buf);
+        }
+    }
+    else if (CASDEBUG>0){
+        char buf[40];
+
+        ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
+
+        epicsPrintf ("CAS: invalid (damaged?) UDP request from %s ?\n", buf);
+
+        epicsTimeToStrftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S",
+            &client->time_at_last_recv);
+        epicsPrintf ("CAS: message received at %s\n", buf);
+    }
+
+    if (CASDEBUG>2) {
+        if ( ellCount (&client->chanList) ) {
+            errlogPrintf ("CAS: Fnd %d name matches (%d tot)\n",
+                ellCount(&client->chanList)-count,
+                ellCount(&client->chanList));
+        }
+    }
+}
+
+static void cast_recv_error ( void )
+{
+    if (SOCKERRNO != SOCK_EINTR) {
+        char sockErrBuf[64];
+        epicsSocketConvertErrnoToString (
+            sockErrBuf, sizeof ( sockErrBuf ) );
+        epicsPrintf ("CAS: UDP recv error: %s\n",
+                sockErrBuf);
+        epicsThreadSleep(1.0);
+    }
+}
+
+#ifdef RSRV_HAVE_MMSG
+/*
+ * Receive, process and answer one batch of datagrams
+ */
+static void cast_serve_batch ( struct client *client, SOCKET recv_sock )
+{
+    rsrv_udp_batch *pBatch = client->udpBatch;
+    int i, n;
+
+    n = cast_batch_recv ( recv_sock, pBatch );
+    if ( n < 0 ) {
+        cast_recv_error ();
+        return;
+    }
+
+    for ( i = 0; i < n; i++ ) {
+        if ( ! cast_batch_accept ( pBatch, i ) ) {
+            continue;
+        }
+        if ( cast_ignored ( &pBatch->raddr[i] ) ) {
+            pBatch->nIgnored++;
+            continue;
+        }
+        if ( casudp_ctl == ctlRun ) {
+            client->recv.buf = pBatch->rbuf[i];
+            cast_process ( client, &pBatch->raddr[i],
+                pBatch->rmsg[i].msg_len );
+        }
+    }
+    client->recv.buf = pBatch->rbuf[0];
+
+    /* queue the replies to the last sender and send everything */
+    cas_send_dg_msg ( client );
+    cast_batch_flush ( client );
+
+    /* a short batch means that the socket was drained */
+    if ( n < RSRV_UDP_BATCH ) {
+        clean_addrq ( client );
+    }
+}
+#endif /* RSRV_HAVE_MMSG */
+
 /*
  * CAST_SERVER
  *
@@ -114,16 +638,14 @@ void cast_server(void *pParm)
 {
     rsrv_iface_config *conf = pParm;
     int                 status;
-    int                 count=0;
     int                 mysocket=0;
+    unsigned            index=0;
     struct sockaddr_in  new_recv_addr;
     osiSocklen_t        recv_addr_size;
     osiSockIoctl_t      nchars;
     SOCKET              recv_sock, reply_sock;
     struct client      *client;
 
-    recv_addr_size = sizeof(new_recv_addr);
-
     reply_sock = conf->udp;
 
     /*
@@ -142,6 +664,11 @@ void cast_server(void *pParm)
         recv_sock = conf->udpbcast;
         conf->bclient = client;
     }
+    else if (conf->startx) {
+        index = conf->startx;
+        recv_sock = conf->udpx[index-1];
+        conf->xclient[index-1] = client;
+    }
     else {
         recv_sock = conf->udp;
         conf->client = client;
@@ -150,6 +677,16 @@ void cast_server(void *pParm)
 
     casAttachThreadToClient ( client );
 
+#ifdef RSRV_HAVE_MMSG
+    /* additional receivers depend on cast_batch_accept(), and are only
+     * started when recvmmsg() is available
+     */
+    while ( cast_have_mmsg &&
+            ! cast_batch_create ( client, recv_sock, index ) && index ) {
+        epicsThreadSleep(300.0);
+    }
+#endif
+
     /*
      * add placeholder for the first version message should it be needed
      */
@@ -161,6 +698,13 @@ void cast_server(void *pParm)
     epicsEventSignal(casudp_startStopEvent);
 
     while (TRUE) {
+#ifdef RSRV_HAVE_MMSG
+        if (client->udpBatch) {
+            cast_serve_batch ( client, recv_sock );
+            continue;
+        }
+#endif
+        recv_addr_size = sizeof(new_recv_addr);
         status = recvfrom (
             recv_sock,
             client->recv.buf,
@@ -169,100 +713,10 @@ void cast_server(void *pParm)
             (struct sockaddr *)&new_recv_addr,
             &recv_addr_size);
         if (status < 0) {
-            if (SOCKERRNO != SOCK_EINTR) {
-                char sockErrBuf[64];
-                epicsSocketConvertErrnoToString (
-                    sockErrBuf, sizeof ( sockErrBuf ) );
-                epicsPrintf ("CAS: UDP recv error: %s\n",
-                        sockErrBuf);
-                epicsThreadSleep(1.0);
-            }
-
-        } else {
-            size_t idx;
-            for(idx=0; casIgnoreAddrs[idx]; idx++)
-            {
-                if(new_recv_addr.sin_addr.s_addr==casIgnoreAddrs[idx]) {
-                    status = -1; /* ignore */
-                    break;
-                }
-            }
+            cast_recv_error ();
         }
-
-        if (status >= 0 && casudp_ctl == ctlRun) {
-            client->recv.cnt = (unsigned) status;
-            client->recv.stk = 0ul;
-            epicsTimeGetCurrent(&client->time_at_last_recv);
-
-            client->minor_version_number = CA_UKN_MINOR_VERSION;
-            client->seqNoOfReq = 0;
-
-            /*
-             * If we are talking to a new client flush to the old one
-             * in case we are holding UDP messages waiting to
-             * see if the next message is for this same client.
-             */
-            if (client->send.stk>sizeof(caHdr)) {
-                status = memcmp(&client->addr,
-                    &new_recv_addr, recv_addr_size);
-                if(status){
-                    /*
-                     * if the address is different
-                     */
-                    cas_send_dg_msg(client);
-                    client->addr = new_recv_addr;
-                }
-            }
-            else {
-                client->addr = new_recv_addr;
-            }
-
-            if (CASDEBUG>1) {
-                char    buf[40];
-
-                ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
-                errlogPrintf ("CAS: cast server msg of %d bytes from addr %s\n",
-                    client->recv.cnt, buf);
-            }
-
-            if (CASDEBUG>2)
-                count = ellCount (&client->chanList);
-
-            status = camessage ( client );
-            if(status == RSRV_OK){
-                if(client->recv.cnt !=
-                    client->recv.stk){
-                    char buf[40];
-
-                    ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
-
-                    epicsPrintf ("CAS: partial (damaged?) UDP msg of %d bytes from %s ?\n",
-                        client->recv.cnt - client->recv.stk, buf);
-
-                    epicsTimeToStrftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S",
-                        &client->time_at_last_recv);
-                    epicsPrintf ("CAS: message received at %s\n", buf);
-                }
-            }
-            else if (CASDEBUG>0){
-                char buf[40];
-
-                ipAddrToDottedIP (&client->addr, buf, sizeof(buf));
-
-                epicsPrintf ("CAS: invalid (damaged?) UDP request from %s ?\n", buf);
-
-                epicsTimeToStrftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S",
-                    &client->time_at_last_recv);
-                epicsPrintf ("CAS: message received at %s\n", buf);
-            }
-
-            if (CASDEBUG>2) {
-                if ( ellCount (&client->chanList) ) {
-                    errlogPrintf ("CAS: Fnd %d name matches (%d tot)\n",
-                        ellCount(&client->chanList)-count,
-                        ellCount(&client->chanList));
-                }
-            }
+        else if (!cast_ignored (&new_recv_addr) && casudp_ctl == ctlRun) {
+            cast_process ( client, &new_recv_addr, (unsigned) status );
         }
 
         /*
@@ -283,6 +737,9 @@ void cast_server(void *pParm)
 
     /* ATM never reached, just a placeholder */
 
+#ifdef RSRV_HAVE_MMSG
+    cast_batch_destroy ( client );
+#endif
     if(!mysocket)
         client->sock = INVALID_SOCKET; /* only one cast_server should destroy the reply socket */
     destroy_client(client);
@@ -30,6 +30,11 @@
 #include "epicsAssert.h"
 #include "osiSock.h"
 
+/* large array replies may be sent without copying them */
+#if defined(__unix__) || defined(__APPLE__)
+#  define RSRV_HAVE_SENDMSG
+#endif
+
 /* a modified ca header with capacity for large arrays */
 typedef struct caHdrLargeArray {
     ca_uint32_t m_postsize;     /* size of message extension */
@@ -65,6 +70,9 @@ struct message_buffer {
 
 extern epicsThreadPrivateId rsrvCurrentClient;
 
+struct rsrv_io_worker;
+struct rsrv_udp_batch;
+
 typedef struct client {
   ELLNODE               node;
   /*! guarded by SEND_LOCK()  aka. client::lock */
@@ -93,6 +101,34 @@ typedef struct client {
   unsigned              recvBytesToDrain;
   unsigned              priority;
   char                  disconnect; /* disconnect detected */
+  /*! set when serviced by the I/O thread pool instead of camsgtask() */
+  struct rsrv_io_worker *ioWorker;
+  /*! rsrv_io_worker::pending, guarded by rsrv_io_worker::lock */
+  ELLNODE               ioNode;
+  char                  ioPending;
+  char                  ioClosing;
+  /*! set while a request waits for a put callback, only used by the worker */
+  char                  ioParked;
+  ELLNODE               ioParkNode;
+  /*! epicsMonotonicGet() when that request times out, or 0 */
+  epicsUInt64           ioParkedUntil;
+  /*! output the socket didn't take yet, guarded by SEND_LOCK() */
+  ELLLIST               ioBacklog;
+  size_t                ioBacklogBytes;
+  /*! the last send failed with ENOBUFS, retry on the worker's poll */
+  char                  ioSendRetry;
+  /*! events that were left queued while the backlog drains */
+  char                  ioEventsDeferred;
+  /*! epoll events registered for the socket, and the worker's list of
+   *  circuits retrying after ENOBUFS, only used by the worker */
+  unsigned              ioEvents;
+  char                  ioRetrying;
+  ELLNODE               ioRetryNode;
+  /*! UDP only, set when cast_server() uses recvmmsg()/sendmmsg() */
+  struct rsrv_udp_batch *udpBatch;
+  /*! UDP only, name searches received and answered by this receiver,
+   *  only updated by the thread receiving for it */
+  size_t                nSearches, nSearchesFound;
 } client;
 
 /* Channel state shows which struct client list a
@@ -154,8 +190,13 @@ typedef struct {
                 udpbcastAddr; /* UDP name broadcast receiver endpoint */
     SOCKET tcp, udp, udpbcast;
     struct client *client, *bclient;
+    /* additional receivers sharing udpAddr with SO_REUSEPORT */
+    SOCKET *udpx;
+    struct client **xclient;
+    unsigned nudpx;
 
     unsigned int startbcast:1;
+    unsigned startx; /* index+1 of udpx[] being started */
 } rsrv_iface_config;
 
 enum ctl {ctlInit, ctlRun, ctlPause, ctlExit};
@@ -197,6 +238,7 @@ GLBLTYPE void               *rsrvLargeBufFreeListTCP;
 GLBLTYPE unsigned           rsrvSizeofLargeBufTCP;
 GLBLTYPE void               *rsrvPutNotifyFreeList;
 GLBLTYPE unsigned           rsrvChannelCount; /* locked by clientQlock */
+GLBLTYPE size_t             rsrvZeroCopySends, rsrvZeroCopyBytes; /* atomic */
 
 GLBLTYPE epicsEventId       casudp_startStopEvent;
 GLBLTYPE epicsEventId       beacon_startStopEvent;
@@ -220,10 +262,18 @@ extern "C" {
 #endif
 
 void camsgtask (void *client);
+void casSendIfIdle ( struct client *client );
+int casRecvAndProcess ( struct client *client, int recvFlags );
+int casProcessRecv ( struct client *client );
 void cas_send_bs_msg ( struct client *pclient, int lock_needed );
 void cas_send_dg_msg ( struct client *pclient );
 void rsrv_online_notify_task (void *);
 void cast_server (void *);
+unsigned rsrvUdpReceivers ( void );
+SOCKET rsrvUdpReceiverCreate ( const osiSockAddr *pAddr );
+int rsrvUdpBatchQueue ( struct client *pClient, const char *pDG,
+    unsigned sizeDG );
+void rsrvUdpBatchShow ( const struct client *pClient, unsigned level );
 struct client *create_client ( SOCKET sock, int proto );
 void destroy_client ( struct client * );
 struct client *create_tcp_client ( SOCKET sock, const osiSockAddr* peerAddr );
@@ -238,6 +288,30 @@ void rsrvFreePutNotify ( struct client *pClient,
 void initializePutNotifyFreeList (void);
 unsigned rsrvSizeOfPutNotify ( struct rsrv_put_notify *pNotify );
 
+/*
+ * I/O thread pool (EPICS_CAS_IO_THREADS)
+ */
+void rsrvIoPoolInit ( void );
+int rsrvIoPoolActive ( void );
+int rsrvIoPoolAttach ( struct client *pClient );
+int rsrvIoPoolStart ( struct client *pClient );
+void rsrvIoPoolDetach ( struct client *pClient );
+unsigned rsrvIoPoolWorkerIndex ( const struct client *pClient );
+void rsrvIoPoolSend ( struct client *pClient, const char *pBuf,
+    unsigned size );
+void rsrvIoPoolDefer ( struct client *pClient, const char *pBuf,
+    size_t size );
+int rsrvIoPoolWouldBlock ( struct client *pClient, int sockErrno );
+void rsrvIoPoolShow ( unsigned level );
+
+/*
+ * Returned by a request handler when a circuit served by the I/O thread
+ * pool must not block for the request.  camessage() leaves the request
+ * in the receive buffer, and the worker stops reading the circuit until
+ * it can process it again.
+ */
+#define RSRV_PARKED 1
+
 /*
  * incoming protocol maintenance
  */
@@ -254,6 +328,13 @@ int cas_copy_in_header (
 void cas_set_header_cid ( struct client *pClient, ca_uint32_t );
 void cas_set_header_count (struct client *pClient, ca_uint32_t count);
 void cas_commit_msg ( struct client *pClient, ca_uint32_t size );
+#ifdef RSRV_HAVE_SENDMSG
+int cas_send_bs_msg_ref (
+    struct client *pClient, ca_uint16_t response, ca_uint32_t payloadSize,
+    ca_uint16_t dataType, ca_uint32_t nElem, ca_uint32_t cid,
+    ca_uint32_t responseSpecific, const void *pMeta, unsigned metaSize,
+    const void *pData );
+#endif
 
 #ifdef __cplusplus
 }
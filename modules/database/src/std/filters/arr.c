@@ -15,6 +15,7 @@
 
 #include "chfPlugin.h"
 #include "dbAccessDefs.h"
+#include "dbEvent.h"
 #include "dbExtractArray.h"
 #include "db_field_log.h"
 #include "dbLock.h"
@@ -115,7 +116,11 @@ static db_field_log* filter(void* pvt, dbChannel *chan, db_field_log *pfl)
             dbChannelGetArrayInfo(chan, &pSource, &nSource, &offset);
         }
         nTarget = wrapArrayIndices(&start, my->incr, &end, nSource);
-        if (nTarget > 0) {
+        if (nTarget > 0 && my->incr == 1 && db_field_log_snapshot(pfl)) {
+            /* a shared snapshot starts at offset 0, so no wrap-around */
+            pfl->u.r.field = (char *) pSource + start * pfl->field_size;
+        }
+        else if (nTarget > 0) {
             /* copy the data */
             pTarget = freeListCalloc(my->arrayFreeList);
             if (!pTarget) break;
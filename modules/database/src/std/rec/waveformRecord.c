@@ -321,7 +321,20 @@ static void monitor(waveformRecord *prec)
     }
 
     if (monitor_mask) {
-        db_post_events(prec, &prec->val, monitor_mask);
+        dbArraySnapshot *psnap = NULL;
+
+        /* Several subscribers, or filters, share one copy of the array */
+        if (db_array_snapshot_wanted(prec, &prec->val, monitor_mask))
+            psnap = db_create_array_snapshot(prec->ftvl,
+                dbValueSize(prec->ftvl), prec->nord);
+        if (psnap) {
+            memcpy(db_array_snapshot_data(psnap), prec->bptr,
+                prec->nord * dbValueSize(prec->ftvl));
+            db_post_array_snapshot(prec, &prec->val, monitor_mask, psnap);
+            db_release_array_snapshot(psnap);
+        }
+        else
+            db_post_events(prec, &prec->val, monitor_mask);
     }
 }
 
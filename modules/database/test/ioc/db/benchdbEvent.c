@@ -0,0 +1,210 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/*
+ * Measure the rate at which db_post_events() can queue monitor updates
+ * for one event task, with 1, 4 and 16 threads posting at once, and
+ * the rate for a record with 1000 subscriptions spread over 20 fields.
+ */
+
+#include <stdio.h>
+
+#include "epicsAtomic.h"
+#include "epicsEvent.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "caeventmask.h"
+#include "dbAccess.h"
+#include "dbChannel.h"
+#include "dbCommon.h"
+#include "dbEvent.h"
+#include "dbLock.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+#include "xRecord.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+#define MAXTHREADS 16
+#define NPOSTS 200000
+
+typedef struct {
+    xRecord *prec;
+    epicsEventId done;
+} poster;
+
+static size_t nDelivered;
+
+static void update(void *arg, struct dbChannel *chan,
+                   int eventsRemaining, struct db_field_log *pfl)
+{
+    epicsAtomicIncrSizeT(&nDelivered);
+}
+
+static void postLoop(void *arg)
+{
+    poster *p = arg;
+    int i;
+
+    for (i = 0; i < NPOSTS; i++) {
+        dbScanLock((dbCommon *) p->prec);
+        p->prec->val = i;
+        db_post_events(p->prec, &p->prec->val, DBE_VALUE);
+        dbScanUnlock((dbCommon *) p->prec);
+    }
+    epicsEventMustTrigger(p->done);
+}
+
+static void runBench(unsigned nThreads)
+{
+    poster posters[MAXTHREADS];
+    dbChannel *chans[MAXTHREADS];
+    dbEventSubscription subs[MAXTHREADS];
+    dbEventQueueStats stats;
+    epicsTimeStamp start, stop;
+    dbEventCtx ctx;
+    double elapsed;
+    unsigned i;
+
+    ctx = db_init_events();
+    if (!ctx || db_start_events(ctx, "benchEvent", NULL, NULL,
+            epicsThreadPriorityCAServerLow) != DB_EVENT_OK)
+        testAbort("Can't start event task");
+
+    for (i = 0; i < nThreads; i++) {
+        char name[16];
+
+        sprintf(name, "bench%02u.VAL", i);
+        chans[i] = dbChannelCreate(name);
+        if (!chans[i] || dbChannelOpen(chans[i]))
+            testAbort("Can't open channel %s", name);
+        subs[i] = db_add_event(ctx, chans[i], update, NULL, DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+        posters[i].prec = (xRecord *) dbChannelRecord(chans[i]);
+        posters[i].done = epicsEventMustCreate(epicsEventEmpty);
+    }
+    epicsAtomicSetSizeT(&nDelivered, 0u);
+
+    epicsTimeGetCurrent(&start);
+    for (i = 0; i < nThreads; i++) {
+        epicsThreadMustCreate("benchPost", epicsThreadPriorityMedium,
+            epicsThreadGetStackSize(epicsThreadStackSmall),
+            postLoop, &posters[i]);
+    }
+    for (i = 0; i < nThreads; i++)
+        epicsEventMustWait(posters[i].done);
+    epicsTimeGetCurrent(&stop);
+    elapsed = epicsTimeDiffInSeconds(&stop, &start);
+
+    db_event_queue_stats(ctx, &stats);
+    testDiag("%2u threads: %.3f Mposts/s, %.1f%% delivered, %lu replaced",
+        nThreads, nThreads * (double) NPOSTS / elapsed / 1e6,
+        100.0 * epicsAtomicGetSizeT(&nDelivered) / (nThreads * NPOSTS),
+        stats.nOverflow);
+
+    for (i = 0; i < nThreads; i++) {
+        db_cancel_event(subs[i]);
+        dbChannelDelete(chans[i]);
+        epicsEventDestroy(posters[i].done);
+    }
+    db_close_events(ctx);
+}
+
+#define NFIELDS 20
+#define NFIELDSUBS 1000
+#define NROUNDS 5000
+
+static void nopWakeup(void *arg) {}
+
+static void runFieldBench(void)
+{
+    static const char *fields[NFIELDS] = {
+        "VAL", "C8", "U8", "I16", "U16", "I32", "U32", "I64", "U64", "F32",
+        "F64", "OTST", "SFX", "PHAS", "PRIO", "DISV", "DISA", "TPRO", "UDF",
+        "PINI"
+    };
+    static dbChannel *chans[NFIELDS];
+    static dbEventSubscription subs[NFIELDSUBS];
+    epicsTimeStamp start, stop;
+    dbEventCtx ctx;
+    dbCommon *prec;
+    double elapsed;
+    unsigned i, j;
+
+    ctx = db_init_events();
+    if (!ctx || db_start_events_external(ctx, nopWakeup, NULL))
+        testAbort("Can't start external event context");
+
+    for (i = 0; i < NFIELDS; i++) {
+        char name[16];
+
+        sprintf(name, "bench00.%s", fields[i]);
+        chans[i] = dbChannelCreate(name);
+        if (!chans[i] || dbChannelOpen(chans[i]))
+            testAbort("Can't open channel %s", name);
+    }
+    for (i = 0; i < NFIELDSUBS; i++) {
+        subs[i] = db_add_event(ctx, chans[i % NFIELDS], update, NULL,
+            DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+    }
+    prec = dbChannelRecord(chans[0]);
+    epicsAtomicSetSizeT(&nDelivered, 0u);
+
+    epicsTimeGetCurrent(&start);
+    for (i = 0; i < NROUNDS; i++) {
+        dbScanLock(prec);
+        for (j = 0; j < NFIELDS; j++)
+            db_post_events(prec, dbChannelField(chans[j]), DBE_VALUE);
+        dbScanUnlock(prec);
+        db_process_events(ctx);
+    }
+    epicsTimeGetCurrent(&stop);
+    elapsed = epicsTimeDiffInSeconds(&stop, &start);
+
+    testDiag("%u subscriptions on %u fields: %.3f Mposts/s, %.1f%% delivered",
+        NFIELDSUBS, NFIELDS, NROUNDS * NFIELDS / elapsed / 1e6,
+        100.0 * epicsAtomicGetSizeT(&nDelivered) /
+            ((double) NROUNDS * NFIELDSUBS));
+
+    for (i = 0; i < NFIELDSUBS; i++)
+        db_cancel_event(subs[i]);
+    for (i = 0; i < NFIELDS; i++)
+        dbChannelDelete(chans[i]);
+    db_close_events(ctx);
+}
+
+MAIN(benchdbEvent)
+{
+    unsigned i;
+
+    testPlan(0);
+
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    for (i = 0; i < MAXTHREADS; i++) {
+        char macros[16];
+
+        sprintf(macros, "NAME=bench%02u", i);
+        testdbReadDatabase("benchdbEvent.db", NULL, macros);
+    }
+    testIocInitOk();
+
+    runBench(1);
+    runBench(4);
+    runBench(16);
+    runFieldBench();
+
+    testIocShutdownOk();
+    testdbCleanup();
+    return testDone();
+}
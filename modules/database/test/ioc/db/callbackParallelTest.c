@@ -20,6 +20,8 @@
 
 #include "callback.h"
 #include "cantProceed.h"
+#include "dbAccessDefs.h"
+#include "epicsAtomic.h"
 #include "epicsThread.h"
 #include "epicsEvent.h"
 #include "epicsTime.h"
@@ -96,6 +98,175 @@ static void printStats(double *stats, const char* tag) {
             sqrt(stats[4]*stats[3]-pow(stats[2], 2.0))/stats[4]);
 }
 
+#define NBLOCKERS 4
+#define NBURST 1000
+
+static epicsEventId gate;
+static int nBlocked;
+static int nBurst;
+
+static void blockCallback(epicsCallback *pCallback)
+{
+    epicsAtomicIncrIntT(&nBlocked);
+    epicsEventMustWait(gate);
+    epicsEventMustTrigger(gate);
+    epicsAtomicDecrIntT(&nBlocked);
+}
+
+static void burstCallback(epicsCallback *pCallback)
+{
+    epicsAtomicIncrIntT(&nBurst);
+}
+
+static void blockWorkers(epicsCallback *blockers)
+{
+    int i;
+
+    for (i = 0; i < NBLOCKERS; i++) {
+        callbackSetCallback(blockCallback, &blockers[i]);
+        callbackSetPriority(priorityLow, &blockers[i]);
+        callbackRequest(&blockers[i]);
+    }
+    for (i = 0; i < 100 && epicsAtomicGetIntT(&nBlocked) < NBLOCKERS; i++)
+        epicsThreadSleep(0.01);
+}
+
+static int waitBurst(int n)
+{
+    int i;
+
+    for (i = 0; i < 500 && epicsAtomicGetIntT(&nBurst) < n; i++)
+        epicsThreadSleep(0.01);
+    return epicsAtomicGetIntT(&nBurst) == n;
+}
+
+static void testBurst(void)
+{
+    epicsCallback blockers[NBLOCKERS];
+    epicsCallback *burst;
+    callbackQueueStats stats;
+    int i, nFailed = 0, nQueued;
+    long status = 0;
+
+    testDiag("Queues grow during a burst, up to callbackQueueMaxSize");
+
+    gate = epicsEventMustCreate(epicsEventEmpty);
+    burst = callocMustSucceed(NBURST, sizeof(epicsCallback), "burst");
+    for (i = 0; i < NBURST; i++) {
+        callbackSetCallback(burstCallback, &burst[i]);
+        callbackSetPriority(priorityLow, &burst[i]);
+    }
+
+    callbackSetQueueSize(8);
+    callbackParallelThreads(NBLOCKERS, "");
+    callbackInit();
+
+    blockWorkers(blockers);
+    testOk(epicsAtomicGetIntT(&nBlocked) == NBLOCKERS, "%d threads blocked",
+        epicsAtomicGetIntT(&nBlocked));
+
+    for (i = 0; i < NBURST; i++) {
+        if (callbackRequest(&burst[i]))
+            nFailed++;
+    }
+    testOk(nFailed == 0, "%d of %d requests failed", nFailed, NBURST);
+    testOk1(callbackQueueStatus(0, &stats) == 0);
+    testOk(stats.size == 8, "Queue size %d as configured", stats.size);
+    testOk(stats.numUsed[priorityLow] == NBURST &&
+        stats.maxUsed[priorityLow] >= NBURST,
+        "%d queued, high-water mark %d", stats.numUsed[priorityLow],
+        stats.maxUsed[priorityLow]);
+
+    epicsEventMustTrigger(gate);
+    testOk(waitBurst(NBURST), "%d requests ran", epicsAtomicGetIntT(&nBurst));
+    for (i = 0; i < 100 && epicsAtomicGetIntT(&nBlocked); i++)
+        epicsThreadSleep(0.01);
+    epicsEventTryWait(gate);
+
+    testDiag("Requests fail once the queues may not grow");
+
+    callbackQueueMaxSize = 64;
+    epicsAtomicSetIntT(&nBurst, 0);
+    blockWorkers(blockers);
+    for (nQueued = 0; nQueued < NBURST; nQueued++) {
+        status = callbackRequest(&burst[nQueued]);
+        if (status)
+            break;
+    }
+    testOk(status == S_db_bufFull, "callbackRequest() failed with %ld",
+        status);
+    testOk(nQueued == 64, "%d requests queued", nQueued);
+    testOk1(callbackQueueStatus(1, &stats) == 0);
+    testOk(stats.numOverflow[priorityLow] == 1, "%d overflows",
+        stats.numOverflow[priorityLow]);
+
+    epicsEventMustTrigger(gate);
+    testOk(waitBurst(nQueued), "%d requests ran", epicsAtomicGetIntT(&nBurst));
+    for (i = 0; i < 100 && epicsAtomicGetIntT(&nBlocked); i++)
+        epicsThreadSleep(0.01);
+
+    callbackStop();
+    callbackCleanup();
+    callbackQueueMaxSize = 100000;
+    free(burst);
+    epicsEventDestroy(gate);
+}
+
+#define NLATE 10
+
+static void testLatency(void)
+{
+    epicsCallback blockers[NBLOCKERS];
+    epicsCallback late[NLATE];
+    callbackLatencyStats lat;
+    int i;
+
+    testDiag("Requests are timed from callbackRequest() until they run");
+
+    gate = epicsEventMustCreate(epicsEventEmpty);
+    epicsAtomicSetIntT(&nBurst, 0);
+    callbackParallelThreads(NBLOCKERS, "");
+    callbackInit();
+    testOk1(callbackLatencyStatus(NUM_CALLBACK_PRIORITIES, 0, &lat) == -2);
+
+    callbackLatencyTiming = 1;
+    blockWorkers(blockers);
+    for (i = 0; i < NLATE; i++) {
+        callbackSetCallback(burstCallback, &late[i]);
+        callbackSetPriority(priorityLow, &late[i]);
+        callbackSetUser(&late[i], &late[i]);
+        callbackRequest(&late[i]);
+    }
+    epicsThreadSleep(0.1);
+    epicsEventMustTrigger(gate);
+    testOk(waitBurst(NLATE), "%d requests ran", epicsAtomicGetIntT(&nBurst));
+    for (i = 0; i < 100 && epicsAtomicGetIntT(&nBlocked); i++)
+        epicsThreadSleep(0.01);
+    epicsEventTryWait(gate);
+
+    testOk1(callbackLatencyStatus(priorityLow, 0, &lat) == 0);
+    testOk(lat.count == NBLOCKERS + NLATE, "%lu requests timed", lat.count);
+    testOk(lat.max >= 0.09 && lat.p99 <= lat.max && lat.p50 <= lat.p99,
+        "p50 %f  p99 %f  max %f", lat.p50, lat.p99, lat.max);
+    testOk(lat.nWorst == CALLBACK_STATS_WORST &&
+        lat.worst[0].callback == burstCallback &&
+        lat.worst[0].time == lat.max,
+        "%d worst, longest wait %f", lat.nWorst, lat.worst[0].time);
+
+    callbackLatencyTiming = 0;
+    callbackLatencyStatus(priorityLow, 1, NULL);
+    callbackRequest(&late[0]);
+    testOk(waitBurst(NLATE + 1), "%d requests ran",
+        epicsAtomicGetIntT(&nBurst));
+    callbackLatencyStatus(priorityLow, 0, &lat);
+    testOk(lat.count == 0 && lat.nWorst == 0,
+        "%lu requests timed after reset", lat.count);
+
+    callbackStop();
+    callbackCleanup();
+    epicsEventDestroy(gate);
+}
+
 MAIN(callbackParallelTest)
 {
     myPvt *pcbt[NCALLBACKS];
@@ -111,7 +282,7 @@ MAIN(callbackParallelTest)
         for (j = 0; j < 5; j++)
             setupError[i][j] = timeError[i][j] = defaultError[j];
 
-    testPlan(2);
+    testPlan(21);
 
     testDiag("Starting %d parallel callback threads", noCpus);
 
@@ -206,5 +377,8 @@ MAIN(callbackParallelTest)
     callbackStop();
     callbackCleanup();
 
+    testBurst();
+    testLatency();
+
     return testDone();
 }
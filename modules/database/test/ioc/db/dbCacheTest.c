@@ -0,0 +1,202 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Loading records through the binary record cache */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <direct.h>
+#  define makeDir(name) _mkdir(name)
+#elif defined(vxWorks)
+#  define makeDir(name) mkdir(name)
+#else
+#  include <sys/stat.h>
+#  define makeDir(name) mkdir(name, 0777)
+#endif
+
+#include "envDefs.h"
+#include "epicsTime.h"
+#include "osiFileName.h"
+#include "dbAccess.h"
+#include "dbStaticLib.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static dbRecordCacheInfo last;
+
+static void writeInclude(const char *file, const char *desc)
+{
+    FILE *fp = fopen(file, "w");
+
+    if (!fp)
+        testAbort("Can't write %s", file);
+    fprintf(fp, "record(x, \"$(P)b\") {\n"
+        "    field(DESC, \"%s\")\n"
+        "}\n", desc);
+    fclose(fp);
+}
+
+static void writeFiles(void)
+{
+    epicsTimeStamp now;
+    FILE *fp;
+
+    /* A different comment each run, so an old cache isn't used */
+    epicsTimeGetCurrent(&now);
+    fp = fopen("dbCacheTest.db", "w");
+    if (!fp)
+        testAbort("Can't write dbCacheTest.db");
+    fprintf(fp, "# run %u.%09u\n", now.secPastEpoch, now.nsec);
+    fputs("# extra $(E=)\n"
+        "record(x, \"$(P)a\") {\n"
+        "    field(DESC, \"$(D)\")\n"
+        "    info(note, \"a \\\"quoted\\\" value\")\n"
+        "    alias(\"$(P)a1\")\n"
+        "}\n"
+        "record(x, \"$(P)gone\") { }\n"
+        "record(\"#\", \"$(P)gone\") { }\n"
+        "record(\"*\", \"$(P)a\") {\n"
+        "    field(VAL, \"5\")\n"
+        "}\n"
+        "alias(\"$(P)a\", \"$(P)a2\")\n"
+        "include \"dbCacheTestInc.db\"\n", fp);
+    fclose(fp);
+    writeInclude("dbCacheTestInc.db", "first");
+}
+
+static void prepare(void)
+{
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+}
+
+static void testString(const char *rec, const char *field, const char *expect)
+{
+    DBENTRY entry;
+
+    dbInitEntry(pdbbase, &entry);
+    if (dbFindRecord(&entry, rec) || dbFindField(&entry, field)) {
+        testFail("%s.%s not found", rec, field);
+    }
+    else {
+        const char *value = dbGetString(&entry);
+
+        testOk(value && strcmp(value, expect) == 0, "%s.%s \"%s\" == \"%s\"",
+            rec, field, value ? value : "(null)", expect);
+    }
+    dbFinishEntry(&entry);
+}
+
+static void testRecords(const char *desc, const char *incDesc)
+{
+    DBENTRY entry;
+
+    testString("c:a", "DESC", desc);
+    testString("c:a", "VAL", "5");
+    testString("c:b", "DESC", incDesc);
+
+    dbInitEntry(pdbbase, &entry);
+    testOk(!dbFindRecord(&entry, "c:a") && !dbFindInfo(&entry, "note") &&
+        strcmp(dbGetInfoString(&entry), "a \"quoted\" value") == 0,
+        "info item");
+    testOk(!dbFindRecord(&entry, "c:a1") && dbIsAlias(&entry),
+        "alias in record");
+    testOk(!dbFindRecord(&entry, "c:a2") && dbIsAlias(&entry),
+        "alias statement");
+    testOk(dbFindRecord(&entry, "c:gone") == S_dbLib_recNotFound,
+        "deleted record");
+    dbFinishEntry(&entry);
+}
+
+/* Check how the last load went */
+static void testLoad(const char *subs, unsigned long loaded,
+    unsigned long parsed, unsigned long saved)
+{
+    dbRecordCacheInfo info;
+
+    testOk(dbLoadRecords("dbCacheTest.db", subs) == 0,
+        "dbLoadRecords(\"dbCacheTest.db\", \"%s\")", subs);
+    dbRecordCacheStats(&info);
+    testOk(info.loaded - last.loaded == loaded &&
+        info.parsed - last.parsed == parsed &&
+        info.saved - last.saved == saved,
+        "loaded %lu, parsed %lu, saved %lu",
+        info.loaded - last.loaded, info.parsed - last.parsed,
+        info.saved - last.saved);
+    last = info;
+}
+
+MAIN(dbCacheTest)
+{
+    testPlan(52);
+
+    writeFiles();
+    testOk1(dbRecordCache(".") == 0);
+    dbRecordCacheStats(&last);
+
+    testDiag("The first load parses the file and saves the cache");
+    prepare();
+    testLoad("P=c:,D=one", 0, 1, 1);
+    testRecords("one", "first");
+    testdbCleanup();
+
+    testDiag("The second load uses the cache");
+    prepare();
+    testLoad("P=c:,D=one", 1, 0, 0);
+    testRecords("one", "first");
+    testdbCleanup();
+
+    testDiag("Other substitutions have their own cache");
+    prepare();
+    testLoad("P=c:,D=two", 0, 1, 1);
+    testString("c:a", "DESC", "two");
+    testdbCleanup();
+
+    testDiag("Changing an included file makes the cache stale");
+    writeInclude("dbCacheTestInc.db", "second");
+    prepare();
+    testLoad("P=c:,D=one", 0, 1, 1);
+    testRecords("one", "second");
+    testdbCleanup();
+
+    testDiag("Files with undefined macros aren't cached");
+    prepare();
+    testLoad("P=c:,D=one,E=$(U)", 0, 1, 0);
+    testdbCleanup();
+
+    testDiag("Without a directory the cache is off");
+    testOk1(dbRecordCache(NULL) == 0);
+    prepare();
+    testLoad("P=c:,D=one", 0, 0, 0);
+    testRecords("one", "second");
+    testdbCleanup();
+
+    testDiag("A file that now shadows an included one makes the cache stale");
+    testOk1(dbRecordCache(".") == 0);
+    epicsEnvSet("EPICS_DB_INCLUDE_PATH",
+        "dbCacheTestDir" OSI_PATH_LIST_SEPARATOR ".");
+    remove("dbCacheTestDir/dbCacheTestInc.db");
+    prepare();
+    testLoad("P=c:,D=one", 0, 1, 1);
+    testString("c:b", "DESC", "second");
+    testdbCleanup();
+    prepare();
+    testLoad("P=c:,D=one", 1, 0, 0);
+    testdbCleanup();
+    makeDir("dbCacheTestDir");
+    writeInclude("dbCacheTestDir/dbCacheTestInc.db", "third");
+    prepare();
+    testLoad("P=c:,D=one", 0, 1, 1);
+    testString("c:b", "DESC", "third");
+    testdbCleanup();
+
+    return testDone();
+}
@@ -0,0 +1,463 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/*
+ * Tests of the dbEvent facility
+ */
+
+#define EPICS_PRIVATE_API
+
+#include <string.h>
+
+#include <epicsAtomic.h>
+#include <errlog.h>
+#include <caeventmask.h>
+#include <dbAccess.h>
+#include <dbChannel.h>
+#include <dbEvent.h>
+#include <db_field_log.h>
+#include <dbUnitTest.h>
+#include <testMain.h>
+
+#include "xRecord.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static int nWakeups;
+static int nUpdates;
+static int nLabor;
+static epicsInt32 lastValue;
+
+static void wakeup(void *arg)
+{
+    testOk1(arg == (void*)&nWakeups);
+    epicsAtomicIncrIntT(&nWakeups);
+}
+
+static void update(void *arg, struct dbChannel *chan,
+                   int eventsRemaining, struct db_field_log *pfl)
+{
+    testOk1(arg == (void*)&nUpdates);
+    nUpdates++;
+    if (pfl && pfl->type == dbfl_type_val)
+        lastValue = pfl->u.v.field.dbf_long;
+}
+
+static void labor(void *arg)
+{
+    testOk1(arg == (void*)&nLabor);
+    nLabor++;
+}
+
+static void testExternal(void)
+{
+    dbEventCtx ctx, taskCtx;
+    dbChannel *chan;
+    dbEventSubscription sub;
+
+    testDiag("Test dbEvent context serviced by db_process_events()");
+
+    ctx = db_init_events();
+    if (!ctx)
+        testAbort("db_init_events() failed");
+
+    testOk1(db_start_events_external(ctx, NULL, NULL) == DB_EVENT_ERROR);
+    testOk1(db_process_events(ctx) == DB_EVENT_ERROR);
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_OK);
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_ERROR);
+    testOk1(db_start_events(ctx, "dbEventTest", NULL, NULL,
+        epicsThreadPriorityCAServerLow) == DB_EVENT_ERROR);
+
+    chan = dbChannelCreate("x.VAL");
+    if (!chan || dbChannelOpen(chan))
+        testAbort("Can't open channel x.VAL");
+
+    sub = db_add_event(ctx, chan, update, &nUpdates, DBE_VALUE);
+    if (!sub)
+        testAbort("db_add_event() failed");
+    db_event_enable(sub);
+
+    db_post_single_event(sub);
+    testOk(nWakeups == 1, "initial update wakes (%d)", nWakeups);
+    testOk(nUpdates == 0, "no update before processing (%d)", nUpdates);
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nUpdates == 1, "initial update delivered (%d)", nUpdates);
+
+    testdbPutFieldOk("x.VAL", DBR_LONG, 42);
+    testOk(nWakeups == 2, "put wakes (%d)", nWakeups);
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nUpdates == 2, "put update delivered (%d)", nUpdates);
+    testOk(lastValue == 42, "value %d == 42", (int)lastValue);
+
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nUpdates == 2, "no spurious updates (%d)", nUpdates);
+
+    testOk1(db_add_extra_labor_event(ctx, labor, &nLabor) == DB_EVENT_OK);
+    testOk1(db_post_extra_labor(ctx) == DB_EVENT_OK);
+    testOk(nWakeups == 3, "extra labor wakes (%d)", nWakeups);
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nLabor == 1, "extra labor run (%d)", nLabor);
+
+    db_cancel_event(sub);
+    db_close_events(ctx);
+    dbChannelDelete(chan);
+
+    testDiag("db_process_events() refuses a context with an event task");
+    taskCtx = db_init_events();
+    if (!taskCtx)
+        testAbort("db_init_events() failed");
+    testOk1(db_start_events(taskCtx, "dbEventTest", NULL, NULL,
+        epicsThreadPriorityCAServerLow) == DB_EVENT_OK);
+    testOk1(db_process_events(taskCtx) == DB_EVENT_ERROR);
+    testOk1(db_start_events_external(taskCtx, wakeup, &nWakeups) == DB_EVENT_ERROR);
+    db_close_events(taskCtx);
+}
+
+static int nCounted;
+
+static void count(void *arg, struct dbChannel *chan,
+                  int eventsRemaining, struct db_field_log *pfl)
+{
+    nCounted++;
+}
+
+#define NSUBS 100
+
+static void testQueueGrowth(void)
+{
+    dbEventCtx ctx;
+    dbChannel *chan;
+    dbEventSubscription subs[NSUBS];
+    dbEventQueueStats stats;
+    unsigned i;
+    int n;
+
+    testDiag("Test event queue growth and overflow statistics");
+
+    ctx = db_init_events();
+    if (!ctx)
+        testAbort("db_init_events() failed");
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_OK);
+
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nQueues == 0 && stats.nEntries == 0,
+        "no queue before subscribing (%u, %u)", stats.nQueues, stats.nEntries);
+
+    testOk1(db_event_queue_config(ctx, 8, 4096) == DB_EVENT_OK);
+
+    chan = dbChannelCreate("x.VAL");
+    if (!chan || dbChannelOpen(chan))
+        testAbort("Can't open channel x.VAL");
+
+    for (i = 0; i < NSUBS; i++) {
+        subs[i] = db_add_event(ctx, chan, count, NULL, DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+    }
+
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nQueues == 1, "one queue for %u subscriptions (%u)",
+        NSUBS, stats.nQueues);
+    testOk(stats.nEntries >= 8 * (NSUBS + 1) && stats.nEntries <= 4096,
+        "queue grew to %u entries", stats.nEntries);
+
+    for (n = 1; n <= 7; n++)
+        testdbPutFieldOk("x.VAL", DBR_LONG, n);
+
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nUsed == 7 * NSUBS, "%u events queued", stats.nUsed);
+    testOk(stats.nOverflow == 0, "no overflow (%lu)", stats.nOverflow);
+
+    nCounted = 0;
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nCounted == 7 * NSUBS, "all %d updates delivered (%d)",
+        7 * NSUBS, nCounted);
+
+    for (n = 1; n <= 16; n++)
+        testdbPutFieldOk("x.VAL", DBR_LONG, n);
+
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nOverflow > 0, "overflow counted (%lu)", stats.nOverflow);
+    testOk(stats.highWater <= stats.nEntries &&
+        stats.highWater >= stats.nEntries - stats.nEntries / 8,
+        "high water %u of %u entries", stats.highWater, stats.nEntries);
+
+    nCounted = 0;
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nCounted == (int)(stats.nUsed), "%u queued updates delivered (%d)",
+        stats.nUsed, nCounted);
+
+    for (i = 0; i < NSUBS; i++)
+        db_cancel_event(subs[i]);
+    db_close_events(ctx);
+
+    testDiag("Queues chain once the size limit is reached");
+
+    ctx = db_init_events();
+    if (!ctx)
+        testAbort("db_init_events() failed");
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_OK);
+    testOk1(db_event_queue_config(ctx, 4, 256) == DB_EVENT_OK);
+    for (i = 0; i < NSUBS; i++) {
+        subs[i] = db_add_event(ctx, chan, count, NULL, DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+    }
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nQueues == 2 && stats.nEntries == 2 * 256,
+        "%u queues of %u entries", stats.nQueues, stats.nEntries);
+    for (i = 0; i < NSUBS; i++)
+        db_cancel_event(subs[i]);
+    db_close_events(ctx);
+
+    testDiag("Events queued before the ring is replaced are delivered");
+
+    ctx = db_init_events();
+    if (!ctx)
+        testAbort("db_init_events() failed");
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_OK);
+    testOk1(db_event_queue_config(ctx, 4, 4096) == DB_EVENT_OK);
+    for (i = 0; i < NSUBS / 2; i++) {
+        subs[i] = db_add_event(ctx, chan, count, NULL, DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+    }
+    testdbPutFieldOk("x.VAL", DBR_LONG, 1);
+    testdbPutFieldOk("x.VAL", DBR_LONG, 2);
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nEntries == 256 && stats.nUsed == NSUBS,
+        "%u of %u entries used", stats.nUsed, stats.nEntries);
+
+    for (; i < NSUBS; i++) {
+        subs[i] = db_add_event(ctx, chan, count, NULL, DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+    }
+    testdbPutFieldOk("x.VAL", DBR_LONG, 3);
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nQueues == 1 && stats.nEntries == 512 &&
+        stats.nUsed == 2 * NSUBS, "%u of %u entries used", stats.nUsed,
+        stats.nEntries);
+
+    nCounted = 0;
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nCounted == 2 * NSUBS, "all %d updates delivered (%d)",
+        2 * NSUBS, nCounted);
+    db_event_queue_stats(ctx, &stats);
+    testOk(stats.nUsed == 0, "queue empty (%u)", stats.nUsed);
+
+    for (i = 0; i < NSUBS; i++)
+        db_cancel_event(subs[i]);
+    db_close_events(ctx);
+
+    dbChannelDelete(chan);
+}
+
+#define NSNAPSUBS 3
+
+static int nSnapUpdates;
+static void *snapField[NSNAPSUBS];
+static long snapElements[NSNAPSUBS];
+static epicsInt32 snapFirst[NSNAPSUBS];
+static int snapShared[NSNAPSUBS];
+
+static void snapUpdate(void *arg, struct dbChannel *chan,
+                       int eventsRemaining, struct db_field_log *pfl)
+{
+    int i = *(int *) arg;
+
+    nSnapUpdates++;
+    snapField[i] = pfl->u.r.field;
+    snapElements[i] = pfl->no_elements;
+    snapFirst[i] = pfl->no_elements ? *(epicsInt32 *) pfl->u.r.field : -1;
+    snapShared[i] = db_field_log_snapshot(pfl) != NULL && dbfl_has_copy(pfl);
+}
+
+static void testSnapshot(void)
+{
+    static int index[NSNAPSUBS] = {0, 1, 2};
+    dbEventSubscription subs[NSNAPSUBS];
+    dbArraySnapshot *psnap;
+    dbEventCtx ctx;
+    dbChannel *chan;
+    dbCommon *prec;
+    epicsInt32 *data = NULL;
+    int i, k;
+
+    testDiag("Test array snapshots shared by subscribers");
+
+    ctx = db_init_events();
+    if (!ctx)
+        testAbort("db_init_events() failed");
+    testOk1(db_start_events_external(ctx, wakeup, &nWakeups) == DB_EVENT_OK);
+
+    chan = dbChannelCreate("i32.VAL");
+    if (!chan || dbChannelOpen(chan))
+        testAbort("Can't open channel i32.VAL");
+    prec = dbChannelRecord(chan);
+
+    for (i = 0; i < NSNAPSUBS; i++) {
+        subs[i] = db_add_event(ctx, chan, snapUpdate, &index[i], DBE_VALUE);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+        if (i == 0) {
+            dbScanLock(prec);
+            testOk(!db_array_snapshot_wanted(prec, dbChannelField(chan),
+                DBE_VALUE), "No snapshot for one subscriber");
+            dbScanUnlock(prec);
+        }
+    }
+    dbScanLock(prec);
+    testOk(db_array_snapshot_wanted(prec, dbChannelField(chan), DBE_VALUE),
+        "Snapshot for %d subscribers", NSNAPSUBS);
+    testOk(!db_array_snapshot_wanted(prec, dbChannelField(chan), DBE_ALARM),
+        "No snapshot for an event they don't want");
+    dbScanUnlock(prec);
+
+    testOk1(db_create_array_snapshot(DBF_LONG, sizeof(epicsInt32), -1) == NULL);
+
+    /* the second snapshot replaces the first, which was never sent */
+    for (k = 1; k <= 2; k++) {
+        psnap = db_create_array_snapshot(DBF_LONG, sizeof(epicsInt32), 5);
+        if (!psnap)
+            testAbort("db_create_array_snapshot() failed");
+        data = db_array_snapshot_data(psnap);
+        for (i = 0; i < 5; i++)
+            data[i] = 10 * k + i;
+        dbScanLock(prec);
+        testOk1(db_post_array_snapshot(prec, dbChannelField(chan), DBE_VALUE,
+            psnap) == DB_EVENT_OK);
+        dbScanUnlock(prec);
+        db_release_array_snapshot(psnap);
+    }
+
+    nSnapUpdates = 0;
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+    testOk(nSnapUpdates == NSNAPSUBS, "%d updates (%d)", NSNAPSUBS,
+        nSnapUpdates);
+    for (i = 0; i < NSNAPSUBS; i++) {
+        testOk(snapField[i] == data && snapElements[i] == 5 &&
+            snapFirst[i] == 20 && snapShared[i],
+            "subscriber %d shares the last snapshot (%ld elements, %d)",
+            i, snapElements[i], (int) snapFirst[i]);
+    }
+
+    for (i = 0; i < NSNAPSUBS; i++)
+        db_cancel_event(subs[i]);
+    db_close_events(ctx);
+    dbChannelDelete(chan);
+}
+
+static int fieldCounts[4];
+
+static void fieldUpdate(void *arg, struct dbChannel *chan,
+                        int eventsRemaining, struct db_field_log *pfl)
+{
+    (*(int *) arg)++;
+}
+
+static void quietWakeup(void *arg) {}
+
+static void postAndCount(dbEventCtx ctx, dbCommon *prec, void *pField,
+    unsigned mask, const int *expect, const char *what)
+{
+    memset(fieldCounts, 0, sizeof(fieldCounts));
+    dbScanLock(prec);
+    db_post_events(prec, pField, mask);
+    dbScanUnlock(prec);
+    db_process_events(ctx);
+    testOk(!memcmp(fieldCounts, expect, sizeof(fieldCounts)),
+        "%s: updates %d %d %d %d", what, fieldCounts[0], fieldCounts[1],
+        fieldCounts[2], fieldCounts[3]);
+}
+
+static void testFieldIndex(void)
+{
+    static const char *names[] = {"x.VAL", "x.I32", "x.I32", "x.U32"};
+    static const unsigned masks[] = {DBE_VALUE, DBE_VALUE, DBE_VALUE|DBE_LOG,
+        DBE_LOG};
+    static const int none[4] = {0, 0, 0, 0};
+    static const int val[4] = {1, 0, 0, 0};
+    static const int i32[4] = {0, 1, 1, 0};
+    static const int i32log[4] = {0, 0, 1, 0};
+    static const int i32one[4] = {0, 0, 1, 0};
+    static const int all[4] = {1, 0, 1, 0};
+    dbEventSubscription subs[4];
+    dbChannel *chans[4];
+    dbEventCtx ctx;
+    dbCommon *prec;
+    xRecord *px;
+    int i;
+
+    testDiag("Test that a post only reaches subscriptions to that field");
+
+    ctx = db_init_events();
+    if (!ctx || db_start_events_external(ctx, quietWakeup, NULL))
+        testAbort("Can't start external event context");
+
+    for (i = 0; i < 4; i++) {
+        chans[i] = dbChannelCreate(names[i]);
+        if (!chans[i] || dbChannelOpen(chans[i]))
+            testAbort("Can't open channel %s", names[i]);
+        subs[i] = db_add_event(ctx, chans[i], fieldUpdate, &fieldCounts[i],
+            masks[i]);
+        if (!subs[i])
+            testAbort("db_add_event() failed");
+        db_event_enable(subs[i]);
+    }
+    prec = dbChannelRecord(chans[0]);
+    px = (xRecord *) prec;
+
+    postAndCount(ctx, prec, &px->val, DBE_VALUE, val, "VAL");
+    postAndCount(ctx, prec, &px->i32, DBE_VALUE, i32, "I32");
+    postAndCount(ctx, prec, &px->i32, DBE_LOG, i32log, "I32 log");
+    postAndCount(ctx, prec, &px->u32, DBE_VALUE, none, "U32 value");
+    postAndCount(ctx, prec, &px->i64, DBE_VALUE|DBE_LOG, none, "I64");
+
+    db_event_disable(subs[1]);
+    postAndCount(ctx, prec, &px->i32, DBE_VALUE, i32one, "I32 after disable");
+    postAndCount(ctx, prec, NULL, DBE_VALUE, all, "all fields");
+    db_event_enable(subs[1]);
+    postAndCount(ctx, prec, &px->i32, DBE_VALUE, i32, "I32 after enable");
+
+    for (i = 0; i < 4; i++) {
+        db_cancel_event(subs[i]);
+        dbChannelDelete(chans[i]);
+    }
+    postAndCount(ctx, prec, &px->i32, DBE_VALUE, none, "I32 after cancel");
+    db_close_events(ctx);
+}
+
+MAIN(dbEventTest)
+{
+    testPlan(105);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("xRecord.db", NULL, NULL);
+    testdbReadDatabase("dbChArrTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testExternal();
+    testQueueGrowth();
+    testSnapshot();
+    testFieldIndex();
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    return testDone();
+}
@@ -11,11 +11,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "epicsSpin.h"
 #include "epicsMutex.h"
 #include "dbCommon.h"
 #include "epicsThread.h"
+#include "epicsEvent.h"
 
 #include "dbLockPvt.h"
 #include "dbStaticLib.h"
@@ -414,12 +416,86 @@ static void testLinkNOP(void)
     testdbCleanup();
 }
 
+typedef struct {
+    dbCommon *prec;
+    epicsEventId done;
+} waiter;
+
+static void lockWaiter(void *raw)
+{
+    waiter *pw = raw;
+
+    dbScanLock(pw->prec);
+    dbScanUnlock(pw->prec);
+    epicsEventMustTrigger(pw->done);
+}
+
+static void testContention(void)
+{
+    dbCommon *precB, *precC;
+    dbLockStats stats;
+    waiter w;
+    testDiag("Test lock set contention statistics");
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbLockTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    precB = testdbRecordPtr("recb");
+    precC = testdbRecordPtr("recc");
+
+    dbLockTiming = 1;
+    dbLockStatus(precB, 1, NULL);
+
+    /* another thread waits for the set while we hold it */
+    w.prec = precC;
+    w.done = epicsEventMustCreate(epicsEventEmpty);
+    dbScanLock(precB);
+    epicsThreadMustCreate("lockWaiter", epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackSmall), &lockWaiter, &w);
+    epicsThreadSleep(0.1);
+    dbScanUnlock(precB);
+    epicsEventMustWait(w.done);
+    epicsEventDestroy(w.done);
+
+    memset(&stats, 0, sizeof(stats));
+    testOk1(dbLockStatus(precC, 0, &stats)==0);
+    testOk(stats.records==2, "records %lu", stats.records);
+    testOk(stats.locks==2, "locks %lu", stats.locks);
+    testOk(stats.contended==1, "contended %lu", stats.contended);
+    testOk(stats.waitMax>=0.05 && stats.waitSum==stats.waitMax,
+        "waited %f s", stats.waitMax);
+    testOk(strcmp(stats.maxHolder, epicsThreadGetNameSelf())==0,
+        "held by \"%s\"", stats.maxHolder);
+
+    testOk1(dblcr(0, 1)==0);
+    dbLockStatus(precC, 0, &stats);
+    testOk(stats.locks==0 && stats.contended==0 && stats.waitMax==0.0,
+        "reset %lu %lu %f", stats.locks, stats.contended, stats.waitMax);
+
+    dbLockTiming = 0;
+    dbScanLock(precB);
+    dbScanUnlock(precB);
+    dbLockStatus(precC, 0, &stats);
+    testOk(stats.locks==0, "untimed locks %lu", stats.locks);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
 MAIN(dbLockTest)
 {
 #ifdef LOCKSET_DEBUG
-    testPlan(100);
+    testPlan(109);
 #else
-    testPlan(88);
+    testPlan(97);
 #endif
     testSets();
     testSingleLock();
@@ -428,5 +504,6 @@ MAIN(dbLockTest)
     testLinkMake();
     testLinkChange();
     testLinkNOP();
+    testContention();
     return testDone();
 }
@@ -19,8 +19,13 @@
 #include "testMain.h"
 
 #include "dbAccess.h"
+#include "dbLock.h"
+#include "epicsAtomic.h"
+#include "epicsThread.h"
 #include "errlog.h"
 
+#include "xRecord.h"
+
 void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
 
 static epicsEventId waiter;
@@ -66,9 +71,352 @@ static void testOnce(void)
     epicsEventDestroy(waiter);
 }
 
+#define NPERIODIC 8
+
+static int nProcessed[NPERIODIC];
+static epicsThreadId processedBy[NPERIODIC];
+
+static void countProcess(xRecord *prec)
+{
+    epicsAtomicIncrIntT(&nProcessed[prec->u32]);
+    processedBy[prec->u32] = epicsThreadGetIdSelf();
+}
+
+static int waitProcessed(int n)
+{
+    int i, tries;
+
+    for (tries = 0; tries < 100; tries++) {
+        for (i = 0; i < NPERIODIC; i++) {
+            if (epicsAtomicGetIntT(&nProcessed[i]) < n)
+                break;
+        }
+        if (i == NPERIODIC)
+            return 1;
+        epicsThreadSleep(0.1);
+    }
+    return 0;
+}
+
+static void testPartitioned(void)
+{
+    xRecord *precs[NPERIODIC];
+    dbCommon *pper5, *pper6;
+    int i, j, nThreads = 0;
+
+    testDiag("check a periodic scan list split over several threads");
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbScanTest.db", NULL, NULL);
+
+    testOk1(scanPeriodicSetThreads(0.1, 4) == 0);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testOk1(scanPeriodicSetThreads(0.1, 2) != 0);
+
+    for (i = 0; i < NPERIODIC; i++) {
+        char name[8];
+
+        sprintf(name, "per%d", i);
+        precs[i] = (xRecord *)testdbRecordPtr(name);
+        dbScanLock((dbCommon *)precs[i]);
+        precs[i]->clbk = countProcess;
+        dbScanUnlock((dbCommon *)precs[i]);
+    }
+
+    testOk(waitProcessed(3), "all records processed 3 times");
+
+    for (i = 0; i < NPERIODIC; i++) {
+        for (j = 0; j < i; j++) {
+            if (processedBy[j] == processedBy[i])
+                break;
+        }
+        if (j == i)
+            nThreads++;
+    }
+    testOk(nThreads > 1 && nThreads <= 4, "processed by %d threads", nThreads);
+
+    pper5 = testdbRecordPtr("per5");
+    pper6 = testdbRecordPtr("per6");
+    testOk1(dbLockGetLockId(pper5) == dbLockGetLockId(pper6));
+    testOk1(processedBy[5] == processedBy[6]);
+
+    testdbPutFieldOk("per3.SCAN", DBF_STRING, "Passive");
+    epicsAtomicSetIntT(&nProcessed[3], 0);
+    epicsThreadSleep(0.3);
+    testOk(epicsAtomicGetIntT(&nProcessed[3]) == 0,
+        "record removed from the list is not processed (%d)",
+        epicsAtomicGetIntT(&nProcessed[3]));
+
+    testdbPutFieldOk("per3.SCAN", DBF_STRING, ".1 second");
+    testOk(waitProcessed(1), "record added back is processed");
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    testOk1(scanPeriodicSetThreads(0.0, 1) == 0);
+}
+
+static void slowProcess(xRecord *prec)
+{
+    if (prec->u32 == 2)
+        epicsThreadSleep(0.005);
+    epicsAtomicIncrIntT(&nProcessed[prec->u32]);
+}
+
+static void testTiming(void)
+{
+    scanPeriodicStats stats;
+    int i;
+
+    testDiag("check timing statistics of periodic scan lists");
+
+    testOk1(scanPeriodicStatus(0.1, 0, &stats) == -1);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbScanTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    scanRecordTiming = 1;
+    for (i = 0; i < NPERIODIC; i++) {
+        char name[8];
+        xRecord *prec;
+
+        sprintf(name, "per%d", i);
+        prec = (xRecord *)testdbRecordPtr(name);
+        dbScanLock((dbCommon *)prec);
+        prec->clbk = slowProcess;
+        dbScanUnlock((dbCommon *)prec);
+        nProcessed[i] = 0;
+    }
+    testOk1(scanPeriodicStatus(0.1, 1, NULL) == 0);
+    testOk(waitProcessed(3), "all records processed 3 times");
+
+    testOk1(scanPeriodicStatus(3.14, 0, &stats) == -2);
+    testOk1(scanPeriodicStatus(0.1, 0, &stats) == 0);
+    testOk(stats.cycles >= 2, "%lu cycles", stats.cycles);
+    testOk(stats.durationP50 >= 0.005 &&
+        stats.durationP50 <= stats.durationP99 &&
+        stats.durationP99 <= stats.durationMax,
+        "duration p50 %f <= p99 %f <= max %f", stats.durationP50,
+        stats.durationP99, stats.durationMax);
+    testOk(stats.lateMean <= stats.lateMax, "start delay mean %f max %f",
+        stats.lateMean, stats.lateMax);
+    testOk(stats.nSlowest == NPERIODIC, "%d records timed", stats.nSlowest);
+    testOk(stats.nSlowest > 0 &&
+        strcmp(stats.slowest[0].precord->name, "per2") == 0 &&
+        stats.slowest[0].time >= 0.005,
+        "per2 is the slowest record (%f)", stats.slowest[0].time);
+    for (i = 1; i < stats.nSlowest; i++) {
+        if (stats.slowest[i].time > stats.slowest[i - 1].time)
+            break;
+    }
+    testOk(i == stats.nSlowest, "slowest records are sorted");
+
+    scanRecordTiming = 0;
+    testOk1(scanPeriodicStatus(0.1, 1, NULL) == 0);
+    testOk1(scanPeriodicStatus(0.1, 0, &stats) == 0);
+    testOk(stats.nSlowest == 0 && stats.cycles <= 1,
+        "reset clears statistics (%d, %lu)", stats.nSlowest, stats.cycles);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+static int nOnce;
+
+static void blockProcess(xRecord *prec)
+{
+    if (prec->u32 == 1)
+        epicsThreadSleep(0.05);
+}
+
+static void onceCount(void *junk, dbCommon *prec)
+{
+    if (epicsAtomicIncrIntT(&nOnce) == 3)
+        epicsEventMustTrigger(waiter);
+}
+
+static void testOnceLatency(void)
+{
+    scanOnceLatencyStats lat;
+    const char *names[] = {"per1", "per3", "per4"};
+    xRecord *precs[3];
+    int i;
+
+    testDiag("check latency statistics of the Once queue");
+
+    testOk1(scanOnceLatencyStatus(0, &lat) == -1);
+    waiter = epicsEventMustCreate(epicsEventEmpty);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbScanTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    for (i = 0; i < 3; i++) {
+        precs[i] = (xRecord *)testdbRecordPtr(names[i]);
+        dbScanLock((dbCommon *)precs[i]);
+        precs[i]->clbk = blockProcess;
+        dbScanUnlock((dbCommon *)precs[i]);
+    }
+
+    scanOnceLatencyTiming = 1;
+    for (i = 0; i < 3; i++)
+        scanOnceCallback((dbCommon *)precs[i], onceCount, NULL);
+    epicsEventMustWait(waiter);
+
+    testOk1(scanOnceLatencyStatus(0, &lat) == 0);
+    testOk(lat.count == 3, "%lu requests timed", lat.count);
+    testOk(lat.nWorst == 3 && lat.max >= 0.045 &&
+        lat.worst[0].time == lat.max &&
+        lat.worst[0].precord != (dbCommon *)precs[0],
+        "%s waited longest (%f)",
+        lat.nWorst ? lat.worst[0].precord->name : "nothing", lat.max);
+
+    scanOnceLatencyTiming = 0;
+    testOk1(scanOnceLatencyStatus(1, NULL) == 0);
+    epicsAtomicSetIntT(&nOnce, 2);
+    scanOnceCallback((dbCommon *)precs[1], onceCount, NULL);
+    epicsEventMustWait(waiter);
+    scanOnceLatencyStatus(0, &lat);
+    testOk(lat.count == 0 && lat.nWorst == 0,
+        "%lu requests timed after reset", lat.count);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+    epicsEventDestroy(waiter);
+}
+
+#define NORDER 20
+
+static epicsEventId gate;
+static int gateBlocked;
+static size_t order[NORDER];
+static int nOrder;
+static char onceThreadName[32];
+
+static void gateProcess(xRecord *prec)
+{
+    char name[32];
+
+    epicsThreadGetName(epicsThreadGetIdSelf(), name, sizeof(name));
+    if (strncmp(name, "scanOnce", 8) != 0)
+        return;
+    strcpy(onceThreadName, name);
+    if (!epicsAtomicCmpAndSwapIntT(&gateBlocked, 0, 1)) {
+        epicsEventMustTrigger(waiter);
+        epicsEventMustWait(gate);
+    }
+}
+
+static void onceOrder(void *usr, dbCommon *prec)
+{
+    int n = epicsAtomicIncrIntT(&nOrder);
+
+    if (n <= NORDER)
+        order[n - 1] = (size_t)usr;
+    if (n == NORDER / 2)
+        epicsEventMustTrigger(waiter);
+}
+
+static void testOnceThreads(void)
+{
+    scanOnceQueueStats stats;
+    xRecord *per5, *per6;
+    int i, nFailed = 0, overflows;
+
+    testDiag("check scanOnce() on several threads with a bounded queue");
+
+    testOk1(scanOnceSetThreads(2) == 0);
+    scanOnceSetQueueSize(NORDER / 2);
+    waiter = epicsEventMustCreate(epicsEventEmpty);
+    gate = epicsEventMustCreate(epicsEventEmpty);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbScanTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testOk1(scanOnceSetThreads(1) == -1);
+    testOk1(scanOnceQueueStatus(0, &stats) == 0);
+    testOk(stats.size == NORDER, "queue size %d", stats.size);
+    overflows = stats.numOverflow;
+
+    per5 = (xRecord *)testdbRecordPtr("per5");
+    per6 = (xRecord *)testdbRecordPtr("per6");
+    testOk1(dbLockGetLockId((dbCommon *)per5) ==
+        dbLockGetLockId((dbCommon *)per6));
+    dbScanLock((dbCommon *)per5);
+    per5->clbk = gateProcess;
+    dbScanUnlock((dbCommon *)per5);
+
+    /* Block the thread of the per5 and per6 lock set */
+    scanOnce((dbCommon *)per5);
+    epicsEventMustWait(waiter);
+
+    for (i = 0; i < NORDER; i++) {
+        if (scanOnceCallback((dbCommon *)per6, onceOrder, (void *)(size_t)i))
+            nFailed++;
+    }
+    testOk(nFailed == NORDER / 2, "%d of %d requests failed", nFailed, NORDER);
+    testOk1(scanOnceQueueStatus(0, &stats) == 0);
+    testOk(stats.numUsed == NORDER / 2 &&
+        stats.numOverflow - overflows == NORDER / 2,
+        "%d queued, %d overflows", stats.numUsed,
+        stats.numOverflow - overflows);
+
+    epicsEventMustTrigger(gate);
+    epicsEventMustWait(waiter);
+    for (i = 1; i < NORDER / 2; i++) {
+        if (order[i] != (size_t)i)
+            break;
+    }
+    testOk(i == NORDER / 2, "requests processed in order");
+    testOk(strncmp(onceThreadName, "scanOnce-", 9) == 0, "processed by %s",
+        onceThreadName);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+    scanOnceSetThreads(1);
+    scanOnceSetQueueSize(1000);
+    epicsEventDestroy(gate);
+    epicsEventDestroy(waiter);
+}
+
 MAIN(dbScanTest)
 {
-    testPlan(3);
+    testPlan(44);
     testOnce();
+    testPartitioned();
+    testTiming();
+    testOnceLatency();
+    testOnceThreads();
     return testDone();
 }
@@ -0,0 +1,138 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Channel Access reads of scalar VAL fields from read snapshots */
+
+#include <string.h>
+
+#include "epicsEvent.h"
+#include "epicsThread.h"
+#include "errlog.h"
+#include "db_access.h"
+#include "db_access_routines.h"
+#include "dbChannel.h"
+#include "dbLock.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+#include "xRecord.h"
+
+/* From dbAccessDefs.h, whose DBR_ codes clash with db_access.h */
+DBCORE_API extern int dbReadSnapshots;
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+typedef struct {
+    dbChannel *chan;
+    int type;
+    union {
+        struct dbr_time_long tl;
+        struct dbr_time_double td;
+        struct dbr_sts_double sd;
+        char s[MAX_STRING_SIZE];
+    } buf;
+    int status;
+    epicsEventId done;
+} reader;
+
+static void readerThread(void *raw)
+{
+    reader *prd = raw;
+
+    prd->status = dbChannel_get(prd->chan, prd->type, &prd->buf, 1, NULL);
+    epicsEventMustTrigger(prd->done);
+}
+
+/* Read from another thread, returns 1 if that finished in time */
+static int readOther(reader *prd, int type, double timeout)
+{
+    memset(&prd->buf, 0, sizeof(prd->buf));
+    prd->type = type;
+    prd->status = -2;
+    epicsThreadMustCreate("snapReader", epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackSmall), &readerThread, prd);
+    return epicsEventWaitWithTimeout(prd->done, timeout) == epicsEventOK;
+}
+
+MAIN(dbSnapshotTest)
+{
+    reader rd;
+    xRecord *prec;
+    dbCommon *parr;
+    epicsTimeStamp stamp;
+
+    testPlan(21);
+
+    rd.done = epicsEventMustCreate(epicsEventEmpty);
+
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbSnapshotTest.db", NULL, NULL);
+
+    dbReadSnapshots = 1;
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    prec = (xRecord *)testdbRecordPtr("x");
+    parr = testdbRecordPtr("arr");
+    testOk(prec->snap != NULL, "scalar VAL has a snapshot");
+    testOk(parr->snap == NULL, "array VAL has no snapshot");
+
+    rd.chan = dbChannel_create("x.VAL");
+    testOk1(rd.chan != NULL);
+
+    testDiag("Puts and processing update the snapshot");
+    testdbPutFieldOk("x.VAL", DBR_STRING, "42");
+    testdbPutFieldOk("x.PROC", DBR_STRING, "1");
+    stamp = prec->time;
+
+    testDiag("Reads of the snapshot don't wait for the lock");
+    dbScanLock((dbCommon *)prec);
+    prec->val = 7;
+
+    testOk(readOther(&rd, DBR_TIME_LONG, 5.0), "DBR_TIME_LONG read finished");
+    testOk(rd.status == 0, "status %d", rd.status);
+    testOk(rd.buf.tl.value == 42, "value %d", (int)rd.buf.tl.value);
+    testOk(rd.buf.tl.stamp.secPastEpoch == stamp.secPastEpoch &&
+        rd.buf.tl.stamp.nsec == stamp.nsec, "time stamp of processing");
+
+    testOk(readOther(&rd, DBR_TIME_DOUBLE, 5.0), "DBR_TIME_DOUBLE read finished");
+    testOk(rd.buf.td.value == 42.0, "value %g", rd.buf.td.value);
+
+    testOk(readOther(&rd, DBR_STS_DOUBLE, 5.0), "DBR_STS_DOUBLE read finished");
+    testOk(rd.buf.sd.severity == prec->sevr && rd.buf.sd.status == prec->stat,
+        "alarm %d %d", rd.buf.sd.status, rd.buf.sd.severity);
+
+    testDiag("Strings are converted with the lock held");
+    testOk(!readOther(&rd, DBR_STRING, 0.1), "DBR_STRING read waits");
+    prec->val = 42;
+    dbScanUnlock((dbCommon *)prec);
+    epicsEventMustWait(rd.done);
+    testOk(rd.status == 0 && strcmp(rd.buf.s, "42") == 0,
+        "value \"%s\"", rd.buf.s);
+
+    testDiag("A record that was changed but not processed");
+    testdbPutFieldOk("x.VAL", DBR_STRING, "-5");
+    testOk(readOther(&rd, DBR_TIME_LONG, 5.0), "DBR_TIME_LONG read finished");
+    testOk(rd.buf.tl.value == -5, "value %d", (int)rd.buf.tl.value);
+
+    testdbPutFieldOk("x.PROC", DBR_STRING, "1");
+    testOk(readOther(&rd, DBR_TIME_LONG, 5.0), "DBR_TIME_LONG read finished");
+    testOk(rd.buf.tl.stamp.secPastEpoch == prec->time.secPastEpoch &&
+        rd.buf.tl.stamp.nsec == prec->time.nsec, "new time stamp");
+
+    dbChannelDelete(rd.chan);
+
+    testIocShutdownOk();
+    testdbCleanup();
+    dbReadSnapshots = 0;
+
+    epicsEventDestroy(rd.done);
+
+    return testDone();
+}
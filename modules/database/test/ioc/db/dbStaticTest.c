@@ -14,6 +14,10 @@
 #include <dbUnitTest.h>
 #include <testMain.h>
 #include <epicsString.h>
+#include <epicsStdio.h>
+#include <epicsAtomic.h>
+#include <epicsEvent.h>
+#include <epicsThread.h>
 
 
 static void testEntryRemoved(const char *pv)
@@ -335,13 +339,172 @@ static void testWrongAliasRecord(const char *filename)
 
 void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
 
+static void testPvdFilter(void)
+{
+    DBENTRY entry;
+    dbPvdFilterInfo before, after;
+    char name[32];
+    unsigned i, nfound = 0, ncreated = 0;
+    const unsigned nrecs = 5000;
+
+    testDiag("testPvdFilter()");
+
+    dbInitEntry(pdbbase, &entry);
+
+    dbPvdFilterStats(pdbbase, &before);
+    testOk1(dbFindRecord(&entry, "no:such:record")==S_dbLib_recNotFound);
+    dbPvdFilterStats(pdbbase, &after);
+    testOk(after.rejected == before.rejected && after.passed == before.passed,
+           "Lookups not counted by default");
+
+    dbPvdCountLookups = 1;
+    testOk1(dbFindRecord(&entry, "no:such:record")==S_dbLib_recNotFound);
+    dbPvdFilterStats(pdbbase, &after);
+    testOk(after.rejected + after.falsePositive ==
+           before.rejected + before.falsePositive + 1,
+           "Miss counted (%lu rejected, %lu false positive)",
+           (unsigned long)after.rejected, (unsigned long)after.falsePositive);
+
+    /* more than the initial filter holds, forcing a rebuild */
+    if (dbFindRecordType(&entry, "x"))
+        testAbort("No record type x");
+    for (i = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "filt:%u", i);
+        if (!dbCreateRecord(&entry, name))
+            ncreated++;
+    }
+    testOk(ncreated == nrecs, "Created %u records", ncreated);
+
+    dbPvdFilterStats(pdbbase, &after);
+    testOk(after.bits > before.bits, "Filter grew from %lu to %lu bits",
+           (unsigned long)before.bits, (unsigned long)after.bits);
+
+    for (i = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "filt:%u.VAL", i);
+        if (!dbFindRecord(&entry, name))
+            nfound++;
+    }
+    testOk(nfound == nrecs, "Found %u of %u records", nfound, nrecs);
+
+    dbPvdFilterStats(pdbbase, &before);
+    for (i = 0, nfound = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "nofilt:%u.VAL", i);
+        if (!dbFindRecord(&entry, name))
+            nfound++;
+    }
+    dbPvdFilterStats(pdbbase, &after);
+    testOk(nfound == 0, "Found %u missing records", nfound);
+    testOk(after.rejected - before.rejected > nrecs * 95 / 100,
+           "Filter rejected %lu of %u misses",
+           (unsigned long)(after.rejected - before.rejected), nrecs);
+
+    for (i = 0, nfound = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "filt:%u", i);
+        if (!dbFindRecord(&entry, name) && dbDeleteRecord(&entry) <= 1)
+            nfound++;
+    }
+    testOk(nfound == nrecs, "Deleted %u records", nfound);
+
+    for (i = 0, nfound = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "filt:%u", i);
+        if (!dbFindRecord(&entry, name))
+            nfound++;
+    }
+    testOk(nfound == 0, "Found %u deleted records", nfound);
+
+    dbPvdCountLookups = 0;
+    dbFinishEntry(&entry);
+}
+
+typedef struct {
+    int stop;
+    unsigned lookups;
+    unsigned failed;
+    epicsEventId done;
+} pvdReader;
+
+static void pvdReaderThread(void *arg)
+{
+    pvdReader *preader = arg;
+    DBENTRY entry;
+
+    dbInitEntry(pdbbase, &entry);
+    while (!epicsAtomicGetIntT(&preader->stop)) {
+        if (dbFindRecord(&entry, "grow:0"))
+            preader->failed++;
+        preader->lookups++;
+    }
+    dbFinishEntry(&entry);
+    epicsEventMustTrigger(preader->done);
+}
+
+/* The directory grows while another thread looks up a record */
+static void testPvdGrow(void)
+{
+    DBENTRY entry;
+    pvdReader reader;
+    char name[32];
+    unsigned i, nfound = 0, ncreated = 0;
+    const unsigned nrecs = 20000;
+
+    testDiag("testPvdGrow()");
+
+    dbInitEntry(pdbbase, &entry);
+    if (dbFindRecordType(&entry, "x") || dbCreateRecord(&entry, "grow:0"))
+        testAbort("Can't create grow:0");
+
+    memset(&reader, 0, sizeof(reader));
+    reader.done = epicsEventMustCreate(epicsEventEmpty);
+    epicsThreadMustCreate("pvdReader", epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackSmall),
+        pvdReaderThread, &reader);
+
+    for (i = 1; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "grow:%u", i);
+        if (!dbFindRecordType(&entry, "x") && !dbCreateRecord(&entry, name))
+            ncreated++;
+        if (!(i % 1000))
+            epicsThreadSleep(0.0);
+    }
+    testOk(ncreated == nrecs - 1, "Created %u records", ncreated);
+
+    for (i = 1; i < nrecs; i += 2) {
+        epicsSnprintf(name, sizeof(name), "grow:%u", i);
+        if (!dbFindRecord(&entry, name) && dbDeleteRecord(&entry) <= 1)
+            nfound++;
+    }
+    testOk(nfound == nrecs / 2, "Deleted %u records", nfound);
+
+    epicsAtomicSetIntT(&reader.stop, 1);
+    epicsEventMustWait(reader.done);
+    epicsEventDestroy(reader.done);
+    testOk(reader.failed == 0, "Concurrent lookups failed %u times in %u",
+           reader.failed, reader.lookups);
+
+    for (i = 0, nfound = 0; i < nrecs; i++) {
+        epicsSnprintf(name, sizeof(name), "grow:%u", i);
+        if (!dbFindRecord(&entry, name))
+            nfound++;
+    }
+    testOk(nfound == nrecs / 2, "Found %u remaining records", nfound);
+
+    for (i = 0, nfound = 0; i < nrecs; i += 2) {
+        epicsSnprintf(name, sizeof(name), "grow:%u", i);
+        if (!dbFindRecord(&entry, name) && dbDeleteRecord(&entry) <= 1)
+            nfound++;
+    }
+    testOk(nfound == nrecs / 2, "Deleted %u more records", nfound);
+
+    dbFinishEntry(&entry);
+}
+
 MAIN(dbStaticTest)
 {
     const char *ldir;
     char *ldirDup;
     FILE *fp = NULL;
 
-    testPlan(340);
+    testPlan(357);
     testdbPrepare();
 
     testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
@@ -401,6 +564,10 @@ MAIN(dbStaticTest)
     testEntryRemoved("testdelrec8");
     testEntryRemoved("testdelrec11");
 
+    testPvdFilter();
+    testPvdGrow();
+    testEntryPresent("testdelrec");
+
     eltc(0);
     testIocInitOk();
     eltc(1);
@@ -25,10 +25,14 @@ int dbServerTest(void);
 int dbCaStatsTest(void);
 int dbShutdownTest(void);
 int dbScanTest(void);
+int dbEventTest(void);
 int scanIoTest(void);
+int dbSnapshotTest(void);
 int dbLockTest(void);
+int iocInitParallelTest(void);
 int dbPutLinkTest(void);
 int dbStaticTest(void);
+int dbCacheTest(void);
 int dbCaLinkTest(void);
 int dbDbLinkTest(void);
 int testDbChannel(void);
@@ -48,10 +52,14 @@ void epicsRunDbTests(void)
     runTest(dbCaStatsTest);
     runTest(dbShutdownTest);
     runTest(dbScanTest);
+    runTest(dbEventTest);
     runTest(scanIoTest);
+    runTest(dbSnapshotTest);
     runTest(dbLockTest);
+    runTest(iocInitParallelTest);
     runTest(dbPutLinkTest);
     runTest(dbStaticTest);
+    runTest(dbCacheTest);
     runTest(dbCaLinkTest);
     runTest(dbDbLinkTest);
     runTest(testDbChannel);
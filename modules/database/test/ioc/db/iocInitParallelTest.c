@@ -0,0 +1,103 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Record initialization on several threads, see iocInitParallel() */
+
+#include "dbAccess.h"
+#include "dbLock.h"
+#include "dbUnitTest.h"
+#include "epicsStdio.h"
+#include "errlog.h"
+#include "iocInit.h"
+#include "testMain.h"
+
+#include "xRecord.h"
+#include "devx.h"
+
+#define NSETS 8
+#define NMEMBERS 6
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+/* The "Scan I/O" device support appends each record to the list of its
+ * driver in pass 1, so that list shows the order they were initialized.
+ */
+static void testOrder(int group)
+{
+    xdrv *drv = xdrv_get(group);
+    ELLNODE *cur;
+    int n = 0, inOrder = 1;
+
+    for (cur = ellFirst(&drv->privlist); cur; cur = ellNext(cur)) {
+        xpriv *priv = CONTAINER(cur, xpriv, privnode);
+
+        inOrder &= priv->member == n++;
+    }
+    testOk(inOrder && n == NMEMBERS,
+        "Lock set %d: %d records initialized in order", group, n);
+}
+
+static void testLockSets(void)
+{
+    unsigned long first[NSETS];
+    int g, m, ok = 1;
+
+    for (g = 0; g < NSETS; g++) {
+        for (m = 0; m < NMEMBERS; m++) {
+            char name[16];
+            unsigned long id;
+
+            epicsSnprintf(name, sizeof(name), "m%dg%d", m, g);
+            id = dbLockGetLockId(testdbRecordPtr(name));
+            if (!m)
+                first[g] = id;
+            ok &= id == first[g];
+        }
+        for (m = 0; m < g; m++)
+            ok &= first[m] != first[g];
+    }
+    testOk(ok, "%d lock sets of %d records", NSETS, NMEMBERS);
+}
+
+MAIN(iocInitParallelTest)
+{
+    int g;
+
+    testPlan(NSETS + 4);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("iocInitParallelTest.db", NULL, NULL);
+
+    for (g = 0; g < NSETS; g++)
+        xdrv_add(g, NULL, NULL);
+
+    testOk1(iocInitParallel(4, "arr, x")==0);
+    iocInitTiming = 1;
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    iocInitTiming = 0;
+    testOk1(iocInitParallel(2, "x")==-1);
+
+    testLockSets();
+    for (g = 0; g < NSETS; g++)
+        testOrder(g);
+
+    testIocShutdownOk();
+
+    testOk1(iocInitParallel(0, NULL)==0);
+
+    testdbCleanup();
+
+    xdrv_reset();
+
+    return testDone();
+}
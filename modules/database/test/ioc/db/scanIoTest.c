@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMessageQueue.h"
 #include "epicsPrint.h"
@@ -296,14 +297,101 @@ static void testMultiThreading(void)
     }
 }
 
+typedef struct {
+    int nprocd;
+    int ncomplete;
+    epicsEventId wait;
+    epicsEventId wake;
+} testcoalesce;
+
+static void testcbcoalesce(xpriv *priv, void *raw)
+{
+    testcoalesce *td = raw;
+
+    epicsAtomicIncrIntT(&td->nprocd);
+}
+
+static void testcompcoalesce(void *raw, IOSCANPVT scan, int prio)
+{
+    testcoalesce *td = raw;
+
+    epicsEventMustTrigger(td->wait);
+    if (epicsAtomicIncrIntT(&td->ncomplete) == 1)
+        epicsEventMustWait(td->wake);
+}
+
+static void testCoalesce(void)
+{
+    testcoalesce data;
+    xdrv *drv;
+    unsigned int queued = 0;
+    int i;
+
+    memset(&data, 0, sizeof(data));
+    data.wait = epicsEventMustCreate(epicsEventEmpty);
+    data.wake = epicsEventMustCreate(epicsEventEmpty);
+
+    testDiag("Test coalescing of I/O Intr scan requests");
+
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    loadRecord(0, 0, "LOW");
+
+    drv = xdrv_add(0, &testcbcoalesce, &data);
+    scanIoSetComplete(drv->scan, &testcompcoalesce, &data);
+    scanIoSetCoalesce(drv->scan, 1);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testDiag("Block the first scan in its completion callback");
+    testOk1(scanIoRequest(drv->scan)==0x1);
+    epicsEventMustWait(data.wait);
+
+    for(i=0; i<10; i++)
+        queued |= scanIoRequest(drv->scan);
+    testOk(queued==0, "requests while running don't queue (0x%x)", queued);
+    testOk(epicsAtomicGetIntT(&data.nprocd)==1, "processed %d times",
+        epicsAtomicGetIntT(&data.nprocd));
+
+    testDiag("Release it, the requests are served by one more scan");
+    epicsEventMustTrigger(data.wake);
+    epicsEventMustWait(data.wait);
+    testSyncCallback();
+    testOk(epicsAtomicGetIntT(&data.nprocd)==2, "processed %d times",
+        epicsAtomicGetIntT(&data.nprocd));
+    testOk(epicsAtomicGetIntT(&data.ncomplete)==2, "completed %d times",
+        epicsAtomicGetIntT(&data.ncomplete));
+
+    testDiag("Idle again, the next request queues a scan");
+    testOk1(scanIoRequest(drv->scan)==0x1);
+    epicsEventMustWait(data.wait);
+    testSyncCallback();
+    testOk(epicsAtomicGetIntT(&data.ncomplete)==3, "completed %d times",
+        epicsAtomicGetIntT(&data.ncomplete));
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    xdrv_reset();
+
+    epicsEventDestroy(data.wake);
+    epicsEventDestroy(data.wait);
+}
+
 MAIN(scanIoTest)
 {
-    testPlan(152);
+    testPlan(159);
     testSingleThreading();
     testDiag("run a second time to verify shutdown and restart works");
     testSingleThreading();
     testMultiThreading();
     testDiag("run a second time to verify shutdown and restart works");
     testMultiThreading();
+    testCoalesce();
     return testDone();
 }
@@ -38,6 +38,8 @@
 #include "iocInit.h"
 #include "iocsh.h"
 #include "dbChannel.h"
+#include "dbEvent.h"
+#include "dbLock.h"
 #include "epicsUnitTest.h"
 #include "dbUnitTest.h"
 #include "testMain.h"
@@ -293,13 +295,110 @@ static void check(short dbr_type) {
     TEST5B(3, -8, -4, "both sides from-end");
 }
 
+struct snapUpdate {
+    int n;
+    long no_elements;
+    const void *field;
+    epicsInt32 value[10];
+};
+
+extern "C" {
+static void snapWakeup(void *) {}
+
+static void snapCallback(void *arg, struct dbChannel *chan,
+                         int eventsRemaining, struct db_field_log *pfl)
+{
+    snapUpdate *pu = (snapUpdate *) arg;
+
+    pu->n++;
+    pu->no_elements = pfl->no_elements;
+    pu->field = pfl->u.r.field;
+    for (long i = 0; i < pfl->no_elements && i < 10; i++)
+        pu->value[i] = ((epicsInt32 *) pfl->u.r.field)[i];
+}
+}
+
+static void checkSnapshot(void)
+{
+    dbEventCtx ctx;
+    dbChannel *pch1, *pch2;
+    dbEventSubscription sub1, sub2;
+    snapUpdate u1, u2;
+    dbArraySnapshot *psnap;
+    epicsInt32 *data;
+    epicsInt32 ar5_2_1[5] = {12,13,14,15,16};
+    epicsInt32 ar5_2_2[3] = {12,14,16};
+
+    testHead("Five long elements from a shared snapshot");
+
+    memset(&u1, 0, sizeof(u1));
+    memset(&u2, 0, sizeof(u2));
+
+    ctx = db_init_events();
+    if (!ctx || db_start_events_external(ctx, snapWakeup, NULL) != DB_EVENT_OK)
+        testAbort("Can't start event context");
+
+    testOk(!!(pch1 = dbChannelCreate("x.VAL{arr:{s:2,e:6}}")) &&
+           !dbChannelOpen(pch1), "channel with increment 1 opened");
+    testOk(!!(pch2 = dbChannelCreate("x.VAL{arr:{s:2,e:6,i:2}}")) &&
+           !dbChannelOpen(pch2), "channel with increment 2 opened");
+    if (!pch1 || !pch2)
+        testAbort("Can't create channels");
+
+    sub1 = db_add_event(ctx, pch1, snapCallback, &u1, DBE_VALUE);
+    if (!sub1)
+        testAbort("db_add_event() failed");
+    db_event_enable(sub1);
+    dbScanLock(dbChannelRecord(pch1));
+    testOk(db_array_snapshot_wanted(dbChannelRecord(pch1),
+        dbChannelField(pch1), DBE_VALUE),
+        "snapshot for one subscriber with a filter");
+    dbScanUnlock(dbChannelRecord(pch1));
+    sub2 = db_add_event(ctx, pch2, snapCallback, &u2, DBE_VALUE);
+    if (!sub2)
+        testAbort("db_add_event() failed");
+    db_event_enable(sub2);
+
+    psnap = db_create_array_snapshot(DBF_LONG, sizeof(epicsInt32), 10);
+    if (!psnap)
+        testAbort("db_create_array_snapshot() failed");
+    data = (epicsInt32 *) db_array_snapshot_data(psnap);
+    for (int i = 0; i < 10; i++)
+        data[i] = 10 + i;
+
+    dbScanLock(dbChannelRecord(pch1));
+    db_post_array_snapshot(dbChannelRecord(pch1), dbChannelField(pch1),
+        DBE_VALUE, psnap);
+    dbScanUnlock(dbChannelRecord(pch1));
+
+    testOk1(db_process_events(ctx) == DB_EVENT_OK);
+
+    testOk(u1.n == 1 && u1.no_elements == 5, "increment 1: %d update, %ld elements",
+           u1.n, u1.no_elements);
+    testOk(u1.field == data + 2, "increment 1 shares the snapshot data");
+    testOk(!memcmp(u1.value, ar5_2_1, sizeof(ar5_2_1)), "increment 1 data correct");
+
+    testOk(u2.n == 1 && u2.no_elements == 3, "increment 2: %d update, %ld elements",
+           u2.n, u2.no_elements);
+    testOk(u2.field < (void *) data || u2.field >= (void *) (data + 10),
+           "increment 2 copies the data");
+    testOk(!memcmp(u2.value, ar5_2_2, sizeof(ar5_2_2)), "increment 2 data correct");
+
+    db_release_array_snapshot(psnap);
+    db_cancel_event(sub1);
+    db_cancel_event(sub2);
+    db_close_events(ctx);
+    dbChannelDelete(pch1);
+    dbChannelDelete(pch2);
+}
+
 MAIN(arrTest)
 {
     dbEventCtx evtctx;
     const chFilterPlugin *plug;
     char arr[] = "arr";
 
-    testPlan(1402);
+    testPlan(1412);
 
     /* Prepare the IOC */
 
@@ -329,6 +428,7 @@ MAIN(arrTest)
     check(DBR_LONG);
     check(DBR_DOUBLE);
     check(DBR_STRING);
+    checkSnapshot();
 
     db_close_events(evtctx);
 
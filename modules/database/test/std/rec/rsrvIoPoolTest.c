@@ -0,0 +1,383 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Circuits served by one RSRV I/O thread (EPICS_CAS_IO_THREADS)
+ * don't wait for a put callback of another circuit, or for a client
+ * which stops reading its replies.
+ *
+ * A CA client in the IOC would reach the records directly, so the test
+ * talks to the server with the CA protocol over its own sockets.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbAccess.h"
+#include "dbServer.h"
+#include "dbUnitTest.h"
+#include "envDefs.h"
+#include "epicsStdio.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "errlog.h"
+#include "osiSock.h"
+#include "caProto.h"
+#include "caerr.h"
+#include "rsrv.h"
+#include "testMain.h"
+
+#define SERVER_PORT 65533
+#define MINOR_VERSION 13
+#define DBR_DOUBLE_TYPE 6
+#define BIG_COUNT 100000
+#define BIG_READS 16
+
+void recTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static void sendMsg(SOCKET sock, unsigned cmd, unsigned type, unsigned count,
+    unsigned cid, unsigned avail, const void *payload, unsigned size)
+{
+    char buf[sizeof(caHdr) + 48];
+    caHdr *hdr = (caHdr *) buf;
+    unsigned postsize = (size + 7u) & ~7u;
+
+    memset(buf, 0, sizeof(buf));
+    hdr->m_cmmd = htons(cmd);
+    hdr->m_postsize = htons(postsize);
+    hdr->m_dataType = htons(type);
+    hdr->m_count = htons(count);
+    hdr->m_cid = htonl(cid);
+    hdr->m_available = htonl(avail);
+    if (size)
+        memcpy(hdr + 1, payload, size);
+    send(sock, buf, (int) (sizeof(*hdr) + postsize), 0);
+}
+
+static int recvAll(SOCKET sock, char *buf, unsigned size)
+{
+    while (size) {
+        int n = recv(sock, buf, (int) size, 0);
+
+        if (n <= 0)
+            return -1;
+        buf += n;
+        size -= (unsigned) n;
+    }
+    return 0;
+}
+
+/* Wait for a reply with the command given, skipping others.  The count
+ * of a channel to a large array is in an extended header.
+ */
+static int recvMsg(SOCKET sock, unsigned cmd, caHdr *hdr, char *payload)
+{
+    while (1) {
+        char skip[64];
+        epicsUInt32 ext[2];
+
+        if (recvAll(sock, (char *) hdr, sizeof(*hdr)))
+            return -1;
+        hdr->m_cmmd = ntohs(hdr->m_cmmd);
+        hdr->m_postsize = ntohs(hdr->m_postsize);
+        hdr->m_dataType = ntohs(hdr->m_dataType);
+        hdr->m_count = ntohs(hdr->m_count);
+        hdr->m_cid = ntohl(hdr->m_cid);
+        hdr->m_available = ntohl(hdr->m_available);
+        if (hdr->m_postsize == 0xffff) {
+            if (recvAll(sock, (char *) ext, sizeof(ext)) ||
+                ntohl(ext[0]) > sizeof(skip))
+                return -1;
+            hdr->m_postsize = (ca_uint16_t) ntohl(ext[0]);
+        }
+        if (hdr->m_postsize > sizeof(skip) ||
+            recvAll(sock, payload ? payload : skip, hdr->m_postsize))
+            return -1;
+        if (hdr->m_cmmd == cmd)
+            return 0;
+    }
+}
+
+static void putDouble(char *buf, double value)
+{
+    epicsUInt64 bits;
+    int i;
+
+    memcpy(&bits, &value, sizeof(bits));
+    for (i = 7; i >= 0; i--, bits >>= 8)
+        buf[i] = (char) (bits & 0xff);
+}
+
+static double getDouble(const char *buf)
+{
+    epicsUInt64 bits = 0;
+    double value;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        bits = (bits << 8) | (unsigned char) buf[i];
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* Receive a reply which may have a large array, returns its payload size */
+static long recvArray(SOCKET sock, caHdr *hdr)
+{
+    char chunk[4096];
+    epicsUInt32 ext[2];
+    unsigned long size, left;
+
+    if (recvAll(sock, (char *) hdr, sizeof(*hdr)))
+        return -1;
+    size = ntohs(hdr->m_postsize);
+    if (size == 0xffff) {
+        if (recvAll(sock, (char *) ext, sizeof(ext)))
+            return -1;
+        size = ntohl(ext[0]);
+    }
+    hdr->m_cmmd = ntohs(hdr->m_cmmd);
+    hdr->m_cid = ntohl(hdr->m_cid);
+    hdr->m_available = ntohl(hdr->m_available);
+    for (left = size; left; ) {
+        unsigned n = left < sizeof(chunk) ? (unsigned) left : sizeof(chunk);
+
+        if (recvAll(sock, chunk, n))
+            return -1;
+        left -= n;
+    }
+    return (long) size;
+}
+
+/* Open a circuit and a channel on it, returns the server's channel id.
+ * A non-zero rcvBuf limits the socket's receive buffer.
+ */
+static SOCKET openCircuit(const char *name, unsigned *psid, int rcvBuf)
+{
+    osiSockAddr addr;
+    SOCKET sock;
+    caHdr hdr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.ia.sin_family = AF_INET;
+    addr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.ia.sin_port = htons(SERVER_PORT);
+
+    sock = epicsSocketCreate(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET)
+        return sock;
+    if (rcvBuf)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char *) &rcvBuf,
+            sizeof(rcvBuf));
+    if (connect(sock, &addr.sa, sizeof(addr.ia))) {
+        epicsSocketDestroy(sock);
+        return INVALID_SOCKET;
+    }
+
+    sendMsg(sock, CA_PROTO_VERSION, 0, MINOR_VERSION, 0, 0, NULL, 0);
+    sendMsg(sock, CA_PROTO_CLIENT_NAME, 0, 0, 0, 0, "test", 5);
+    sendMsg(sock, CA_PROTO_HOST_NAME, 0, 0, 0, 0, "localhost", 10);
+    sendMsg(sock, CA_PROTO_CREATE_CHAN, 0, 0, 1, MINOR_VERSION,
+        name, (unsigned) strlen(name) + 1);
+    if (recvMsg(sock, CA_PROTO_CREATE_CHAN, &hdr, NULL)) {
+        epicsSocketDestroy(sock);
+        return INVALID_SOCKET;
+    }
+    *psid = hdr.m_available;
+    return sock;
+}
+
+typedef struct {
+    epicsTimeStamp start;
+    int ok;
+    double value;
+    double seconds;
+} otherClient;
+
+/* Connect a second circuit and read a value with it */
+static void otherGet(void *arg)
+{
+    otherClient *pother = arg;
+    epicsTimeStamp end;
+    char payload[8];
+    unsigned sid;
+    SOCKET sock;
+    caHdr hdr;
+
+    sock = openCircuit("fast", &sid, 0);
+    if (sock != INVALID_SOCKET) {
+        sendMsg(sock, CA_PROTO_READ_NOTIFY, DBR_DOUBLE_TYPE, 1, sid, 7,
+            NULL, 0);
+        pother->ok = !recvMsg(sock, CA_PROTO_READ_NOTIFY, &hdr, payload) &&
+            hdr.m_available == 7 && hdr.m_cid == ECA_NORMAL;
+        if (pother->ok)
+            pother->value = getDouble(payload);
+        epicsSocketDestroy(sock);
+    }
+    epicsTimeGetCurrent(&end);
+    pother->seconds = epicsTimeDiffInSeconds(&end, &pother->start);
+}
+
+static void testSlowPut(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    otherClient other;
+    char value[8];
+    unsigned sid;
+    SOCKET sock;
+    caHdr hdr;
+
+    testDiag("Two put callbacks for one channel, and another circuit");
+
+    sock = openCircuit("slow.A", &sid, 0);
+    testOk(sock != INVALID_SOCKET, "Connected to slow.A");
+    if (sock == INVALID_SOCKET) {
+        testSkip(6, "No circuit");
+        return;
+    }
+
+    /* The second waits until the first completes. A blocked worker also
+     * keeps this thread from running, so time the other circuit from here.
+     */
+    memset(&other, 0, sizeof(other));
+    epicsTimeGetCurrent(&other.start);
+    putDouble(value, 1.0);
+    sendMsg(sock, CA_PROTO_WRITE_NOTIFY, DBR_DOUBLE_TYPE, 1, sid, 1,
+        value, sizeof(value));
+    putDouble(value, 2.0);
+    sendMsg(sock, CA_PROTO_WRITE_NOTIFY, DBR_DOUBLE_TYPE, 1, sid, 2,
+        value, sizeof(value));
+    epicsThreadSleep(0.5);
+
+    opts.joinable = 1;
+    epicsThreadMustJoin(epicsThreadCreateOpt("otherClient", otherGet,
+        &other, &opts));
+    testOk(other.ok && other.value == 42.0, "Other circuit read %g",
+        other.value);
+    testOk(other.seconds < 1.5,
+        "Other circuit wasn't blocked by the put callback (%.3f sec)",
+        other.seconds);
+
+    testOk(!recvMsg(sock, CA_PROTO_WRITE_NOTIFY, &hdr, NULL) &&
+        hdr.m_available == 1 && hdr.m_cid == ECA_NORMAL,
+        "First put callback completed");
+    testOk(!recvMsg(sock, CA_PROTO_WRITE_NOTIFY, &hdr, NULL) &&
+        hdr.m_available == 2 && hdr.m_cid == ECA_NORMAL,
+        "Second put callback completed");
+    testdbGetFieldEqual("slow", DBR_DOUBLE, 2.0);
+
+    /* The circuit is read again after the parked request */
+    sendMsg(sock, CA_PROTO_READ_NOTIFY, DBR_DOUBLE_TYPE, 1, sid, 3, NULL, 0);
+    testOk(!recvMsg(sock, CA_PROTO_READ_NOTIFY, &hdr, value) &&
+        hdr.m_available == 3 && getDouble(value) == 2.0,
+        "Circuit serves requests again");
+
+    epicsSocketDestroy(sock);
+}
+
+static void testStalledClient(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    otherClient other;
+    unsigned sid, i, nOk = 0;
+    double *values = calloc(BIG_COUNT, sizeof(double));
+    SOCKET sock;
+
+    testDiag("A client which doesn't read %u replies of %u doubles",
+        BIG_READS, BIG_COUNT);
+
+    if (!values)
+        testAbort("No memory");
+    testdbPutArrFieldOk("big", DBR_DOUBLE, BIG_COUNT, values);
+    free(values);
+
+    sock = openCircuit("big", &sid, 4096);
+    testOk(sock != INVALID_SOCKET, "Connected to big");
+    if (sock == INVALID_SOCKET) {
+        testSkip(3, "No circuit");
+        return;
+    }
+
+    memset(&other, 0, sizeof(other));
+    for (i = 0; i < BIG_READS; i++)
+        sendMsg(sock, CA_PROTO_READ_NOTIFY, DBR_DOUBLE_TYPE, 0, sid, i,
+            NULL, 0);
+    epicsThreadSleep(0.5);
+
+    epicsTimeGetCurrent(&other.start);
+    opts.joinable = 1;
+    epicsThreadMustJoin(epicsThreadCreateOpt("otherClient", otherGet,
+        &other, &opts));
+    testOk(other.ok && other.value == 42.0, "Other circuit read %g",
+        other.value);
+    testOk(other.seconds < 1.5,
+        "Other circuit wasn't blocked by the full socket (%.3f sec)",
+        other.seconds);
+
+    for (i = 0; i < BIG_READS; i++) {
+        caHdr hdr;
+        long size = recvArray(sock, &hdr);
+
+        if (size < 0)
+            break;
+        if (hdr.m_cmmd == CA_PROTO_READ_NOTIFY && hdr.m_available == i &&
+                hdr.m_cid == ECA_NORMAL &&
+                size >= BIG_COUNT * (long) sizeof(double))
+            nOk++;
+    }
+    testOk(nOk == BIG_READS, "Received %u of %u replies in order", nOk,
+        BIG_READS);
+
+    epicsSocketDestroy(sock);
+}
+
+MAIN(rsrvIoPoolTest)
+{
+    char port[16];
+
+    testPlan(12);
+
+    epicsSnprintf(port, sizeof(port), "%d", SERVER_PORT);
+    epicsEnvSet("EPICS_CAS_IO_THREADS", "1");
+    epicsEnvSet("EPICS_CA_MAX_ARRAY_BYTES", "1000000");
+    epicsEnvSet("EPICS_CAS_SERVER_PORT", port);
+    epicsEnvSet("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1");
+    epicsEnvSet("EPICS_CAS_BEACON_ADDR_LIST", "127.0.0.1");
+    epicsEnvSet("EPICS_CAS_AUTO_BEACON_ADDR_LIST", "NO");
+
+    if (osiSockAttach() == 0)
+        testAbort("Can't use sockets");
+
+    testdbPrepare();
+
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    testdbReadDatabase("rsrvIoPoolTest.db", NULL, NULL);
+
+    rsrv_register_server();
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+    /* An isolated IOC doesn't start its servers */
+    dbInitServers();
+    dbRunServers();
+
+    testSlowPut();
+    testStalledClient();
+
+    /* let the server close the circuits while the records exist */
+    epicsThreadSleep(0.5);
+    dbPauseServers();
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    osiSockRelease();
+
+    return testDone();
+}
@@ -20,6 +20,8 @@
 
 void scanEventTest_registerRecordDeviceDriver(struct dbBase *);
 
+#define NMANY 3000
+
 /* test name to event number:
     num = 0 is no event,
     num > 0 is numeric event
@@ -61,10 +63,12 @@ MAIN(scanEventTest)
     int i, e;
     int aliases[512] ;
     int expected_count[512];
+    scanEventStats stats;
+    EVENTPVT info, many[NMANY];
     #define INDX(i) 256-events[i].num
     #define MAXEV 5
 
-    testPlan(NELEMENTS(events)*2+(MAXEV+1)*5);
+    testPlan(NELEMENTS(events)*2+(MAXEV+1)*5+7);
 
     testdbPrepare();
 
@@ -136,6 +140,40 @@ MAIN(scanEventTest)
         testdbGetFieldEqual(pvname, DBR_LONG, expected_count[INDX(i)]);
     }
 
+    testDiag("Check the counters of an event");
+    testOk1(scanEventStatus(NULL, 0, &stats) == -1);
+    info = eventNameToHandle("info 1");
+    testOk1(scanEventStatus(info, 0, &stats) == 0);
+    testOk(stats.posts == 2 && stats.dropped == 0, "%lu posts, %lu dropped",
+        (unsigned long)stats.posts, (unsigned long)stats.dropped);
+    testOk(stats.prio[0].runs == 2 && stats.prio[0].records == 4 &&
+        stats.prio[0].timeMean <= stats.prio[0].timeMax,
+        "%lu runs processed %lu records", stats.prio[0].runs,
+        stats.prio[0].records);
+    scanEventStatus(info, 1, NULL);
+    scanEventStatus(info, 0, &stats);
+    testOk(stats.posts == 0 && stats.prio[0].runs == 0,
+        "counters reset");
+
+    testDiag("Look up many named events");
+    for (i = 0; i < NMANY; i++) {
+        char name[20];
+        sprintf(name, "many %d", i);
+        many[i] = eventNameToHandle(name);
+    }
+    for (i = 0; i < NMANY; i++) {
+        char name[20];
+        sprintf(name, " many %d ", i);
+        if (!many[i] || eventNameToHandle(name) != many[i])
+            break;
+    }
+    testOk(i == NMANY, "%d events found again", i);
+    for (i = 1; i < NMANY; i++) {
+        if (many[i] == many[i - 1])
+            break;
+    }
+    testOk(i == NMANY, "events are distinct");
+
     testIocShutdownOk();
 
     testdbCleanup();
@@ -62,6 +62,8 @@ LIBCOM_API extern const ENV_PARAM EPICS_CAS_SERVER_PORT;
 LIBCOM_API extern const ENV_PARAM EPICS_CA_BEACON_PERIOD; /**< \brief deprecated */
 LIBCOM_API extern const ENV_PARAM EPICS_CAS_BEACON_PERIOD;
 LIBCOM_API extern const ENV_PARAM EPICS_CAS_BEACON_PORT;
+LIBCOM_API extern const ENV_PARAM EPICS_CAS_IO_THREADS;
+LIBCOM_API extern const ENV_PARAM EPICS_CAS_UDP_THREADS;
 LIBCOM_API extern const ENV_PARAM EPICS_BUILD_COMPILER_CLASS;
 LIBCOM_API extern const ENV_PARAM EPICS_BUILD_OS_CLASS;
 LIBCOM_API extern const ENV_PARAM EPICS_BUILD_TARGET_ARCH;
@@ -17,6 +17,8 @@
  * Describes routines to allocate and free fixed size memory elements.
  * Free elements are maintained on a free list rather than being returned to the heap via calls to free.
  * When it is necessary to call malloc(), memory is allocated in multiples of the element size.
+ * Each EPICS thread keeps a small cache of free elements for lists with a malloc count of 8
+ * or more, and exchanges them with the shared list in batches.
  */
 
 #ifndef INCfreeListh
@@ -37,6 +39,14 @@ LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt);
 LIBCOM_API void epicsStdCall freeListFree(void *pvt,void*pmem);
 LIBCOM_API void epicsStdCall freeListCleanup(void *pvt);
 LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt);
+/** \brief Print the usage of a free list.
+ *
+ * Shows how many elements were allocated, and how many are free on the
+ * shared list and in the caches of threads.  With level > 0 the cache of
+ * each thread is listed.
+ * \since 7.0.9
+ */
+LIBCOM_API void epicsStdCall freeListShow(void *pvt, unsigned level);
 
 #ifdef __cplusplus
 }
@@ -29,6 +29,10 @@
 #include "errlog.h"
 #include "epicsString.h"
 #include "epicsAtomic.h"
+#include "epicsThread.h"
+#include "epicsExit.h"
+#include "ellLib.h"
+#include "epicsStdio.h"
 #include "epicsExport.h"
 
 /* Bypass free list and directly call malloc() every time? */
@@ -41,19 +45,215 @@ int freeListBypass
 
 epicsExportAddress(int, freeListBypass);
 
+/* Each thread keeps a magazine of free blocks for every free list it
+ * uses, so most calls take no lock at all.  The list's own mutex is only
+ * taken to move a batch of blocks between the list and a magazine.  A
+ * magazine holds at most MAG_MAX blocks, or nmalloc if that is less.
+ * Lists with nmalloc below MAG_MIN_NMALLOC, typically of large buffers,
+ * don't use magazines, nor do lists created while MAG_SLOTS others exist.
+ *
+ * Each list has its own slot in every thread's magazines, which is only
+ * reused after freeListCleanup().  The magazines are allocated in pages
+ * of MAG_PAGE as a thread first uses a slot, and only the thread itself
+ * changes them.  freeListItemsAvail() and freeListShow() read the counts
+ * of other threads without stopping them, so they may be a little stale,
+ * and freeListCleanup() clears the magazines of its list, which no thread
+ * can be using any more.  Holding cacheListLock keeps threads from freeing
+ * their magazines meanwhile.  The locks are taken in the order
+ * cacheListLock, FREELISTPVT.lock.
+ *
+ * Only threads created by epicsThreadCreate() after the first free list
+ * get magazines: they are marked by a thread hook, and their magazines go
+ * back to the lists in an epicsAtThreadExit() routine, which other threads
+ * never run.
+ */
+#define MAG_PAGE 32
+#define MAG_SLOTS (64 * MAG_PAGE)
+#define MAG_MAX 64
+#define MAG_MIN_NMALLOC 8
+
 typedef struct allocMem {
     struct allocMem     *next;
     void                *memory;
 }allocMem;
-typedef struct {
+typedef struct FREELISTPVT {
     int         size;
     int         nmalloc;
     void        *head;
     allocMem    *mallochead;
     size_t      nBlocksAvailable;
     epicsMutexId lock;
+    int         slot;       /* of the magazines, -1 if they aren't used */
+    unsigned    magSize;
+    size_t      nchunks;    /* guarded by lock, as are the rest */
+    size_t      nrefill;    /* batches moved to magazines */
+    size_t      nflush;     /* batches moved back */
 }FREELISTPVT;
 
+typedef struct {
+    FREELISTPVT *pfl;       /* NULL if unused */
+    void        *head;
+    unsigned    count;
+    size_t      nops;       /* allocations and frees from this magazine */
+}magazine;
+
+typedef struct {
+    ELLNODE         node;
+    epicsThreadId   tid;
+    magazine        *pages[MAG_SLOTS / MAG_PAGE];
+}threadCache;
+
+static epicsThreadOnceId cacheOnce = EPICS_THREAD_ONCE_INIT;
+static epicsThreadPrivateId cacheKey;
+static epicsMutexId cacheListLock;
+static ELLLIST cacheList = ELLLIST_INIT;
+static char slotUsed[MAG_SLOTS];    /* guarded by cacheListLock */
+
+/* cacheKey of threads which may get a threadCache */
+static char cacheAllowed;
+
+static void cacheThreadHook(epicsThreadId id)
+{
+    epicsThreadPrivateSet(cacheKey, &cacheAllowed);
+}
+
+static void cacheInit(void *unused)
+{
+    cacheKey = epicsThreadPrivateCreate();
+    cacheListLock = epicsMutexMustCreate();
+    epicsThreadHookAdd(cacheThreadHook);
+}
+
+/* Magazine in slot of pcache, or NULL if its page isn't allocated */
+static magazine * magPeek(threadCache *pcache, int slot)
+{
+    magazine *page = epicsAtomicGetPtrT(
+        (EpicsAtomicPtrT *) &pcache->pages[slot / MAG_PAGE]);
+
+    return page ? &page[slot % MAG_PAGE] : NULL;
+}
+
+/* Called with pfl->lock held */
+static int listGrow(FREELISTPVT *pfl)
+{
+    void        *ptemp;
+    void        **ppnext;
+    allocMem    *pallocmem;
+    int         i;
+
+    /* layout of each block. nmalloc+1 REDZONEs for nmallocs.
+     * The first sizeof(void*) bytes are used to store a pointer
+     * to the next free block.
+     *
+     * | RED | size0 ------ | RED | size1 | ... | RED |
+     * |     | next | ----- |
+     */
+    ptemp = (void *)malloc(pfl->nmalloc*(pfl->size+REDZONE)+REDZONE);
+    if(ptemp==0)
+        return -1;
+    pallocmem = (allocMem *)calloc(1,sizeof(allocMem));
+    if(pallocmem==0) {
+        free(ptemp);
+        return -1;
+    }
+    pallocmem->memory = ptemp; /* real allocation */
+    ptemp = REDZONE + (char *) ptemp; /* skip first REDZONE */
+    if(pfl->mallochead)
+        pallocmem->next = pfl->mallochead;
+    pfl->mallochead = pallocmem;
+    for(i=0; i<pfl->nmalloc; i++) {
+        ppnext = ptemp;
+        VALGRIND_MEMPOOL_ALLOC(pfl, ptemp, sizeof(void*));
+        *ppnext = pfl->head;
+        pfl->head = ptemp;
+        ptemp = ((char *)ptemp) + pfl->size+REDZONE;
+    }
+    pfl->nBlocksAvailable += pfl->nmalloc;
+    pfl->nchunks++;
+    return 0;
+}
+
+/* Called by the magazine's thread.  Returns all but keep blocks of the
+ * magazine to its list.
+ */
+static void magFlush(magazine *pmag, unsigned keep)
+{
+    FREELISTPVT *pfl = pmag->pfl;
+
+    if(pmag->count <= keep)
+        return;
+    epicsMutexMustLock(pfl->lock);
+    while(pmag->count > keep) {
+        void **ppnext = pmag->head;
+
+        pmag->head = *ppnext;
+        *ppnext = pfl->head;
+        pfl->head = ppnext;
+        pmag->count--;
+        pfl->nBlocksAvailable++;
+    }
+    pfl->nflush++;
+    epicsMutexUnlock(pfl->lock);
+}
+
+static void cacheExit(void *arg)
+{
+    threadCache *pcache = arg;
+    int i, j;
+
+    epicsMutexMustLock(cacheListLock);
+    ellDelete(&cacheList, &pcache->node);
+    for(i=0; i<MAG_SLOTS / MAG_PAGE; i++) {
+        magazine *page = pcache->pages[i];
+
+        if(!page)
+            continue;
+        for(j=0; j<MAG_PAGE; j++) {
+            if(page[j].pfl)
+                magFlush(&page[j], 0);
+        }
+        free(page);
+    }
+    epicsMutexUnlock(cacheListLock);
+    epicsThreadPrivateSet(cacheKey, NULL);
+    free(pcache);
+}
+
+/* The calling thread's magazine for pfl, or NULL */
+static magazine * magGet(FREELISTPVT *pfl)
+{
+    threadCache *pcache = epicsThreadPrivateGet(cacheKey);
+    magazine **ppage;
+    magazine *pmag;
+
+    if(!pcache)
+        return NULL;
+    if(pcache == (threadCache *)&cacheAllowed) {
+        pcache = calloc(1, sizeof(threadCache));
+        if(!pcache)
+            return NULL;
+        pcache->tid = epicsThreadGetIdSelf();
+        epicsMutexMustLock(cacheListLock);
+        ellAdd(&cacheList, &pcache->node);
+        epicsMutexUnlock(cacheListLock);
+        epicsThreadPrivateSet(cacheKey, pcache);
+        epicsAtThreadExit(cacheExit, pcache);
+    }
+
+    ppage = &pcache->pages[pfl->slot / MAG_PAGE];
+    if(!*ppage) {
+        magazine *page = calloc(MAG_PAGE, sizeof(magazine));
+
+        if(!page)
+            return NULL;
+        epicsAtomicSetPtrT((EpicsAtomicPtrT *) ppage, page);
+    }
+    pmag = &(*ppage)[pfl->slot % MAG_PAGE];
+    if(!pmag->pfl)
+        pmag->pfl = pfl;
+    return pmag;
+}
+
 LIBCOM_API void epicsStdCall 
     freeListInitPvt(void **ppvt,int size,int nmalloc)
 {
@@ -73,6 +273,8 @@ LIBCOM_API void epicsStdCall
         epicsAtomicSetIntT(&freeListBypass, bypass);
     }
 
+    epicsThreadOnce(&cacheOnce, cacheInit, NULL);
+
     pfl = callocMustSucceed(1,sizeof(FREELISTPVT), "freeListInitPvt");
     pfl->size = adjustToWorstCaseAlignment(size);
     if(!bypass)
@@ -81,6 +283,21 @@ LIBCOM_API void epicsStdCall
     pfl->mallochead = NULL;
     pfl->nBlocksAvailable = 0u;
     pfl->lock = epicsMutexMustCreate();
+    pfl->slot = -1;
+    if(pfl->nmalloc >= MAG_MIN_NMALLOC) {
+        int i;
+
+        epicsMutexMustLock(cacheListLock);
+        for(i=0; i<MAG_SLOTS; i++) {
+            if(!slotUsed[i]) {
+                slotUsed[i] = 1;
+                pfl->slot = i;
+                pfl->magSize = pfl->nmalloc < MAG_MAX ? pfl->nmalloc : MAG_MAX;
+                break;
+            }
+        }
+        epicsMutexUnlock(cacheListLock);
+    }
     *ppvt = (void *)pfl;
     VALGRIND_CREATE_MEMPOOL(pfl, REDZONE, 0);
 }
@@ -96,58 +313,58 @@ LIBCOM_API void * epicsStdCall freeListCalloc(void *pvt)
         memset((char *)ptemp,0,pfl->size);
     return(ptemp);
 }
-
+
 LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt)
 {
     FREELISTPVT *pfl = pvt;
     void        *ptemp;
     void        **ppnext;
-    allocMem    *pallocmem;
-    int         i;
+    magazine    *pmag;
 
     if(!pfl->nmalloc)
         return malloc(pfl->size);
 
-    epicsMutexMustLock(pfl->lock);
-    ptemp = pfl->head;
-    if(ptemp==0) {
-        /* layout of each block. nmalloc+1 REDZONEs for nmallocs.
-         * The first sizeof(void*) bytes are used to store a pointer
-         * to the next free block.
-         *
-         * | RED | size0 ------ | RED | size1 | ... | RED |
-         * |     | next | ----- |
-         */
-        ptemp = (void *)malloc(pfl->nmalloc*(pfl->size+REDZONE)+REDZONE);
-        if(ptemp==0) {
-            epicsMutexUnlock(pfl->lock);
-            return(0);
-        }
-        pallocmem = (allocMem *)calloc(1,sizeof(allocMem));
-        if(pallocmem==0) {
+    if(pfl->magSize && (pmag = magGet(pfl))) {
+        if(!pmag->count) {
+            /* Refill half the magazine from the list */
+            unsigned n = pfl->magSize / 2;
+
+            epicsMutexMustLock(pfl->lock);
+            while(pmag->count < n) {
+                if(!pfl->head && listGrow(pfl))
+                    break;
+                ppnext = pfl->head;
+                pfl->head = *ppnext;
+                pfl->nBlocksAvailable--;
+                *ppnext = pmag->head;
+                pmag->head = ppnext;
+                pmag->count++;
+            }
+            pfl->nrefill++;
             epicsMutexUnlock(pfl->lock);
-            free(ptemp);
-            return(0);
         }
-        pallocmem->memory = ptemp; /* real allocation */
-        ptemp = REDZONE + (char *) ptemp; /* skip first REDZONE */
-        if(pfl->mallochead)
-            pallocmem->next = pfl->mallochead;
-        pfl->mallochead = pallocmem;
-        for(i=0; i<pfl->nmalloc; i++) {
+        ptemp = pmag->head;
+        if(ptemp) {
             ppnext = ptemp;
-            VALGRIND_MEMPOOL_ALLOC(pfl, ptemp, sizeof(void*));
-            *ppnext = pfl->head;
-            pfl->head = ptemp;
-            ptemp = ((char *)ptemp) + pfl->size+REDZONE;
+            pmag->head = *ppnext;
+            pmag->count--;
+            pmag->nops++;
         }
+    }
+    else {
+        epicsMutexMustLock(pfl->lock);
         ptemp = pfl->head;
-        pfl->nBlocksAvailable += pfl->nmalloc;
+        if(ptemp==0 && !listGrow(pfl))
+            ptemp = pfl->head;
+        if(ptemp) {
+            ppnext = ptemp;
+            pfl->head = *ppnext;
+            pfl->nBlocksAvailable--;
+        }
+        epicsMutexUnlock(pfl->lock);
     }
-    ppnext = pfl->head;
-    pfl->head = *ppnext;
-    pfl->nBlocksAvailable--;
-    epicsMutexUnlock(pfl->lock);
+    if(ptemp==0)
+        return(0);
     VALGRIND_MEMPOOL_FREE(pfl, ptemp);
     VALGRIND_MEMPOOL_ALLOC(pfl, ptemp, pfl->size);
     return(ptemp);
@@ -157,6 +374,7 @@ LIBCOM_API void epicsStdCall freeListFree(void *pvt,void*pmem)
 {
     FREELISTPVT *pfl = pvt;
     void        **ppnext;
+    magazine    *pmag;
 
     if(!pfl->nmalloc) {
         free(pmem);
@@ -166,8 +384,18 @@ LIBCOM_API void epicsStdCall freeListFree(void *pvt,void*pmem)
     VALGRIND_MEMPOOL_FREE(pvt, pmem);
     VALGRIND_MEMPOOL_ALLOC(pvt, pmem, sizeof(void*));
 
-    epicsMutexMustLock(pfl->lock);
     ppnext = pmem;
+    if(pfl->magSize && (pmag = magGet(pfl))) {
+        *ppnext = pmag->head;
+        pmag->head = pmem;
+        pmag->count++;
+        pmag->nops++;
+        if(pmag->count > pfl->magSize)
+            magFlush(pmag, pfl->magSize / 2);
+        return;
+    }
+
+    epicsMutexMustLock(pfl->lock);
     *ppnext = pfl->head;
     pfl->head = pmem;
     pfl->nBlocksAvailable++;
@@ -180,6 +408,22 @@ LIBCOM_API void epicsStdCall freeListCleanup(void *pvt)
     allocMem    *phead;
     allocMem    *pnext;
 
+    if(pfl->magSize) {
+        /* Forget blocks in magazines, their memory is freed below */
+        threadCache *pcache;
+
+        epicsMutexMustLock(cacheListLock);
+        for(pcache = (threadCache *)ellFirst(&cacheList); pcache;
+            pcache = (threadCache *)ellNext(&pcache->node)) {
+            magazine *pmag = magPeek(pcache, pfl->slot);
+
+            if(pmag)
+                memset(pmag, 0, sizeof(magazine));
+        }
+        slotUsed[pfl->slot] = 0;
+        epicsMutexUnlock(cacheListLock);
+    }
+
     VALGRIND_DESTROY_MEMPOOL(pvt);
 
     phead = pfl->mallochead;
@@ -193,6 +437,31 @@ LIBCOM_API void epicsStdCall freeListCleanup(void *pvt)
     free(pvt);
 }
 
+/* Blocks of pfl in the magazines of all threads */
+static size_t magCount(FREELISTPVT *pfl, unsigned *pnthreads)
+{
+    threadCache *pcache;
+    size_t count = 0;
+    unsigned nthreads = 0;
+
+    if(!pfl->magSize)
+        return 0;
+    epicsMutexMustLock(cacheListLock);
+    for(pcache = (threadCache *)ellFirst(&cacheList); pcache;
+        pcache = (threadCache *)ellNext(&pcache->node)) {
+        magazine *pmag = magPeek(pcache, pfl->slot);
+
+        if(pmag && pmag->pfl == pfl) {
+            count += pmag->count;
+            nthreads++;
+        }
+    }
+    epicsMutexUnlock(cacheListLock);
+    if(pnthreads)
+        *pnthreads = nthreads;
+    return count;
+}
+
 LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt)
 {
     FREELISTPVT *pfl = pvt;
@@ -200,6 +469,50 @@ LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt)
     epicsMutexMustLock(pfl->lock);
     nBlocksAvailable = pfl->nBlocksAvailable;
     epicsMutexUnlock(pfl->lock);
-    return nBlocksAvailable;
+    return nBlocksAvailable + magCount(pfl, NULL);
 }
 
+LIBCOM_API void epicsStdCall freeListShow(void *pvt, unsigned level)
+{
+    FREELISTPVT *pfl = pvt;
+    size_t nchunks, navail, nrefill, nflush, ncached;
+    unsigned nthreads = 0;
+
+    if(!pfl->nmalloc) {
+        printf("Free list of %d byte blocks, bypassed\n", pfl->size);
+        return;
+    }
+    epicsMutexMustLock(pfl->lock);
+    nchunks = pfl->nchunks;
+    navail = pfl->nBlocksAvailable;
+    nrefill = pfl->nrefill;
+    nflush = pfl->nflush;
+    epicsMutexUnlock(pfl->lock);
+    ncached = magCount(pfl, &nthreads);
+
+    printf("Free list of %d byte blocks, %lu allocated in chunks of %d\n",
+        pfl->size, (unsigned long)(nchunks * pfl->nmalloc), pfl->nmalloc);
+    printf("    %lu free on the list, %lu in %u thread magazines of %u\n",
+        (unsigned long)navail, (unsigned long)ncached, nthreads, pfl->magSize);
+    if(pfl->magSize)
+        printf("    %lu batches moved to magazines, %lu moved back\n",
+            (unsigned long)nrefill, (unsigned long)nflush);
+
+    if(level > 0 && pfl->magSize) {
+        threadCache *pcache;
+
+        epicsMutexMustLock(cacheListLock);
+        for(pcache = (threadCache *)ellFirst(&cacheList); pcache;
+            pcache = (threadCache *)ellNext(&pcache->node)) {
+            magazine *pmag = magPeek(pcache, pfl->slot);
+            char name[32];
+
+            if(pmag && pmag->pfl == pfl) {
+                epicsThreadGetName(pcache->tid, name, sizeof(name));
+                printf("    %-20s %4u free, %lu allocations and frees\n",
+                    name, pmag->count, (unsigned long)pmag->nops);
+            }
+        }
+        epicsMutexUnlock(cacheListLock);
+    }
+}
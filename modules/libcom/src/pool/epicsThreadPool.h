@@ -138,6 +138,23 @@ LIBCOM_API int epicsJobMove(epicsJob* job, epicsThreadPool* pool);
  */
 LIBCOM_API int epicsJobQueue(epicsJob*);
 
+/* Adds njobs jobs to the run queues, waking or creating the workers
+ * for them together.  The jobs need not belong to the same pool.
+ * Safe to call from a running job function.
+ * returns 0 if all were queued, else the error of the last that wasn't.
+ */
+LIBCOM_API int epicsJobQueueMany(epicsJob **jobs, size_t njobs);
+
+/* Each worker of a pool has its own run queue, and takes jobs from the
+ * queues of other workers when its own is empty.  Jobs queued by a worker
+ * go on its own queue, others are spread over the workers.
+ * This hints that the job should be queued for the worker number given,
+ * counting from 0, to keep the data it uses in the caches of one CPU.
+ * The number is taken modulo the number of workers started.
+ * A negative number removes the hint.
+ */
+LIBCOM_API void epicsJobSetAffinity(epicsJob *job, int worker);
+
 /* Remove a job from the run queue if it is queued.
  * Safe to call from a running job function.
  * returns 0 if job was queued and now is not.
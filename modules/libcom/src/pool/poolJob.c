@@ -14,7 +14,9 @@
 #include "dbDefs.h"
 #include "errlog.h"
 #include "ellLib.h"
+#include "epicsAtomic.h"
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "epicsMutex.h"
 #include "epicsEvent.h"
 #include "epicsInterrupt.h"
@@ -24,114 +26,312 @@
 
 void *epicsJobArgSelfMagic = &epicsJobArgSelfMagic;
 
+/* The poolWorker of each worker thread */
+static epicsThreadPrivateId workerKey;
+/* Round robin counter of other threads queueing jobs */
+static epicsThreadPrivateId cursorKey;
+
 static
-void workerMain(void *arg)
+void workerKeyInit(void *unused)
 {
-    epicsThreadPool *pool = arg;
-    unsigned int nrun, ocnt;
-
-    /* workers are created with counts
-     * in the running, sleeping, and (possibly) waking counters
-     */
+    workerKey = epicsThreadPrivateCreate();
+    cursorKey = epicsThreadPrivateCreate();
+}
 
-    epicsMutexMustLock(pool->guard);
-    pool->threadsAreAwake++;
-    pool->threadsSleeping--;
+void initPoolWorkerKey(void)
+{
+    static epicsThreadOnceId workerKeyOnce = EPICS_THREAD_ONCE_INIT;
 
-    while (1) {
-        ELLNODE *cur;
+    epicsThreadOnce(&workerKeyOnce, &workerKeyInit, NULL);
+}
 
-        pool->threadsAreAwake--;
-        pool->threadsSleeping++;
-        epicsMutexUnlock(pool->guard);
+/* Put a job on a run queue, with job->lock held */
+static
+void jobPush(poolWorker *pw, epicsJob *job)
+{
+    job->queuedAt = epicsMonotonicGet();
+    /* count it first so that nQueued is never less than the jobs queued */
+    epicsAtomicIncrIntT(&pw->pool->nQueued);
+    epicsSpinLock(pw->lock);
+    ellAdd(&pw->jobs, &job->queuenode);
+    job->wq = pw;
+    epicsSpinUnlock(pw->lock);
+}
 
-        epicsEventMustWait(pool->workerWakeup);
+/* Take the oldest job from a run queue */
+static
+epicsJob* jobPop(poolWorker *pw)
+{
+    ELLNODE *cur;
+    epicsJob *job = NULL;
+
+    epicsSpinLock(pw->lock);
+    cur = ellGet(&pw->jobs);
+    if (cur) {
+        job = CONTAINER(cur, epicsJob, queuenode);
+        job->wq = NULL;
+    }
+    epicsSpinUnlock(pw->lock);
 
-        epicsMutexMustLock(pool->guard);
-        pool->threadsSleeping--;
-        pool->threadsAreAwake++;
+    if (job)
+        epicsAtomicDecrIntT(&pw->pool->nQueued);
+    return job;
+}
 
-        if (pool->threadsWaking==0)
-            continue;
+/* Take a queued job off its run queue, with job->lock held.
+ * Returns 0 if the job was queued and now is not.
+ */
+static
+int jobUnqueue(epicsJob *job)
+{
+    poolWorker *pw;
 
-        pool->threadsWaking--;
+    if (!job->queued)
+        return S_pool_jobIdle;
 
-        CHECKCOUNT(pool);
+    job->queued = 0;
+    if (job->running)
+        return 0; /* won't be queued again when done */
 
-        if (pool->shutdown)
-            break;
+    /* wq can only change to NULL while we hold job->lock */
+    pw = job->wq;
+    if (pw) {
+        int removed = 0;
 
-        if (pool->pauserun)
-            continue;
+        epicsSpinLock(pw->lock);
+        if (job->wq == pw) {
+            ellDelete(&pw->jobs, &job->queuenode);
+            job->wq = NULL;
+            removed = 1;
+        }
+        epicsSpinUnlock(pw->lock);
 
-        /* more threads to wakeup */
-        if (pool->threadsWaking) {
-            epicsEventSignal(pool->workerWakeup);
+        if (removed) {
+            epicsAtomicDecrIntT(&pw->pool->nQueued);
+            return 0;
         }
+    }
 
-        while ((cur=ellGet(&pool->jobs)) != NULL) {
-            epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
+    /* a worker took the job from its run queue, and will drop it */
+    job->stale++;
+    return 0;
+}
 
-            assert(job->queued && !job->running);
+static
+void jobFree(epicsJob *job)
+{
+    epicsThreadPool *pool = job->pool;
 
-            job->queued=0;
-            job->running=1;
+    if (pool) {
+        epicsMutexMustLock(pool->guard);
+        ellDelete(&pool->allJobs, &job->jobnode);
+        epicsMutexUnlock(pool->guard);
+    }
+    job->dead = 1;
+    epicsSpinDestroy(job->lock);
+    free(job);
+}
 
-            epicsMutexUnlock(pool->guard);
-            (*job->func)(job->arg, epicsJobModeRun);
-            epicsMutexMustLock(pool->guard);
+static
+void runJob(poolWorker *pw, epicsJob *job, int stolen)
+{
+    epicsUInt64 queuedAt, start, end;
 
-            if (job->freewhendone) {
-                job->dead=1;
-                free(job);
-            }
-            else {
-                job->running=0;
-                /* job may be re-queued from within callback */
-                if (job->queued)
-                    ellAdd(&pool->jobs, &job->jobnode);
-                else
-                    ellAdd(&pool->owned, &job->jobnode);
+    epicsSpinLock(job->lock);
+    if (job->stale) {
+        /* unqueued or destroyed after we took it, maybe queued again */
+        int last = --job->stale == 0 && job->freewhendone && !job->running;
+
+        epicsSpinUnlock(job->lock);
+        if (last)
+            jobFree(job);
+        return;
+    }
+    assert(job->queued && !job->running && !job->freewhendone);
+
+    job->queued = 0;
+    job->running = 1;
+    queuedAt = job->queuedAt;
+    epicsSpinUnlock(job->lock);
+
+    start = epicsMonotonicGet();
+    (*job->func)(job->arg, epicsJobModeRun);
+    end = epicsMonotonicGet();
+
+    pw->nRun++;
+    if (stolen)
+        pw->nStolen++;
+    pw->waitTotal += start - queuedAt;
+    if (pw->waitMax < start - queuedAt)
+        pw->waitMax = start - queuedAt;
+    pw->runTotal += end - start;
+
+    epicsSpinLock(job->lock);
+    job->running = 0;
+    if (job->freewhendone) {
+        /* unless a worker still holds it from before it ran */
+        int last = !job->stale;
+
+        epicsSpinUnlock(job->lock);
+        if (last)
+            jobFree(job);
+        return;
+    }
+    /* job may be re-queued from within callback, run it here again */
+    if (job->queued)
+        jobPush(pw, job);
+    epicsSpinUnlock(job->lock);
+}
+
+/* Back from sleep, or about to sleep but found more work */
+static
+void workerAwake(poolWorker *pw)
+{
+    epicsAtomicDecrIntT(&pw->pool->nIdle);
+    /* if another thread woke this worker it counted it as waking */
+    if (epicsAtomicCmpAndSwapIntT(&pw->idle, 1, 0) != 1)
+        epicsAtomicDecrIntT(&pw->pool->nWaking);
+}
+
+static
+void workerMain(void *arg)
+{
+    poolWorker *pw = arg;
+    epicsThreadPool *pool = pw->pool;
+    unsigned int nrun;
+
+    epicsThreadPrivateSet(workerKey, pw);
+    epicsAtomicDecrIntT(&pool->nStarting);
+
+    while (!epicsAtomicGetIntT(&pool->shutdown)) {
+        epicsJob *job = NULL;
+        int stolen = 0;
+
+        if (!epicsAtomicGetIntT(&pool->pauserun)) {
+            int nStarted = epicsAtomicGetIntT(&pool->nStarted);
+            int i;
+
+            /* our own queue, then the others starting with the next.
+             * This worker may not be counted in nStarted yet.
+             */
+            job = jobPop(pw);
+            for (i = 1; !job && i <= nStarted; i++) {
+                int victim = (pw->index + i) % nStarted;
+
+                if (victim != (int)pw->index) {
+                    job = jobPop(&pool->workers[victim]);
+                    stolen = 1;
+                }
             }
         }
+        if (job) {
+            runJob(pw, job, stolen);
+            continue;
+        }
 
-        if (pool->observerCount)
+        /* Nothing to do.  Sleep unless a job was queued meanwhile,
+         * a thread queueing a job after we become idle will wake us.
+         */
+        epicsAtomicSetIntT(&pw->idle, 1);
+        epicsAtomicIncrIntT(&pool->nIdle);
+        if ((epicsAtomicGetIntT(&pool->nQueued) > 0 &&
+                !epicsAtomicGetIntT(&pool->pauserun)) ||
+                epicsAtomicGetIntT(&pool->shutdown)) {
+            workerAwake(pw);
+            continue;
+        }
+
+        epicsAtomicDecrIntT(&pool->nAwake);
+        if (epicsAtomicGetIntT(&pool->observerCount))
             epicsEventSignal(pool->observerWakeup);
+
+        epicsEventMustWait(pw->wake);
+
+        epicsAtomicIncrIntT(&pool->nAwake);
+        workerAwake(pw);
     }
 
-    pool->threadsAreAwake--;
-    pool->threadsRunning--;
+    epicsAtomicDecrIntT(&pool->nAwake);
 
+    epicsMutexMustLock(pool->guard);
+    pool->threadsRunning--;
     nrun = pool->threadsRunning;
-    ocnt = pool->observerCount;
     epicsMutexUnlock(pool->guard);
 
-    if (ocnt)
+    if (epicsAtomicGetIntT(&pool->observerCount))
         epicsEventSignal(pool->observerWakeup);
 
-    if (nrun)
-        epicsEventSignal(pool->workerWakeup); /* pass along */
-    else
+    if (!nrun)
         epicsEventSignal(pool->shutdownEvent);
 }
 
+/* Call with pool->guard held */
 int createPoolThread(epicsThreadPool *pool)
 {
+    int index = epicsAtomicGetIntT(&pool->nStarted);
     epicsThreadId tid;
 
+    if (index >= (int)pool->conf.maxThreads)
+        return S_pool_noThreads;
+
+    /* new workers are awake, and starting until they look for jobs */
+    epicsAtomicIncrIntT(&pool->nStarting);
+    epicsAtomicIncrIntT(&pool->nAwake);
+
     tid = epicsThreadCreate("PoolWorker",
                             pool->conf.workerPriority,
                             pool->conf.workerStack,
                             &workerMain,
-                            pool);
-    if (!tid)
+                            &pool->workers[index]);
+    if (!tid) {
+        epicsAtomicDecrIntT(&pool->nStarting);
+        epicsAtomicDecrIntT(&pool->nAwake);
         return S_pool_noThreads;
+    }
 
+    epicsAtomicSetIntT(&pool->nStarted, index + 1);
     pool->threadsRunning++;
-    pool->threadsSleeping++;
     return 0;
 }
 
+/* Find workers for njobs jobs just queued, the first on worker hint.
+ * Wakes sleeping workers, then creates new ones if more jobs are queued
+ * than workers about to look for them.
+ */
+void wakePoolWorkers(epicsThreadPool *pool, unsigned int njobs,
+                     unsigned int hint)
+{
+    int nStarted = epicsAtomicGetIntT(&pool->nStarted);
+    int i;
+
+    if (!njobs || epicsAtomicGetIntT(&pool->pauserun))
+        return;
+
+    for (i = 0; njobs && i < nStarted &&
+            epicsAtomicGetIntT(&pool->nIdle) > 0; i++) {
+        poolWorker *pw = &pool->workers[(hint + i) % nStarted];
+
+        if (epicsAtomicCmpAndSwapIntT(&pw->idle, 1, 0) == 1) {
+            epicsAtomicIncrIntT(&pool->nWaking);
+            epicsEventSignal(pw->wake);
+            njobs--;
+        }
+    }
+
+    if (!njobs || nStarted >= (int)pool->conf.maxThreads)
+        return;
+
+    epicsMutexMustLock(pool->guard);
+    while (njobs-- &&
+           epicsAtomicGetIntT(&pool->nQueued) >
+               epicsAtomicGetIntT(&pool->nWaking) +
+               epicsAtomicGetIntT(&pool->nStarting)) {
+        if (createPoolThread(pool))
+            break; /* oops, couldn't create worker */
+    }
+    epicsMutexUnlock(pool->guard);
+}
+
 epicsJob* epicsJobCreate(epicsThreadPool *pool,
                          epicsJobFunction func,
                          void *arg)
@@ -141,12 +341,19 @@ epicsJob* epicsJobCreate(epicsThreadPool *pool,
     if (!job)
         return NULL;
 
+    job->lock = epicsSpinCreate();
+    if (!job->lock) {
+        free(job);
+        return NULL;
+    }
+
     if (arg == &epicsJobArgSelfMagic)
         arg = job;
 
     job->pool = NULL;
     job->func = func;
     job->arg = arg;
+    job->affinity = -1;
 
     epicsJobMove(job, pool);
 
@@ -155,29 +362,29 @@ epicsJob* epicsJobCreate(epicsThreadPool *pool,
 
 void epicsJobDestroy(epicsJob *job)
 {
-    epicsThreadPool *pool;
-    if (!job || !job->pool) {
+    if (!job)
+        return;
+    if (!job->pool) {
+        epicsSpinDestroy(job->lock);
         free(job);
         return;
     }
-    pool = job->pool;
 
-    epicsMutexMustLock(pool->guard);
+    epicsSpinLock(job->lock);
 
     assert(!job->dead);
 
-    epicsJobUnqueue(job);
+    jobUnqueue(job);
 
-    if (job->running || job->freewhendone) {
+    if (job->running || job->stale) {
+        /* the last worker holding the job frees it */
         job->freewhendone = 1;
-    }
-    else {
-        ellDelete(&pool->owned, &job->jobnode);
-        job->dead = 1;
-        free(job);
+        epicsSpinUnlock(job->lock);
+        return;
     }
 
-    epicsMutexUnlock(pool->guard);
+    epicsSpinUnlock(job->lock);
+    jobFree(job);
 }
 
 int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
@@ -186,15 +393,16 @@ int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
 
     /* remove from current pool */
     if (pool) {
-        epicsMutexMustLock(pool->guard);
+        int busy;
 
-        if (job->queued || job->running) {
-            epicsMutexUnlock(pool->guard);
+        epicsSpinLock(job->lock);
+        busy = job->queued || job->running || job->stale;
+        epicsSpinUnlock(job->lock);
+        if (busy)
             return S_pool_jobBusy;
-        }
-
-        ellDelete(&pool->owned, &job->jobnode);
 
+        epicsMutexMustLock(pool->guard);
+        ellDelete(&pool->allJobs, &job->jobnode);
         epicsMutexUnlock(pool->guard);
     }
 
@@ -204,7 +412,7 @@ int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
     if (pool) {
         epicsMutexMustLock(pool->guard);
 
-        ellAdd(&pool->owned, &job->jobnode);
+        ellAdd(&pool->allJobs, &job->jobnode);
 
         epicsMutexUnlock(pool->guard);
     }
@@ -212,116 +420,141 @@ int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
     return 0;
 }
 
-int epicsJobQueue(epicsJob *job)
+void epicsJobSetAffinity(epicsJob *job, int worker)
+{
+    epicsSpinLock(job->lock);
+    job->affinity = worker < 0 ? -1 : worker;
+    epicsSpinUnlock(job->lock);
+}
+
+/* Queue one job, and return the worker whose run queue it went on.
+ * That is NULL if the job was already queued, or is running.
+ */
+static
+int jobQueue(epicsJob *job, poolWorker **ptarget)
 {
     int ret = 0;
     epicsThreadPool *pool = job->pool;
+    poolWorker *self;
+
+    *ptarget = NULL;
 
     if (!pool)
         return S_pool_noPool;
 
-    epicsMutexMustLock(pool->guard);
+    if (epicsAtomicGetIntT(&pool->pauseadd))
+        return S_pool_paused;
 
-    assert(!job->dead);
+    if (!epicsAtomicGetIntT(&pool->nStarted)) {
+        unsigned int nThreads;
 
-    if (pool->pauseadd) {
-        ret = S_pool_paused;
-        goto done;
-    }
-    else if (job->freewhendone) {
-        ret = S_pool_jobBusy;
-        goto done;
-    }
-    else if (job->queued) {
-        goto done;
-    }
+        /* we need a first worker to queue the job on */
+        epicsMutexMustLock(pool->guard);
+        if (pool->threadsRunning == 0)
+            createPoolThread(pool);
+        nThreads = pool->threadsRunning;
+        epicsMutexUnlock(pool->guard);
 
-    job->queued = 1;
-    /* Job may be queued from within a callback */
-    if (!job->running) {
-        ellDelete(&pool->owned, &job->jobnode);
-        ellAdd(&pool->jobs, &job->jobnode);
-    }
-    else {
-        /* some worker will find it again before sleeping */
-        goto done;
+        if (!nThreads) {
+            /* oops, we couldn't lazy create our first worker
+             * so this job would never run!
+             */
+            return S_pool_noThreads;
+        }
     }
 
-    /* Since we hold the lock, we can be certain that all awake worker are
-     * executing work functions.  The current thread may be a worker.
-     * We prefer to wakeup a new worker rather then wait for a busy worker to
-     * finish.  However, after we initiate a wakeup there will be a race
-     * between the worker waking up, and a busy worker finishing.
-     * Thus we can't avoid spurious wakeups.
-     */
-
-    if (pool->threadsRunning >= pool->conf.maxThreads) {
-        /* all workers created... */
-        /* ... but some are sleeping, so wake one up */
-        if (pool->threadsWaking < pool->threadsSleeping) {
-            pool->threadsWaking++;
-            epicsEventSignal(pool->workerWakeup);
-        }
-        /*else one of the running workers will find this job before sleeping */
-        CHECKCOUNT(pool);
+    self = epicsThreadPrivateGet(workerKey);
+    if (self && self->pool != pool)
+        self = NULL;
 
+    epicsSpinLock(job->lock);
+
+    assert(!job->dead);
+
+    if (job->freewhendone) {
+        ret = S_pool_jobBusy;
     }
-    else {
-        /* could create more workers so
-         * will either create a new worker, or wakeup an existing worker
+    else if (!job->queued) {
+        job->queued = 1;
+        /* Job may be queued from within a callback,
+         * the worker queues it again when done.
          */
+        if (!job->running) {
+            int nStarted = epicsAtomicGetIntT(&pool->nStarted);
+            poolWorker *pw;
 
-        if (pool->threadsWaking >= pool->threadsSleeping) {
-            /* all sleeping workers have already been woken.
-             * start a new worker for this job
+            /* Prefer the worker the job has an affinity for, then the
+             * worker queueing it, otherwise go round robin.
              */
-            if (createPoolThread(pool) && pool->threadsRunning == 0) {
-                /* oops, we couldn't lazy create our first worker
-                 * so this job would never run!
-                 */
-                ret = S_pool_noThreads;
-                job->queued = 0;
-                /* if threadsRunning==0 then no jobs can be running */
-                assert(!job->running);
-                ellDelete(&pool->jobs, &job->jobnode);
-                ellAdd(&pool->owned, &job->jobnode);
+            if (job->affinity >= 0)
+                pw = &pool->workers[job->affinity % nStarted];
+            else if (self)
+                pw = self;
+            else {
+                size_t next = (size_t) epicsThreadPrivateGet(cursorKey);
+
+                epicsThreadPrivateSet(cursorKey, (void *) (next + 1));
+                pw = &pool->workers[next % nStarted];
             }
+
+            jobPush(pw, job);
+            *ptarget = pw;
         }
-        if (ret == 0) {
-            pool->threadsWaking++;
-            epicsEventSignal(pool->workerWakeup);
+    }
+
+    epicsSpinUnlock(job->lock);
+    return ret;
+}
+
+int epicsJobQueueMany(epicsJob **jobs, size_t njobs)
+{
+    int ret = 0;
+    epicsThreadPool *pool = NULL;
+    unsigned int nqueued = 0, hint = 0;
+    size_t i;
+
+    for (i = 0; i < njobs; i++) {
+        poolWorker *target;
+        int err;
+
+        if (jobs[i]->pool != pool) {
+            if (pool)
+                wakePoolWorkers(pool, nqueued, hint);
+            pool = jobs[i]->pool;
+            nqueued = 0;
         }
-        CHECKCOUNT(pool);
+
+        err = jobQueue(jobs[i], &target);
+        if (err)
+            ret = err;
+        else if (target && !nqueued++)
+            hint = target->index;
     }
+    if (pool)
+        wakePoolWorkers(pool, nqueued, hint);
 
-done:
-    epicsMutexUnlock(pool->guard);
     return ret;
 }
 
+int epicsJobQueue(epicsJob *job)
+{
+    return epicsJobQueueMany(&job, 1);
+}
+
 int epicsJobUnqueue(epicsJob *job)
 {
-    int ret = S_pool_jobIdle;
-    epicsThreadPool *pool = job->pool;
+    int ret;
 
-    if (!pool)
+    if (!job->pool)
         return S_pool_noPool;
 
-    epicsMutexMustLock(pool->guard);
+    epicsSpinLock(job->lock);
 
     assert(!job->dead);
 
-    if (job->queued) {
-        if (!job->running) {
-            ellDelete(&pool->jobs, &job->jobnode);
-            ellAdd(&pool->owned, &job->jobnode);
-        }
-        job->queued = 0;
-        ret = 0;
-    }
+    ret = jobUnqueue(job);
 
-    epicsMutexUnlock(pool->guard);
+    epicsSpinUnlock(job->lock);
 
     return ret;
 }
-
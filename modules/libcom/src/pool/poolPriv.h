@@ -14,80 +14,112 @@
 #include "epicsThread.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
+#include "epicsSpin.h"
+#include "epicsTypes.h"
+
+/* Each worker has its own run queue.  Jobs queued by a worker go on its
+ * own queue, others are spread round robin over the workers started by
+ * each queueing thread, or go to the worker a job has an affinity for.  A worker runs the
+ * oldest job of its own queue, and when that is empty takes the oldest
+ * job of another worker's queue before it sleeps.
+ */
+typedef struct poolWorker {
+    epicsThreadPool *pool;
+    unsigned int index;
+
+    epicsSpinId lock; /* guards jobs, and the wq of the jobs on it */
+    ELLLIST jobs; /* run queue */
+
+    epicsEventId wake;
+    int idle; /* waiting for wake, use atomic */
+
+    /* Counters, only written by the worker */
+    size_t nRun; /* jobs run */
+    size_t nStolen; /* of those, taken from another worker's queue */
+    epicsUInt64 waitTotal; /* ns from queued to started */
+    epicsUInt64 waitMax;
+    epicsUInt64 runTotal; /* ns running jobs */
+} poolWorker;
 
 struct epicsThreadPool {
     ELLNODE sharedNode;
     size_t sharedCount;
 
-    ELLLIST jobs; /* run queue */
-    ELLLIST owned; /* unqueued jobs. */
+    ELLLIST allJobs; /* every job of this pool, guarded by guard */
+
+    /* maxThreads workers, of which the first nStarted have a thread */
+    poolWorker *workers;
+    int nStarted; /* use atomic */
 
-    /* Worker state counters.
-     * The life cycle of a worker is
-     *   Wakeup -> Awake -> Sleeping
-     * Newly created workers go into the wakeup state
+    /* Counters, use atomic.
+     * Workers are created awake and starting.  An awake worker with
+     * nothing to do becomes idle, and sleeps until another thread
+     * wakes it.  It is then waking until it runs again.
      */
+    int nQueued; /* jobs on the run queues */
+    int nAwake; /* workers not sleeping */
+    int nIdle; /* workers sleeping, or about to */
+    int nWaking; /* idle workers woken which didn't run yet */
+    int nStarting; /* workers created which didn't run yet */
 
-    /* # of running workers which are not waiting for a wakeup event */
-    unsigned int threadsAreAwake;
-    /* # of sleeping workers which need to be awakened */
-    unsigned int threadsWaking;
-    /* # of workers waiting on the workerWakeup event */
-    unsigned int threadsSleeping;
-    /* # of threads started and not stopped */
+    /* # of threads started and not stopped, guarded by guard */
     unsigned int threadsRunning;
 
-    /* # of observers waiting on pool events */
-    unsigned int observerCount;
+    /* # of observers waiting on pool events, use atomic */
+    int observerCount;
 
-    epicsEventId workerWakeup;
     epicsEventId shutdownEvent;
 
     epicsEventId observerWakeup;
 
-    /* Disallow epicsJobQueue */
-    unsigned int pauseadd:1;
-    /* Prevent workers from running new jobs */
-    unsigned int pauserun:1;
+    /* Disallow epicsJobQueue, use atomic */
+    int pauseadd;
+    /* Prevent workers from running new jobs, use atomic */
+    int pauserun;
+    /* tell workers to exit, use atomic */
+    int shutdown;
     /* Prevent further changes to pool options */
     unsigned int freezeopt:1;
-    /* tell workers to exit */
-    unsigned int shutdown:1;
 
     epicsMutexId guard;
 
+    epicsUInt64 created; /* epicsMonotonicGet() */
+
     /* copy of config passed when created */
     epicsThreadPoolConfig conf;
 };
 
-/* Called after manipulating counters to check that invariants are preserved */
-#define CHECKCOUNT(pPool) do { \
-    if (!(pPool)->shutdown) { \
-        assert((pPool)->threadsAreAwake + (pPool)->threadsSleeping == (pPool)->threadsRunning); \
-        assert((pPool)->threadsWaking <= (pPool)->threadsSleeping); \
-    } \
-} while(0)
-
-/* When created a job is idle.  queued and running are false
- * and jobnode is in the thread pool's owned list.
+/* When created a job is idle.  queued and running are false,
+ * and jobnode is in the thread pool's allJobs list, where it stays.
  *
- * When the job is added, the queued flag is set and jobnode
- * is in the jobs list.
+ * When the job is added, the queued flag is set and queuenode is on
+ * the run queue of worker wq.
  *
- * When the job starts running the queued flag is cleared and
- * the running flag is set.  jobnode is not in any list
- * (held locally by worker).
+ * A worker takes the job from the run queue, sets wq to NULL, then
+ * locks the job.  It clears the queued flag and sets the running flag,
+ * unless the job was unqueued or destroyed in the meantime.  Then the
+ * job may have been queued and taken again before the first worker
+ * locks it, so stale counts the workers which took the job and must
+ * drop it.  Any of the workers holding the job may drop it, the last
+ * one frees it if it was destroyed.
  *
  * When the job has finished running, the running flag is cleared.
- * The queued flag may be set if the job re-added itself.
- * Based on the queued flag jobnode is added to the appropriate
- * list.
+ * The queued flag may be set if the job re-added itself, and the
+ * worker puts it on its own run queue.
+ *
+ * The flags are guarded by lock, which is taken before any worker's.
  */
 struct epicsJob {
     ELLNODE jobnode;
+    ELLNODE queuenode;
     epicsJobFunction func;
     void *arg;
     epicsThreadPool *pool;
+    poolWorker *wq; /* run queue holding this job, guarded by its lock */
+    int affinity; /* preferred worker, or -1 */
+    epicsUInt64 queuedAt; /* epicsMonotonicGet() */
+    epicsSpinId lock;
+    unsigned int stale; /* # of workers holding it after it was unqueued */
 
     unsigned int queued:1;
     unsigned int running:1;
@@ -99,7 +131,10 @@ struct epicsJob {
 extern "C" {
 #endif
 
+void initPoolWorkerKey(void);
 int createPoolThread(epicsThreadPool *pool);
+void wakePoolWorkers(epicsThreadPool *pool, unsigned int njobs,
+                     unsigned int hint);
 
 #ifdef __cplusplus
 }
@@ -14,7 +14,9 @@
 #include "dbDefs.h"
 #include "errlog.h"
 #include "ellLib.h"
+#include "epicsAtomic.h"
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "epicsMutex.h"
 #include "epicsEvent.h"
 #include "epicsInterrupt.h"
@@ -35,6 +37,25 @@ void epicsThreadPoolConfigDefaults(epicsThreadPoolConfig *opts)
         opts->workerPriority = epicsThreadPriorityMedium;
 }
 
+static
+void freeWorkers(epicsThreadPool *pool)
+{
+    size_t i;
+
+    if (!pool->workers)
+        return;
+
+    for (i = 0; i < pool->conf.maxThreads; i++) {
+        poolWorker *pw = &pool->workers[i];
+
+        if (pw->lock)
+            epicsSpinDestroy(pw->lock);
+        if (pw->wake)
+            epicsEventDestroy(pw->wake);
+    }
+    free(pool->workers);
+}
+
 epicsThreadPool* epicsThreadPoolCreate(epicsThreadPoolConfig *opts)
 {
     size_t i;
@@ -58,17 +79,30 @@ epicsThreadPool* epicsThreadPoolCreate(epicsThreadPoolConfig *opts)
     if (pool->conf.initialThreads > pool->conf.maxThreads)
         pool->conf.initialThreads = pool->conf.maxThreads;
 
-    pool->workerWakeup = epicsEventCreate(epicsEventEmpty);
     pool->shutdownEvent = epicsEventCreate(epicsEventEmpty);
     pool->observerWakeup = epicsEventCreate(epicsEventEmpty);
     pool->guard = epicsMutexCreate();
+    pool->workers = calloc(pool->conf.maxThreads, sizeof(*pool->workers));
 
-    if (!pool->workerWakeup || !pool->shutdownEvent ||
-       !pool->observerWakeup || !pool->guard)
+    if (!pool->shutdownEvent ||
+       !pool->observerWakeup || !pool->guard || !pool->workers)
         goto cleanup;
 
-    ellInit(&pool->jobs);
-    ellInit(&pool->owned);
+    for (i = 0; i < pool->conf.maxThreads; i++) {
+        poolWorker *pw = &pool->workers[i];
+
+        pw->pool = pool;
+        pw->index = i;
+        ellInit(&pw->jobs);
+        pw->lock = epicsSpinCreate();
+        pw->wake = epicsEventCreate(epicsEventEmpty);
+        if (!pw->lock || !pw->wake)
+            goto cleanup;
+    }
+
+    ellInit(&pool->allJobs);
+    initPoolWorkerKey();
+    pool->created = epicsMonotonicGet();
 
     epicsMutexMustLock(pool->guard);
 
@@ -92,8 +126,7 @@ epicsThreadPool* epicsThreadPoolCreate(epicsThreadPoolConfig *opts)
     return pool;
 
 cleanup:
-    if (pool->workerWakeup)
-        epicsEventDestroy(pool->workerWakeup);
+    freeWorkers(pool);
     if (pool->shutdownEvent)
         epicsEventDestroy(pool->shutdownEvent);
     if (pool->observerWakeup)
@@ -112,38 +145,19 @@ void epicsThreadPoolControlImpl(epicsThreadPool *pool, epicsThreadPoolOption opt
         return;
 
     if (opt == epicsThreadPoolQueueAdd) {
-        pool->pauseadd = !val;
+        epicsAtomicSetIntT(&pool->pauseadd, !val);
     }
     else if (opt == epicsThreadPoolQueueRun) {
-        if (!val && !pool->pauserun)
-            pool->pauserun = 1;
-
-        else if (val && pool->pauserun) {
-            int jobs = ellCount(&pool->jobs);
-            pool->pauserun = 0;
-
-            if (jobs) {
-                int wakeable = pool->threadsSleeping - pool->threadsWaking;
-
-                /* first try to give jobs to sleeping workers */
-                if (wakeable) {
-                    int wakeup = jobs > wakeable ? wakeable : jobs;
-                    assert(wakeup > 0);
-                    jobs -= wakeup;
-                    pool->threadsWaking += wakeup;
-                    epicsEventSignal(pool->workerWakeup);
-                    CHECKCOUNT(pool);
-                }
-            }
-            while (jobs-- && pool->threadsRunning < pool->conf.maxThreads) {
-                if (createPoolThread(pool) == 0) {
-                    pool->threadsWaking++;
-                    epicsEventSignal(pool->workerWakeup);
-                }
-                else
-                    break; /* oops, couldn't create worker */
-            }
-            CHECKCOUNT(pool);
+        if (!val) {
+            epicsAtomicSetIntT(&pool->pauserun, 1);
+        }
+        else if (epicsAtomicGetIntT(&pool->pauserun)) {
+            int jobs = epicsAtomicGetIntT(&pool->nQueued);
+
+            epicsAtomicSetIntT(&pool->pauserun, 0);
+            /* give jobs to sleeping workers, or create new ones */
+            if (jobs > 0)
+                wakePoolWorkers(pool, jobs, 0);
         }
     }
     /* unknown options ignored */
@@ -160,11 +174,18 @@ void epicsThreadPoolControl(epicsThreadPool *pool, epicsThreadPoolOption opt, un
 int epicsThreadPoolWait(epicsThreadPool *pool, double timeout)
 {
     int ret = 0;
-    epicsMutexMustLock(pool->guard);
 
-    while (ellCount(&pool->jobs) > 0 || pool->threadsAreAwake > 0) {
-        pool->observerCount++;
-        epicsMutexUnlock(pool->guard);
+    while (1) {
+        /* Count ourselves first, a worker going to sleep after we look
+         * at the counters below will wake us
+         */
+        epicsAtomicIncrIntT(&pool->observerCount);
+
+        if (epicsAtomicGetIntT(&pool->nQueued) == 0 &&
+                epicsAtomicGetIntT(&pool->nAwake) == 0) {
+            epicsAtomicDecrIntT(&pool->observerCount);
+            break;
+        }
 
         if (timeout < 0.0) {
             epicsEventMustWait(pool->observerWakeup);
@@ -183,23 +204,20 @@ int epicsThreadPoolWait(epicsThreadPool *pool, double timeout)
             }
         }
 
-        epicsMutexMustLock(pool->guard);
-        pool->observerCount--;
-
-        if (pool->observerCount)
+        if (epicsAtomicDecrIntT(&pool->observerCount))
             epicsEventSignal(pool->observerWakeup);
 
         if (ret != 0)
             break;
     }
 
-    epicsMutexUnlock(pool->guard);
     return ret;
 }
 
 void epicsThreadPoolDestroy(epicsThreadPool *pool)
 {
     unsigned int nThr;
+    int i, nStarted;
     ELLLIST notify;
     ELLNODE *cur;
 
@@ -221,18 +239,14 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
     epicsThreadPoolWait(pool, -1.0);
     /* At this point all queued jobs have run */
 
-    epicsMutexMustLock(pool->guard);
-
-    pool->shutdown = 1;
+    epicsAtomicSetIntT(&pool->shutdown, 1);
     /* wakeup all */
-    if (pool->threadsWaking < pool->threadsSleeping) {
-        pool->threadsWaking = pool->threadsSleeping;
-        epicsEventSignal(pool->workerWakeup);
-    }
-
-    ellConcat(&notify, &pool->owned);
-    ellConcat(&notify, &pool->jobs);
+    nStarted = epicsAtomicGetIntT(&pool->nStarted);
+    for (i = 0; i < nStarted; i++)
+        epicsEventSignal(pool->workers[i].wake);
 
+    epicsMutexMustLock(pool->guard);
+    ellConcat(&notify, &pool->allJobs);
     epicsMutexUnlock(pool->guard);
 
     if (nThr && epicsEventWait(pool->shutdownEvent) != epicsEventWaitOK){
@@ -249,13 +263,16 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
         job->running = 1;
         job->func(job->arg, epicsJobModeCleanup);
         job->running = 0;
-        if (job->freewhendone)
+        if (job->freewhendone) {
+            job->dead = 1;
+            epicsSpinDestroy(job->lock);
             free(job);
+        }
         else
             job->pool = NULL; /* orphan */
     }
 
-    epicsEventDestroy(pool->workerWakeup);
+    freeWorkers(pool);
     epicsEventDestroy(pool->shutdownEvent);
     epicsEventDestroy(pool->observerWakeup);
     epicsMutexDestroy(pool->guard);
@@ -267,24 +284,66 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
 void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd)
 {
     ELLNODE *cur;
+    double uptime = (epicsMonotonicGet() - pool->created) * 1e-9;
+    size_t nRun = 0, nStolen = 0;
+    epicsUInt64 waitTotal = 0, waitMax = 0;
+    int i, nStarted;
+
     epicsMutexMustLock(pool->guard);
 
     fprintf(fd, "Thread Pool with %u/%u threads\n"
-            " running %d jobs with %u threads\n",
+            " running %d jobs with %d threads\n",
             pool->threadsRunning,
             pool->conf.maxThreads,
-            ellCount(&pool->jobs),
-            pool->threadsAreAwake);
-    if (pool->pauseadd)
+            epicsAtomicGetIntT(&pool->nQueued),
+            epicsAtomicGetIntT(&pool->nAwake));
+    if (epicsAtomicGetIntT(&pool->pauseadd))
         fprintf(fd, "  Inhibit queueing\n");
-    if (pool->pauserun)
+    if (epicsAtomicGetIntT(&pool->pauserun))
         fprintf(fd, "  Pause workers\n");
-    if (pool->shutdown)
+    if (epicsAtomicGetIntT(&pool->shutdown))
         fprintf(fd, "  Shutdown in progress\n");
 
-    for (cur = ellFirst(&pool->jobs); cur; cur = ellNext(cur)) {
+    /* The counters are read while the workers update them */
+    nStarted = epicsAtomicGetIntT(&pool->nStarted);
+    if (nStarted > 0)
+        fprintf(fd, "  worker  queued        run     stolen"
+                "  wait avg/max us  busy\n");
+    for (i = 0; i < nStarted; i++) {
+        poolWorker *pw = &pool->workers[i];
+        int queued;
+
+        epicsSpinLock(pw->lock);
+        queued = ellCount(&pw->jobs);
+        epicsSpinUnlock(pw->lock);
+
+        fprintf(fd, "  %6d  %6d %10lu %10lu  %7.1f/%7.1f  %3.0f%%%s\n",
+                i, queued,
+                (unsigned long)pw->nRun,
+                (unsigned long)pw->nStolen,
+                pw->nRun ? pw->waitTotal * 1e-3 / pw->nRun : 0.0,
+                pw->waitMax * 1e-3,
+                uptime > 0.0 ? pw->runTotal * 1e-7 / uptime : 0.0,
+                epicsAtomicGetIntT(&pw->idle) ? " idle" : "");
+        nRun += pw->nRun;
+        nStolen += pw->nStolen;
+        waitTotal += pw->waitTotal;
+        if (waitMax < pw->waitMax)
+            waitMax = pw->waitMax;
+    }
+    fprintf(fd, "  %lu jobs run, %.1f per second, %lu stolen,"
+            " waited %.1f us on average and %.1f us at most\n",
+            (unsigned long)nRun,
+            uptime > 0.0 ? nRun / uptime : 0.0,
+            (unsigned long)nStolen,
+            nRun ? waitTotal * 1e-3 / nRun : 0.0,
+            waitMax * 1e-3);
+
+    for (cur = ellFirst(&pool->allJobs); cur; cur = ellNext(cur)) {
         epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
 
+        if (!job->queued && !job->running)
+            continue;
         fprintf(fd, "  job %p func: %p, arg: %p ",
                 job, job->func,
                 job->arg);
@@ -294,6 +353,8 @@ void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd)
             fprintf(fd, "Running ");
         if (job->freewhendone)
             fprintf(fd, "Free ");
+        if (job->affinity >= 0)
+            fprintf(fd, "Worker %d ", job->affinity);
         fprintf(fd, "\n");
     }
 
@@ -35,13 +35,22 @@ template class tsFreeList < timer, 0x20 >;
 #endif
 
 timer::timer ( timerQueue & queueIn ) :
-    queue ( queueIn ), curState ( stateLimbo ), pNotify ( 0 )
+    queue ( queueIn ), curState ( stateLimbo ), pNotify ( 0 ),
+    heapIndex ( 0u ), seq ( 0u )
 {
+    // make room in the heap now so that start() never allocates
+    epicsGuard < epicsMutex > locker ( this->queue.mutex );
+    if ( this->queue.nTimers >= this->queue.heap.capacity () ) {
+        this->queue.heap.reserve ( 2u * this->queue.nTimers + 16u );
+    }
+    this->queue.nTimers++;
 }
 
 timer::~timer ()
 {
     this->cancel ();
+    epicsGuard < epicsMutex > locker ( this->queue.mutex );
+    this->queue.nTimers--;
 }
 
 void timer::destroy ()
@@ -74,45 +83,17 @@ void timer::privateStart ( epicsTimerNotify & notify, const epicsTime & expire )
         return;
     }
     else if ( this->curState == statePending ) {
-        this->queue.timerList.remove ( *this );
-        if ( this->queue.timerList.first() == this &&
-                this->queue.timerList.count() > 0 ) {
-            reschedualNeeded = true;
-        }
+        this->queue.remove ( *this );
     }
 
-#   ifdef DEBUG
-        unsigned preemptCount=0u;
-#   endif
-
-    //
-    // insert into the pending queue
     //
-    // Finds proper time sorted location using a linear search.
+    // insert into the pending queue, timers with the same expiration
+    // time expire in the order they were started
     //
-    // **** this should use a binary tree ????
-    //
-    tsDLIter < timer > pTmr = this->queue.timerList.lastIter ();
-    while ( true ) {
-        if ( ! pTmr.valid () ) {
-            //
-            // add to the beginning of the list
-            //
-            this->queue.timerList.push ( *this );
-            reschedualNeeded = true;
-            break;
-        }
-        if ( pTmr->exp <= this->exp ) {
-            //
-            // add after the item found that expires earlier
-            //
-            this->queue.timerList.insertAfter ( *this, *pTmr );
-            break;
-        }
-#       ifdef DEBUG
-            preemptCount++;
-#       endif
-        --pTmr;
+    this->seq = this->queue.nStarts++;
+    this->queue.insert ( *this );
+    if ( this->queue.first () == this ) {
+        reschedualNeeded = true;
     }
 
     this->curState = timer::statePending;
@@ -126,26 +107,20 @@ void timer::privateStart ( epicsTimerNotify & notify, const epicsTime & expire )
         this->queue.show ( 10u );
 #   endif
 
-    debugPrintf ( ("Start of \"%s\" with delay %f at %p preempting %u\n",
+    debugPrintf ( ("Start of \"%s\" with delay %f at %p\n",
         typeid ( this->pNotify ).name (),
-        expire - epicsTime::getCurrent (), 
-        this, preemptCount ) );
+        expire - epicsTime::getCurrent (), this ) );
 }
 
 void timer::cancel ()
 {
-    bool reschedual = false;
     bool wakeupCancelBlockingThreads = false;
     {
         epicsGuard < epicsMutex > locker ( this->queue.mutex );
         this->pNotify = 0;
         if ( this->curState == statePending ) {
-            this->queue.timerList.remove ( *this );
+            this->queue.remove ( *this );
             this->curState = stateLimbo;
-            if ( this->queue.timerList.first() == this &&
-                    this->queue.timerList.count() > 0 ) {
-                reschedual = true;
-            }
         }
         else if ( this->curState == stateActive ) {
             this->queue.cancelPending = true;
@@ -163,9 +138,6 @@ void timer::cancel ()
             }
         }
     }
-    if ( reschedual ) {
-        this->queue.notify.reschedule ();
-    }
     if ( wakeupCancelBlockingThreads ) {
         this->queue.cancelBlockingEvent.signal ();
     }
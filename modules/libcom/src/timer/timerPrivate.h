@@ -17,7 +17,9 @@
 #define epicsTimerPrivate_h
 
 #include <typeinfo>
+#include <vector>
 
+#include "epicsTypes.h"
 #include "tsFreeList.h"
 #include "epicsSingleton.h"
 #include "tsDLList.h"
@@ -37,7 +39,7 @@
 
 template < class T > class epicsGuard;
 
-class timer : public epicsTimer, public tsDLNode < timer > {
+class timer : public epicsTimer {
 public:
     void destroy () override;
     void start ( class epicsTimerNotify &, const epicsTime & ) override final;
@@ -56,7 +58,10 @@ private:
     epicsTime exp; // expiration time
     state curState; // current state
     epicsTimerNotify * pNotify; // callback
+    unsigned heapIndex; // position in the queue's heap while pending
+    epicsUInt64 seq; // orders timers with the same expiration time
     void privateStart ( epicsTimerNotify & notify, const epicsTime & );
+    bool expiresBefore ( const timer & ) const;
     timer & operator = ( const timer & );
     // Visual C++ .net appears to require operator delete if
     // placement operator delete is defined? I smell a ms rat
@@ -104,7 +109,10 @@ private:
     tsFreeList < epicsTimerForC, 0x20 > timerForCFreeList;
     mutable epicsMutex mutex;
     epicsEvent cancelBlockingEvent;
-    tsDLList < timer > timerList;
+    // pending timers, a binary heap ordered by expiration time
+    std::vector < timer * > heap;
+    unsigned nTimers; // timers created, the heap has room for them all
+    epicsUInt64 nStarts;
     epicsTimerQueueNotify & notify;
     timer * pExpireTmr;
     epicsThreadId processThread;
@@ -113,6 +121,11 @@ private:
     static const double exceptMsgMinPeriod;
     void printExceptMsg ( const char * pName,
                 const type_info & type );
+    timer * first () const;
+    void insert ( timer & );
+    void remove ( timer & );
+    void siftUp ( unsigned index );
+    void siftDown ( unsigned index );
     timerQueue ( const timerQueue & );
     timerQueue & operator = ( const timerQueue & );
     friend class timer;
@@ -236,6 +249,19 @@ inline bool timerQueueActive::sharingOK () const
     return this->okToShare;
 }
 
+inline bool timer::expiresBefore ( const timer & other ) const
+{
+    if ( this->exp == other.exp ) {
+        return this->seq < other.seq;
+    }
+    return this->exp < other.exp;
+}
+
+inline timer * timerQueue::first () const
+{
+    return this->heap.empty () ? 0 : this->heap.front ();
+}
+
 inline unsigned timerQueueActive::threadPriority () const
 {
     return thread.getPriority ();
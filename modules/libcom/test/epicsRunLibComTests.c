@@ -50,6 +50,7 @@ int epicsTimeZoneTest(void);
 #endif
 int epicsTypesTest(void);
 int epicsInlineTest(void);
+int freeListTest(void);
 int initHookTest(void);
 int ipAddrToAsciiTest(void);
 int macDefExpandTest(void);
@@ -106,6 +107,7 @@ void epicsRunLibComTests(void)
     runTest(epicsTimeZoneTest);
 #endif
     runTest(epicsTypesTest);
+    runTest(freeListTest);
     runTest(initHookTest);
     runTest(ipAddrToAsciiTest);
     runTest(macDefExpandTest);
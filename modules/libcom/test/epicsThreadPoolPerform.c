@@ -0,0 +1,113 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Throughput and queueing latency of fine-grained thread pool jobs */
+
+#include <stdlib.h>
+
+#include "epicsThreadPool.h"
+
+/* included to read the worker counters */
+#include "../../src/pool/poolPriv.h"
+
+#include "epicsAtomic.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+#define NJOBS 10000
+#define NROUNDS 10
+
+static volatile double sink;
+
+/* A job of about a microsecond */
+static void work(void *arg, epicsJobMode mode)
+{
+    double x = 1.0;
+    int i;
+
+    if (mode != epicsJobModeRun)
+        return;
+    for (i = 0; i < 200; i++)
+        x = x * 1.000001 + 0.5;
+    sink = x;
+    epicsAtomicIncrIntT((int *) arg);
+}
+
+static void measure(unsigned nThreads, int many)
+{
+    epicsThreadPoolConfig conf;
+    epicsThreadPool *pool;
+    epicsJob **jobs;
+    epicsTimeStamp start, end;
+    epicsUInt64 waitTotal = 0, waitMax = 0;
+    size_t nRun = 0, nStolen = 0;
+    int count = 0;
+    unsigned i, r;
+    double sec;
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.initialThreads = nThreads;
+    conf.maxThreads = nThreads;
+    pool = epicsThreadPoolCreate(&conf);
+    jobs = calloc(NJOBS, sizeof(*jobs));
+    if (!pool || !jobs) {
+        testAbort("Can't create a pool of %u threads", nThreads);
+        return;
+    }
+    for (i = 0; i < NJOBS; i++)
+        jobs[i] = epicsJobCreate(pool, &work, &count);
+
+    epicsTimeGetCurrent(&start);
+    for (r = 0; r < NROUNDS; r++) {
+        if (many) {
+            epicsJobQueueMany(jobs, NJOBS);
+        }
+        else {
+            for (i = 0; i < NJOBS; i++)
+                epicsJobQueue(jobs[i]);
+        }
+        epicsThreadPoolWait(pool, -1.0);
+    }
+    epicsTimeGetCurrent(&end);
+    sec = epicsTimeDiffInSeconds(&end, &start);
+
+    for (i = 0; i < (unsigned) pool->nStarted; i++) {
+        poolWorker *pw = &pool->workers[i];
+
+        nRun += pw->nRun;
+        nStolen += pw->nStolen;
+        waitTotal += pw->waitTotal;
+        if (waitMax < pw->waitMax)
+            waitMax = pw->waitMax;
+    }
+
+    testDiag("%2u threads, %-18s %9.0f jobs/sec, %5.1f%% stolen, "
+        "waited %8.1f us average %9.1f us max",
+        nThreads, many ? "epicsJobQueueMany:" : "epicsJobQueue:",
+        count / sec, nRun ? 100.0 * nStolen / nRun : 0.0,
+        nRun ? waitTotal / 1e3 / nRun : 0.0, waitMax / 1e3);
+
+    for (i = 0; i < NJOBS; i++)
+        epicsJobDestroy(jobs[i]);
+    free(jobs);
+    epicsThreadPoolDestroy(pool);
+}
+
+MAIN(epicsThreadPoolPerform)
+{
+    unsigned ncpus = epicsThreadGetCPUs();
+    unsigned n;
+
+    testPlan(0);
+    testDiag("%u rounds of %u jobs on %u CPUs", NROUNDS, NJOBS, ncpus);
+    for (n = 1; n <= 2 * ncpus && n <= 16; n *= 2) {
+        measure(n, 0);
+        measure(n, 1);
+    }
+    return testDone();
+}
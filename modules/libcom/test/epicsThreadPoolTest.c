@@ -15,6 +15,8 @@
 #include "epicsUnitTest.h"
 
 #include "cantProceed.h"
+#include "dbDefs.h"
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsThread.h"
@@ -421,9 +423,284 @@ void testshared(void)
 
 }
 
+/* Queue many jobs at once, on workers of their choice */
+#define NMANY 100
+
+static int manyRun;
+
+static void manyjob(void *arg, epicsJobMode mode)
+{
+    if(mode==epicsJobModeRun) {
+        epicsAtomicIncrIntT(&manyRun);
+        if(arg)
+            epicsThreadSleep(0.01);
+    }
+}
+
+static size_t poolRuns(epicsThreadPool *pool, size_t *stolen)
+{
+    size_t nrun=0;
+    int i;
+
+    *stolen=0;
+    for(i=0; i<pool->nStarted; i++) {
+        nrun+=pool->workers[i].nRun;
+        *stolen+=pool->workers[i].nStolen;
+    }
+    return nrun;
+}
+
+static
+void testmany(void)
+{
+    epicsThreadPool *poolA, *poolB;
+    epicsThreadPoolConfig conf;
+    epicsJob *jobs[NMANY+1];
+    size_t i, nrun, nstolen;
+
+    testDiag("Queue many jobs at once");
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.maxThreads=4;
+    testOk1((poolA=epicsThreadPoolCreate(&conf))!=NULL);
+    testOk1((poolB=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!poolA || !poolB)
+        return;
+
+    epicsThreadPoolControl(poolA, epicsThreadPoolQueueRun, 0);
+    epicsThreadPoolControl(poolB, epicsThreadPoolQueueRun, 0);
+
+    for(i=0; i<NMANY; i++)
+        jobs[i]=epicsJobCreate(i<NMANY/2 ? poolA : poolB, &manyjob, NULL);
+    /* queueing a job twice is a no-op */
+    jobs[NMANY]=jobs[0];
+
+    manyRun=0;
+    testOk1(epicsJobQueueMany(jobs, NMANY+1)==0);
+    testOk1(poolA->nQueued==NMANY/2);
+    testOk1(poolB->nQueued==NMANY/2);
+    testOk1(manyRun==0);
+
+    epicsThreadPoolControl(poolA, epicsThreadPoolQueueRun, 1);
+    epicsThreadPoolControl(poolB, epicsThreadPoolQueueRun, 1);
+    testOk1(epicsThreadPoolWait(poolA, 5.0)==0);
+    testOk1(epicsThreadPoolWait(poolB, 5.0)==0);
+    testOk(manyRun==NMANY, "%d jobs ran", manyRun);
+    nrun=poolRuns(poolA, &nstolen)+poolRuns(poolB, &nstolen);
+    testOk(nrun==NMANY, "Workers counted %u jobs", (unsigned)nrun);
+
+    for(i=0; i<NMANY; i++)
+        epicsJobDestroy(jobs[i]);
+    epicsThreadPoolDestroy(poolA);
+    epicsThreadPoolDestroy(poolB);
+}
+
+static
+void testaffinity(void)
+{
+    epicsThreadPool *pool;
+    epicsThreadPoolConfig conf;
+    epicsJob *jobs[12];
+    size_t i, nrun, nstolen;
+
+    testDiag("Job affinity, and stealing jobs from a busy worker");
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.initialThreads=3;
+    conf.maxThreads=3;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool)
+        return;
+
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 0);
+
+    jobs[0]=epicsJobCreate(pool, &manyjob, NULL);
+    epicsJobSetAffinity(jobs[0], 1);
+    testOk1(epicsJobQueue(jobs[0])==0);
+    testOk1(jobs[0]->wq==&pool->workers[1]);
+    testOk1(epicsJobUnqueue(jobs[0])==0);
+    testOk1(jobs[0]->wq==NULL);
+
+    epicsJobSetAffinity(jobs[0], 5);
+    testOk1(epicsJobQueue(jobs[0])==0);
+    testOk(jobs[0]->wq==&pool->workers[2], "Affinity taken modulo workers");
+    testOk1(epicsJobUnqueue(jobs[0])==0);
+    epicsJobDestroy(jobs[0]);
+
+    /* slow jobs all for worker 0, which can't run them all by itself */
+    for(i=0; i<NELEMENTS(jobs); i++) {
+        jobs[i]=epicsJobCreate(pool, &manyjob, pool);
+        epicsJobSetAffinity(jobs[i], 0);
+    }
+    manyRun=0;
+    testOk1(epicsJobQueueMany(jobs, NELEMENTS(jobs))==0);
+    testOk1(ellCount(&pool->workers[0].jobs)==NELEMENTS(jobs));
+
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 1);
+    testOk1(epicsThreadPoolWait(pool, 5.0)==0);
+    testOk1(manyRun==NELEMENTS(jobs));
+    nrun=poolRuns(pool, &nstolen);
+    testOk(nrun==NELEMENTS(jobs), "Workers counted %u jobs", (unsigned)nrun);
+    testOk(nstolen>0, "%u jobs were stolen", (unsigned)nstolen);
+    epicsThreadPoolReport(pool, stdout);
+
+    for(i=0; i<NELEMENTS(jobs); i++)
+        epicsJobDestroy(jobs[i]);
+    epicsThreadPoolDestroy(pool);
+}
+
+/* Unqueue, queue again and destroy jobs while workers steal them */
+#define NRACE 8
+#define NRACEROUNDS 20000
+
+static epicsJob *raceShared[NRACE];
+static int raceRun;
+
+static void racejob(void *arg, epicsJobMode mode)
+{
+    if(mode==epicsJobModeRun)
+        epicsAtomicIncrIntT(&raceRun);
+}
+
+/* Runs on workers, so the jobs it queues go on their own queues */
+static void racedriver(void *arg, epicsJobMode mode)
+{
+    unsigned int i;
+
+    if(mode!=epicsJobModeRun)
+        return;
+    for(i=0; i<NRACEROUNDS/4; i++) {
+        epicsJob *job=raceShared[i%NRACE];
+
+        epicsJobQueue(job);
+        if(i%3)
+            epicsJobUnqueue(job);
+        if(i%64==0)
+            epicsThreadSleep(0.0);
+    }
+}
+
+static
+void testrace(void)
+{
+    epicsThreadPool *pool;
+    epicsThreadPoolConfig conf;
+    epicsJob *own[NRACE], *drivers[2];
+    unsigned int i;
+
+    testDiag("Unqueue and queue jobs again while workers steal them");
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.initialThreads=4;
+    conf.maxThreads=4;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool)
+        return;
+
+    raceRun=0;
+    for(i=0; i<NRACE; i++) {
+        raceShared[i]=epicsJobCreate(pool, &racejob, NULL);
+        own[i]=epicsJobCreate(pool, &racejob, NULL);
+    }
+    for(i=0; i<NELEMENTS(drivers); i++) {
+        drivers[i]=epicsJobCreate(pool, &racedriver, NULL);
+        epicsJobQueue(drivers[i]);
+    }
+
+    for(i=0; i<NRACEROUNDS; i++) {
+        epicsJob **pjob=&own[i%NRACE];
+
+        epicsJobQueue(*pjob);
+        epicsJobQueue(raceShared[i%NRACE]);
+        if(i%3) {
+            epicsJobUnqueue(*pjob);
+            epicsJobUnqueue(raceShared[i%NRACE]);
+            epicsJobQueue(*pjob);
+        }
+        if(i%7==0) {
+            /* maybe while a worker holds it */
+            epicsJobDestroy(*pjob);
+            *pjob=epicsJobCreate(pool, &racejob, NULL);
+        }
+        if(i%64==0)
+            epicsThreadSleep(0.0);
+    }
+
+    testOk1(epicsThreadPoolWait(pool, 10.0)==0);
+    testOk(pool->nQueued==0, "No job left queued (%d)", pool->nQueued);
+    testOk(raceRun>0, "%d jobs ran", raceRun);
+
+    for(i=0; i<NRACE; i++) {
+        epicsJobDestroy(raceShared[i]);
+        epicsJobDestroy(own[i]);
+    }
+    for(i=0; i<NELEMENTS(drivers); i++)
+        epicsJobDestroy(drivers[i]);
+    epicsThreadPoolDestroy(pool);
+}
+
+/* Take a job from a run queue as a worker does, but don't run it */
+static epicsJob* takeJob(poolWorker *pw)
+{
+    ELLNODE *cur;
+    epicsJob *job = NULL;
+
+    epicsSpinLock(pw->lock);
+    cur = ellGet(&pw->jobs);
+    if(cur) {
+        job = CONTAINER(cur, epicsJob, queuenode);
+        job->wq = NULL;
+    }
+    epicsSpinUnlock(pw->lock);
+    if(job)
+        epicsAtomicDecrIntT(&pw->pool->nQueued);
+    return job;
+}
+
+static
+void teststale(void)
+{
+    epicsThreadPool *pool;
+    epicsThreadPoolConfig conf;
+    epicsJob *job;
+
+    testDiag("Unqueue a job held by two workers, then destroy it");
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.initialThreads=2;
+    conf.maxThreads=2;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool)
+        return;
+
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 0);
+    testOk1((job=epicsJobCreate(pool, &racejob, NULL))!=NULL);
+
+    epicsJobSetAffinity(job, 0);
+    testOk1(epicsJobQueue(job)==0);
+    testOk1(takeJob(&pool->workers[0])==job);
+    testOk1(epicsJobUnqueue(job)==0);
+    testOk1(job->stale==1);
+
+    epicsJobSetAffinity(job, 1);
+    testOk1(epicsJobQueue(job)==0);
+    testOk1(takeJob(&pool->workers[1])==job);
+    testOk1(epicsJobUnqueue(job)==0);
+    testOk(job->stale==2, "Both workers must drop the job");
+    testOk1(epicsJobMove(job, NULL)==S_pool_jobBusy);
+
+    epicsJobDestroy(job);
+    testOk(!job->dead && job->freewhendone,
+           "Job is freed by the last worker holding it");
+
+    /* The workers never drop it, the pool frees it */
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 1);
+    epicsThreadPoolDestroy(pool);
+}
+
 MAIN(epicsThreadPoolTest)
 {
-    testPlan(171);
+    testPlan(211);
 
     nullop();
     oneop();
@@ -443,6 +720,10 @@ MAIN(epicsThreadPoolTest)
     testreadd();
     testcancel();
     testshared();
+    testmany();
+    testaffinity();
+    testrace();
+    teststale();
 
     return testDone();
 }
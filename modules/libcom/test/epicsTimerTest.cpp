@@ -452,13 +452,141 @@ void testPeriodic ()
     queue.release ();
 }
 
+class scaleNotify : public epicsTimerQueueNotify {
+public:
+    void reschedule () {}
+    double quantum () { return 0.0; }
+};
+
+class orderVerify : public epicsTimerNotify {
+public:
+    orderVerify ( epicsTimerQueue & );
+    void start ( const epicsTime &expireTime );
+    void cancel ();
+    virtual ~orderVerify ();
+    static epicsTime lastExpire;
+    static unsigned nextOrder;
+    static unsigned lastOrder;
+    static unsigned expireCount;
+    static unsigned errorCount;
+private:
+    epicsTimer & timer;
+    epicsTime expireTime;
+    unsigned order;
+    expireStatus expire ( const epicsTime & );
+    orderVerify ( const orderVerify & );
+    orderVerify & operator = ( const orderVerify & );
+};
+
+epicsTime orderVerify::lastExpire;
+unsigned orderVerify::nextOrder;
+unsigned orderVerify::lastOrder;
+unsigned orderVerify::expireCount;
+unsigned orderVerify::errorCount;
+
+orderVerify::orderVerify ( epicsTimerQueue & queueIn ) :
+    timer ( queueIn.createTimer () ), order ( 0u )
+{
+}
+
+orderVerify::~orderVerify ()
+{
+    this->timer.destroy ();
+}
+
+inline void orderVerify::start ( const epicsTime &expireTimeIn )
+{
+    this->expireTime = expireTimeIn;
+    this->order = orderVerify::nextOrder++;
+    this->timer.start ( *this, expireTimeIn );
+}
+
+inline void orderVerify::cancel ()
+{
+    this->timer.cancel ();
+}
+
+epicsTimerNotify::expireStatus orderVerify::expire ( const epicsTime & )
+{
+    // timers expire in time order, those with the same time in the
+    // order they were started
+    if ( orderVerify::expireCount > 0u &&
+            ( this->expireTime < orderVerify::lastExpire ||
+            ( this->expireTime == orderVerify::lastExpire &&
+                this->order < orderVerify::lastOrder ) ) ) {
+        orderVerify::errorCount++;
+    }
+    orderVerify::lastExpire = this->expireTime;
+    orderVerify::lastOrder = this->order;
+    orderVerify::expireCount++;
+    return noRestart;
+}
+
+//
+// time starting, restarting, cancelling and expiring many timers
+//
+void testScaling ( unsigned nTimers )
+{
+    scaleNotify notify;
+    epicsTimerQueuePassive & queue = epicsTimerQueuePassive::create ( notify );
+    orderVerify ** pTimers = new orderVerify * [nTimers];
+    unsigned i, nCancel = 0u;
+
+    testDiag ( "Testing %u timers", nTimers );
+    orderVerify::nextOrder = 0u;
+    orderVerify::expireCount = 0u;
+    orderVerify::errorCount = 0u;
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i] = new orderVerify ( queue );
+    }
+
+    // only 1000 distinct expiration times, so many timers share one
+    epicsTime base = epicsTime::getCurrent () + 10.0;
+    epicsTime t0 = epicsTime::getCurrent ();
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i]->start ( base + ( rand () % 1000 ) * 0.001 );
+    }
+    epicsTime t1 = epicsTime::getCurrent ();
+    for ( i = 0u; i < nTimers / 2u; i++ ) {
+        pTimers[rand () % nTimers]->start ( base + ( rand () % 1000 ) * 0.001 );
+    }
+    epicsTime t2 = epicsTime::getCurrent ();
+    for ( i = 0u; i < nTimers; i += 4u ) {
+        pTimers[i]->cancel ();
+        nCancel++;
+    }
+    epicsTime t3 = epicsTime::getCurrent ();
+    double delay = queue.process ( base + 2.0 );
+    epicsTime t4 = epicsTime::getCurrent ();
+
+    testOk ( orderVerify::expireCount == nTimers - nCancel &&
+        delay == DBL_MAX, "%u of %u timers expired",
+        orderVerify::expireCount, nTimers - nCancel );
+    testOk ( orderVerify::errorCount == 0u,
+        "Timers expired in order (%u errors)", orderVerify::errorCount );
+    testDiag ( "per timer: start %.0f ns, restart %.0f ns, "
+        "cancel %.0f ns, expire %.0f ns",
+        ( t1 - t0 ) * 1e9 / nTimers, ( t2 - t1 ) * 1e9 / ( nTimers / 2u ),
+        ( t3 - t2 ) * 1e9 / nCancel,
+        ( t4 - t3 ) * 1e9 / ( nTimers - nCancel ) );
+
+    for ( i = 0u; i < nTimers; i++ ) {
+        delete pTimers[i];
+    }
+    delete [] pTimers;
+    delete & queue;
+}
+
 MAIN(epicsTimerTest)
 {
-    testPlan(41);
+    testPlan(47);
     testRefCount();
     testAccuracy ();
     testCancel ();
     testExpireDestroy ();
     testPeriodic ();
+    testScaling ( 1000u );
+    testScaling ( 10000u );
+    testScaling ( 100000u );
     return testDone();
 }
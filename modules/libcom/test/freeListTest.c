@@ -0,0 +1,308 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS Base is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Free lists, and the per-thread caches in front of them */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "epicsThread.h"
+#include "epicsEvent.h"
+#include "epicsTime.h"
+#include "freeList.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+#define NMALLOC 16
+#define NTHREADS 4
+#define NBLOCKS 100
+
+typedef struct {
+    double value;
+    void *owner;
+    unsigned seq;
+} block;
+
+typedef struct {
+    void *pfl;
+    unsigned rounds;
+    unsigned errors;
+    block *blocks[NBLOCKS];
+} worker;
+
+static epicsThreadId startWorker(EPICSTHREADFUNC func, worker *pw)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+
+    opts.joinable = 1;
+    return epicsThreadCreateOpt("freeListWorker", func, pw, &opts);
+}
+
+static void testBasic(void)
+{
+    void *pfl;
+    block *blocks[NBLOCKS];
+    size_t avail;
+    unsigned i, j, distinct = 1, zeroed = 1;
+
+    testDiag("Allocate and free on one thread");
+    freeListInitPvt(&pfl, sizeof(block), NMALLOC);
+    testOk1(freeListItemsAvail(pfl) == 0);
+
+    for (i = 0; i < NBLOCKS; i++) {
+        blocks[i] = freeListCalloc(pfl);
+        if (!blocks[i] || blocks[i]->value != 0.0 || blocks[i]->owner)
+            zeroed = 0;
+        if (blocks[i])
+            blocks[i]->owner = blocks;
+    }
+    for (i = 0; i < NBLOCKS; i++)
+        for (j = 0; j < i; j++)
+            if (blocks[i] == blocks[j])
+                distinct = 0;
+    testOk(zeroed, "freeListCalloc() returns zeroed blocks");
+    testOk(distinct, "%u blocks are distinct", NBLOCKS);
+
+    for (i = 0; i < NBLOCKS; i++)
+        freeListFree(pfl, blocks[i]);
+    avail = freeListItemsAvail(pfl);
+    testOk(avail >= NBLOCKS && avail % NMALLOC == 0,
+        "All %u blocks available again", (unsigned) avail);
+
+    for (i = 0; i < NBLOCKS; i++)
+        blocks[i] = freeListCalloc(pfl);
+    testOk(freeListItemsAvail(pfl) == avail - NBLOCKS,
+        "Blocks reused without more allocation");
+    for (i = 0; i < NBLOCKS; i++)
+        freeListFree(pfl, blocks[i]);
+    freeListShow(pfl, 1);
+    freeListCleanup(pfl);
+
+    testDiag("Lists of a few large blocks don't use thread caches");
+    freeListInitPvt(&pfl, 4096, 1);
+    blocks[0] = freeListMalloc(pfl);
+    blocks[1] = freeListMalloc(pfl);
+    testOk(blocks[0] && blocks[1] && blocks[0] != blocks[1] &&
+        freeListItemsAvail(pfl) == 0, "Two single block chunks");
+    freeListFree(pfl, blocks[0]);
+    freeListFree(pfl, blocks[1]);
+    testOk1(freeListItemsAvail(pfl) == 2);
+    freeListCleanup(pfl);
+}
+
+static void churn(void *arg)
+{
+    worker *pw = arg;
+    void *self = epicsThreadGetIdSelf();
+    unsigned r, i;
+
+    for (r = 0; r < pw->rounds; r++) {
+        unsigned n = 1 + r % NBLOCKS;
+
+        for (i = 0; i < n; i++) {
+            block *pb = freeListMalloc(pw->pfl);
+
+            if (!pb) {
+                pw->errors++;
+                n = i;
+                break;
+            }
+            pb->owner = self;
+            pb->seq = r;
+            pw->blocks[i] = pb;
+        }
+        for (i = 0; i < n; i++) {
+            if (pw->blocks[i]->owner != self || pw->blocks[i]->seq != r)
+                pw->errors++;
+            freeListFree(pw->pfl, pw->blocks[i]);
+        }
+    }
+}
+
+static void allocOnly(void *arg)
+{
+    worker *pw = arg;
+    unsigned i;
+
+    for (i = 0; i < NBLOCKS; i++)
+        pw->blocks[i] = freeListMalloc(pw->pfl);
+}
+
+static void freeOnly(void *arg)
+{
+    worker *pw = arg;
+    unsigned i;
+
+    for (i = 0; i < NBLOCKS; i++)
+        freeListFree(pw->pfl, pw->blocks[i]);
+}
+
+static void testThreads(void)
+{
+    void *pfl;
+    worker workers[NTHREADS];
+    epicsThreadId tids[NTHREADS];
+    epicsTimeStamp start, end;
+    size_t avail;
+    unsigned i, errors = 0;
+
+    testDiag("Allocate and free on %u threads", NTHREADS);
+    freeListInitPvt(&pfl, sizeof(block), NMALLOC);
+    memset(workers, 0, sizeof(workers));
+    epicsTimeGetCurrent(&start);
+    for (i = 0; i < NTHREADS; i++) {
+        workers[i].pfl = pfl;
+        workers[i].rounds = 20000;
+        tids[i] = startWorker(churn, &workers[i]);
+    }
+    for (i = 0; i < NTHREADS; i++) {
+        epicsThreadMustJoin(tids[i]);
+        errors += workers[i].errors;
+    }
+    epicsTimeGetCurrent(&end);
+    testOk(errors == 0, "No block was handed out twice (%u errors)", errors);
+    testDiag("%u threads took %.3f sec", NTHREADS,
+        epicsTimeDiffInSeconds(&end, &start));
+
+    avail = freeListItemsAvail(pfl);
+    testOk(avail >= NBLOCKS && avail % NMALLOC == 0,
+        "Exited threads returned their blocks, %u available", (unsigned) avail);
+
+    testDiag("Free blocks on another thread than allocated them");
+    workers[0].pfl = pfl;
+    epicsThreadMustJoin(startWorker(allocOnly, &workers[0]));
+    for (i = 0; i < NBLOCKS; i++)
+        if (!workers[0].blocks[i])
+            errors++;
+    testOk(errors == 0, "Allocated %u blocks", NBLOCKS);
+    epicsThreadMustJoin(startWorker(freeOnly, &workers[0]));
+    testOk(freeListItemsAvail(pfl) == avail, "All blocks returned");
+    freeListCleanup(pfl);
+}
+
+static void useLists(void *arg)
+{
+    void **lists = arg;
+    unsigned i, j;
+
+    for (i = 0; lists[i]; i++) {
+        void *blocks[NMALLOC];
+
+        for (j = 0; j < NMALLOC; j++)
+            blocks[j] = freeListMalloc(lists[i]);
+        for (j = 0; j < NMALLOC; j++)
+            freeListFree(lists[i], blocks[j]);
+    }
+}
+
+typedef struct {
+    void **lists;
+    epicsEventId go;
+    epicsEventId used;
+} listUser;
+
+/* Uses the lists whenever told to, keeping blocks in its magazines */
+static void listUserThread(void *arg)
+{
+    listUser *pu = arg;
+
+    while (1) {
+        epicsEventMustWait(pu->go);
+        if (!pu->lists)
+            break;
+        useLists(pu->lists);
+        epicsEventMustTrigger(pu->used);
+    }
+}
+
+static void useListsOn(listUser *pu, void **lists)
+{
+    pu->lists = lists;
+    epicsEventMustTrigger(pu->go);
+    if (lists)
+        epicsEventMustWait(pu->used);
+}
+
+static void testCleanup(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    epicsThreadId tid;
+    listUser user;
+    void *lists[65];
+    unsigned i;
+    size_t avail = 0;
+
+    testDiag("Clean up lists which threads still cache blocks of");
+    user.go = epicsEventMustCreate(epicsEventEmpty);
+    user.used = epicsEventMustCreate(epicsEventEmpty);
+    opts.joinable = 1;
+    tid = epicsThreadCreateOpt("freeListUser", listUserThread, &user, &opts);
+
+    for (i = 0; i < 32; i++)
+        freeListInitPvt(&lists[i], sizeof(block), NMALLOC);
+    lists[32] = NULL;
+    useLists(lists);
+    useListsOn(&user, lists);
+    for (i = 0; i < 32; i++)
+        freeListCleanup(lists[i]);
+
+    /* Half of these get the magazine slots of the lists cleaned up */
+    for (i = 0; i < 64; i++)
+        freeListInitPvt(&lists[i], sizeof(block), NMALLOC);
+    lists[64] = NULL;
+    useLists(lists);
+    useListsOn(&user, lists);
+    for (i = 0; i < 64; i++) {
+        avail += freeListItemsAvail(lists[i]);
+        freeListCleanup(lists[i]);
+    }
+    testOk(avail == 64 * NMALLOC, "%u blocks available in 64 lists",
+        (unsigned) avail);
+
+    /* Its magazines of the lists cleaned up are empty as it exits */
+    useListsOn(&user, NULL);
+    epicsThreadMustJoin(tid);
+    epicsEventDestroy(user.go);
+    epicsEventDestroy(user.used);
+}
+
+static void testBypass(void)
+{
+    int saved = freeListBypass;
+    void *pfl;
+    block *pb;
+
+    testDiag("freeListBypass");
+    freeListBypass = 1;
+    freeListInitPvt(&pfl, sizeof(block), NMALLOC);
+    freeListBypass = saved;
+    pb = freeListCalloc(pfl);
+    testOk(pb && pb->owner == NULL, "Bypassed list allocates");
+    freeListFree(pfl, pb);
+    testOk1(freeListItemsAvail(pfl) == 0);
+    freeListCleanup(pfl);
+}
+
+MAIN(freeListTest)
+{
+    void *pfl;
+
+    testPlan(14);
+
+    /* Resolves freeListBypass from $EPICS_FREELIST_BYPASS */
+    freeListInitPvt(&pfl, sizeof(block), NMALLOC);
+    freeListCleanup(pfl);
+    if (freeListBypass) {
+        testSkip(12, "EPICS_FREELIST_BYPASS is set");
+    }
+    else {
+        testBasic();
+        testThreads();
+        testCleanup();
+    }
+    testBypass();
+    return testDone();
+}